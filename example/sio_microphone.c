@@ -13,7 +13,7 @@
 #include <string.h>
 #include <math.h>
 
-struct SoundIoRingBuffer *ring_buffer = NULL;
+struct SoundIoBridge *bridge = NULL;
 
 static enum SoundIoFormat prioritized_formats[] = {
     SoundIoFormatFloat32NE,
@@ -22,6 +22,8 @@ static enum SoundIoFormat prioritized_formats[] = {
     SoundIoFormatS32FE,
     SoundIoFormatS24NE,
     SoundIoFormatS24FE,
+    SoundIoFormatS24PackedNE,
+    SoundIoFormatS24PackedFE,
     SoundIoFormatS16NE,
     SoundIoFormatS16FE,
     SoundIoFormatFloat64NE,
@@ -30,6 +32,8 @@ static enum SoundIoFormat prioritized_formats[] = {
     SoundIoFormatU32FE,
     SoundIoFormatU24NE,
     SoundIoFormatU24FE,
+    SoundIoFormatU24PackedNE,
+    SoundIoFormatU24PackedFE,
     SoundIoFormatU16NE,
     SoundIoFormatU16FE,
     SoundIoFormatS8,
@@ -58,119 +62,16 @@ static void panic(const char *format, ...) {
     abort();
 }
 
-static int min_int(int a, int b) {
-    return (a < b) ? a : b;
-}
-
 static void read_callback(struct SoundIoInStream *instream, int frame_count_min, int frame_count_max) {
-    struct SoundIoChannelArea *areas;
     int err;
-    char *write_ptr = soundio_ring_buffer_write_ptr(ring_buffer);
-    int free_bytes = soundio_ring_buffer_free_count(ring_buffer);
-    int free_count = free_bytes / instream->bytes_per_frame;
-
-    if (frame_count_min > free_count)
-        panic("ring buffer overflow");
-
-    int write_frames = min_int(free_count, frame_count_max);
-    int frames_left = write_frames;
-
-    for (;;) {
-        int frame_count = frames_left;
-
-        if ((err = soundio_instream_begin_read(instream, &areas, &frame_count)))
-            panic("begin read error: %s", soundio_strerror(err));
-
-        if (!frame_count)
-            break;
-
-        if (!areas) {
-            // Due to an overflow there is a hole. Fill the ring buffer with
-            // silence for the size of the hole.
-            memset(write_ptr, 0, frame_count * instream->bytes_per_frame);
-            fprintf(stderr, "Dropped %d frames due to internal overflow\n", frame_count);
-        } else {
-            for (int frame = 0; frame < frame_count; frame += 1) {
-                for (int ch = 0; ch < instream->layout.channel_count; ch += 1) {
-                    memcpy(write_ptr, areas[ch].ptr, instream->bytes_per_sample);
-                    areas[ch].ptr += areas[ch].step;
-                    write_ptr += instream->bytes_per_sample;
-                }
-            }
-        }
-
-        if ((err = soundio_instream_end_read(instream)))
-            panic("end read error: %s", soundio_strerror(err));
-
-        frames_left -= frame_count;
-        if (frames_left <= 0)
-            break;
-    }
-
-    int advance_bytes = write_frames * instream->bytes_per_frame;
-    soundio_ring_buffer_advance_write_ptr(ring_buffer, advance_bytes);
+    if ((err = soundio_bridge_read(bridge, frame_count_min, frame_count_max)))
+        panic("read error: %s", soundio_strerror(err));
 }
 
 static void write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
-    struct SoundIoChannelArea *areas;
-    int frames_left;
-    int frame_count;
     int err;
-
-    char *read_ptr = soundio_ring_buffer_read_ptr(ring_buffer);
-    int fill_bytes = soundio_ring_buffer_fill_count(ring_buffer);
-    int fill_count = fill_bytes / outstream->bytes_per_frame;
-
-    if (frame_count_min > fill_count) {
-        // Ring buffer does not have enough data, fill with zeroes.
-        frames_left = frame_count_min;
-        for (;;) {
-            frame_count = frames_left;
-            if (frame_count <= 0)
-              return;
-            if ((err = soundio_outstream_begin_write(outstream, &areas, &frame_count)))
-                panic("begin write error: %s", soundio_strerror(err));
-            if (frame_count <= 0)
-                return;
-            for (int frame = 0; frame < frame_count; frame += 1) {
-                for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
-                    memset(areas[ch].ptr, 0, outstream->bytes_per_sample);
-                    areas[ch].ptr += areas[ch].step;
-                }
-            }
-            if ((err = soundio_outstream_end_write(outstream)))
-                panic("end write error: %s", soundio_strerror(err));
-            frames_left -= frame_count;
-        }
-    }
-
-    int read_count = min_int(frame_count_max, fill_count);
-    frames_left = read_count;
-
-    while (frames_left > 0) {
-        int frame_count = frames_left;
-
-        if ((err = soundio_outstream_begin_write(outstream, &areas, &frame_count)))
-            panic("begin write error: %s", soundio_strerror(err));
-
-        if (frame_count <= 0)
-            break;
-
-        for (int frame = 0; frame < frame_count; frame += 1) {
-            for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
-                memcpy(areas[ch].ptr, read_ptr, outstream->bytes_per_sample);
-                areas[ch].ptr += areas[ch].step;
-                read_ptr += outstream->bytes_per_sample;
-            }
-        }
-
-        if ((err = soundio_outstream_end_write(outstream)))
-            panic("end write error: %s", soundio_strerror(err));
-
-        frames_left -= frame_count;
-    }
-
-    soundio_ring_buffer_advance_read_ptr(ring_buffer, read_count * outstream->bytes_per_frame);
+    if ((err = soundio_bridge_write(bridge, frame_count_min, frame_count_max)))
+        panic("write error: %s", soundio_strerror(err));
 }
 
 static void underflow_callback(struct SoundIoOutStream *outstream) {
@@ -363,14 +264,8 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    int capacity = microphone_latency * 2 * instream->sample_rate * instream->bytes_per_frame;
-    ring_buffer = soundio_ring_buffer_create(soundio, capacity);
-    if (!ring_buffer)
-        panic("unable to create ring buffer: out of memory");
-    char *buf = soundio_ring_buffer_write_ptr(ring_buffer);
-    int fill_count = microphone_latency * outstream->sample_rate * outstream->bytes_per_frame;
-    memset(buf, 0, fill_count);
-    soundio_ring_buffer_advance_write_ptr(ring_buffer, fill_count);
+    if ((err = soundio_bridge_create(instream, outstream, microphone_latency, &bridge)))
+        panic("unable to create bridge: %s", soundio_strerror(err));
 
     if ((err = soundio_instream_start(instream)))
         panic("unable to start input device: %s", soundio_strerror(err));
@@ -383,6 +278,7 @@ int main(int argc, char **argv) {
 
     soundio_outstream_destroy(outstream);
     soundio_instream_destroy(instream);
+    soundio_bridge_destroy(bridge);
     soundio_device_unref(in_device);
     soundio_device_unref(out_device);
     soundio_destroy(soundio);
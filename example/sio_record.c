@@ -12,7 +12,6 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
-#include <unistd.h>
 
 struct RecordContext {
     struct SoundIoRingBuffer *ring_buffer;
@@ -25,6 +24,8 @@ static enum SoundIoFormat prioritized_formats[] = {
     SoundIoFormatS32FE,
     SoundIoFormatS24NE,
     SoundIoFormatS24FE,
+    SoundIoFormatS24PackedNE,
+    SoundIoFormatS24PackedFE,
     SoundIoFormatS16NE,
     SoundIoFormatS16FE,
     SoundIoFormatFloat64NE,
@@ -33,6 +34,8 @@ static enum SoundIoFormat prioritized_formats[] = {
     SoundIoFormatU32FE,
     SoundIoFormatU24NE,
     SoundIoFormatU24FE,
+    SoundIoFormatU24PackedNE,
+    SoundIoFormatU24PackedFE,
     SoundIoFormatU16NE,
     SoundIoFormatU16FE,
     SoundIoFormatS8,
@@ -48,25 +51,22 @@ static int prioritized_sample_rates[] = {
     0,
 };
 
-static int min_int(int a, int b) {
-    return (a < b) ? a : b;
-}
-
 static void read_callback(struct SoundIoInStream *instream, int frame_count_min, int frame_count_max) {
     struct RecordContext *rc = instream->userdata;
     struct SoundIoChannelArea *areas;
     int err;
 
-    char *write_ptr = soundio_ring_buffer_write_ptr(rc->ring_buffer);
-    int free_bytes = soundio_ring_buffer_free_count(rc->ring_buffer);
-    int free_count = free_bytes / instream->bytes_per_frame;
+    char *write_ptr;
+    int free_bytes;
+    soundio_ring_buffer_reserve_write(rc->ring_buffer, frame_count_min * instream->bytes_per_frame,
+            frame_count_max * instream->bytes_per_frame, &write_ptr, &free_bytes);
 
-    if (free_count < frame_count_min) {
+    if (frame_count_min > 0 && !free_bytes) {
         fprintf(stderr, "ring buffer overflow\n");
         exit(1);
     }
 
-    int write_frames = min_int(free_count, frame_count_max);
+    int write_frames = free_bytes / instream->bytes_per_frame;
     int frames_left = write_frames;
 
     for (;;) {
@@ -104,8 +104,7 @@ static void read_callback(struct SoundIoInStream *instream, int frame_count_min,
             break;
     }
 
-    int advance_bytes = write_frames * instream->bytes_per_frame;
-    soundio_ring_buffer_advance_write_ptr(rc->ring_buffer, advance_bytes);
+    soundio_ring_buffer_commit_write(rc->ring_buffer, write_frames * instream->bytes_per_frame);
 }
 
 static void overflow_callback(struct SoundIoInStream *instream) {
@@ -266,7 +265,7 @@ int main(int argc, char **argv) {
 
     const int ring_buffer_duration_seconds = 30;
     int capacity = ring_buffer_duration_seconds * instream->sample_rate * instream->bytes_per_frame;
-    rc.ring_buffer = soundio_ring_buffer_create(soundio, capacity);
+    rc.ring_buffer = soundio_ring_buffer_create_flags(soundio, capacity, SoundIoRingBufferFlagWakeup);
     if (!rc.ring_buffer) {
         fprintf(stderr, "out of memory\n");
         return 1;
@@ -277,20 +276,25 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    // Write to disk in chunks of a tenth of a second, but flush events at least
+    // once a second even if the device stops delivering data.
     // Note: in this example, if you send SIGINT (by pressing Ctrl+C for example)
-    // you will lose up to 1 second of recorded audio data. In non-example code,
-    // consider a better shutdown strategy.
+    // you will lose up to a tenth of a second of recorded audio data. In
+    // non-example code, consider a better shutdown strategy.
+    int chunk_bytes = instream->sample_rate / 10 * instream->bytes_per_frame;
     for (;;) {
         soundio_flush_events(soundio);
-        sleep(1);
-        int fill_bytes = soundio_ring_buffer_fill_count(rc.ring_buffer);
-        char *read_buf = soundio_ring_buffer_read_ptr(rc.ring_buffer);
+        soundio_ring_buffer_wait(rc.ring_buffer, chunk_bytes, 1.0);
+        char *read_buf;
+        int fill_bytes;
+        soundio_ring_buffer_reserve_read(rc.ring_buffer, 0,
+                soundio_ring_buffer_capacity(rc.ring_buffer), &read_buf, &fill_bytes);
         size_t amt = fwrite(read_buf, 1, fill_bytes, out_f);
         if ((int)amt != fill_bytes) {
             fprintf(stderr, "write error: %s\n", strerror(errno));
             return 1;
         }
-        soundio_ring_buffer_advance_read_ptr(rc.ring_buffer, fill_bytes);
+        soundio_ring_buffer_commit_read(rc.ring_buffer, fill_bytes);
     }
 
     soundio_instream_destroy(instream);
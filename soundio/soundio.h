@@ -10,6 +10,7 @@
 
 #include "endian.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 /// \cond
 #ifdef __cplusplus
@@ -100,6 +101,9 @@ enum SoundIoError {
     SoundIoErrorUnderflow,
     /// Unable to convert to or from UTF-8 to the native string format.
     SoundIoErrorEncodingString,
+    /// Buffer overrun occurred: a reader fell behind and data it had not
+    /// read yet was overwritten.
+    SoundIoErrorOverflow,
 };
 
 /// Specifies where a channel is physically located.
@@ -252,6 +256,10 @@ enum SoundIoFormat {
     SoundIoFormatFloat32BE, ///< Float 32 bit Big Endian, Range -1.0 to 1.0
     SoundIoFormatFloat64LE, ///< Float 64 bit Little Endian, Range -1.0 to 1.0
     SoundIoFormatFloat64BE, ///< Float 64 bit Big Endian, Range -1.0 to 1.0
+    SoundIoFormatS24PackedLE, ///< Signed 24 bit Little Endian packed in three bytes
+    SoundIoFormatS24PackedBE, ///< Signed 24 bit Big Endian packed in three bytes
+    SoundIoFormatU24PackedLE, ///< Unsigned 24 bit Little Endian packed in three bytes
+    SoundIoFormatU24PackedBE, ///< Unsigned 24 bit Big Endian packed in three bytes
 };
 
 #if defined(SOUNDIO_OS_BIG_ENDIAN)
@@ -259,6 +267,8 @@ enum SoundIoFormat {
 #define SoundIoFormatU16NE SoundIoFormatU16BE
 #define SoundIoFormatS24NE SoundIoFormatS24BE
 #define SoundIoFormatU24NE SoundIoFormatU24BE
+#define SoundIoFormatS24PackedNE SoundIoFormatS24PackedBE
+#define SoundIoFormatU24PackedNE SoundIoFormatU24PackedBE
 #define SoundIoFormatS32NE SoundIoFormatS32BE
 #define SoundIoFormatU32NE SoundIoFormatU32BE
 #define SoundIoFormatFloat32NE SoundIoFormatFloat32BE
@@ -268,6 +278,8 @@ enum SoundIoFormat {
 #define SoundIoFormatU16FE SoundIoFormatU16LE
 #define SoundIoFormatS24FE SoundIoFormatS24LE
 #define SoundIoFormatU24FE SoundIoFormatU24LE
+#define SoundIoFormatS24PackedFE SoundIoFormatS24PackedLE
+#define SoundIoFormatU24PackedFE SoundIoFormatU24PackedLE
 #define SoundIoFormatS32FE SoundIoFormatS32LE
 #define SoundIoFormatU32FE SoundIoFormatU32LE
 #define SoundIoFormatFloat32FE SoundIoFormatFloat32LE
@@ -283,6 +295,8 @@ enum SoundIoFormat {
 #define SoundIoFormatU16NE SoundIoFormatU16LE
 #define SoundIoFormatS24NE SoundIoFormatS24LE
 #define SoundIoFormatU24NE SoundIoFormatU24LE
+#define SoundIoFormatS24PackedNE SoundIoFormatS24PackedLE
+#define SoundIoFormatU24PackedNE SoundIoFormatU24PackedLE
 #define SoundIoFormatS32NE SoundIoFormatS32LE
 #define SoundIoFormatU32NE SoundIoFormatU32LE
 #define SoundIoFormatFloat32NE SoundIoFormatFloat32LE
@@ -292,6 +306,8 @@ enum SoundIoFormat {
 #define SoundIoFormatU16FE SoundIoFormatU16BE
 #define SoundIoFormatS24FE SoundIoFormatS24BE
 #define SoundIoFormatU24FE SoundIoFormatU24BE
+#define SoundIoFormatS24PackedFE SoundIoFormatS24PackedBE
+#define SoundIoFormatU24PackedFE SoundIoFormatU24PackedBE
 #define SoundIoFormatS32FE SoundIoFormatS32BE
 #define SoundIoFormatU32FE SoundIoFormatU32BE
 #define SoundIoFormatFloat32FE SoundIoFormatFloat32BE
@@ -301,6 +317,31 @@ enum SoundIoFormat {
 #error unknown byte order
 #endif
 
+/// Filter lengths for resampling streams, trading CPU time for quality.
+/// See SoundIoOutStream::app_sample_rate.
+enum SoundIoResampleQuality {
+    SoundIoResampleQualityDefault, ///< Same as #SoundIoResampleQualityMedium
+    SoundIoResampleQualityLow,     ///< 8 taps
+    SoundIoResampleQualityMedium,  ///< 16 taps
+    SoundIoResampleQualityHigh,    ///< 32 taps
+    SoundIoResampleQualityBest,    ///< 64 taps
+};
+
+/// How float frames are rounded on their way to an integer format.
+/// See SoundIoOutStream::dither.
+enum SoundIoDither {
+    SoundIoDitherNone,   ///< Round to nearest
+    SoundIoDitherTpdf,   ///< Add triangular noise of 1 LSB first
+    SoundIoDitherShaped, ///< TPDF, with the noise moved up towards Nyquist
+};
+
+/// How software volume moves to a new value.
+/// See SoundIoOutStream::volume_ramp.
+enum SoundIoVolumeRamp {
+    SoundIoVolumeRampLinear,      ///< By the same amount every frame
+    SoundIoVolumeRampExponential, ///< By the same number of dB every frame
+};
+
 #define SOUNDIO_MAX_CHANNELS 24
 /// The size of this struct is OK to use.
 struct SoundIoChannelLayout {
@@ -324,6 +365,21 @@ struct SoundIoChannelArea {
     int step;
 };
 
+/// Levels of each channel of a stream, from ::soundio_outstream_get_meters
+/// or ::soundio_instream_get_meters. The size of this struct is OK to use.
+struct SoundIoMeters {
+    /// How many windows have been measured since the stream was opened.
+    /// The rest describe the latest one, or are 0 before the first.
+    long window_count;
+    int channel_count;
+    /// Largest magnitude of a sample, where 1.0 is full scale.
+    float peak[SOUNDIO_MAX_CHANNELS];
+    /// Root mean square, where 1.0 is full scale.
+    float rms[SOUNDIO_MAX_CHANNELS];
+    /// Samples at or past full scale since the stream was opened.
+    long clip_count[SOUNDIO_MAX_CHANNELS];
+};
+
 /// The size of this struct is not part of the API or ABI.
 struct SoundIo {
     /// Optional. Put whatever you want here. Defaults to NULL.
@@ -381,6 +437,95 @@ struct SoundIo {
     /// Optional: JACK error callback.
     /// See SoundIo::jack_info_callback
     void (*jack_error_callback)(const char *msg);
+
+    /// Optional: Harden memory used by real-time threads against page faults.
+    /// When `true`, every ring buffer created with this SoundIo, including
+    /// the ones backends use internally, has its pages touched and locked into
+    /// RAM up front, and stream threads that libsoundio creates touch and lock
+    /// the top of their stack before the first callback. Locking is best
+    /// effort because it is limited by `RLIMIT_MEMLOCK`. Use
+    /// ::soundio_outstream_get_page_faults to check the effect.
+    /// Set this before opening streams. Defaults to `false`.
+    bool lock_memory;
+
+    /// Optional: Only for #SoundIoBackendDummy. When `true`, streams run on a
+    /// virtual clock instead of the wall clock: as soon as a callback returns,
+    /// the device jumps to the start of the next period, so streams run as
+    /// fast as the application can produce or consume audio. Useful for
+    /// offline rendering and for tests. ::soundio_outstream_get_latency and
+    /// ::soundio_instream_get_latency report virtual time. All streams share
+    /// the one virtual clock, so they stay in step with each other.
+    /// Read by ::soundio_connect. Defaults to `false`.
+    bool dummy_freewheel;
+
+    /// Optional: Only for #SoundIoBackendDummy. When `true`, what the first
+    /// started output stream plays is recorded by the first started input
+    /// stream, SoundIo::dummy_loopback_latency seconds later. The input
+    /// stream then runs on the clock of the output stream, so it records
+    /// nothing while no output stream plays, and the latency is exact to the
+    /// frame. Channels are passed through by index and sample rates are not
+    /// converted, so both streams should use the same one. Without loopback
+    /// the dummy input device records silence.
+    /// Read when a stream is opened. Defaults to `false`.
+    bool dummy_loopback;
+    /// Optional: Seconds between a frame being played and it being recorded
+    /// with SoundIo::dummy_loopback, rounded to whole frames. Must not be
+    /// negative. Defaults to 0.
+    double dummy_loopback_latency;
+
+    /// Optional: Only for #SoundIoBackendDummy. A schedule of faults to
+    /// inject, for testing how an application recovers from them. When
+    /// `NULL`, the `SOUNDIO_DUMMY_FAULTS` environment variable is used
+    /// instead. Items are separated by commas or spaces:
+    /// * `seed=N` - seeds the random jitter, so that runs repeat. Defaults to 1.
+    /// * `jitter=uniform:S` - each wakeup of a stream is up to `S` seconds
+    ///   late, uniformly distributed. Not in freewheel mode.
+    /// * `jitter=exponential:S` - as above, exponentially distributed with
+    ///   a mean of `S` seconds.
+    /// * `underflow@F` - output streams underflow once they have played
+    ///   `F` frames.
+    /// * `overflow@F` - input streams overflow once they have recorded `F`
+    ///   frames.
+    /// * `stall@F:S` - streams stop for `S` seconds once they have played or
+    ///   recorded `F` frames.
+    /// * `remove@S` - `S` seconds after connecting, the devices disappear:
+    ///   streams get #SoundIoErrorStreaming, SoundIo::on_devices_change is
+    ///   called with no devices, followed by SoundIo::on_backend_disconnect
+    ///   with #SoundIoErrorBackendDisconnected.
+    ///
+    /// At most 32 frame faults are allowed. Read by ::soundio_connect, which
+    /// fails with #SoundIoErrorInvalid if the schedule does not parse.
+    const char *dummy_faults;
+
+    /// Optional: Only for #SoundIoBackendDummy. The devices to make up,
+    /// for example to see how an application copes with hundreds of them.
+    /// When `NULL`, the `SOUNDIO_DUMMY_DEVICES` environment variable is used
+    /// instead, and when that is not set either, there is one output device
+    /// and one input device. Devices are separated by semicolons. Each
+    /// starts with `out` or `in`, followed by settings separated by commas
+    /// or spaces:
+    /// * `count=N` - makes `N` devices alike, at most 4096. Defaults to 1.
+    /// * `channels=N` or `channels=MIN-MAX` - the built in channel layouts
+    ///   with that many channels. Defaults to all of them.
+    /// * `formats=A|B|...` - the sample formats, in order of preference,
+    ///   named `s8`, `u8`, `s16le`, `u16be`, `s24le`, `s24packedle`,
+    ///   `u24packedbe`, `s32be`, `float32le`, `float64be` and so on.
+    ///   Defaults to all of them but the packed 24 bit ones.
+    /// * `rates=A|B-C|...` - sample rates and ranges of them. Defaults to
+    ///   everything libsoundio allows.
+    /// * `rate=N` - SoundIoDevice::sample_rate_current. Defaults to 48000
+    ///   if that is supported.
+    /// * `latency=MIN-MAX` - the software latency limits, in seconds.
+    ///   Defaults to `0.01-4.0`.
+    /// * `latency_current=S` - SoundIoDevice::software_latency_current.
+    ///   Defaults to 0.1 seconds, within the limits.
+    ///
+    /// For example `out count=200 channels=2 formats=s16le rates=48000; in`.
+    /// The first device of each kind is the default one. Ids are
+    /// `dummy-out` and `dummy-in`, then `dummy-out-1` and so on.
+    /// Read by ::soundio_connect, which fails with #SoundIoErrorInvalid if
+    /// the description does not parse.
+    const char *dummy_devices;
 };
 
 /// The size of this struct is not part of the API or ABI.
@@ -536,7 +681,10 @@ struct SoundIoOutStream {
     /// For JACK, this value is always equal to
     /// SoundIoDevice::software_latency_current of the device.
     double software_latency;
-    /// Core Audio and WASAPI only: current output Audio Unit volume. Float, 0.0-1.0.
+    /// Current volume, 0.0-1.0, as set with ::soundio_outstream_set_volume.
+    /// Core Audio and WASAPI set the volume of the output Audio Unit; other
+    /// backends scale the samples in ::soundio_outstream_end_write. Read it
+    /// from the thread which sets it, not from the callbacks.
     float volume;
     /// Defaults to NULL. Put whatever you want here.
     void *userdata;
@@ -584,6 +732,66 @@ struct SoundIoOutStream {
     /// stream. Defaults to `false`.
     bool non_terminal_hint;
 
+    /// Optional: Always hand #SoundIoFormatFloat32NE areas to
+    /// ::soundio_outstream_begin_write, whatever format the device is opened
+    /// with. `format` is still chosen as usual and is what the device gets;
+    /// the library converts to it in ::soundio_outstream_end_write, using a
+    /// buffer allocated by ::soundio_outstream_open, so `bytes_per_frame`
+    /// and `bytes_per_sample` describe `format`, not the areas. If `format`
+    /// is #SoundIoFormatFloat32NE this costs nothing. Defaults to `false`.
+    bool native_float;
+
+    /// Optional: The sample rate ::soundio_outstream_begin_write works at,
+    /// when the device does not support it. The device is opened at
+    /// `sample_rate`, which defaults to the supported rate nearest to this
+    /// one, and the library resamples in between with a polyphase filter.
+    /// The areas are #SoundIoFormatFloat32NE as with `native_float`, and
+    /// the frame counts given to `write_callback` and taken by
+    /// ::soundio_outstream_begin_write are at this rate. Everything is
+    /// allocated by ::soundio_outstream_open, so resampling is real-time
+    /// safe. Defaults to 0, which means the same as `sample_rate`.
+    /// JACK needs every period written in full, which the resampler cannot
+    /// promise, so there ::soundio_outstream_open returns
+    /// #SoundIoErrorIncompatibleBackend if this differs from `sample_rate`.
+    int app_sample_rate;
+    /// Optional: How well to resample when `app_sample_rate` differs from
+    /// `sample_rate`.
+    enum SoundIoResampleQuality resample_quality;
+
+    /// Optional: The channel layout ::soundio_outstream_begin_write works
+    /// in, when the device does not support it. If `layout` is not set, the
+    /// device is opened with this layout if it supports it, otherwise with
+    /// the default. Frames are then mixed from this layout to `layout` with
+    /// ::soundio_channel_layout_remix_matrix. The areas are
+    /// #SoundIoFormatFloat32NE and interleaved, as with `app_sample_rate`.
+    /// Defaults to a channel count of 0, which means the same as `layout`.
+    struct SoundIoChannelLayout app_layout;
+
+    /// Optional: Dither for when the library converts float frames to an
+    /// integer `format` of 24 bits or fewer, that is with `native_float`,
+    /// `app_sample_rate` or `app_layout`. Rounding a quiet signal straight
+    /// to 16 bits distorts it; dither trades that for a little noise, and
+    /// #SoundIoDitherShaped moves most of that noise where it is hard to
+    /// hear. The state of the noise is kept in the stream, so converting
+    /// stays real-time safe. Defaults to #SoundIoDitherNone.
+    enum SoundIoDither dither;
+
+    /// Optional: The shape of the 10 ms ramp that software volume takes to a
+    /// new value, on backends where ::soundio_outstream_set_volume does not
+    /// change the volume of the device. An exponential ramp sounds even to
+    /// the ear; it treats anything below -60 dB as silence, jumping between
+    /// that and 0.0. Defaults to #SoundIoVolumeRampLinear.
+    enum SoundIoVolumeRamp volume_ramp;
+
+    /// Optional: Measure peak, RMS and clipping of each channel of what the
+    /// app writes, in ::soundio_outstream_end_write, for
+    /// ::soundio_outstream_get_meters. The frames are as the app wrote them,
+    /// before volume, and in `app_layout` when that is set. Defaults to
+    /// `false`.
+    bool metering;
+    /// Optional: How many seconds each measurement covers, when `metering`.
+    /// Defaults to 0, which means 0.05.
+    double meter_window;
 
     /// computed automatically when you call ::soundio_outstream_open
     int bytes_per_frame;
@@ -668,6 +876,36 @@ struct SoundIoInStream {
     /// passed on or made available to another stream. Defaults to `false`.
     bool non_terminal_hint;
 
+    /// Optional: Always hand #SoundIoFormatFloat32NE areas out of
+    /// ::soundio_instream_begin_read, whatever format the device is opened
+    /// with. `format` is still chosen as usual and is what the device
+    /// delivers; the library converts from it in
+    /// ::soundio_instream_begin_read, using a buffer allocated by
+    /// ::soundio_instream_open, so `bytes_per_frame` and `bytes_per_sample`
+    /// describe `format`, not the areas. If `format` is
+    /// #SoundIoFormatFloat32NE this costs nothing. Defaults to `false`.
+    bool native_float;
+
+    /// Optional: The sample rate ::soundio_instream_begin_read works at,
+    /// when the device does not support it. See
+    /// SoundIoOutStream::app_sample_rate, including why JACK does not
+    /// support it. A hole in the device's buffer is resampled as silence.
+    int app_sample_rate;
+    /// Optional: How well to resample when `app_sample_rate` differs from
+    /// `sample_rate`.
+    enum SoundIoResampleQuality resample_quality;
+
+    /// Optional: The channel layout ::soundio_instream_begin_read works in,
+    /// when the device does not support it. See
+    /// SoundIoOutStream::app_layout.
+    struct SoundIoChannelLayout app_layout;
+
+    /// Optional: Measure what the app reads, in ::soundio_instream_end_read,
+    /// for ::soundio_instream_get_meters. Defaults to `false`.
+    bool metering;
+    /// Optional: See SoundIoOutStream::meter_window.
+    double meter_window;
+
     /// computed automatically when you call ::soundio_instream_open
     int bytes_per_frame;
     /// computed automatically when you call ::soundio_instream_open
@@ -813,6 +1051,16 @@ SOUNDIO_EXPORT int soundio_channel_layout_find_channel(
 /// returns whether it found a match
 SOUNDIO_EXPORT bool soundio_channel_layout_detect_builtin(struct SoundIoChannelLayout *layout);
 
+/// Fills `matrix` with the standard mix from `from` to `to`, as
+/// `to->channel_count` rows of `from->channel_count` gains. A channel both
+/// layouts have goes straight through. One that `to` lacks is folded into
+/// its nearest neighbors, for example center into left and right at -3 dB
+/// and back into side or front. Channels with no sensible place to go, such
+/// as LFE when downmixing, are dropped, and channels of `to` which nothing
+/// maps to stay silent. The gains are scaled so that no output can clip.
+SOUNDIO_EXPORT void soundio_channel_layout_remix_matrix(const struct SoundIoChannelLayout *from,
+        const struct SoundIoChannelLayout *to, float *matrix);
+
 /// Iterates over preferred_layouts. Returns the first channel layout in
 /// preferred_layouts which matches one of the channel layouts in
 /// available_layouts. Returns NULL if none matches.
@@ -844,6 +1092,43 @@ static inline int soundio_get_bytes_per_second(enum SoundIoFormat format,
 /// Returns string representation of `format`.
 SOUNDIO_EXPORT const char * soundio_format_string(enum SoundIoFormat format);
 
+/// Convert `frame_count` frames of `channel_count` channels from `src_areas`,
+/// in `src_format`, to `dst_areas`, in `dst_format`. Any two formats work.
+/// Float samples outside the range -1.0 to 1.0 are clamped when converted
+/// to an integer format, and rounded to the nearest integer.
+/// Converting between #SoundIoFormatFloat32NE or #SoundIoFormatFloat64NE
+/// and an integer format is vectorized, using AVX2 or SSE2 if the CPU has
+/// it, and is fastest when both sides are interleaved the same way or when
+/// each channel is contiguous. The result does not depend on which
+/// instructions were used. Real-time safe.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - a format is invalid, or a count is negative
+SOUNDIO_EXPORT int soundio_convert_samples(enum SoundIoFormat dst_format,
+        const struct SoundIoChannelArea *dst_areas, enum SoundIoFormat src_format,
+        const struct SoundIoChannelArea *src_areas, int channel_count, int frame_count);
+
+/// Copy `frame_count` frames of `channel_count` channels of
+/// `bytes_per_sample` byte samples from `src_areas` to `dst_areas`, for
+/// example from the areas given by ::soundio_instream_begin_read into an
+/// interleaved buffer. Going between interleaved and one contiguous block
+/// per channel is vectorized for 2 channels of 16 or 32 bit samples and 8
+/// channels of 32 bit samples; other layouts are copied one sample at a
+/// time. The areas must not overlap. Real-time safe.
+SOUNDIO_EXPORT void soundio_channel_areas_copy(const struct SoundIoChannelArea *dst_areas,
+        const struct SoundIoChannelArea *src_areas, int channel_count, int frame_count,
+        int bytes_per_sample);
+
+/// Interleave `channel_count` buffers of `frame_count` samples each,
+/// `src_planes[0]` through `src_planes[channel_count - 1]`, into `dst`.
+/// See ::soundio_channel_areas_copy.
+SOUNDIO_EXPORT void soundio_interleave(char *dst, char *const *src_planes,
+        int channel_count, int frame_count, int bytes_per_sample);
+
+/// The opposite of ::soundio_interleave.
+SOUNDIO_EXPORT void soundio_deinterleave(char *const *dst_planes, const char *src,
+        int channel_count, int frame_count, int bytes_per_sample);
+
 
 
 
@@ -947,8 +1232,10 @@ SOUNDIO_EXPORT void soundio_outstream_destroy(struct SoundIoOutStream *outstream
 /// * #SoundIoErrorBackendDisconnected
 /// * #SoundIoErrorSystemResources
 /// * #SoundIoErrorNoSuchClient - when JACK returns `JackNoSuchClient`
-/// * #SoundIoErrorIncompatibleBackend - SoundIoOutStream::channel_count is
-///   greater than the number of channels the backend can handle.
+/// * #SoundIoErrorIncompatibleBackend
+///   * SoundIoOutStream::channel_count is greater than the number of
+///     channels the backend can handle.
+///   * SoundIoOutStream::app_sample_rate needs resampling on JACK.
 /// * #SoundIoErrorIncompatibleDevice - stream parameters requested are not
 ///   compatible with the chosen device.
 SOUNDIO_EXPORT int soundio_outstream_open(struct SoundIoOutStream *outstream);
@@ -1058,6 +1345,40 @@ SOUNDIO_EXPORT int soundio_outstream_pause(struct SoundIoOutStream *outstream, b
 SOUNDIO_EXPORT int soundio_outstream_get_latency(struct SoundIoOutStream *outstream,
         double *out_latency);
 
+/// Obtain the number of minor and major page faults that the thread which
+/// calls SoundIoOutStream::write_callback has taken since the stream started.
+/// Useful to verify the effect of SoundIo::lock_memory. May be called from
+/// any thread. Before ::soundio_outstream_start both counts are 0.
+///
+/// Possible errors:
+/// * #SoundIoErrorIncompatibleBackend - the backend does not run the stream
+///   on a thread of libsoundio's, or the system does not count faults per
+///   thread. Currently supported by the ALSA and dummy backends on Linux.
+/// * #SoundIoErrorSystemResources
+SOUNDIO_EXPORT int soundio_outstream_get_page_faults(struct SoundIoOutStream *outstream,
+        long *out_minor_faults, long *out_major_faults);
+
+/// Obtain the levels of the latest window measured with
+/// SoundIoOutStream::metering. May be called from any thread, for example
+/// to draw meters; it never makes SoundIoOutStream::write_callback wait.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - `metering` was not set when the stream was opened
+SOUNDIO_EXPORT int soundio_outstream_get_meters(struct SoundIoOutStream *outstream,
+        struct SoundIoMeters *out_meters);
+
+/// Sets SoundIoOutStream::volume, 0.0-1.0. Core Audio and WASAPI change the
+/// volume of the device. Elsewhere the samples are scaled in software on
+/// their way to the device, ramping to the new volume over 10 ms so that it
+/// does not click, as SoundIoOutStream::volume_ramp says. At 1.0 this costs
+/// nothing. The write callback picks up the new volume by itself, but since
+/// this writes SoundIoOutStream::volume, call it from the thread which
+/// manages the stream rather than from the callbacks.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - `volume` is out of range
+/// * #SoundIoErrorIncompatibleDevice - Core Audio or WASAPI refused to set
+///   the volume of the device
 SOUNDIO_EXPORT int soundio_outstream_set_volume(struct SoundIoOutStream *outstream,
         double volume);
 
@@ -1166,6 +1487,23 @@ SOUNDIO_EXPORT int soundio_instream_pause(struct SoundIoInStream *instream, bool
 SOUNDIO_EXPORT int soundio_instream_get_latency(struct SoundIoInStream *instream,
         double *out_latency);
 
+/// The input counterpart of ::soundio_outstream_get_page_faults, counting
+/// faults taken by the thread which calls SoundIoInStream::read_callback.
+///
+/// Possible errors:
+/// * #SoundIoErrorIncompatibleBackend
+/// * #SoundIoErrorSystemResources
+SOUNDIO_EXPORT int soundio_instream_get_page_faults(struct SoundIoInStream *instream,
+        long *out_minor_faults, long *out_major_faults);
+
+/// The input counterpart of ::soundio_outstream_get_meters, for
+/// SoundIoInStream::metering.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid
+SOUNDIO_EXPORT int soundio_instream_get_meters(struct SoundIoInStream *instream,
+        struct SoundIoMeters *out_meters);
+
 
 struct SoundIoRingBuffer;
 
@@ -1181,6 +1519,49 @@ struct SoundIoRingBuffer;
 SOUNDIO_EXPORT struct SoundIoRingBuffer *soundio_ring_buffer_create(struct SoundIo *soundio, int requested_capacity);
 SOUNDIO_EXPORT void soundio_ring_buffer_destroy(struct SoundIoRingBuffer *ring_buffer);
 
+/// Options for ::soundio_ring_buffer_create_flags. Combine with bitwise or.
+enum SoundIoRingBufferFlag {
+    SoundIoRingBufferFlagNone = 0,
+    /// Back the buffer with 2 MiB huge pages, which cuts TLB misses when
+    /// streaming through large buffers such as multi-minute capture buffers.
+    /// Currently only supported on Linux, which must have huge pages reserved
+    /// (see `vm.nr_hugepages`). When no huge pages are available the buffer
+    /// silently falls back to normal pages; check
+    /// ::soundio_ring_buffer_page_size to find out which was used.
+    SoundIoRingBufferFlagHugePages = 1,
+    /// Touch every page up front and lock them into RAM, so that the first
+    /// access from a real-time thread does not take a page fault. Implied
+    /// for all ring buffers when SoundIo::lock_memory is set.
+    SoundIoRingBufferFlagLockMemory = 2,
+    /// Overwrite-oldest mode, for keeping the most recent `capacity` bytes,
+    /// such as a capture pre-roll. The writer never runs out of space: when
+    /// it laps the reader it overwrites the oldest data. The reader notices
+    /// from the write position, skips ahead to the oldest intact data and
+    /// counts what it lost in ::soundio_ring_buffer_overrun_count.
+    /// Use ::soundio_ring_buffer_reserve_write and
+    /// ::soundio_ring_buffer_reserve_read with their commit functions in this
+    /// mode. Only then can ::soundio_ring_buffer_commit_read detect that a
+    /// span was overwritten while it was being read.
+    SoundIoRingBufferFlagOverwrite = 4,
+    /// Let a non-real-time reader sleep until data arrives, with
+    /// ::soundio_ring_buffer_wait or by polling
+    /// ::soundio_ring_buffer_wakeup_fd. The writer stays real-time safe:
+    /// after each write it checks whether a reader is parked, and only then
+    /// makes a system call to wake it, once per wait.
+    SoundIoRingBufferFlagWakeup = 8,
+};
+
+/// Like ::soundio_ring_buffer_create but with `flags`, a bitmask of
+/// ::SoundIoRingBufferFlag. The actual capacity is rounded up to a multiple
+/// of the page size that ended up backing the buffer.
+SOUNDIO_EXPORT struct SoundIoRingBuffer *soundio_ring_buffer_create_flags(struct SoundIo *soundio,
+        int requested_capacity, int flags);
+
+/// Returns the size in bytes of the pages backing the ring buffer: 2 MiB if
+/// ::SoundIoRingBufferFlagHugePages took effect, otherwise the system page
+/// size.
+SOUNDIO_EXPORT int soundio_ring_buffer_page_size(struct SoundIoRingBuffer *ring_buffer);
+
 /// When you create a ring buffer, capacity might be more than the requested
 /// capacity for alignment purposes. This function returns the actual capacity.
 SOUNDIO_EXPORT int soundio_ring_buffer_capacity(struct SoundIoRingBuffer *ring_buffer);
@@ -1204,4 +1585,317 @@ SOUNDIO_EXPORT int soundio_ring_buffer_free_count(struct SoundIoRingBuffer *ring
 /// Must be called by the writer.
 SOUNDIO_EXPORT void soundio_ring_buffer_clear(struct SoundIoRingBuffer *ring_buffer);
 
+/// Reserve a contiguous span of free space for writing. This replaces calling
+/// ::soundio_ring_buffer_free_count, ::soundio_ring_buffer_write_ptr and then
+/// clamping the count yourself, and it looks at the reader's position at most
+/// once.
+///  * `min_count` - (in) If fewer than this many bytes are free, nothing is
+///    reserved and `*out_count` is set to 0.
+///  * `max_count` - (in) Reserve no more than this many bytes.
+///  * `out_ptr` - (out) Where to write the data.
+///  * `out_count` - (out) The number of bytes reserved, which is as many as are
+///    free up to `max_count`.
+/// Must be called by the writer. Follow it with
+/// ::soundio_ring_buffer_commit_write.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - `min_count` is negative or greater than
+///   `max_count`
+SOUNDIO_EXPORT int soundio_ring_buffer_reserve_write(struct SoundIoRingBuffer *ring_buffer,
+        int min_count, int max_count, char **out_ptr, int *out_count);
+/// Make `count` bytes of a span from ::soundio_ring_buffer_reserve_write
+/// available to the reader. `count` may be less than what was reserved.
+/// Must be called by the writer.
+SOUNDIO_EXPORT void soundio_ring_buffer_commit_write(struct SoundIoRingBuffer *ring_buffer, int count);
+
+/// The reading counterpart of ::soundio_ring_buffer_reserve_write. Sets
+/// `*out_ptr` to the oldest unread data and `*out_count` to how many bytes of
+/// it are contiguous, up to `max_count`, or 0 if fewer than `min_count` bytes
+/// are ready.
+/// Must be called by the reader. Follow it with
+/// ::soundio_ring_buffer_commit_read.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - `min_count` is negative or greater than
+///   `max_count`
+SOUNDIO_EXPORT int soundio_ring_buffer_reserve_read(struct SoundIoRingBuffer *ring_buffer,
+        int min_count, int max_count, char **out_ptr, int *out_count);
+/// Release `count` bytes of a span from ::soundio_ring_buffer_reserve_read
+/// back to the writer. Must be called by the reader.
+///
+/// Possible errors:
+/// * #SoundIoErrorOverflow - only in #SoundIoRingBufferFlagOverwrite mode:
+///   the writer overwrote part of the span before it was released. Discard
+///   what was read. The reader has been moved past the damage.
+SOUNDIO_EXPORT int soundio_ring_buffer_commit_read(struct SoundIoRingBuffer *ring_buffer, int count);
+
+/// Returns the total number of bytes the reader has lost because the writer
+/// overwrote them. Always 0 unless the ring buffer was created with
+/// #SoundIoRingBufferFlagOverwrite. Must be called by the reader.
+SOUNDIO_EXPORT long soundio_ring_buffer_overrun_count(struct SoundIoRingBuffer *ring_buffer);
+
+/// Block until at least `min_count` bytes can be read, for ring buffers
+/// created with #SoundIoRingBufferFlagWakeup. `timeout` in seconds; pass a
+/// negative value to wait without a timeout. Must be called by the reader,
+/// which must not be a real-time thread.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - the ring buffer was created without
+///   #SoundIoRingBufferFlagWakeup, or `min_count` is not between 1 and the
+///   capacity
+/// * #SoundIoErrorInterrupted - the timeout expired or
+///   ::soundio_ring_buffer_wakeup was called
+SOUNDIO_EXPORT int soundio_ring_buffer_wait(struct SoundIoRingBuffer *ring_buffer,
+        int min_count, double timeout);
+/// Make a pending or the next ::soundio_ring_buffer_wait return
+/// #SoundIoErrorInterrupted, for example to shut down the reader thread.
+/// May be called from any thread, but takes a lock on systems other than
+/// Linux.
+SOUNDIO_EXPORT void soundio_ring_buffer_wakeup(struct SoundIoRingBuffer *ring_buffer);
+/// For readers with their own event loop. On Linux, returns a file
+/// descriptor which polls readable once the ring buffer was armed with
+/// ::soundio_ring_buffer_arm_wakeup and enough data arrived. Returns -1 on
+/// other systems or if the ring buffer was created without
+/// #SoundIoRingBufferFlagWakeup. Do not read from or close it.
+SOUNDIO_EXPORT int soundio_ring_buffer_wakeup_fd(struct SoundIoRingBuffer *ring_buffer);
+/// Ask the writer to signal ::soundio_ring_buffer_wakeup_fd once at least
+/// `min_count` bytes can be read, and reset the fd. Returns the current fill
+/// count; if that is already at least `min_count`, do not wait for the fd.
+/// Must be called by the reader before each poll.
+SOUNDIO_EXPORT int soundio_ring_buffer_arm_wakeup(struct SoundIoRingBuffer *ring_buffer, int min_count);
+
+/// Like ::soundio_ring_buffer_create_flags but takes a `size_t` capacity, for
+/// buffers of 2 GiB or more, such as long-duration capture spools. All ring
+/// buffer functions work on such buffers, but the `int` ones clamp what they
+/// return to `INT_MAX`; use the `_size` variants below to see everything.
+/// Returns `NULL` if the capacity does not fit in the address space.
+SOUNDIO_EXPORT struct SoundIoRingBuffer *soundio_ring_buffer_create_size(struct SoundIo *soundio,
+        size_t requested_capacity, int flags);
+/// Like ::soundio_ring_buffer_capacity, without clamping.
+SOUNDIO_EXPORT size_t soundio_ring_buffer_capacity_size(struct SoundIoRingBuffer *ring_buffer);
+/// Like ::soundio_ring_buffer_fill_count, without clamping.
+SOUNDIO_EXPORT size_t soundio_ring_buffer_fill_count_size(struct SoundIoRingBuffer *ring_buffer);
+/// Like ::soundio_ring_buffer_free_count, without clamping.
+SOUNDIO_EXPORT size_t soundio_ring_buffer_free_count_size(struct SoundIoRingBuffer *ring_buffer);
+/// Like ::soundio_ring_buffer_advance_write_ptr with a `size_t` count.
+SOUNDIO_EXPORT void soundio_ring_buffer_advance_write_ptr_size(struct SoundIoRingBuffer *ring_buffer,
+        size_t count);
+/// Like ::soundio_ring_buffer_advance_read_ptr with a `size_t` count.
+SOUNDIO_EXPORT void soundio_ring_buffer_advance_read_ptr_size(struct SoundIoRingBuffer *ring_buffer,
+        size_t count);
+/// Like ::soundio_ring_buffer_reserve_write with `size_t` counts.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - `min_count` is greater than `max_count`
+SOUNDIO_EXPORT int soundio_ring_buffer_reserve_write_size(struct SoundIoRingBuffer *ring_buffer,
+        size_t min_count, size_t max_count, char **out_ptr, size_t *out_count);
+/// Like ::soundio_ring_buffer_commit_write with a `size_t` count.
+SOUNDIO_EXPORT void soundio_ring_buffer_commit_write_size(struct SoundIoRingBuffer *ring_buffer,
+        size_t count);
+/// Like ::soundio_ring_buffer_reserve_read with `size_t` counts.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - `min_count` is greater than `max_count`
+SOUNDIO_EXPORT int soundio_ring_buffer_reserve_read_size(struct SoundIoRingBuffer *ring_buffer,
+        size_t min_count, size_t max_count, char **out_ptr, size_t *out_count);
+/// Like ::soundio_ring_buffer_commit_read with a `size_t` count.
+///
+/// Possible errors:
+/// * #SoundIoErrorOverflow - see ::soundio_ring_buffer_commit_read
+SOUNDIO_EXPORT int soundio_ring_buffer_commit_read_size(struct SoundIoRingBuffer *ring_buffer,
+        size_t count);
+
+struct SoundIoMpscRingBuffer;
+
+/// A multi-writer single-reader lock-free queue of fixed-size slots, for
+/// example several decoder threads feeding one SoundIoOutStream. Like
+/// SoundIoRingBuffer it uses mirrored memory, so any run of consecutive slots
+/// is contiguous.
+/// `slot_size` in bytes, `requested_slot_count` is the minimum number of
+/// slots. The actual slot count is rounded up so that the buffer spans a
+/// whole number of pages; a `slot_size` which divides the page size keeps
+/// this overhead small.
+/// Returns `NULL` if and only if memory could not be allocated.
+/// See also ::soundio_mpsc_ring_buffer_destroy
+SOUNDIO_EXPORT struct SoundIoMpscRingBuffer *soundio_mpsc_ring_buffer_create(struct SoundIo *soundio,
+        int slot_size, int requested_slot_count);
+SOUNDIO_EXPORT void soundio_mpsc_ring_buffer_destroy(struct SoundIoMpscRingBuffer *ring_buffer);
+
+SOUNDIO_EXPORT int soundio_mpsc_ring_buffer_slot_size(struct SoundIoMpscRingBuffer *ring_buffer);
+/// Returns the actual number of slots, which is at least the requested count.
+SOUNDIO_EXPORT int soundio_mpsc_ring_buffer_slot_count(struct SoundIoMpscRingBuffer *ring_buffer);
+
+/// Claim the next slot for writing and return a pointer to its `slot_size`
+/// bytes. Safe to call from any number of writer threads. Slots are handed
+/// out in order by a single atomic add; if the buffer is full this waits,
+/// yielding the CPU, until the reader releases the slot. Check
+/// ::soundio_mpsc_ring_buffer_free_count first to avoid waiting.
+/// Every claimed slot must be passed to ::soundio_mpsc_ring_buffer_publish,
+/// and the reader cannot get past a slot until it is.
+SOUNDIO_EXPORT char *soundio_mpsc_ring_buffer_claim(struct SoundIoMpscRingBuffer *ring_buffer);
+/// Make a slot from ::soundio_mpsc_ring_buffer_claim available to the reader.
+/// Must be called by the writer that claimed it.
+SOUNDIO_EXPORT void soundio_mpsc_ring_buffer_publish(struct SoundIoMpscRingBuffer *ring_buffer,
+        char *slot);
+/// Returns how many slots can be claimed without waiting. Only a hint when
+/// there is more than one writer.
+SOUNDIO_EXPORT int soundio_mpsc_ring_buffer_free_count(struct SoundIoMpscRingBuffer *ring_buffer);
+
+/// Returns how many consecutive slots starting at
+/// ::soundio_mpsc_ring_buffer_read_ptr are published. Must be called by the
+/// reader. Wait-free, so it is safe to call from
+/// SoundIoOutStream::write_callback.
+SOUNDIO_EXPORT int soundio_mpsc_ring_buffer_fill_count(struct SoundIoMpscRingBuffer *ring_buffer);
+/// Returns a pointer to the oldest unread slot. Must be called by the reader.
+SOUNDIO_EXPORT char *soundio_mpsc_ring_buffer_read_ptr(struct SoundIoMpscRingBuffer *ring_buffer);
+/// Release `count` slots, at most ::soundio_mpsc_ring_buffer_fill_count, back
+/// to the writers. Must be called by the reader. Wait-free.
+SOUNDIO_EXPORT void soundio_mpsc_ring_buffer_advance_read_ptr(struct SoundIoMpscRingBuffer *ring_buffer,
+        int count);
+
+struct SoundIoBroadcastRingBuffer;
+
+/// What the writer of a SoundIoBroadcastRingBuffer does about readers that
+/// fall behind.
+enum SoundIoBroadcastPolicy {
+    /// The writer never gets more than capacity ahead of the slowest reader,
+    /// so no reader ever misses data.
+    SoundIoBroadcastPolicyBlock,
+    /// The writer can always write the full capacity. A reader that falls
+    /// more than capacity behind skips ahead to the oldest data that is still
+    /// intact; see ::soundio_broadcast_ring_buffer_overrun_count.
+    SoundIoBroadcastPolicyOverwrite,
+};
+
+/// A single-writer multi-reader lock-free ring buffer, for fanning out one
+/// stream to several consumers without copying. Every reader has its own
+/// read position and gets spans that point directly into the shared
+/// mirrored memory, so spans are contiguous across the end of the buffer.
+/// `requested_capacity` in bytes. `max_readers` is the maximum number of
+/// readers that can be added at the same time.
+/// Returns `NULL` if and only if memory could not be allocated.
+/// See also ::soundio_broadcast_ring_buffer_destroy
+SOUNDIO_EXPORT struct SoundIoBroadcastRingBuffer *soundio_broadcast_ring_buffer_create(
+        struct SoundIo *soundio, int requested_capacity, int max_readers,
+        enum SoundIoBroadcastPolicy policy);
+SOUNDIO_EXPORT void soundio_broadcast_ring_buffer_destroy(struct SoundIoBroadcastRingBuffer *ring_buffer);
+
+/// Returns the actual capacity, which might be greater than the requested
+/// capacity for alignment purposes.
+SOUNDIO_EXPORT int soundio_broadcast_ring_buffer_capacity(struct SoundIoBroadcastRingBuffer *ring_buffer);
+
+/// Returns how many bytes the writer can reserve. With
+/// #SoundIoBroadcastPolicyBlock this depends on the slowest reader; with
+/// #SoundIoBroadcastPolicyOverwrite it is always the capacity.
+/// Must be called by the writer.
+SOUNDIO_EXPORT int soundio_broadcast_ring_buffer_free_count(struct SoundIoBroadcastRingBuffer *ring_buffer);
+/// Works like ::soundio_ring_buffer_reserve_write. Must be called by the
+/// writer.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - `min_count` is negative or greater than
+///   `max_count`
+SOUNDIO_EXPORT int soundio_broadcast_ring_buffer_reserve_write(struct SoundIoBroadcastRingBuffer *ring_buffer,
+        int min_count, int max_count, char **out_ptr, int *out_count);
+/// Make `count` bytes of the reserved span visible to all readers. Must be
+/// called by the writer.
+SOUNDIO_EXPORT void soundio_broadcast_ring_buffer_commit_write(struct SoundIoBroadcastRingBuffer *ring_buffer,
+        int count);
+
+/// Register a new reader and set `out_reader` to its index, which the
+/// reader passes to the other reader functions. The reader starts at the
+/// current write position. Safe to call while the writer is running, but
+/// not concurrently with ::soundio_broadcast_ring_buffer_remove_reader for
+/// the same index.
+///
+/// Possible errors:
+/// * #SoundIoErrorSystemResources - `max_readers` readers already exist
+SOUNDIO_EXPORT int soundio_broadcast_ring_buffer_add_reader(struct SoundIoBroadcastRingBuffer *ring_buffer,
+        int *out_reader);
+/// The writer no longer waits for this reader, and its index may be reused.
+SOUNDIO_EXPORT void soundio_broadcast_ring_buffer_remove_reader(struct SoundIoBroadcastRingBuffer *ring_buffer,
+        int reader);
+
+/// Returns how many bytes `reader` can read. Must be called by that reader.
+SOUNDIO_EXPORT int soundio_broadcast_ring_buffer_fill_count(struct SoundIoBroadcastRingBuffer *ring_buffer,
+        int reader);
+/// Works like ::soundio_ring_buffer_reserve_read, for `reader`. Must be
+/// called by that reader.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - `min_count` is negative or greater than
+///   `max_count`
+SOUNDIO_EXPORT int soundio_broadcast_ring_buffer_reserve_read(struct SoundIoBroadcastRingBuffer *ring_buffer,
+        int reader, int min_count, int max_count, char **out_ptr, int *out_count);
+/// Release `count` bytes of the span from
+/// ::soundio_broadcast_ring_buffer_reserve_read. Must be called by that
+/// reader.
+///
+/// With #SoundIoBroadcastPolicyOverwrite the writer may have overwritten
+/// part of the span while the reader was using it. In that case the reader
+/// is moved past the damage and this returns #SoundIoErrorOverflow, meaning
+/// the contents of the span must be discarded.
+SOUNDIO_EXPORT int soundio_broadcast_ring_buffer_commit_read(struct SoundIoBroadcastRingBuffer *ring_buffer,
+        int reader, int count);
+/// Returns the total number of bytes `reader` has lost to the writer since it
+/// was added. Always 0 with #SoundIoBroadcastPolicyBlock. Must be called by
+/// that reader.
+SOUNDIO_EXPORT long soundio_broadcast_ring_buffer_overrun_count(struct SoundIoBroadcastRingBuffer *ring_buffer,
+        int reader);
+
+struct SoundIoBridge;
+
+/// Connects a SoundIoInStream to a SoundIoOutStream, for example to play
+/// what a microphone records. The two devices run on different clocks, so a
+/// plain ring buffer in between slowly fills up or runs dry. The bridge
+/// measures how much it holds and resamples by a tiny ratio to keep that at
+/// `target_latency` seconds. It works at the rates and formats the app sees,
+/// which may differ between the streams; the channel counts must match,
+/// counting SoundIoOutStream::app_layout where it is set. The
+/// resampler uses SoundIoOutStream::resample_quality. A `target_latency`
+/// of 0 means the sum of both streams' software latency.
+///
+/// Call after both streams are opened and before either is started. Then
+/// call ::soundio_bridge_read from SoundIoInStream::read_callback and
+/// ::soundio_bridge_write from SoundIoOutStream::write_callback. Everything
+/// is allocated here, so both are real-time safe.
+///
+/// Possible errors:
+/// * #SoundIoErrorInvalid - the channel counts differ, or `target_latency`
+///   is negative
+/// * #SoundIoErrorNoMem
+/// See also ::soundio_bridge_destroy
+SOUNDIO_EXPORT int soundio_bridge_create(struct SoundIoInStream *instream,
+        struct SoundIoOutStream *outstream, double target_latency, struct SoundIoBridge **out_bridge);
+/// Call after both streams are destroyed.
+SOUNDIO_EXPORT void soundio_bridge_destroy(struct SoundIoBridge *bridge);
+
+/// Reads everything the input has into the bridge. If there is no room,
+/// what does not fit is dropped; see ::soundio_bridge_get_overflow_count.
+/// Returns errors from ::soundio_instream_begin_read and
+/// ::soundio_instream_end_read.
+SOUNDIO_EXPORT int soundio_bridge_read(struct SoundIoBridge *bridge,
+        int frame_count_min, int frame_count_max);
+/// Writes `frame_count_max` frames to the output. Until the bridge holds
+/// the target latency, at the start and after it runs dry, this is silence.
+/// Returns errors from ::soundio_outstream_begin_write and
+/// ::soundio_outstream_end_write.
+SOUNDIO_EXPORT int soundio_bridge_write(struct SoundIoBridge *bridge,
+        int frame_count_min, int frame_count_max);
+
+/// Seconds from input arriving at the bridge to it leaving, averaged over
+/// about a second. Does not count the latency of either device; see
+/// ::soundio_instream_get_latency and ::soundio_outstream_get_latency.
+/// Safe to call from any thread.
+SOUNDIO_EXPORT double soundio_bridge_get_latency(struct SoundIoBridge *bridge);
+/// How many parts per million faster the input clock runs than the output
+/// clock, as far as the bridge can tell so far. Safe to call from any thread.
+SOUNDIO_EXPORT double soundio_bridge_get_drift_ppm(struct SoundIoBridge *bridge);
+/// How many times the output found the bridge empty. Safe to call from any
+/// thread.
+SOUNDIO_EXPORT long soundio_bridge_get_underflow_count(struct SoundIoBridge *bridge);
+/// How many times the input found the bridge full. Safe to call from any
+/// thread.
+SOUNDIO_EXPORT long soundio_bridge_get_overflow_count(struct SoundIoBridge *bridge);
+
 #endif
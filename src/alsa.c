@@ -244,6 +244,10 @@ static snd_pcm_format_t to_alsa_fmt(enum SoundIoFormat fmt) {
     case SoundIoFormatFloat32BE:    return SND_PCM_FORMAT_FLOAT_BE;
     case SoundIoFormatFloat64LE:    return SND_PCM_FORMAT_FLOAT64_LE;
     case SoundIoFormatFloat64BE:    return SND_PCM_FORMAT_FLOAT64_BE;
+    case SoundIoFormatS24PackedLE:  return SND_PCM_FORMAT_S24_3LE;
+    case SoundIoFormatS24PackedBE:  return SND_PCM_FORMAT_S24_3BE;
+    case SoundIoFormatU24PackedLE:  return SND_PCM_FORMAT_U24_3LE;
+    case SoundIoFormatU24PackedBE:  return SND_PCM_FORMAT_U24_3BE;
 
     case SoundIoFormatInvalid:
         return SND_PCM_FORMAT_UNKNOWN;
@@ -358,13 +362,17 @@ static int probe_open_device(struct SoundIoDevice *device, snd_pcm_t *handle, in
     snd_pcm_format_mask_set(fmt_mask, SND_PCM_FORMAT_FLOAT_BE);
     snd_pcm_format_mask_set(fmt_mask, SND_PCM_FORMAT_FLOAT64_LE);
     snd_pcm_format_mask_set(fmt_mask, SND_PCM_FORMAT_FLOAT64_BE);
+    snd_pcm_format_mask_set(fmt_mask, SND_PCM_FORMAT_S24_3LE);
+    snd_pcm_format_mask_set(fmt_mask, SND_PCM_FORMAT_S24_3BE);
+    snd_pcm_format_mask_set(fmt_mask, SND_PCM_FORMAT_U24_3LE);
+    snd_pcm_format_mask_set(fmt_mask, SND_PCM_FORMAT_U24_3BE);
 
     if ((err = snd_pcm_hw_params_set_format_mask(handle, hwparams, fmt_mask)) < 0)
         return SoundIoErrorOpeningDevice;
 
     if (!device->formats) {
         snd_pcm_hw_params_get_format_mask(hwparams, fmt_mask);
-        device->formats = ALLOCATE(enum SoundIoFormat, 18);
+        device->formats = ALLOCATE(enum SoundIoFormat, 22);
         if (!device->formats)
             return SoundIoErrorNoMem;
 
@@ -387,6 +395,10 @@ static int probe_open_device(struct SoundIoDevice *device, snd_pcm_t *handle, in
         test_fmt_mask(device, fmt_mask, SoundIoFormatFloat32BE);
         test_fmt_mask(device, fmt_mask, SoundIoFormatFloat64LE);
         test_fmt_mask(device, fmt_mask, SoundIoFormatFloat64BE);
+        test_fmt_mask(device, fmt_mask, SoundIoFormatS24PackedLE);
+        test_fmt_mask(device, fmt_mask, SoundIoFormatS24PackedBE);
+        test_fmt_mask(device, fmt_mask, SoundIoFormatU24PackedLE);
+        test_fmt_mask(device, fmt_mask, SoundIoFormatU24PackedBE);
     }
 
     return 0;
@@ -1439,7 +1451,8 @@ static int outstream_start_alsa(struct SoundIoPrivate *si, struct SoundIoOutStre
 
     int err;
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osa->thread_exit_flag);
-    if ((err = soundio_os_thread_create(outstream_thread_run, os, soundio->emit_rtprio_warning, &osa->thread)))
+    if ((err = soundio_os_thread_create(outstream_thread_run, os, soundio->emit_rtprio_warning,
+                    soundio->lock_memory, &osa->thread)))
         return err;
 
     return 0;
@@ -1568,6 +1581,13 @@ static int outstream_get_latency_alsa(struct SoundIoPrivate *si, struct SoundIoO
     return 0;
 }
 
+static int outstream_get_page_faults_alsa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        long *out_minor_faults, long *out_major_faults)
+{
+    struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
+    return soundio_os_thread_page_faults(osa->thread, out_minor_faults, out_major_faults);
+}
+
 static void instream_destroy_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
     struct SoundIoInStreamAlsa *isa = &is->backend_data.alsa;
 
@@ -1741,7 +1761,8 @@ static int instream_start_alsa(struct SoundIoPrivate *si, struct SoundIoInStream
 
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isa->thread_exit_flag);
     int err;
-    if ((err = soundio_os_thread_create(instream_thread_run, is, soundio->emit_rtprio_warning, &isa->thread))) {
+    if ((err = soundio_os_thread_create(instream_thread_run, is, soundio->emit_rtprio_warning,
+                    soundio->lock_memory, &isa->thread))) {
         instream_destroy_alsa(si, is);
         return err;
     }
@@ -1863,6 +1884,13 @@ static int instream_get_latency_alsa(struct SoundIoPrivate *si, struct SoundIoIn
     return 0;
 }
 
+static int instream_get_page_faults_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is,
+        long *out_minor_faults, long *out_major_faults)
+{
+    struct SoundIoInStreamAlsa *isa = &is->backend_data.alsa;
+    return soundio_os_thread_page_faults(isa->thread, out_minor_faults, out_major_faults);
+}
+
 int soundio_alsa_init(struct SoundIoPrivate *si) {
     struct SoundIoAlsa *sia = &si->backend_data.alsa;
     int err;
@@ -1926,7 +1954,7 @@ int soundio_alsa_init(struct SoundIoPrivate *si) {
 
     wakeup_device_poll(sia);
 
-    if ((err = soundio_os_thread_create(device_thread_run, si, NULL, &sia->thread))) {
+    if ((err = soundio_os_thread_create(device_thread_run, si, NULL, false, &sia->thread))) {
         destroy_alsa(si);
         return err;
     }
@@ -1945,6 +1973,7 @@ int soundio_alsa_init(struct SoundIoPrivate *si) {
     si->outstream_clear_buffer = outstream_clear_buffer_alsa;
     si->outstream_pause = outstream_pause_alsa;
     si->outstream_get_latency = outstream_get_latency_alsa;
+    si->outstream_get_page_faults = outstream_get_page_faults_alsa;
 
     si->instream_open = instream_open_alsa;
     si->instream_destroy = instream_destroy_alsa;
@@ -1953,6 +1982,7 @@ int soundio_alsa_init(struct SoundIoPrivate *si) {
     si->instream_end_read = instream_end_read_alsa;
     si->instream_pause = instream_pause_alsa;
     si->instream_get_latency = instream_get_latency_alsa;
+    si->instream_get_page_faults = instream_get_page_faults_alsa;
 
     return 0;
 }
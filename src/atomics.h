@@ -11,9 +11,14 @@
 // Simple wrappers around atomic values so that the compiler will catch it if
 // I accidentally use operators such as +, -, += on them.
 
+// Values that are written by different threads should be at least this far
+// apart in memory to avoid false sharing.
+#define SOUNDIO_CACHE_LINE_SIZE 64
+
 #ifdef __cplusplus
 
 #include <atomic>
+#include <cstddef>
 
 struct SoundIoAtomicLong {
     std::atomic<long> x;
@@ -35,13 +40,24 @@ struct SoundIoAtomicULong {
     std::atomic<unsigned long> x;
 };
 
+struct SoundIoAtomicSize {
+    std::atomic<size_t> x;
+};
+
 #define SOUNDIO_ATOMIC_LOAD(a) (a.x.load())
+#define SOUNDIO_ATOMIC_LOAD_RELAXED(a) (a.x.load(std::memory_order_relaxed))
+#define SOUNDIO_ATOMIC_LOAD_ACQUIRE(a) (a.x.load(std::memory_order_acquire))
 #define SOUNDIO_ATOMIC_FETCH_ADD(a, delta) (a.x.fetch_add(delta))
 #define SOUNDIO_ATOMIC_STORE(a, value) (a.x.store(value))
+#define SOUNDIO_ATOMIC_STORE_RELAXED(a, value) (a.x.store(value, std::memory_order_relaxed))
+#define SOUNDIO_ATOMIC_STORE_RELEASE(a, value) (a.x.store(value, std::memory_order_release))
 #define SOUNDIO_ATOMIC_EXCHANGE(a, value) (a.x.exchange(value))
 #define SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(a) (a.x.test_and_set())
 #define SOUNDIO_ATOMIC_FLAG_CLEAR(a) (a.x.clear())
 #define SOUNDIO_ATOMIC_FLAG_INIT ATOMIC_FLAG_INIT
+#define SOUNDIO_ATOMIC_FENCE_ACQUIRE() std::atomic_thread_fence(std::memory_order_acquire)
+#define SOUNDIO_ATOMIC_FENCE_RELEASE() std::atomic_thread_fence(std::memory_order_release)
+#define SOUNDIO_ATOMIC_FENCE_SEQ_CST() std::atomic_thread_fence(std::memory_order_seq_cst)
 
 #else
 
@@ -67,13 +83,24 @@ struct SoundIoAtomicULong {
     atomic_ulong x;
 };
 
+struct SoundIoAtomicSize {
+    atomic_size_t x;
+};
+
 #define SOUNDIO_ATOMIC_LOAD(a) atomic_load(&a.x)
+#define SOUNDIO_ATOMIC_LOAD_RELAXED(a) atomic_load_explicit(&a.x, memory_order_relaxed)
+#define SOUNDIO_ATOMIC_LOAD_ACQUIRE(a) atomic_load_explicit(&a.x, memory_order_acquire)
 #define SOUNDIO_ATOMIC_FETCH_ADD(a, delta) atomic_fetch_add(&a.x, delta)
 #define SOUNDIO_ATOMIC_STORE(a, value) atomic_store(&a.x, value)
+#define SOUNDIO_ATOMIC_STORE_RELAXED(a, value) atomic_store_explicit(&a.x, value, memory_order_relaxed)
+#define SOUNDIO_ATOMIC_STORE_RELEASE(a, value) atomic_store_explicit(&a.x, value, memory_order_release)
 #define SOUNDIO_ATOMIC_EXCHANGE(a, value) atomic_exchange(&a.x, value)
 #define SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(a) atomic_flag_test_and_set(&a.x)
 #define SOUNDIO_ATOMIC_FLAG_CLEAR(a) atomic_flag_clear(&a.x)
 #define SOUNDIO_ATOMIC_FLAG_INIT ATOMIC_FLAG_INIT
+#define SOUNDIO_ATOMIC_FENCE_ACQUIRE() atomic_thread_fence(memory_order_acquire)
+#define SOUNDIO_ATOMIC_FENCE_RELEASE() atomic_thread_fence(memory_order_release)
+#define SOUNDIO_ATOMIC_FENCE_SEQ_CST() atomic_thread_fence(memory_order_seq_cst)
 
 #endif
 
@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "bridge.h"
+#include "soundio_private.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The loop corrects an error in latency with a time constant of about
+// 2 / PROPORTIONAL_GAIN seconds. INTEGRAL_GAIN makes it critically damped.
+static const double SMOOTHING_TIME = 1.0;
+static const double PROPORTIONAL_GAIN = 0.1;
+static const double INTEGRAL_GAIN = 0.0025;
+// Far more than any two crystals disagree by, and little enough not to be
+// heard as a change in pitch.
+static const double MAX_CORRECTION = 0.005;
+
+static double clamp_correction(double x) {
+    return soundio_double_clamp(-MAX_CORRECTION, x, MAX_CORRECTION);
+}
+
+void soundio_bridge_control_reset(struct SoundIoBridgeControl *control, double target) {
+    control->target = target;
+    control->smoothed = target;
+    control->integral = 0.0;
+    control->settled = false;
+}
+
+double soundio_bridge_control_update(struct SoundIoBridgeControl *control, double latency, double dt) {
+    if (control->settled) {
+        control->smoothed += (latency - control->smoothed) * dt / (SMOOTHING_TIME + dt);
+    } else {
+        control->smoothed = latency;
+        control->settled = true;
+    }
+    double error = control->smoothed - control->target;
+    control->integral = clamp_correction(control->integral + INTEGRAL_GAIN * error * dt);
+    return 1.0 + clamp_correction(PROPORTIONAL_GAIN * error + control->integral);
+}
+
+double soundio_bridge_control_drift_ppm(const struct SoundIoBridgeControl *control) {
+    return control->integral * 1000000.0;
+}
+
+// The rate, layout and format the app sees, which is what the bridge works with.
+static int instream_rate(struct SoundIoInStream *instream) {
+    return instream->app_sample_rate ? instream->app_sample_rate : instream->sample_rate;
+}
+
+static int outstream_rate(struct SoundIoOutStream *outstream) {
+    return outstream->app_sample_rate ? outstream->app_sample_rate : outstream->sample_rate;
+}
+
+static int instream_channel_count(struct SoundIoInStream *instream) {
+    return instream->app_layout.channel_count ? instream->app_layout.channel_count :
+        instream->layout.channel_count;
+}
+
+static int outstream_channel_count(struct SoundIoOutStream *outstream) {
+    return outstream->app_layout.channel_count ? outstream->app_layout.channel_count :
+        outstream->layout.channel_count;
+}
+
+static enum SoundIoFormat instream_format(struct SoundIoInStream *instream) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    return is->float_buffer ? SoundIoFormatFloat32NE : instream->format;
+}
+
+static enum SoundIoFormat outstream_format(struct SoundIoOutStream *outstream) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    return os->float_buffer ? SoundIoFormatFloat32NE : outstream->format;
+}
+
+static int frames_for(double seconds, int rate) {
+    return (seconds > 0.0) ? (int)(seconds * rate) + 1 : rate;
+}
+
+int soundio_bridge_create(struct SoundIoInStream *instream, struct SoundIoOutStream *outstream,
+        double target_latency, struct SoundIoBridge **out_bridge)
+{
+    *out_bridge = NULL;
+    if (instream_channel_count(instream) != outstream_channel_count(outstream) || target_latency < 0.0)
+        return SoundIoErrorInvalid;
+
+    struct SoundIoBridge *bridge = ALLOCATE(struct SoundIoBridge, 1);
+    if (!bridge)
+        return SoundIoErrorNoMem;
+
+    bridge->instream = instream;
+    bridge->outstream = outstream;
+    bridge->channel_count = instream_channel_count(instream);
+    bridge->in_format = instream_format(instream);
+    bridge->out_format = outstream_format(outstream);
+    bridge->in_rate = instream_rate(instream);
+    bridge->out_rate = outstream_rate(outstream);
+    bridge->bytes_per_frame = sizeof(float) * bridge->channel_count;
+    bridge->priming = true;
+    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(bridge->no_overflow);
+
+    if (target_latency == 0.0)
+        target_latency = instream->software_latency + outstream->software_latency;
+    bridge->target_frames = soundio_int_max(1, (int)(target_latency * bridge->in_rate + 0.5));
+    soundio_bridge_control_reset(&bridge->control, bridge->target_frames / (double)bridge->in_rate);
+
+    // Whatever the output asks for at once, in input frames.
+    int out_frames = (int)((int64_t)frames_for(outstream->software_latency, bridge->out_rate) *
+            bridge->in_rate / bridge->out_rate) + 1;
+    int in_frames = frames_for(instream->software_latency, bridge->in_rate);
+    int capacity = 2 * (bridge->target_frames + in_frames + out_frames);
+
+    struct SoundIo *soundio = instream->device->soundio;
+    int flags = soundio->lock_memory ? SoundIoRingBufferFlagLockMemory : SoundIoRingBufferFlagNone;
+    int err;
+    if ((err = soundio_ring_buffer_init_flags(&bridge->ring_buffer,
+                    (size_t)capacity * bridge->bytes_per_frame, flags)))
+    {
+        soundio_bridge_destroy(bridge);
+        return err;
+    }
+    if ((err = soundio_resampler_init(&bridge->resampler, bridge->channel_count, bridge->in_rate,
+                    bridge->out_rate, outstream->resample_quality, 2 * out_frames)))
+    {
+        soundio_bridge_destroy(bridge);
+        return err;
+    }
+
+    *out_bridge = bridge;
+    return 0;
+}
+
+void soundio_bridge_destroy(struct SoundIoBridge *bridge) {
+    if (!bridge)
+        return;
+
+    soundio_resampler_deinit(&bridge->resampler);
+    soundio_ring_buffer_deinit(&bridge->ring_buffer);
+
+    free(bridge);
+}
+
+static void interleaved_float_areas(struct SoundIoChannelArea *areas, float *ptr, int channel_count) {
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        areas[ch].ptr = (char *)(ptr + ch);
+        areas[ch].step = sizeof(float) * channel_count;
+    }
+}
+
+int soundio_bridge_read(struct SoundIoBridge *bridge, int frame_count_min, int frame_count_max) {
+    struct SoundIoInStream *instream = bridge->instream;
+    struct SoundIoRingBuffer *rb = &bridge->ring_buffer;
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        int err;
+        if ((err = soundio_instream_begin_read(instream, &areas, &frame_count)))
+            return err;
+        if (!frame_count)
+            break;
+
+        // Whatever does not fit is lost, and the write callback is told to
+        // start over from what is there.
+        int write_count = soundio_int_min(frame_count,
+                soundio_ring_buffer_free_count(rb) / bridge->bytes_per_frame);
+        if (write_count < frame_count) {
+            SOUNDIO_ATOMIC_FETCH_ADD(bridge->overflow_count, 1);
+            SOUNDIO_ATOMIC_FLAG_CLEAR(bridge->no_overflow);
+        }
+        float *ptr = (float *)soundio_ring_buffer_write_ptr(rb);
+        if (areas) {
+            struct SoundIoChannelArea ring_areas[SOUNDIO_MAX_CHANNELS];
+            interleaved_float_areas(ring_areas, ptr, bridge->channel_count);
+            soundio_convert_samples(SoundIoFormatFloat32NE, ring_areas, bridge->in_format, areas,
+                    bridge->channel_count, write_count);
+        } else {
+            memset(ptr, 0, (size_t)write_count * bridge->bytes_per_frame);
+        }
+        soundio_ring_buffer_advance_write_ptr(rb, write_count * bridge->bytes_per_frame);
+
+        if ((err = soundio_instream_end_read(instream)))
+            return err;
+        frames_left -= frame_count;
+    }
+    return 0;
+}
+
+// Throws away input so that no more than the target is buffered.
+static void drop_to_target(struct SoundIoBridge *bridge, int fill_frames) {
+    int drop = fill_frames - bridge->target_frames;
+    if (drop > 0)
+        soundio_ring_buffer_advance_read_ptr(&bridge->ring_buffer, drop * bridge->bytes_per_frame);
+}
+
+// Resamples into `areas`, and plays silence while priming.
+static void fill_areas(struct SoundIoBridge *bridge, const struct SoundIoChannelArea *areas, int frame_count) {
+    struct SoundIoRingBuffer *rb = &bridge->ring_buffer;
+    struct SoundIoResampler *rs = &bridge->resampler;
+    struct SoundIoChannelArea dst[SOUNDIO_MAX_CHANNELS];
+    memcpy(dst, areas, sizeof(struct SoundIoChannelArea) * bridge->channel_count);
+    while (frame_count > 0) {
+        int count = frame_count;
+        if (!bridge->priming) {
+            count = soundio_int_min(soundio_resampler_output_count(rs), frame_count);
+            if (count == 0) {
+                int write_count = soundio_int_min(soundio_resampler_input_needed(rs, frame_count),
+                        soundio_ring_buffer_fill_count(rb) / bridge->bytes_per_frame);
+                write_count = soundio_int_min(write_count, soundio_resampler_free_count(rs));
+                if (write_count > 0) {
+                    struct SoundIoChannelArea ring_areas[SOUNDIO_MAX_CHANNELS];
+                    interleaved_float_areas(ring_areas, (float *)soundio_ring_buffer_read_ptr(rb),
+                            bridge->channel_count);
+                    soundio_resampler_write(rs, SoundIoFormatFloat32NE, ring_areas, write_count);
+                    soundio_ring_buffer_advance_read_ptr(rb, write_count * bridge->bytes_per_frame);
+                    continue;
+                }
+                SOUNDIO_ATOMIC_FETCH_ADD(bridge->underflow_count, 1);
+                // What the filter remembers is from before the gap, and would
+                // throw off both the audio and soundio_resampler_delay.
+                soundio_resampler_reset(rs);
+                bridge->priming = true;
+                count = frame_count;
+            } else {
+                soundio_resampler_read(rs, bridge->out_format, dst, count);
+            }
+        }
+        if (bridge->priming) {
+            struct SoundIoChannelArea silence[SOUNDIO_MAX_CHANNELS];
+            for (int ch = 0; ch < bridge->channel_count; ch += 1) {
+                silence[ch].ptr = (char *)&bridge->silence;
+                silence[ch].step = 0;
+            }
+            soundio_convert_samples(bridge->out_format, dst, SoundIoFormatFloat32NE, silence,
+                    bridge->channel_count, count);
+        }
+        for (int ch = 0; ch < bridge->channel_count; ch += 1)
+            dst[ch].ptr += count * dst[ch].step;
+        frame_count -= count;
+    }
+}
+
+int soundio_bridge_write(struct SoundIoBridge *bridge, int frame_count_min, int frame_count_max) {
+    struct SoundIoOutStream *outstream = bridge->outstream;
+    struct SoundIoRingBuffer *rb = &bridge->ring_buffer;
+    int fill_frames = soundio_ring_buffer_fill_count(rb) / bridge->bytes_per_frame;
+
+    // After an overflow what is buffered has a gap in it anyway, so it may
+    // as well be cut down to the target right away.
+    if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(bridge->no_overflow)) {
+        drop_to_target(bridge, fill_frames);
+        fill_frames = soundio_int_min(fill_frames, bridge->target_frames);
+        bridge->control.settled = false;
+    }
+    if (bridge->priming && fill_frames >= bridge->target_frames) {
+        drop_to_target(bridge, fill_frames);
+        fill_frames = bridge->target_frames;
+        bridge->priming = false;
+        bridge->control.settled = false;
+    }
+
+    double now = soundio_os_get_time();
+    if (!bridge->priming) {
+        double dt = bridge->control.settled ? now - bridge->last_time : 0.0;
+        double latency = (fill_frames + soundio_resampler_delay(&bridge->resampler)) / bridge->in_rate;
+        double ratio = soundio_bridge_control_update(&bridge->control, latency, dt);
+        soundio_resampler_set_ratio(&bridge->resampler, ratio);
+        SOUNDIO_ATOMIC_STORE(bridge->latency_us, (long)(bridge->control.smoothed * 1000000.0));
+        SOUNDIO_ATOMIC_STORE(bridge->drift_ppb,
+                (long)(soundio_bridge_control_drift_ppm(&bridge->control) * 1000.0));
+    }
+    bridge->last_time = now;
+
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        int err;
+        if ((err = soundio_outstream_begin_write(outstream, &areas, &frame_count)))
+            return err;
+        if (!frame_count)
+            break;
+        fill_areas(bridge, areas, frame_count);
+        if ((err = soundio_outstream_end_write(outstream)))
+            return err;
+        frames_left -= frame_count;
+    }
+    return 0;
+}
+
+double soundio_bridge_get_latency(struct SoundIoBridge *bridge) {
+    return SOUNDIO_ATOMIC_LOAD(bridge->latency_us) / 1000000.0;
+}
+
+double soundio_bridge_get_drift_ppm(struct SoundIoBridge *bridge) {
+    return SOUNDIO_ATOMIC_LOAD(bridge->drift_ppb) / 1000.0;
+}
+
+long soundio_bridge_get_underflow_count(struct SoundIoBridge *bridge) {
+    return SOUNDIO_ATOMIC_LOAD(bridge->underflow_count);
+}
+
+long soundio_bridge_get_overflow_count(struct SoundIoBridge *bridge) {
+    return SOUNDIO_ATOMIC_LOAD(bridge->overflow_count);
+}
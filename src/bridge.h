@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_BRIDGE_H
+#define SOUNDIO_BRIDGE_H
+
+#include "ring_buffer.h"
+#include "resampler.h"
+#include "atomics.h"
+
+#include <stdbool.h>
+
+// Steers how fast the output side consumes input so that the latency
+// through the bridge settles on a target. The latency is measured once per
+// write callback, which makes it a sawtooth at the period of the input, so
+// it is smoothed before going into a PI controller. The integral term ends
+// up as the ratio of the two clocks.
+struct SoundIoBridgeControl {
+    double target;
+    double smoothed;
+    double integral;
+    bool settled;
+};
+
+void soundio_bridge_control_reset(struct SoundIoBridgeControl *control, double target);
+// `latency` and `dt` in seconds. Returns how much faster than nominal to
+// consume input.
+double soundio_bridge_control_update(struct SoundIoBridgeControl *control, double latency, double dt);
+// Parts per million that the input clock runs faster than the output clock.
+double soundio_bridge_control_drift_ppm(const struct SoundIoBridgeControl *control);
+
+struct SoundIoBridge {
+    struct SoundIoInStream *instream;
+    struct SoundIoOutStream *outstream;
+    int channel_count;
+    enum SoundIoFormat in_format;
+    enum SoundIoFormat out_format;
+    int in_rate;
+    int out_rate;
+    int target_frames;
+    // Float32NE interleaved frames at the input rate.
+    struct SoundIoRingBuffer ring_buffer;
+    int bytes_per_frame;
+    // Set by the read side when input had to be dropped.
+    struct SoundIoAtomicFlag no_overflow;
+
+    // Write callback only.
+    struct SoundIoResampler resampler;
+    struct SoundIoBridgeControl control;
+    bool priming;
+    double last_time;
+    float silence;
+
+    // Published by the write callback, for any thread to read.
+    struct SoundIoAtomicLong latency_us;
+    struct SoundIoAtomicLong drift_ppb;
+    struct SoundIoAtomicLong underflow_count;
+    struct SoundIoAtomicLong overflow_count;
+};
+
+#endif
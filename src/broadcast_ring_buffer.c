@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "broadcast_ring_buffer.h"
+#include "soundio_private.h"
+#include "util.h"
+
+#include <stdlib.h>
+
+struct SoundIoBroadcastRingBuffer *soundio_broadcast_ring_buffer_create(struct SoundIo *soundio,
+        int requested_capacity, int max_readers, enum SoundIoBroadcastPolicy policy)
+{
+    struct SoundIoBroadcastRingBuffer *rb = ALLOCATE(struct SoundIoBroadcastRingBuffer, 1);
+
+    assert(requested_capacity > 0);
+    assert(max_readers > 0);
+
+    if (!rb) {
+        soundio_broadcast_ring_buffer_destroy(rb);
+        return NULL;
+    }
+
+    int os_flags = (soundio && soundio->lock_memory) ? SoundIoOsMemoryFlagLock : 0;
+    if (soundio_broadcast_ring_buffer_init(rb, requested_capacity, max_readers, policy, os_flags)) {
+        soundio_broadcast_ring_buffer_destroy(rb);
+        return NULL;
+    }
+
+    return rb;
+}
+
+void soundio_broadcast_ring_buffer_destroy(struct SoundIoBroadcastRingBuffer *rb) {
+    if (!rb)
+        return;
+
+    soundio_broadcast_ring_buffer_deinit(rb);
+
+    free(rb);
+}
+
+int soundio_broadcast_ring_buffer_capacity(struct SoundIoBroadcastRingBuffer *rb) {
+    return rb->capacity;
+}
+
+int soundio_broadcast_ring_buffer_free_count(struct SoundIoBroadcastRingBuffer *rb) {
+    if (rb->policy == SoundIoBroadcastPolicyOverwrite)
+        return rb->capacity;
+
+    size_t write_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->write_offset);
+    int free_count = rb->capacity;
+    for (int i = 0; i < rb->max_readers; i += 1) {
+        struct SoundIoBroadcastReader *reader = &rb->readers[i];
+        if (!SOUNDIO_ATOMIC_LOAD_ACQUIRE(reader->active))
+            continue;
+        size_t read_offset = SOUNDIO_ATOMIC_LOAD_ACQUIRE(reader->read_offset);
+        free_count = soundio_int_min(free_count, rb->capacity - (int)(write_offset - read_offset));
+    }
+    return soundio_int_max(free_count, 0);
+}
+
+int soundio_broadcast_ring_buffer_reserve_write(struct SoundIoBroadcastRingBuffer *rb,
+        int min_count, int max_count, char **out_ptr, int *out_count)
+{
+    if (min_count < 0 || min_count > max_count)
+        return SoundIoErrorInvalid;
+
+    size_t write_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->write_offset);
+    int count = soundio_int_min(soundio_broadcast_ring_buffer_free_count(rb), max_count);
+    if (count < min_count)
+        count = 0;
+
+    if (count > 0 && rb->policy == SoundIoBroadcastPolicyOverwrite) {
+        // Readers must see the new reserve_end before they can see any of
+        // the bytes about to be written. See commit_read. It never moves
+        // back: an earlier, longer reservation may have written further.
+        size_t reserve_end = write_offset + count;
+        if ((ptrdiff_t)(SOUNDIO_ATOMIC_LOAD_RELAXED(rb->reserve_end) - reserve_end) < 0)
+            SOUNDIO_ATOMIC_STORE_RELAXED(rb->reserve_end, reserve_end);
+        SOUNDIO_ATOMIC_FENCE_RELEASE();
+    }
+
+    *out_ptr = rb->mem.address + (write_offset % rb->capacity);
+    *out_count = count;
+    return 0;
+}
+
+void soundio_broadcast_ring_buffer_commit_write(struct SoundIoBroadcastRingBuffer *rb, int count) {
+    assert(count >= 0);
+    size_t write_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->write_offset);
+    assert(rb->policy != SoundIoBroadcastPolicyOverwrite ||
+            (ptrdiff_t)(SOUNDIO_ATOMIC_LOAD_RELAXED(rb->reserve_end) - (write_offset + count)) >= 0);
+    SOUNDIO_ATOMIC_STORE_RELEASE(rb->write_offset, write_offset + count);
+}
+
+int soundio_broadcast_ring_buffer_add_reader(struct SoundIoBroadcastRingBuffer *rb, int *out_reader) {
+    for (int i = 0; i < rb->max_readers; i += 1) {
+        struct SoundIoBroadcastReader *reader = &rb->readers[i];
+        if (SOUNDIO_ATOMIC_EXCHANGE(reader->in_use, true))
+            continue;
+
+        reader->overrun_bytes = 0;
+        SOUNDIO_ATOMIC_STORE(reader->read_offset, SOUNDIO_ATOMIC_LOAD(rb->write_offset));
+        SOUNDIO_ATOMIC_STORE(reader->active, true);
+        // The writer may have gone ahead based on the other readers before it
+        // saw this one, so catch up once more now that it is visible.
+        SOUNDIO_ATOMIC_STORE(reader->read_offset, SOUNDIO_ATOMIC_LOAD(rb->write_offset));
+
+        *out_reader = i;
+        return 0;
+    }
+    return SoundIoErrorSystemResources;
+}
+
+void soundio_broadcast_ring_buffer_remove_reader(struct SoundIoBroadcastRingBuffer *rb, int reader_index) {
+    assert(reader_index >= 0 && reader_index < rb->max_readers);
+    struct SoundIoBroadcastReader *reader = &rb->readers[reader_index];
+    SOUNDIO_ATOMIC_STORE(reader->active, false);
+    SOUNDIO_ATOMIC_STORE(reader->in_use, false);
+}
+
+// Returns the reader's offset, first moving it past anything the writer has
+// overwritten or might be overwriting right now.
+static size_t reader_sync(struct SoundIoBroadcastRingBuffer *rb,
+        struct SoundIoBroadcastReader *reader, size_t *out_write_offset)
+{
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(reader->read_offset);
+    *out_write_offset = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->write_offset);
+    if (rb->policy == SoundIoBroadcastPolicyOverwrite) {
+        size_t oldest = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->reserve_end) - rb->capacity;
+        if ((ptrdiff_t)(oldest - read_offset) > 0) {
+            reader->overrun_bytes += oldest - read_offset;
+            read_offset = oldest;
+            SOUNDIO_ATOMIC_STORE_RELEASE(reader->read_offset, read_offset);
+        }
+    }
+    return read_offset;
+}
+
+int soundio_broadcast_ring_buffer_fill_count(struct SoundIoBroadcastRingBuffer *rb, int reader_index) {
+    assert(reader_index >= 0 && reader_index < rb->max_readers);
+    size_t write_offset;
+    size_t read_offset = reader_sync(rb, &rb->readers[reader_index], &write_offset);
+    return (int)(write_offset - read_offset);
+}
+
+int soundio_broadcast_ring_buffer_reserve_read(struct SoundIoBroadcastRingBuffer *rb, int reader_index,
+        int min_count, int max_count, char **out_ptr, int *out_count)
+{
+    assert(reader_index >= 0 && reader_index < rb->max_readers);
+    if (min_count < 0 || min_count > max_count)
+        return SoundIoErrorInvalid;
+
+    size_t write_offset;
+    size_t read_offset = reader_sync(rb, &rb->readers[reader_index], &write_offset);
+    int count = soundio_int_min((int)(write_offset - read_offset), max_count);
+    if (count < min_count)
+        count = 0;
+
+    *out_ptr = rb->mem.address + (read_offset % rb->capacity);
+    *out_count = count;
+    return 0;
+}
+
+int soundio_broadcast_ring_buffer_commit_read(struct SoundIoBroadcastRingBuffer *rb, int reader_index,
+        int count)
+{
+    assert(reader_index >= 0 && reader_index < rb->max_readers);
+    assert(count >= 0);
+    struct SoundIoBroadcastReader *reader = &rb->readers[reader_index];
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(reader->read_offset);
+    size_t new_offset = read_offset + count;
+
+    if (rb->policy == SoundIoBroadcastPolicyOverwrite) {
+        // Pairs with the fence in reserve_write: if any byte the caller read
+        // belonged to a newer span, the reservation of that span is visible.
+        SOUNDIO_ATOMIC_FENCE_ACQUIRE();
+        size_t oldest = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->reserve_end) - rb->capacity;
+        if ((ptrdiff_t)(oldest - read_offset) > 0) {
+            reader->overrun_bytes += oldest - read_offset;
+            if ((ptrdiff_t)(oldest - new_offset) > 0)
+                new_offset = oldest;
+            SOUNDIO_ATOMIC_STORE_RELEASE(reader->read_offset, new_offset);
+            return SoundIoErrorOverflow;
+        }
+    } else {
+        assert(count <= (int)(SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->write_offset) - read_offset));
+    }
+
+    SOUNDIO_ATOMIC_STORE_RELEASE(reader->read_offset, new_offset);
+    return 0;
+}
+
+long soundio_broadcast_ring_buffer_overrun_count(struct SoundIoBroadcastRingBuffer *rb, int reader_index) {
+    assert(reader_index >= 0 && reader_index < rb->max_readers);
+    return rb->readers[reader_index].overrun_bytes;
+}
+
+int soundio_broadcast_ring_buffer_init(struct SoundIoBroadcastRingBuffer *rb, int requested_capacity,
+        int max_readers, int policy, int os_flags)
+{
+    int err;
+    if ((err = soundio_os_init_mirrored_memory_flags(&rb->mem, requested_capacity, os_flags, NULL)))
+        return err;
+    rb->capacity = rb->mem.capacity;
+    rb->policy = policy;
+    rb->max_readers = max_readers;
+    rb->readers = ALLOCATE(struct SoundIoBroadcastReader, max_readers);
+    if (!rb->readers) {
+        soundio_broadcast_ring_buffer_deinit(rb);
+        return SoundIoErrorNoMem;
+    }
+    for (int i = 0; i < max_readers; i += 1) {
+        SOUNDIO_ATOMIC_STORE(rb->readers[i].in_use, false);
+        SOUNDIO_ATOMIC_STORE(rb->readers[i].active, false);
+        SOUNDIO_ATOMIC_STORE(rb->readers[i].read_offset, 0);
+    }
+    SOUNDIO_ATOMIC_STORE(rb->write_offset, 0);
+    // Nothing has been written yet, so nothing counts as overwritten.
+    SOUNDIO_ATOMIC_STORE(rb->reserve_end, rb->capacity);
+    return 0;
+}
+
+void soundio_broadcast_ring_buffer_deinit(struct SoundIoBroadcastRingBuffer *rb) {
+    free(rb->readers);
+    rb->readers = NULL;
+    soundio_os_deinit_mirrored_memory(&rb->mem);
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_BROADCAST_RING_BUFFER_H
+#define SOUNDIO_BROADCAST_RING_BUFFER_H
+
+#include "os.h"
+#include "atomics.h"
+
+// Each reader owns a cache line so that readers do not slow each other down.
+// The writer loads every active reader's offset, but only when it reserves.
+struct SoundIoBroadcastReader {
+    char pad0[SOUNDIO_CACHE_LINE_SIZE];
+    // Claimed by add_reader.
+    struct SoundIoAtomicBool in_use;
+    // Whether the writer has to respect read_offset.
+    struct SoundIoAtomicBool active;
+    struct SoundIoAtomicSize read_offset;
+    // Reader only. Bytes skipped because the writer overwrote them.
+    long overrun_bytes;
+};
+
+// Offsets only ever grow. Counts are differences of offsets, which stay
+// correct when an offset wraps around, but offset % capacity only stays
+// continuous across the wrap if capacity is a power of two, which it need not
+// be. With 64-bit size_t that takes longer than any stream runs.
+struct SoundIoBroadcastRingBuffer {
+    struct SoundIoOsMirroredMemory mem;
+    int capacity;
+    int policy;
+    int max_readers;
+    struct SoundIoBroadcastReader *readers;
+
+    // Writer. reserve_end is the end of the last span the writer reserved,
+    // stored before it writes any byte of that span. In overwrite mode
+    // readers compare against it after reading to find out whether what they
+    // read was overwritten in the meantime.
+    char pad0[SOUNDIO_CACHE_LINE_SIZE];
+    struct SoundIoAtomicSize write_offset;
+    struct SoundIoAtomicSize reserve_end;
+
+    char pad1[SOUNDIO_CACHE_LINE_SIZE];
+};
+
+// policy is a SoundIoBroadcastPolicy
+int soundio_broadcast_ring_buffer_init(struct SoundIoBroadcastRingBuffer *rb, int requested_capacity,
+        int max_readers, int policy, int os_flags);
+void soundio_broadcast_ring_buffer_deinit(struct SoundIoBroadcastRingBuffer *rb);
+
+#endif
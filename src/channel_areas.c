@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "convert.h"
+#include "util.h"
+
+#include <string.h>
+
+// Interleave or deinterleave a fixed number of channels of a fixed sample
+// size. A kernel handles any frame count, including its own tail.
+typedef void (*InterleaveKernel)(char *dst, char *const *planes, size_t frame_count);
+typedef void (*DeinterleaveKernel)(char *const *planes, const char *src, size_t frame_count);
+
+// Indexed by SoundIoSimdLevel. NULL means use the generic loops.
+struct AreaKernels {
+    InterleaveKernel interleave_2x16;
+    InterleaveKernel interleave_2x32;
+    InterleaveKernel interleave_8x32;
+    DeinterleaveKernel deinterleave_2x16;
+    DeinterleaveKernel deinterleave_2x32;
+    DeinterleaveKernel deinterleave_8x32;
+};
+
+// The switch is outside of the loop so that each common size gets a loop
+// with a fixed size memcpy, which compiles to a single load and store.
+#define COPY_STRIDED_LOOP(size) \
+    for (size_t i = 0; i < count; i += 1) { \
+        memcpy(dst, src, size); \
+        dst += dst_step; \
+        src += src_step; \
+    }
+
+static void copy_strided(char *dst, ptrdiff_t dst_step, const char *src, ptrdiff_t src_step,
+        size_t count, int bytes)
+{
+    switch (bytes) {
+        case 1: COPY_STRIDED_LOOP(1); break;
+        case 2: COPY_STRIDED_LOOP(2); break;
+        case 3: COPY_STRIDED_LOOP(3); break;
+        case 4: COPY_STRIDED_LOOP(4); break;
+        case 8: COPY_STRIDED_LOOP(8); break;
+        default: COPY_STRIDED_LOOP((size_t)bytes); break;
+    }
+}
+
+// Frames `start` up to `end`.
+static void interleave_range(char *dst, char *const *planes, int channel_count, int bytes,
+        size_t start, size_t end)
+{
+    ptrdiff_t frame_bytes = (ptrdiff_t)channel_count * bytes;
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        copy_strided(dst + start * frame_bytes + ch * bytes, frame_bytes,
+                planes[ch] + start * bytes, bytes, end - start, bytes);
+    }
+}
+
+static void deinterleave_range(char *const *planes, const char *src, int channel_count, int bytes,
+        size_t start, size_t end)
+{
+    ptrdiff_t frame_bytes = (ptrdiff_t)channel_count * bytes;
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        copy_strided(planes[ch] + start * bytes, bytes,
+                src + start * frame_bytes + ch * bytes, frame_bytes, end - start, bytes);
+    }
+}
+
+#if defined(SOUNDIO_SIMD_X86)
+
+SOUNDIO_TARGET_SSE2
+static void interleave_2x16_sse2(char *dst, char *const *planes, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 8 <= frame_count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(planes[0] + i * 2));
+        __m128i b = _mm_loadu_si128((const __m128i *)(planes[1] + i * 2));
+        _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_unpacklo_epi16(a, b));
+        _mm_storeu_si128((__m128i *)(dst + i * 4 + 16), _mm_unpackhi_epi16(a, b));
+    }
+    interleave_range(dst, planes, 2, 2, i, frame_count);
+}
+
+SOUNDIO_TARGET_SSE2
+static void interleave_2x32_sse2(char *dst, char *const *planes, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 4 <= frame_count; i += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(planes[0] + i * 4));
+        __m128i b = _mm_loadu_si128((const __m128i *)(planes[1] + i * 4));
+        _mm_storeu_si128((__m128i *)(dst + i * 8), _mm_unpacklo_epi32(a, b));
+        _mm_storeu_si128((__m128i *)(dst + i * 8 + 16), _mm_unpackhi_epi32(a, b));
+    }
+    interleave_range(dst, planes, 2, 4, i, frame_count);
+}
+
+// Two 4x4 transposes: the first four channels and the last four.
+SOUNDIO_TARGET_SSE2
+static void interleave_8x32_sse2(char *dst, char *const *planes, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 4 <= frame_count; i += 4) {
+        __m128 r[8];
+        for (int ch = 0; ch < 8; ch += 1)
+            r[ch] = _mm_loadu_ps((const float *)(planes[ch] + i * 4));
+        _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+        _MM_TRANSPOSE4_PS(r[4], r[5], r[6], r[7]);
+        float *out = (float *)(dst + i * 32);
+        for (int frame = 0; frame < 4; frame += 1) {
+            _mm_storeu_ps(out + frame * 8, r[frame]);
+            _mm_storeu_ps(out + frame * 8 + 4, r[frame + 4]);
+        }
+    }
+    interleave_range(dst, planes, 8, 4, i, frame_count);
+}
+
+// Sign extending the low halves keeps packs from saturating, so it only
+// moves bits around.
+SOUNDIO_TARGET_SSE2
+static void deinterleave_2x16_sse2(char *const *planes, const char *src, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 8 <= frame_count; i += 8) {
+        __m128i x0 = _mm_loadu_si128((const __m128i *)(src + i * 4));
+        __m128i x1 = _mm_loadu_si128((const __m128i *)(src + i * 4 + 16));
+        __m128i a = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(x0, 16), 16),
+                _mm_srai_epi32(_mm_slli_epi32(x1, 16), 16));
+        __m128i b = _mm_packs_epi32(_mm_srai_epi32(x0, 16), _mm_srai_epi32(x1, 16));
+        _mm_storeu_si128((__m128i *)(planes[0] + i * 2), a);
+        _mm_storeu_si128((__m128i *)(planes[1] + i * 2), b);
+    }
+    deinterleave_range(planes, src, 2, 2, i, frame_count);
+}
+
+SOUNDIO_TARGET_SSE2
+static void deinterleave_2x32_sse2(char *const *planes, const char *src, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 4 <= frame_count; i += 4) {
+        __m128 x0 = _mm_loadu_ps((const float *)(src + i * 8));
+        __m128 x1 = _mm_loadu_ps((const float *)(src + i * 8 + 16));
+        _mm_storeu_ps((float *)(planes[0] + i * 4), _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps((float *)(planes[1] + i * 4), _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    deinterleave_range(planes, src, 2, 4, i, frame_count);
+}
+
+SOUNDIO_TARGET_SSE2
+static void deinterleave_8x32_sse2(char *const *planes, const char *src, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 4 <= frame_count; i += 4) {
+        const float *in = (const float *)(src + i * 32);
+        __m128 r[8];
+        for (int frame = 0; frame < 4; frame += 1) {
+            r[frame] = _mm_loadu_ps(in + frame * 8);
+            r[frame + 4] = _mm_loadu_ps(in + frame * 8 + 4);
+        }
+        _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+        _MM_TRANSPOSE4_PS(r[4], r[5], r[6], r[7]);
+        for (int ch = 0; ch < 8; ch += 1)
+            _mm_storeu_ps((float *)(planes[ch] + i * 4), r[ch]);
+    }
+    deinterleave_range(planes, src, 8, 4, i, frame_count);
+}
+
+// The 128 bit lanes are interleaved separately, then put back in order.
+SOUNDIO_TARGET_AVX2
+static void interleave_2x16_avx2(char *dst, char *const *planes, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 16 <= frame_count; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(planes[0] + i * 2));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(planes[1] + i * 2));
+        __m256i lo = _mm256_unpacklo_epi16(a, b);
+        __m256i hi = _mm256_unpackhi_epi16(a, b);
+        _mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + i * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    _mm256_zeroupper();
+    interleave_range(dst, planes, 2, 2, i, frame_count);
+}
+
+SOUNDIO_TARGET_AVX2
+static void interleave_2x32_avx2(char *dst, char *const *planes, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 8 <= frame_count; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(planes[0] + i * 4));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(planes[1] + i * 4));
+        __m256i lo = _mm256_unpacklo_epi32(a, b);
+        __m256i hi = _mm256_unpackhi_epi32(a, b);
+        _mm256_storeu_si256((__m256i *)(dst + i * 8), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + i * 8 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    _mm256_zeroupper();
+    interleave_range(dst, planes, 2, 4, i, frame_count);
+}
+
+// Its own inverse, so it serves both directions.
+SOUNDIO_TARGET_AVX2
+static inline void transpose_8x8(__m256 *r) {
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+    __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+    __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+    __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+    r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+    r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+    r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+    r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+    r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+    r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+    r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+SOUNDIO_TARGET_AVX2
+static void interleave_8x32_avx2(char *dst, char *const *planes, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 8 <= frame_count; i += 8) {
+        __m256 r[8];
+        for (int ch = 0; ch < 8; ch += 1)
+            r[ch] = _mm256_loadu_ps((const float *)(planes[ch] + i * 4));
+        transpose_8x8(r);
+        float *out = (float *)(dst + i * 32);
+        for (int frame = 0; frame < 8; frame += 1)
+            _mm256_storeu_ps(out + frame * 8, r[frame]);
+    }
+    _mm256_zeroupper();
+    interleave_range(dst, planes, 8, 4, i, frame_count);
+}
+
+// packs works within 128 bit lanes, leaving the 64 bit quarters in the
+// order 0, 2, 1, 3.
+SOUNDIO_TARGET_AVX2
+static void deinterleave_2x16_avx2(char *const *planes, const char *src, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 16 <= frame_count; i += 16) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+        __m256i x1 = _mm256_loadu_si256((const __m256i *)(src + i * 4 + 32));
+        __m256i a = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(x0, 16), 16),
+                _mm256_srai_epi32(_mm256_slli_epi32(x1, 16), 16));
+        __m256i b = _mm256_packs_epi32(_mm256_srai_epi32(x0, 16), _mm256_srai_epi32(x1, 16));
+        _mm256_storeu_si256((__m256i *)(planes[0] + i * 2), _mm256_permute4x64_epi64(a, 0xd8));
+        _mm256_storeu_si256((__m256i *)(planes[1] + i * 2), _mm256_permute4x64_epi64(b, 0xd8));
+    }
+    _mm256_zeroupper();
+    deinterleave_range(planes, src, 2, 2, i, frame_count);
+}
+
+SOUNDIO_TARGET_AVX2
+static void deinterleave_2x32_avx2(char *const *planes, const char *src, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 8 <= frame_count; i += 8) {
+        __m256 x0 = _mm256_loadu_ps((const float *)(src + i * 8));
+        __m256 x1 = _mm256_loadu_ps((const float *)(src + i * 8 + 32));
+        __m256d a = _mm256_castps_pd(_mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m256d b = _mm256_castps_pd(_mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm256_storeu_pd((double *)(planes[0] + i * 4), _mm256_permute4x64_pd(a, 0xd8));
+        _mm256_storeu_pd((double *)(planes[1] + i * 4), _mm256_permute4x64_pd(b, 0xd8));
+    }
+    _mm256_zeroupper();
+    deinterleave_range(planes, src, 2, 4, i, frame_count);
+}
+
+SOUNDIO_TARGET_AVX2
+static void deinterleave_8x32_avx2(char *const *planes, const char *src, size_t frame_count) {
+    size_t i = 0;
+    for (; i + 8 <= frame_count; i += 8) {
+        const float *in = (const float *)(src + i * 32);
+        __m256 r[8];
+        for (int frame = 0; frame < 8; frame += 1)
+            r[frame] = _mm256_loadu_ps(in + frame * 8);
+        transpose_8x8(r);
+        for (int ch = 0; ch < 8; ch += 1)
+            _mm256_storeu_ps((float *)(planes[ch] + i * 4), r[ch]);
+    }
+    _mm256_zeroupper();
+    deinterleave_range(planes, src, 8, 4, i, frame_count);
+}
+
+#endif
+
+static const struct AreaKernels kernels[] = {
+    {NULL, NULL, NULL, NULL, NULL, NULL},
+#if defined(SOUNDIO_SIMD_X86)
+    {
+        interleave_2x16_sse2,
+        interleave_2x32_sse2,
+        interleave_8x32_sse2,
+        deinterleave_2x16_sse2,
+        deinterleave_2x32_sse2,
+        deinterleave_8x32_sse2,
+    },
+    {
+        interleave_2x16_avx2,
+        interleave_2x32_avx2,
+        interleave_8x32_avx2,
+        deinterleave_2x16_avx2,
+        deinterleave_2x32_avx2,
+        deinterleave_8x32_avx2,
+    },
+#endif
+};
+
+static void interleave(char *dst, char *const *planes, int channel_count, size_t frame_count, int bytes) {
+    const struct AreaKernels *k = &kernels[soundio_convert_get_simd_level()];
+    InterleaveKernel kernel = NULL;
+    if (channel_count == 2 && bytes == 2)
+        kernel = k->interleave_2x16;
+    else if (channel_count == 2 && bytes == 4)
+        kernel = k->interleave_2x32;
+    else if (channel_count == 8 && bytes == 4)
+        kernel = k->interleave_8x32;
+
+    if (kernel)
+        kernel(dst, planes, frame_count);
+    else
+        interleave_range(dst, planes, channel_count, bytes, 0, frame_count);
+}
+
+static void deinterleave(char *const *planes, const char *src, int channel_count, size_t frame_count, int bytes) {
+    const struct AreaKernels *k = &kernels[soundio_convert_get_simd_level()];
+    DeinterleaveKernel kernel = NULL;
+    if (channel_count == 2 && bytes == 2)
+        kernel = k->deinterleave_2x16;
+    else if (channel_count == 2 && bytes == 4)
+        kernel = k->deinterleave_2x32;
+    else if (channel_count == 8 && bytes == 4)
+        kernel = k->deinterleave_8x32;
+
+    if (kernel)
+        kernel(planes, src, frame_count);
+    else
+        deinterleave_range(planes, src, channel_count, bytes, 0, frame_count);
+}
+
+void soundio_interleave(char *dst, char *const *src_planes, int channel_count, int frame_count,
+        int bytes_per_sample)
+{
+    if (channel_count <= 0 || frame_count <= 0 || bytes_per_sample <= 0)
+        return;
+    if (channel_count == 1) {
+        memcpy(dst, src_planes[0], (size_t)frame_count * bytes_per_sample);
+        return;
+    }
+    interleave(dst, src_planes, channel_count, frame_count, bytes_per_sample);
+}
+
+void soundio_deinterleave(char *const *dst_planes, const char *src, int channel_count, int frame_count,
+        int bytes_per_sample)
+{
+    if (channel_count <= 0 || frame_count <= 0 || bytes_per_sample <= 0)
+        return;
+    if (channel_count == 1) {
+        memcpy(dst_planes[0], src, (size_t)frame_count * bytes_per_sample);
+        return;
+    }
+    deinterleave(dst_planes, src, channel_count, frame_count, bytes_per_sample);
+}
+
+static bool is_planar(const struct SoundIoChannelArea *areas, int channel_count, int bytes) {
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        if (areas[ch].step != bytes)
+            return false;
+    }
+    return true;
+}
+
+void soundio_channel_areas_copy(const struct SoundIoChannelArea *dst_areas,
+        const struct SoundIoChannelArea *src_areas, int channel_count, int frame_count,
+        int bytes_per_sample)
+{
+    if (channel_count <= 0 || frame_count <= 0 || bytes_per_sample <= 0)
+        return;
+
+    bool dst_interleaved = soundio_channel_areas_interleaved(dst_areas, channel_count, bytes_per_sample);
+    bool src_interleaved = soundio_channel_areas_interleaved(src_areas, channel_count, bytes_per_sample);
+    if (dst_interleaved && src_interleaved) {
+        memcpy(dst_areas[0].ptr, src_areas[0].ptr, (size_t)frame_count * channel_count * bytes_per_sample);
+        return;
+    }
+
+    if (channel_count <= SOUNDIO_MAX_CHANNELS) {
+        char *planes[SOUNDIO_MAX_CHANNELS];
+        if (dst_interleaved && is_planar(src_areas, channel_count, bytes_per_sample)) {
+            for (int ch = 0; ch < channel_count; ch += 1)
+                planes[ch] = src_areas[ch].ptr;
+            interleave(dst_areas[0].ptr, planes, channel_count, frame_count, bytes_per_sample);
+            return;
+        }
+        if (src_interleaved && is_planar(dst_areas, channel_count, bytes_per_sample)) {
+            for (int ch = 0; ch < channel_count; ch += 1)
+                planes[ch] = dst_areas[ch].ptr;
+            deinterleave(planes, src_areas[0].ptr, channel_count, frame_count, bytes_per_sample);
+            return;
+        }
+    }
+
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        if (dst_areas[ch].step == bytes_per_sample && src_areas[ch].step == bytes_per_sample) {
+            memcpy(dst_areas[ch].ptr, src_areas[ch].ptr, (size_t)frame_count * bytes_per_sample);
+        } else {
+            copy_strided(dst_areas[ch].ptr, dst_areas[ch].step, src_areas[ch].ptr, src_areas[ch].step,
+                    frame_count, bytes_per_sample);
+        }
+    }
+}
@@ -463,3 +463,118 @@ enum SoundIoChannelId soundio_parse_channel_id(const char *str, int str_len) {
     }
     return SoundIoChannelIdInvalid;
 }
+
+// Where a channel goes when the layout being mixed to does not have it, as
+// groups of channels with their gains, best first. The first group which
+// the layout has all of is used. If there is none, the last group is
+// folded further.
+struct RemixTarget {
+    enum SoundIoChannelId id;
+    float gain;
+};
+
+struct RemixRule {
+    enum SoundIoChannelId id;
+    struct RemixTarget groups[3][2];
+};
+
+#define MINUS_3DB 0.70710678f
+
+static const struct RemixRule remix_rules[] = {
+    {SoundIoChannelIdFrontLeft, {{{SoundIoChannelIdFrontCenter, MINUS_3DB}}}},
+    {SoundIoChannelIdFrontRight, {{{SoundIoChannelIdFrontCenter, MINUS_3DB}}}},
+    {SoundIoChannelIdFrontCenter, {{{SoundIoChannelIdFrontLeft, MINUS_3DB}, {SoundIoChannelIdFrontRight, MINUS_3DB}}}},
+    {SoundIoChannelIdLfe, {{{SoundIoChannelIdLeftLfe, MINUS_3DB}, {SoundIoChannelIdRightLfe, MINUS_3DB}}}},
+    {SoundIoChannelIdBackLeft, {{{SoundIoChannelIdSideLeft, 1.0f}}, {{SoundIoChannelIdFrontLeft, MINUS_3DB}}}},
+    {SoundIoChannelIdBackRight, {{{SoundIoChannelIdSideRight, 1.0f}}, {{SoundIoChannelIdFrontRight, MINUS_3DB}}}},
+    {SoundIoChannelIdFrontLeftCenter, {{{SoundIoChannelIdFrontLeft, MINUS_3DB}, {SoundIoChannelIdFrontCenter, MINUS_3DB}},
+        {{SoundIoChannelIdFrontLeft, 1.0f}}}},
+    {SoundIoChannelIdFrontRightCenter, {{{SoundIoChannelIdFrontRight, MINUS_3DB}, {SoundIoChannelIdFrontCenter, MINUS_3DB}},
+        {{SoundIoChannelIdFrontRight, 1.0f}}}},
+    {SoundIoChannelIdBackCenter, {{{SoundIoChannelIdBackLeft, MINUS_3DB}, {SoundIoChannelIdBackRight, MINUS_3DB}},
+        {{SoundIoChannelIdSideLeft, MINUS_3DB}, {SoundIoChannelIdSideRight, MINUS_3DB}}}},
+    {SoundIoChannelIdSideLeft, {{{SoundIoChannelIdBackLeft, 1.0f}}, {{SoundIoChannelIdFrontLeft, MINUS_3DB}}}},
+    {SoundIoChannelIdSideRight, {{{SoundIoChannelIdBackRight, 1.0f}}, {{SoundIoChannelIdFrontRight, MINUS_3DB}}}},
+    {SoundIoChannelIdTopCenter, {{{SoundIoChannelIdFrontLeft, 0.5f}, {SoundIoChannelIdFrontRight, 0.5f}}}},
+    {SoundIoChannelIdTopFrontLeft, {{{SoundIoChannelIdFrontLeft, MINUS_3DB}}}},
+    {SoundIoChannelIdTopFrontCenter, {{{SoundIoChannelIdFrontCenter, MINUS_3DB}}}},
+    {SoundIoChannelIdTopFrontRight, {{{SoundIoChannelIdFrontRight, MINUS_3DB}}}},
+    {SoundIoChannelIdTopBackLeft, {{{SoundIoChannelIdBackLeft, MINUS_3DB}}}},
+    {SoundIoChannelIdTopBackCenter, {{{SoundIoChannelIdBackCenter, MINUS_3DB}}}},
+    {SoundIoChannelIdTopBackRight, {{{SoundIoChannelIdBackRight, MINUS_3DB}}}},
+    {SoundIoChannelIdBackLeftCenter, {{{SoundIoChannelIdBackLeft, 1.0f}}, {{SoundIoChannelIdSideLeft, 1.0f}}}},
+    {SoundIoChannelIdBackRightCenter, {{{SoundIoChannelIdBackRight, 1.0f}}, {{SoundIoChannelIdSideRight, 1.0f}}}},
+    {SoundIoChannelIdFrontLeftWide, {{{SoundIoChannelIdFrontLeft, 1.0f}}}},
+    {SoundIoChannelIdFrontRightWide, {{{SoundIoChannelIdFrontRight, 1.0f}}}},
+    {SoundIoChannelIdFrontLeftHigh, {{{SoundIoChannelIdFrontLeft, 1.0f}}}},
+    {SoundIoChannelIdFrontCenterHigh, {{{SoundIoChannelIdFrontCenter, 1.0f}}}},
+    {SoundIoChannelIdFrontRightHigh, {{{SoundIoChannelIdFrontRight, 1.0f}}}},
+    {SoundIoChannelIdTopFrontLeftCenter, {{{SoundIoChannelIdTopFrontLeft, 1.0f}}}},
+    {SoundIoChannelIdTopFrontRightCenter, {{{SoundIoChannelIdTopFrontRight, 1.0f}}}},
+    {SoundIoChannelIdTopSideLeft, {{{SoundIoChannelIdSideLeft, MINUS_3DB}}}},
+    {SoundIoChannelIdTopSideRight, {{{SoundIoChannelIdSideRight, MINUS_3DB}}}},
+    {SoundIoChannelIdLeftLfe, {{{SoundIoChannelIdLfe, 1.0f}}}},
+    {SoundIoChannelIdRightLfe, {{{SoundIoChannelIdLfe, 1.0f}}}},
+    {SoundIoChannelIdLfe2, {{{SoundIoChannelIdLfe, 1.0f}}}},
+    {SoundIoChannelIdHeadphonesLeft, {{{SoundIoChannelIdFrontLeft, 1.0f}}}},
+    {SoundIoChannelIdHeadphonesRight, {{{SoundIoChannelIdFrontRight, 1.0f}}}},
+};
+
+// Deep enough for a top back channel to reach the front.
+#define REMIX_MAX_DEPTH 4
+
+static void remix_add(float *matrix, const struct SoundIoChannelLayout *to, int column, int column_count,
+        enum SoundIoChannelId id, float gain, int depth)
+{
+    int row = soundio_channel_layout_find_channel(to, id);
+    if (row >= 0) {
+        matrix[row * column_count + column] += gain;
+        return;
+    }
+    if (depth == 0)
+        return;
+
+    const struct RemixRule *rule = NULL;
+    for (int i = 0; i < ARRAY_LENGTH(remix_rules); i += 1) {
+        if (remix_rules[i].id == id) {
+            rule = &remix_rules[i];
+            break;
+        }
+    }
+    // Anything else, such as ambisonics or aux channels, is dropped.
+    if (!rule)
+        return;
+
+    const struct RemixTarget *group = NULL;
+    for (int g = 0; g < 3 && rule->groups[g][0].id != SoundIoChannelIdInvalid; g += 1) {
+        group = rule->groups[g];
+        bool has_all = true;
+        for (int t = 0; t < 2 && group[t].id != SoundIoChannelIdInvalid; t += 1)
+            has_all = has_all && soundio_channel_layout_find_channel(to, group[t].id) >= 0;
+        if (has_all)
+            break;
+    }
+    for (int t = 0; t < 2 && group[t].id != SoundIoChannelIdInvalid; t += 1)
+        remix_add(matrix, to, column, column_count, group[t].id, gain * group[t].gain, depth - 1);
+}
+
+void soundio_channel_layout_remix_matrix(const struct SoundIoChannelLayout *from,
+        const struct SoundIoChannelLayout *to, float *matrix)
+{
+    int row_count = to->channel_count;
+    int column_count = from->channel_count;
+    memset(matrix, 0, (size_t)row_count * column_count * sizeof(float));
+    for (int column = 0; column < column_count; column += 1)
+        remix_add(matrix, to, column, column_count, from->channels[column], 1.0f, REMIX_MAX_DEPTH);
+
+    // A full scale signal in every channel must not clip.
+    float max_sum = 1.0f;
+    for (int row = 0; row < row_count; row += 1) {
+        float sum = 0.0f;
+        for (int column = 0; column < column_count; column += 1)
+            sum += matrix[row * column_count + column];
+        max_sum = (sum > max_sum) ? sum : max_sum;
+    }
+    for (int i = 0; i < row_count * column_count; i += 1)
+        matrix[i] /= max_sum;
+}
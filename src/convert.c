@@ -0,0 +1,801 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "convert.h"
+#include "atomics.h"
+#include "util.h"
+
+#include <string.h>
+
+// Conversions between integer and float formats go through int32 in two
+// steps: scaling, clamping and rounding to the integer range of the format,
+// and packing to or unpacking from its bytes. Each step has a scalar, an SSE2
+// and an AVX2 kernel working on contiguous samples, and the steps meet in a
+// small buffer which stays in L1. Every kernel produces exactly what the
+// scalar one does, so results do not depend on the CPU:
+//  * scales are powers of two, so scaling never rounds;
+//  * float to integer rounds half to even, like the SSE conversions do with
+//    the default rounding mode, and clamps to full scale, with NaN going to
+//    negative full scale;
+//  * integer to float rounds the integer to float first, and scales after.
+// Conversions which do not involve a native endian float on one side and an
+// integer format on the other only have a scalar path.
+
+struct ConvertKernels {
+    void (*float32_to_int32)(int32_t *dst, const float *src, size_t count, double scale);
+    void (*float64_to_int32)(int32_t *dst, const double *src, size_t count, double scale);
+    void (*int32_to_float32)(float *dst, const int32_t *src, size_t count, double scale);
+    void (*int32_to_float64)(double *dst, const int32_t *src, size_t count, double scale);
+    void (*pack)(char *dst, const int32_t *src, size_t count, const struct SoundIoSampleFormat *format);
+    void (*unpack)(int32_t *dst, const char *src, size_t count, const struct SoundIoSampleFormat *format);
+};
+
+// How many samples go through the intermediate int32 buffer at a time.
+#define CONVERT_CHUNK_SIZE 256
+
+static bool is_big_endian_format(enum SoundIoFormat format) {
+    switch (format) {
+    case SoundIoFormatS16BE:
+    case SoundIoFormatU16BE:
+    case SoundIoFormatS24BE:
+    case SoundIoFormatU24BE:
+    case SoundIoFormatS24PackedBE:
+    case SoundIoFormatU24PackedBE:
+    case SoundIoFormatS32BE:
+    case SoundIoFormatU32BE:
+    case SoundIoFormatFloat32BE:
+    case SoundIoFormatFloat64BE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool is_unsigned_format(enum SoundIoFormat format) {
+    switch (format) {
+    case SoundIoFormatU8:
+    case SoundIoFormatU16LE:
+    case SoundIoFormatU16BE:
+    case SoundIoFormatU24LE:
+    case SoundIoFormatU24BE:
+    case SoundIoFormatU24PackedLE:
+    case SoundIoFormatU24PackedBE:
+    case SoundIoFormatU32LE:
+    case SoundIoFormatU32BE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static int format_bits(enum SoundIoFormat format) {
+    switch (format) {
+    case SoundIoFormatS8:
+    case SoundIoFormatU8:
+        return 8;
+    case SoundIoFormatS16LE:
+    case SoundIoFormatS16BE:
+    case SoundIoFormatU16LE:
+    case SoundIoFormatU16BE:
+        return 16;
+    case SoundIoFormatS24LE:
+    case SoundIoFormatS24BE:
+    case SoundIoFormatU24LE:
+    case SoundIoFormatU24BE:
+    case SoundIoFormatS24PackedLE:
+    case SoundIoFormatS24PackedBE:
+    case SoundIoFormatU24PackedLE:
+    case SoundIoFormatU24PackedBE:
+        return 24;
+    default:
+        return 32;
+    }
+}
+
+bool soundio_get_sample_format(enum SoundIoFormat format, struct SoundIoSampleFormat *out) {
+    int bytes = soundio_get_bytes_per_sample(format);
+    if (bytes <= 0)
+        return false;
+
+    memset(out, 0, sizeof(struct SoundIoSampleFormat));
+    out->bytes = bytes;
+    out->is_float = (format == SoundIoFormatFloat32LE || format == SoundIoFormatFloat32BE ||
+            format == SoundIoFormatFloat64LE || format == SoundIoFormatFloat64BE);
+#if defined(SOUNDIO_OS_BIG_ENDIAN)
+    out->swap = bytes > 1 && !is_big_endian_format(format);
+#else
+    out->swap = is_big_endian_format(format);
+#endif
+    if (out->is_float)
+        return true;
+
+    out->bits = format_bits(format);
+    out->scale = (double)((uint32_t)1 << (out->bits - 1));
+    out->bias = is_unsigned_format(format) ? (uint32_t)1 << (out->bits - 1) : 0;
+    out->mask = (out->bits == 24 && out->bias) ? 0xffffff : 0xffffffff;
+    return true;
+}
+
+static inline uint16_t bswap16(uint16_t x) {
+    return (uint16_t)((x << 8) | (x >> 8));
+}
+
+static inline uint32_t bswap32(uint32_t x) {
+    return (x << 24) | ((x & 0xff00) << 8) | ((x >> 8) & 0xff00) | (x >> 24);
+}
+
+static inline uint64_t bswap64(uint64_t x) {
+    return ((uint64_t)bswap32((uint32_t)x) << 32) | bswap32((uint32_t)(x >> 32));
+}
+
+static inline int32_t sign_extend(uint32_t x, int bits) {
+    if (bits == 32)
+        return (int32_t)x;
+    uint32_t sign = (uint32_t)1 << (bits - 1);
+    return (int32_t)((x & ((sign << 1) - 1)) ^ sign) - (int32_t)sign;
+}
+
+// Without libm, and without depending on the rounding mode.
+static inline int32_t round_half_even(double x) {
+    int64_t i = (int64_t)x;
+    double frac = x - (double)i;
+    if (frac > 0.5 || (frac == 0.5 && (i & 1)))
+        i += 1;
+    else if (frac < -0.5 || (frac == -0.5 && (i & 1)))
+        i -= 1;
+    return (int32_t)i;
+}
+
+static inline int32_t float_to_int32_one(double x, double scale) {
+    x *= scale;
+    // Written so that NaN ends up at the bottom.
+    if (!(x >= -scale))
+        x = -scale;
+    if (x > scale - 1.0)
+        x = scale - 1.0;
+    return round_half_even(x);
+}
+
+// Whether a packed 24 bit sample starts with its least significant byte.
+static inline bool is_lsb_first(const struct SoundIoSampleFormat *format) {
+#if defined(SOUNDIO_OS_BIG_ENDIAN)
+    return format->swap;
+#else
+    return !format->swap;
+#endif
+}
+
+static inline void pack_one(char *dst, int32_t value, const struct SoundIoSampleFormat *format) {
+    uint32_t x = ((uint32_t)value ^ format->bias) & format->mask;
+    if (format->bytes == 1) {
+        *dst = (char)(uint8_t)x;
+    } else if (format->bytes == 2) {
+        uint16_t x16 = (uint16_t)x;
+        if (format->swap)
+            x16 = bswap16(x16);
+        memcpy(dst, &x16, 2);
+    } else if (format->bytes == 3) {
+        int lsb = is_lsb_first(format) ? 0 : 2;
+        dst[lsb] = (char)(uint8_t)x;
+        dst[1] = (char)(uint8_t)(x >> 8);
+        dst[2 - lsb] = (char)(uint8_t)(x >> 16);
+    } else {
+        if (format->swap)
+            x = bswap32(x);
+        memcpy(dst, &x, 4);
+    }
+}
+
+static inline int32_t unpack_one(const char *src, const struct SoundIoSampleFormat *format) {
+    uint32_t x;
+    if (format->bytes == 1) {
+        x = (uint8_t)*src;
+    } else if (format->bytes == 2) {
+        uint16_t x16;
+        memcpy(&x16, src, 2);
+        x = format->swap ? bswap16(x16) : x16;
+    } else if (format->bytes == 3) {
+        int lsb = is_lsb_first(format) ? 0 : 2;
+        x = (uint32_t)(uint8_t)src[lsb] | (uint32_t)(uint8_t)src[1] << 8 |
+            (uint32_t)(uint8_t)src[2 - lsb] << 16;
+    } else {
+        memcpy(&x, src, 4);
+        if (format->swap)
+            x = bswap32(x);
+    }
+    return sign_extend(x ^ format->bias, format->bits);
+}
+
+// Any format to and from a double in the range -1.0 to 1.0.
+static double load_sample(const char *src, const struct SoundIoSampleFormat *format) {
+    if (!format->is_float)
+        return unpack_one(src, format) * (1.0 / format->scale);
+    if (format->bytes == 4) {
+        uint32_t x;
+        float value;
+        memcpy(&x, src, 4);
+        if (format->swap)
+            x = bswap32(x);
+        memcpy(&value, &x, 4);
+        return value;
+    } else {
+        uint64_t x;
+        double value;
+        memcpy(&x, src, 8);
+        if (format->swap)
+            x = bswap64(x);
+        memcpy(&value, &x, 8);
+        return value;
+    }
+}
+
+static void store_sample(char *dst, double value, const struct SoundIoSampleFormat *format) {
+    if (!format->is_float) {
+        pack_one(dst, float_to_int32_one(value, format->scale), format);
+    } else if (format->bytes == 4) {
+        float value32 = (float)value;
+        uint32_t x;
+        memcpy(&x, &value32, 4);
+        if (format->swap)
+            x = bswap32(x);
+        memcpy(dst, &x, 4);
+    } else {
+        uint64_t x;
+        memcpy(&x, &value, 8);
+        if (format->swap)
+            x = bswap64(x);
+        memcpy(dst, &x, 8);
+    }
+}
+
+static void float32_to_int32_scalar(int32_t *dst, const float *src, size_t count, double scale) {
+    for (size_t i = 0; i < count; i += 1)
+        dst[i] = float_to_int32_one(src[i], scale);
+}
+
+static void float64_to_int32_scalar(int32_t *dst, const double *src, size_t count, double scale) {
+    for (size_t i = 0; i < count; i += 1)
+        dst[i] = float_to_int32_one(src[i], scale);
+}
+
+static void int32_to_float32_scalar(float *dst, const int32_t *src, size_t count, double scale) {
+    float inverse = (float)(1.0 / scale);
+    for (size_t i = 0; i < count; i += 1)
+        dst[i] = (float)src[i] * inverse;
+}
+
+static void int32_to_float64_scalar(double *dst, const int32_t *src, size_t count, double scale) {
+    double inverse = 1.0 / scale;
+    for (size_t i = 0; i < count; i += 1)
+        dst[i] = src[i] * inverse;
+}
+
+static void pack_scalar(char *dst, const int32_t *src, size_t count, const struct SoundIoSampleFormat *format) {
+    for (size_t i = 0; i < count; i += 1)
+        pack_one(dst + i * format->bytes, src[i], format);
+}
+
+static void unpack_scalar(int32_t *dst, const char *src, size_t count, const struct SoundIoSampleFormat *format) {
+    for (size_t i = 0; i < count; i += 1)
+        dst[i] = unpack_one(src + i * format->bytes, format);
+}
+
+#if defined(SOUNDIO_SIMD_X86)
+
+SOUNDIO_TARGET_SSE2 static inline __m128i bswap16_sse2(__m128i x) {
+    return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+SOUNDIO_TARGET_SSE2 static inline __m128i bswap32_sse2(__m128i x) {
+    x = bswap16_sse2(x);
+    x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+SOUNDIO_TARGET_SSE2 static void float32_to_int32_sse2(int32_t *dst, const float *src, size_t count,
+        double scale)
+{
+    const __m128 vscale = _mm_set1_ps((float)scale);
+    const __m128 lo = _mm_set1_ps((float)-scale);
+    // For 32 bit formats this rounds up to 2^31, which the conversion turns
+    // into INT32_MIN. The xor with the comparison mask makes that INT32_MAX.
+    const __m128 hi = _mm_set1_ps((float)(scale - 1.0));
+    const __m128 overflow = _mm_set1_ps(2147483648.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(src + i), vscale);
+        // maxps returns its second operand if either is NaN.
+        x = _mm_min_ps(_mm_max_ps(x, lo), hi);
+        __m128i fixup = _mm_castps_si128(_mm_cmpge_ps(x, overflow));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(_mm_cvtps_epi32(x), fixup));
+    }
+    float32_to_int32_scalar(dst + i, src + i, count - i, scale);
+}
+
+SOUNDIO_TARGET_SSE2 static void float64_to_int32_sse2(int32_t *dst, const double *src, size_t count,
+        double scale)
+{
+    const __m128d vscale = _mm_set1_pd(scale);
+    const __m128d lo = _mm_set1_pd(-scale);
+    const __m128d hi = _mm_set1_pd(scale - 1.0);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128d x0 = _mm_mul_pd(_mm_loadu_pd(src + i), vscale);
+        __m128d x1 = _mm_mul_pd(_mm_loadu_pd(src + i + 2), vscale);
+        x0 = _mm_min_pd(_mm_max_pd(x0, lo), hi);
+        x1 = _mm_min_pd(_mm_max_pd(x1, lo), hi);
+        __m128i y = _mm_unpacklo_epi64(_mm_cvtpd_epi32(x0), _mm_cvtpd_epi32(x1));
+        _mm_storeu_si128((__m128i *)(dst + i), y);
+    }
+    float64_to_int32_scalar(dst + i, src + i, count - i, scale);
+}
+
+SOUNDIO_TARGET_SSE2 static void int32_to_float32_sse2(float *dst, const int32_t *src, size_t count,
+        double scale)
+{
+    const __m128 inverse = _mm_set1_ps((float)(1.0 / scale));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(src + i)));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(x, inverse));
+    }
+    int32_to_float32_scalar(dst + i, src + i, count - i, scale);
+}
+
+SOUNDIO_TARGET_SSE2 static void int32_to_float64_sse2(double *dst, const int32_t *src, size_t count,
+        double scale)
+{
+    const __m128d inverse = _mm_set1_pd(1.0 / scale);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d x = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)(src + i)));
+        _mm_storeu_pd(dst + i, _mm_mul_pd(x, inverse));
+    }
+    int32_to_float64_scalar(dst + i, src + i, count - i, scale);
+}
+
+SOUNDIO_TARGET_SSE2 static void pack_sse2(char *dst, const int32_t *src, size_t count,
+        const struct SoundIoSampleFormat *format)
+{
+    const __m128i *in = (const __m128i *)src;
+    size_t i = 0;
+    if (format->bytes == 4) {
+        const __m128i bias = _mm_set1_epi32((int32_t)format->bias);
+        const __m128i mask = _mm_set1_epi32((int32_t)format->mask);
+        for (; i + 4 <= count; i += 4, in += 1) {
+            __m128i x = _mm_and_si128(_mm_xor_si128(_mm_loadu_si128(in), bias), mask);
+            if (format->swap)
+                x = bswap32_sse2(x);
+            _mm_storeu_si128((__m128i *)(dst + 4 * i), x);
+        }
+    } else if (format->bytes == 2) {
+        const __m128i bias = _mm_set1_epi16((int16_t)format->bias);
+        for (; i + 8 <= count; i += 8, in += 2) {
+            __m128i x = _mm_packs_epi32(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+            x = _mm_xor_si128(x, bias);
+            if (format->swap)
+                x = bswap16_sse2(x);
+            _mm_storeu_si128((__m128i *)(dst + 2 * i), x);
+        }
+    } else if (format->bytes == 3) {
+        // Pairs of samples are joined in each 64 bit lane, then the lanes
+        // are put next to each other. Every store writes four bytes past its
+        // samples, which the next one overwrites.
+        if (!format->swap) {
+            const __m128i bias = _mm_set1_epi32((int32_t)format->bias);
+            const __m128i even = _mm_setr_epi32(0xffffff, 0, 0xffffff, 0);
+            const __m128i odd = _mm_setr_epi32(0, 0xffffff, 0, 0xffffff);
+            for (; i + 6 <= count; i += 4, in += 1) {
+                __m128i x = _mm_xor_si128(_mm_loadu_si128(in), bias);
+                x = _mm_or_si128(_mm_and_si128(x, even), _mm_srli_epi64(_mm_and_si128(x, odd), 8));
+                x = _mm_or_si128(_mm_move_epi64(x), _mm_slli_si128(_mm_srli_si128(x, 8), 6));
+                _mm_storeu_si128((__m128i *)(dst + 3 * i), x);
+            }
+        }
+    } else if (format->bytes == 1) {
+        const __m128i bias = _mm_set1_epi8((char)format->bias);
+        for (; i + 16 <= count; i += 16, in += 4) {
+            __m128i lo = _mm_packs_epi32(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+            __m128i hi = _mm_packs_epi32(_mm_loadu_si128(in + 2), _mm_loadu_si128(in + 3));
+            __m128i x = _mm_xor_si128(_mm_packs_epi16(lo, hi), bias);
+            _mm_storeu_si128((__m128i *)(dst + i), x);
+        }
+    }
+    pack_scalar(dst + i * format->bytes, src + i, count - i, format);
+}
+
+SOUNDIO_TARGET_SSE2 static void unpack_sse2(int32_t *dst, const char *src, size_t count,
+        const struct SoundIoSampleFormat *format)
+{
+    __m128i *out = (__m128i *)dst;
+    size_t i = 0;
+    if (format->bytes == 4) {
+        const __m128i bias = _mm_set1_epi32((int32_t)format->bias);
+        for (; i + 4 <= count; i += 4, out += 1) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+            if (format->swap)
+                x = bswap32_sse2(x);
+            x = _mm_xor_si128(x, bias);
+            if (format->bits == 24)
+                x = _mm_srai_epi32(_mm_slli_epi32(x, 8), 8);
+            _mm_storeu_si128(out, x);
+        }
+    } else if (format->bytes == 2) {
+        const __m128i bias = _mm_set1_epi16((int16_t)format->bias);
+        for (; i + 8 <= count; i += 8, out += 2) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+            if (format->swap)
+                x = bswap16_sse2(x);
+            x = _mm_xor_si128(x, bias);
+            _mm_storeu_si128(out, _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+            _mm_storeu_si128(out + 1, _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+        }
+    } else if (format->bytes == 3) {
+        // Byte shifts line each sample up with the start of a 32 bit word.
+        // Loads read one sample past the four they use.
+        if (!format->swap) {
+            const __m128i bias = _mm_set1_epi32((int32_t)(format->bias << 8));
+            for (; i + 6 <= count; i += 4, out += 1) {
+                __m128i x = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+                __m128i lo = _mm_unpacklo_epi32(x, _mm_srli_si128(x, 3));
+                __m128i hi = _mm_unpacklo_epi32(_mm_srli_si128(x, 6), _mm_srli_si128(x, 9));
+                x = _mm_xor_si128(_mm_slli_epi32(_mm_unpacklo_epi64(lo, hi), 8), bias);
+                _mm_storeu_si128(out, _mm_srai_epi32(x, 8));
+            }
+        }
+    } else if (format->bytes == 1) {
+        const __m128i bias = _mm_set1_epi8((char)format->bias);
+        for (; i + 16 <= count; i += 16, out += 4) {
+            __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), bias);
+            __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+            __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+            _mm_storeu_si128(out, _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16));
+            _mm_storeu_si128(out + 1, _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16));
+            _mm_storeu_si128(out + 2, _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16));
+            _mm_storeu_si128(out + 3, _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16));
+        }
+    }
+    unpack_scalar(dst + i, src + i * format->bytes, count - i, format);
+}
+
+SOUNDIO_TARGET_AVX2 static inline __m256i bswap16_avx2(__m256i x) {
+    const __m256i shuffle = _mm256_setr_epi8(
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    return _mm256_shuffle_epi8(x, shuffle);
+}
+
+SOUNDIO_TARGET_AVX2 static inline __m256i bswap32_avx2(__m256i x) {
+    const __m256i shuffle = _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    return _mm256_shuffle_epi8(x, shuffle);
+}
+
+// The AVX2 kernels leave the tail to code compiled without VEX encoding.
+// Clearing the upper halves of the registers first avoids the penalty for
+// mixing the two, which the compiler does not do before a tail call.
+
+SOUNDIO_TARGET_AVX2 static void float32_to_int32_avx2(int32_t *dst, const float *src, size_t count,
+        double scale)
+{
+    const __m256 vscale = _mm256_set1_ps((float)scale);
+    const __m256 lo = _mm256_set1_ps((float)-scale);
+    // See float32_to_int32_sse2.
+    const __m256 hi = _mm256_set1_ps((float)(scale - 1.0));
+    const __m256 overflow = _mm256_set1_ps(2147483648.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src + i), vscale);
+        x = _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+        __m256i fixup = _mm256_castps_si256(_mm256_cmp_ps(x, overflow, _CMP_GE_OQ));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(_mm256_cvtps_epi32(x), fixup));
+    }
+    _mm256_zeroupper();
+    float32_to_int32_sse2(dst + i, src + i, count - i, scale);
+}
+
+SOUNDIO_TARGET_AVX2 static void float64_to_int32_avx2(int32_t *dst, const double *src, size_t count,
+        double scale)
+{
+    const __m256d vscale = _mm256_set1_pd(scale);
+    const __m256d lo = _mm256_set1_pd(-scale);
+    const __m256d hi = _mm256_set1_pd(scale - 1.0);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d x = _mm256_mul_pd(_mm256_loadu_pd(src + i), vscale);
+        x = _mm256_min_pd(_mm256_max_pd(x, lo), hi);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm256_cvtpd_epi32(x));
+    }
+    _mm256_zeroupper();
+    float64_to_int32_scalar(dst + i, src + i, count - i, scale);
+}
+
+SOUNDIO_TARGET_AVX2 static void int32_to_float32_avx2(float *dst, const int32_t *src, size_t count,
+        double scale)
+{
+    const __m256 inverse = _mm256_set1_ps((float)(1.0 / scale));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(x, inverse));
+    }
+    _mm256_zeroupper();
+    int32_to_float32_sse2(dst + i, src + i, count - i, scale);
+}
+
+SOUNDIO_TARGET_AVX2 static void int32_to_float64_avx2(double *dst, const int32_t *src, size_t count,
+        double scale)
+{
+    const __m256d inverse = _mm256_set1_pd(1.0 / scale);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d x = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(src + i)));
+        _mm256_storeu_pd(dst + i, _mm256_mul_pd(x, inverse));
+    }
+    _mm256_zeroupper();
+    int32_to_float64_scalar(dst + i, src + i, count - i, scale);
+}
+
+SOUNDIO_TARGET_AVX2 static void pack_avx2(char *dst, const int32_t *src, size_t count,
+        const struct SoundIoSampleFormat *format)
+{
+    const __m256i *in = (const __m256i *)src;
+    size_t i = 0;
+    if (format->bytes == 4) {
+        const __m256i bias = _mm256_set1_epi32((int32_t)format->bias);
+        const __m256i mask = _mm256_set1_epi32((int32_t)format->mask);
+        for (; i + 8 <= count; i += 8, in += 1) {
+            __m256i x = _mm256_and_si256(_mm256_xor_si256(_mm256_loadu_si256(in), bias), mask);
+            if (format->swap)
+                x = bswap32_avx2(x);
+            _mm256_storeu_si256((__m256i *)(dst + 4 * i), x);
+        }
+    } else if (format->bytes == 2) {
+        const __m256i bias = _mm256_set1_epi16((int16_t)format->bias);
+        for (; i + 16 <= count; i += 16, in += 2) {
+            // Packing works within 128 bit lanes, so put the quarters back
+            // in order afterwards.
+            __m256i x = _mm256_packs_epi32(_mm256_loadu_si256(in), _mm256_loadu_si256(in + 1));
+            x = _mm256_xor_si256(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 1, 2, 0)), bias);
+            if (format->swap)
+                x = bswap16_avx2(x);
+            _mm256_storeu_si256((__m256i *)(dst + 2 * i), x);
+        }
+    } else if (format->bytes == 3) {
+        // Each lane packs its four samples into its low twelve bytes. As in
+        // pack_sse2, every store writes four bytes past its samples.
+        const __m256i bias = _mm256_set1_epi32((int32_t)format->bias);
+        const __m256i shuffle = is_lsb_first(format) ?
+            _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1) :
+            _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        for (; i + 10 <= count; i += 8, in += 1) {
+            __m256i x = _mm256_shuffle_epi8(_mm256_xor_si256(_mm256_loadu_si256(in), bias), shuffle);
+            _mm_storeu_si128((__m128i *)(dst + 3 * i), _mm256_castsi256_si128(x));
+            _mm_storeu_si128((__m128i *)(dst + 3 * i + 12), _mm256_extracti128_si256(x, 1));
+        }
+    } else if (format->bytes == 1) {
+        const __m256i bias = _mm256_set1_epi8((char)format->bias);
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        for (; i + 32 <= count; i += 32, in += 4) {
+            __m256i lo = _mm256_packs_epi32(_mm256_loadu_si256(in), _mm256_loadu_si256(in + 1));
+            __m256i hi = _mm256_packs_epi32(_mm256_loadu_si256(in + 2), _mm256_loadu_si256(in + 3));
+            __m256i x = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(lo, hi), order);
+            _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(x, bias));
+        }
+    }
+    _mm256_zeroupper();
+    pack_sse2(dst + i * format->bytes, src + i, count - i, format);
+}
+
+SOUNDIO_TARGET_AVX2 static void unpack_avx2(int32_t *dst, const char *src, size_t count,
+        const struct SoundIoSampleFormat *format)
+{
+    __m256i *out = (__m256i *)dst;
+    size_t i = 0;
+    if (format->bytes == 4) {
+        const __m256i bias = _mm256_set1_epi32((int32_t)format->bias);
+        for (; i + 8 <= count; i += 8, out += 1) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(src + 4 * i));
+            if (format->swap)
+                x = bswap32_avx2(x);
+            x = _mm256_xor_si256(x, bias);
+            if (format->bits == 24)
+                x = _mm256_srai_epi32(_mm256_slli_epi32(x, 8), 8);
+            _mm256_storeu_si256(out, x);
+        }
+    } else if (format->bytes == 2) {
+        const __m128i bias = _mm_set1_epi16((int16_t)format->bias);
+        const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        for (; i + 8 <= count; i += 8, out += 1) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+            if (format->swap)
+                x = _mm_shuffle_epi8(x, swap);
+            _mm256_storeu_si256(out, _mm256_cvtepi16_epi32(_mm_xor_si128(x, bias)));
+        }
+    } else if (format->bytes == 3) {
+        // Each lane takes twelve bytes and puts every sample in the top three
+        // bytes of a word, so an arithmetic shift sign extends it. Loads read
+        // one sample past the four they use.
+        const __m256i bias = _mm256_set1_epi32((int32_t)(format->bias << 8));
+        const __m256i shuffle = is_lsb_first(format) ?
+            _mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+                    -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11) :
+            _mm256_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9,
+                    -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+        for (; i + 10 <= count; i += 8, out += 1) {
+            __m256i x = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(src + 3 * i)));
+            x = _mm256_inserti128_si256(x, _mm_loadu_si128((const __m128i *)(src + 3 * i + 12)), 1);
+            x = _mm256_xor_si256(_mm256_shuffle_epi8(x, shuffle), bias);
+            _mm256_storeu_si256(out, _mm256_srai_epi32(x, 8));
+        }
+    } else if (format->bytes == 1) {
+        const __m128i bias = _mm_set1_epi8((char)format->bias);
+        for (; i + 8 <= count; i += 8, out += 1) {
+            __m128i x = _mm_loadl_epi64((const __m128i *)(src + i));
+            _mm256_storeu_si256(out, _mm256_cvtepi8_epi32(_mm_xor_si128(x, bias)));
+        }
+    }
+    _mm256_zeroupper();
+    unpack_sse2(dst + i, src + i * format->bytes, count - i, format);
+}
+
+#endif
+
+static const struct ConvertKernels kernels[] = {
+    {
+        float32_to_int32_scalar,
+        float64_to_int32_scalar,
+        int32_to_float32_scalar,
+        int32_to_float64_scalar,
+        pack_scalar,
+        unpack_scalar,
+    },
+#if defined(SOUNDIO_SIMD_X86)
+    {
+        float32_to_int32_sse2,
+        float64_to_int32_sse2,
+        int32_to_float32_sse2,
+        int32_to_float64_sse2,
+        pack_sse2,
+        unpack_sse2,
+    },
+    {
+        float32_to_int32_avx2,
+        float64_to_int32_avx2,
+        int32_to_float32_avx2,
+        int32_to_float64_avx2,
+        pack_avx2,
+        unpack_avx2,
+    },
+#endif
+};
+
+// The level in use plus one, so that the zero it starts out as means that
+// the CPU has not been looked at yet.
+static struct SoundIoAtomicInt simd_level;
+
+enum SoundIoSimdLevel soundio_convert_detect_simd_level(void) {
+#if defined(SOUNDIO_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SoundIoSimdLevelAvx2;
+    if (__builtin_cpu_supports("sse2"))
+        return SoundIoSimdLevelSse2;
+#endif
+    return SoundIoSimdLevelScalar;
+}
+
+enum SoundIoSimdLevel soundio_convert_get_simd_level(void) {
+    int level = SOUNDIO_ATOMIC_LOAD_RELAXED(simd_level);
+    if (!level) {
+        // Every thread that gets here stores the same value.
+        level = soundio_convert_detect_simd_level() + 1;
+        SOUNDIO_ATOMIC_STORE_RELAXED(simd_level, level);
+    }
+    return (enum SoundIoSimdLevel)(level - 1);
+}
+
+int soundio_convert_set_simd_level(enum SoundIoSimdLevel level) {
+    if (level < SoundIoSimdLevelScalar || level > soundio_convert_detect_simd_level())
+        return SoundIoErrorInvalid;
+    SOUNDIO_ATOMIC_STORE_RELAXED(simd_level, (int)level + 1);
+    return 0;
+}
+
+static void convert_strided(char *dst, int dst_step, const struct SoundIoSampleFormat *dst_format,
+        const char *src, int src_step, const struct SoundIoSampleFormat *src_format, size_t count)
+{
+    for (size_t i = 0; i < count; i += 1) {
+        store_sample(dst, load_sample(src, src_format), dst_format);
+        dst += dst_step;
+        src += src_step;
+    }
+}
+
+void soundio_convert_run(char *dst, const struct SoundIoSampleFormat *dst_format,
+        const char *src, const struct SoundIoSampleFormat *src_format, size_t count)
+{
+    const struct ConvertKernels *k = &kernels[soundio_convert_get_simd_level()];
+    int32_t buf[CONVERT_CHUNK_SIZE];
+
+    if (src_format->is_float && !src_format->swap && !dst_format->is_float) {
+        while (count > 0) {
+            size_t n = (count < CONVERT_CHUNK_SIZE) ? count : CONVERT_CHUNK_SIZE;
+            if (src_format->bytes == 4)
+                k->float32_to_int32(buf, (const float *)src, n, dst_format->scale);
+            else
+                k->float64_to_int32(buf, (const double *)src, n, dst_format->scale);
+            k->pack(dst, buf, n, dst_format);
+            src += n * src_format->bytes;
+            dst += n * dst_format->bytes;
+            count -= n;
+        }
+    } else if (dst_format->is_float && !dst_format->swap && !src_format->is_float) {
+        while (count > 0) {
+            size_t n = (count < CONVERT_CHUNK_SIZE) ? count : CONVERT_CHUNK_SIZE;
+            k->unpack(buf, src, n, src_format);
+            if (dst_format->bytes == 4)
+                k->int32_to_float32((float *)dst, buf, n, src_format->scale);
+            else
+                k->int32_to_float64((double *)dst, buf, n, src_format->scale);
+            src += n * src_format->bytes;
+            dst += n * dst_format->bytes;
+            count -= n;
+        }
+    } else {
+        convert_strided(dst, dst_format->bytes, dst_format, src, src_format->bytes, src_format, count);
+    }
+}
+
+bool soundio_channel_areas_interleaved(const struct SoundIoChannelArea *areas, int channel_count, int bytes) {
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        if (areas[ch].step != channel_count * bytes || areas[ch].ptr != areas[0].ptr + ch * bytes)
+            return false;
+    }
+    return true;
+}
+
+int soundio_convert_samples(enum SoundIoFormat dst_format, const struct SoundIoChannelArea *dst_areas,
+        enum SoundIoFormat src_format, const struct SoundIoChannelArea *src_areas,
+        int channel_count, int frame_count)
+{
+    struct SoundIoSampleFormat dst_fmt;
+    struct SoundIoSampleFormat src_fmt;
+    if (!soundio_get_sample_format(dst_format, &dst_fmt) || !soundio_get_sample_format(src_format, &src_fmt))
+        return SoundIoErrorInvalid;
+    if (channel_count < 0 || frame_count < 0)
+        return SoundIoErrorInvalid;
+    if (channel_count == 0 || frame_count == 0)
+        return 0;
+
+    if (dst_format == src_format) {
+        soundio_channel_areas_copy(dst_areas, src_areas, channel_count, frame_count, dst_fmt.bytes);
+        return 0;
+    }
+
+    // Both sides interleaved the same way is one long run.
+    if (soundio_channel_areas_interleaved(dst_areas, channel_count, dst_fmt.bytes) &&
+        soundio_channel_areas_interleaved(src_areas, channel_count, src_fmt.bytes))
+    {
+        soundio_convert_run(dst_areas[0].ptr, &dst_fmt, src_areas[0].ptr, &src_fmt,
+                (size_t)frame_count * channel_count);
+        return 0;
+    }
+
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        if (dst_areas[ch].step == dst_fmt.bytes && src_areas[ch].step == src_fmt.bytes) {
+            soundio_convert_run(dst_areas[ch].ptr, &dst_fmt, src_areas[ch].ptr, &src_fmt, frame_count);
+        } else {
+            convert_strided(dst_areas[ch].ptr, dst_areas[ch].step, &dst_fmt,
+                    src_areas[ch].ptr, src_areas[ch].step, &src_fmt, frame_count);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_CONVERT_H
+#define SOUNDIO_CONVERT_H
+
+#include "soundio_internal.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Kernels for x86 are compiled with target attributes and picked at run
+// time, so that the library itself does not require any of them.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SOUNDIO_SIMD_X86
+#include <immintrin.h>
+#define SOUNDIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define SOUNDIO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+enum SoundIoSimdLevel {
+    SoundIoSimdLevelScalar,
+    SoundIoSimdLevelSse2,
+    SoundIoSimdLevelAvx2,
+};
+
+// Everything the conversion kernels need to know about a sample format.
+struct SoundIoSampleFormat {
+    bool is_float;
+    // Stored in the other byte order than the host's.
+    bool swap;
+    int bytes;
+    // Integer formats only.
+    int bits;
+    // Xor'd in to go between signed and unsigned.
+    uint32_t bias;
+    // Unsigned 24 bit keeps the top byte of the word zero.
+    uint32_t mask;
+    // 2^(bits - 1), the integer value of full scale.
+    double scale;
+};
+
+// Returns false for SoundIoFormatInvalid and values outside the enum.
+bool soundio_get_sample_format(enum SoundIoFormat format, struct SoundIoSampleFormat *out);
+
+// The best level this CPU supports.
+enum SoundIoSimdLevel soundio_convert_detect_simd_level(void);
+// The level conversions currently use. Defaults to the detected one.
+enum SoundIoSimdLevel soundio_convert_get_simd_level(void);
+// For tests and benchmarks. Returns SoundIoErrorInvalid if the CPU does not
+// support `level`. Must not be called while conversions are running.
+int soundio_convert_set_simd_level(enum SoundIoSimdLevel level);
+
+// Converts `count` contiguous samples.
+void soundio_convert_run(char *dst, const struct SoundIoSampleFormat *dst_format,
+        const char *src, const struct SoundIoSampleFormat *src_format, size_t count);
+
+// Whether `areas` are one run of whole frames, channel after channel.
+bool soundio_channel_areas_interleaved(const struct SoundIoChannelArea *areas, int channel_count, int bytes);
+
+#endif
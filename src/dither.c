@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "dither.h"
+#include "convert.h"
+#include "util.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Noise shaping feeds the errors back so that the noise spectrum is
+// 1 - 1.5z^-1 + 0.6z^-2: 20 dB quieter at low frequencies, where it is
+// easiest to hear, and louder towards Nyquist.
+#define SHAPE_A1 1.5
+#define SHAPE_A2 -0.6
+// Rounding and dither never err by more than 1.5 LSBs, clipping does.
+#define SHAPE_MAX_ERROR 2.0
+
+// The noise comes out in 1/65536ths of an LSB.
+#define NOISE_SCALE (1.0f / 65536.0f)
+
+typedef void (*TpdfRun)(float *samples, size_t count, uint32_t *lanes, float scale);
+
+static inline uint32_t xorshift32(uint32_t x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// The difference of two uniform halves of the word is triangular, from
+// -65535 to 65535.
+static inline float next_noise(uint32_t *lane) {
+    uint32_t x = xorshift32(*lane);
+    *lane = x;
+    return (float)((int32_t)(x & 0xffff) - (int32_t)(x >> 16));
+}
+
+static void tpdf_run_scalar(float *samples, size_t count, uint32_t *lanes, float scale) {
+    for (size_t i = 0; i < count; i += 1)
+        samples[i] += next_noise(&lanes[i % SOUNDIO_DITHER_LANES]) * scale;
+}
+
+#if defined(SOUNDIO_SIMD_X86)
+
+SOUNDIO_TARGET_SSE2 static inline __m128i xorshift32_sse2(__m128i x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+SOUNDIO_TARGET_SSE2 static inline __m128 noise_sse2(__m128i x) {
+    __m128i lo = _mm_and_si128(x, _mm_set1_epi32(0xffff));
+    return _mm_cvtepi32_ps(_mm_sub_epi32(lo, _mm_srli_epi32(x, 16)));
+}
+
+SOUNDIO_TARGET_SSE2
+static void tpdf_run_sse2(float *samples, size_t count, uint32_t *lanes, float scale) {
+    __m128i x[4];
+    for (int j = 0; j < 4; j += 1)
+        x[j] = _mm_loadu_si128((const __m128i *)(lanes + 4 * j));
+    __m128 s = _mm_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        for (int j = 0; j < 4; j += 1) {
+            x[j] = xorshift32_sse2(x[j]);
+            __m128 noise = _mm_mul_ps(noise_sse2(x[j]), s);
+            _mm_storeu_ps(samples + i + 4 * j, _mm_add_ps(_mm_loadu_ps(samples + i + 4 * j), noise));
+        }
+    }
+    for (int j = 0; j < 4; j += 1)
+        _mm_storeu_si128((__m128i *)(lanes + 4 * j), x[j]);
+    tpdf_run_scalar(samples + i, count - i, lanes, scale);
+}
+
+SOUNDIO_TARGET_AVX2 static inline __m256i xorshift32_avx2(__m256i x) {
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    return _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+}
+
+SOUNDIO_TARGET_AVX2 static inline __m256 noise_avx2(__m256i x) {
+    __m256i lo = _mm256_and_si256(x, _mm256_set1_epi32(0xffff));
+    return _mm256_cvtepi32_ps(_mm256_sub_epi32(lo, _mm256_srli_epi32(x, 16)));
+}
+
+SOUNDIO_TARGET_AVX2
+static void tpdf_run_avx2(float *samples, size_t count, uint32_t *lanes, float scale) {
+    __m256i x0 = _mm256_loadu_si256((const __m256i *)lanes);
+    __m256i x1 = _mm256_loadu_si256((const __m256i *)(lanes + 8));
+    __m256 s = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        x0 = xorshift32_avx2(x0);
+        x1 = xorshift32_avx2(x1);
+        __m256 a = _mm256_add_ps(_mm256_loadu_ps(samples + i), _mm256_mul_ps(noise_avx2(x0), s));
+        __m256 b = _mm256_add_ps(_mm256_loadu_ps(samples + i + 8), _mm256_mul_ps(noise_avx2(x1), s));
+        _mm256_storeu_ps(samples + i, a);
+        _mm256_storeu_ps(samples + i + 8, b);
+    }
+    _mm256_storeu_si256((__m256i *)lanes, x0);
+    _mm256_storeu_si256((__m256i *)(lanes + 8), x1);
+    _mm256_zeroupper();
+    tpdf_run_scalar(samples + i, count - i, lanes, scale);
+}
+
+#endif
+
+// Indexed by SoundIoSimdLevel.
+static const TpdfRun tpdf_runs[] = {
+    tpdf_run_scalar,
+#if defined(SOUNDIO_SIMD_X86)
+    tpdf_run_sse2,
+    tpdf_run_avx2,
+#endif
+};
+
+bool soundio_dither_wanted(enum SoundIoFormat format) {
+    struct SoundIoSampleFormat fmt;
+    // Float has 24 bits of mantissa, below that the noise would be rounded
+    // away.
+    return soundio_get_sample_format(format, &fmt) && !fmt.is_float && fmt.bits <= 24;
+}
+
+int soundio_dither_init(struct SoundIoDitherer *d, enum SoundIoDither mode,
+        enum SoundIoFormat format, int channel_count)
+{
+    struct SoundIoSampleFormat fmt;
+    if ((int)mode < SoundIoDitherNone || (int)mode > SoundIoDitherShaped ||
+        !soundio_get_sample_format(format, &fmt) ||
+        channel_count <= 0 || channel_count > SOUNDIO_MAX_CHANNELS)
+    {
+        return SoundIoErrorInvalid;
+    }
+    memset(d, 0, sizeof(struct SoundIoDitherer));
+    d->mode = mode;
+    d->channel_count = channel_count;
+    d->full_scale = fmt.scale;
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        for (int i = 0; i < SOUNDIO_DITHER_LANES; i += 1)
+            d->lanes[ch][i] = 0x9e3779b9u * (uint32_t)(ch * SOUNDIO_DITHER_LANES + i + 1);
+    }
+    d->buffer = ALLOCATE_NONZERO(float, (size_t)SOUNDIO_DITHER_CHUNK_SIZE * channel_count);
+    if (!d->buffer)
+        return SoundIoErrorNoMem;
+    return 0;
+}
+
+void soundio_dither_deinit(struct SoundIoDitherer *d) {
+    free(d->buffer);
+    d->buffer = NULL;
+}
+
+// Rounds each sample here, since the error of one goes into the next. In
+// double, so that 24 bit keeps the fraction.
+static void shape_channel(struct SoundIoDitherer *d, double *errors, uint32_t *lane,
+        char *ptr, int step, int frame_count)
+{
+    double full_scale = d->full_scale;
+    double e1 = errors[0];
+    double e2 = errors[1];
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        float *sample = (float *)(ptr + (size_t)frame * step);
+        double wanted = *sample * full_scale - (SHAPE_A1 * e1 + SHAPE_A2 * e2);
+        double q = floor(wanted + next_noise(lane) * NOISE_SCALE + 0.5);
+        // Written so that NaN ends up at the bottom.
+        if (!(q >= -full_scale))
+            q = -full_scale;
+        if (q > full_scale - 1.0)
+            q = full_scale - 1.0;
+        double e = q - wanted;
+        if (!(e >= -SHAPE_MAX_ERROR))
+            e = -SHAPE_MAX_ERROR;
+        if (e > SHAPE_MAX_ERROR)
+            e = SHAPE_MAX_ERROR;
+        e2 = e1;
+        e1 = e;
+        *sample = (float)(q / full_scale);
+    }
+    errors[0] = e1;
+    errors[1] = e2;
+}
+
+void soundio_dither_apply(struct SoundIoDitherer *d, const struct SoundIoChannelArea *areas,
+        int frame_count)
+{
+    int channel_count = d->channel_count;
+    if (d->mode == SoundIoDitherNone || frame_count <= 0)
+        return;
+
+    if (d->mode == SoundIoDitherShaped) {
+        for (int ch = 0; ch < channel_count; ch += 1)
+            shape_channel(d, d->errors[ch], &d->lanes[ch][0], areas[ch].ptr, areas[ch].step, frame_count);
+        return;
+    }
+
+    TpdfRun run = tpdf_runs[soundio_convert_get_simd_level()];
+    float scale = (float)(NOISE_SCALE / d->full_scale);
+    if (SOUNDIO_DITHER_LANES % channel_count == 0 &&
+        soundio_channel_areas_interleaved(areas, channel_count, sizeof(float)))
+    {
+        // Sample i is channel i % channel_count, and so is lane
+        // i % SOUNDIO_DITHER_LANES.
+        uint32_t lanes[SOUNDIO_DITHER_LANES];
+        for (int i = 0; i < SOUNDIO_DITHER_LANES; i += 1)
+            lanes[i] = d->lanes[i % channel_count][i / channel_count];
+        run((float *)areas[0].ptr, (size_t)frame_count * channel_count, lanes, scale);
+        for (int i = 0; i < SOUNDIO_DITHER_LANES; i += 1)
+            d->lanes[i % channel_count][i / channel_count] = lanes[i];
+        return;
+    }
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        if (areas[ch].step == (int)sizeof(float)) {
+            run((float *)areas[ch].ptr, frame_count, d->lanes[ch], scale);
+            continue;
+        }
+        uint32_t *lanes = d->lanes[ch];
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            *(float *)(areas[ch].ptr + (size_t)frame * areas[ch].step) +=
+                next_noise(&lanes[frame % SOUNDIO_DITHER_LANES]) * scale;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_DITHER_H
+#define SOUNDIO_DITHER_H
+
+#include "soundio_internal.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Xorshift generators run side by side, as many as fit in two AVX2
+// registers, so that the two chains overlap.
+#define SOUNDIO_DITHER_LANES 16
+// Frames of `buffer`.
+#define SOUNDIO_DITHER_CHUNK_SIZE 256
+
+// Dither for float frames on their way to an integer format. Noise is
+// added to the floats in place, and then the usual conversion rounds them.
+struct SoundIoDitherer {
+    enum SoundIoDither mode;
+    int channel_count;
+    // 2^(bits - 1) of the integer format, so that one LSB is its inverse.
+    double full_scale;
+    // Each channel has generators of its own, so that channels stay
+    // independent however many there are. Frame i of a channel gets its
+    // noise from lane i % SOUNDIO_DITHER_LANES, so that every SIMD level
+    // comes up with the same noise. Interleaved frames with a channel count
+    // that divides SOUNDIO_DITHER_LANES go through the lanes of all channels
+    // at once, and use 1/channel_count of the lanes of each.
+    uint32_t lanes[SOUNDIO_MAX_CHANNELS][SOUNDIO_DITHER_LANES];
+    // Noise shaping only: the last two errors of each channel, in LSBs.
+    double errors[SOUNDIO_MAX_CHANNELS][2];
+    // SOUNDIO_DITHER_CHUNK_SIZE interleaved frames, for callers whose floats
+    // are not theirs to change.
+    float *buffer;
+};
+
+// Whether dither makes a difference going from float to `format`.
+bool soundio_dither_wanted(enum SoundIoFormat format);
+
+int soundio_dither_init(struct SoundIoDitherer *d, enum SoundIoDither mode,
+        enum SoundIoFormat format, int channel_count);
+void soundio_dither_deinit(struct SoundIoDitherer *d);
+
+// `areas` are Float32NE, laid out any way.
+void soundio_dither_apply(struct SoundIoDitherer *d, const struct SoundIoChannelArea *areas,
+        int frame_count);
+
+#endif
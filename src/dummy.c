@@ -8,124 +8,693 @@
 #include "dummy.h"
 #include "soundio_private.h"
 
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-static void playback_thread_run(void *arg) {
-    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)arg;
+SOUNDIO_MAKE_LIST_DEF(struct SoundIoDummyTimer *, SoundIoListDummyTimerPtr, SOUNDIO_LIST_STATIC)
+
+static bool parse_prefix(const char **str, const char *prefix) {
+    size_t len = strlen(prefix);
+    if (strncmp(*str, prefix, len) != 0)
+        return false;
+    *str += len;
+    return true;
+}
+
+static bool parse_seconds(const char **str, double *out) {
+    char *end;
+    *out = strtod(*str, &end);
+    if (end == *str || !(*out >= 0.0))
+        return false;
+    *str = end;
+    return true;
+}
+
+static bool parse_frame(const char **str, long *out) {
+    char *end;
+    *out = strtol(*str, &end, 10);
+    if (end == *str || *out < 0)
+        return false;
+    *str = end;
+    return true;
+}
+
+static int add_fault(struct SoundIoDummyFaults *faults, enum SoundIoDummyFaultKind kind,
+        long frame, double seconds)
+{
+    if (faults->count >= SOUNDIO_DUMMY_MAX_FAULTS)
+        return SoundIoErrorInvalid;
+    int i = faults->count;
+    for (; i > 0 && faults->items[i - 1].frame > frame; i -= 1)
+        faults->items[i] = faults->items[i - 1];
+    faults->items[i].kind = kind;
+    faults->items[i].frame = frame;
+    faults->items[i].seconds = seconds;
+    faults->count += 1;
+    return 0;
+}
+
+// See SoundIo::dummy_faults for the syntax.
+static int parse_faults(struct SoundIoDummyFaults *faults, const char *schedule) {
+    memset(faults, 0, sizeof(struct SoundIoDummyFaults));
+    faults->seed = 1;
+    faults->remove_after = -1.0;
+    if (!schedule)
+        return 0;
+
+    const char *p = schedule;
+    for (;;) {
+        p += strspn(p, ", \t\n");
+        if (!*p)
+            return 0;
+        long frame;
+        double seconds;
+        int err;
+        if (parse_prefix(&p, "seed=")) {
+            if (!parse_frame(&p, &frame))
+                return SoundIoErrorInvalid;
+            faults->seed = (uint32_t)frame;
+        } else if (parse_prefix(&p, "jitter=")) {
+            if (parse_prefix(&p, "uniform:"))
+                faults->jitter = SoundIoDummyJitterUniform;
+            else if (parse_prefix(&p, "exponential:"))
+                faults->jitter = SoundIoDummyJitterExponential;
+            else
+                return SoundIoErrorInvalid;
+            if (!parse_seconds(&p, &faults->jitter_seconds))
+                return SoundIoErrorInvalid;
+        } else if (parse_prefix(&p, "underflow@")) {
+            if (!parse_frame(&p, &frame))
+                return SoundIoErrorInvalid;
+            if ((err = add_fault(faults, SoundIoDummyFaultUnderflow, frame, 0.0)))
+                return err;
+        } else if (parse_prefix(&p, "overflow@")) {
+            if (!parse_frame(&p, &frame))
+                return SoundIoErrorInvalid;
+            if ((err = add_fault(faults, SoundIoDummyFaultOverflow, frame, 0.0)))
+                return err;
+        } else if (parse_prefix(&p, "stall@")) {
+            if (!parse_frame(&p, &frame) || !parse_prefix(&p, ":") || !parse_seconds(&p, &seconds))
+                return SoundIoErrorInvalid;
+            if ((err = add_fault(faults, SoundIoDummyFaultStall, frame, seconds)))
+                return err;
+        } else if (parse_prefix(&p, "remove@")) {
+            if (!parse_seconds(&p, &faults->remove_after))
+                return SoundIoErrorInvalid;
+        } else {
+            return SoundIoErrorInvalid;
+        }
+        if (*p && !strchr(", \t\n", *p))
+            return SoundIoErrorInvalid;
+    }
+}
+
+// The next fault which is due once a stream has got to `frame`, or NULL.
+static const struct SoundIoDummyFault *due_fault(const struct SoundIoDummyFaults *faults,
+        int *index, long frame)
+{
+    if (*index >= faults->count || faults->items[*index].frame > frame)
+        return NULL;
+    const struct SoundIoDummyFault *fault = &faults->items[*index];
+    *index += 1;
+    return fault;
+}
+
+static bool device_removed(struct SoundIoPrivate *si) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    return sid->faults.remove_after >= 0.0 && soundio_os_get_time() >= sid->remove_time;
+}
+
+// Wall clock time, or virtual time when freewheeling. Called by the timer
+// thread, or with the mutex held.
+static double timer_now(struct SoundIoDummy *sid) {
+    return sid->freewheel ? sid->virtual_now : soundio_os_get_time();
+}
+
+static bool timer_before(struct SoundIoDummyTimer *a, struct SoundIoDummyTimer *b) {
+    return a->deadline < b->deadline;
+}
+
+static void heap_set(struct SoundIoListDummyTimerPtr *heap, int index, struct SoundIoDummyTimer *timer) {
+    heap->items[index] = timer;
+    timer->heap_index = index;
+}
+
+static void heap_sift_up(struct SoundIoListDummyTimerPtr *heap, int index) {
+    struct SoundIoDummyTimer *timer = heap->items[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!timer_before(timer, heap->items[parent]))
+            break;
+        heap_set(heap, index, heap->items[parent]);
+        index = parent;
+    }
+    heap_set(heap, index, timer);
+}
+
+static void heap_sift_down(struct SoundIoListDummyTimerPtr *heap, int index) {
+    struct SoundIoDummyTimer *timer = heap->items[index];
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= heap->length)
+            break;
+        if (child + 1 < heap->length && timer_before(heap->items[child + 1], heap->items[child]))
+            child += 1;
+        if (!timer_before(heap->items[child], timer))
+            break;
+        heap_set(heap, index, heap->items[child]);
+        index = child;
+    }
+    heap_set(heap, index, timer);
+}
+
+// Called with the mutex held. There is always room, because it is made when
+// streams start.
+static void timer_schedule(struct SoundIoDummy *sid, struct SoundIoDummyTimer *timer, double deadline) {
+    struct SoundIoListDummyTimerPtr *heap = &sid->timer_heap;
+    if (timer->heap_index < 0) {
+        assert(heap->length < heap->capacity);
+        timer->deadline = deadline;
+        heap->length += 1;
+        heap_set(heap, heap->length - 1, timer);
+        heap_sift_up(heap, timer->heap_index);
+    } else {
+        double old_deadline = timer->deadline;
+        timer->deadline = deadline;
+        if (deadline < old_deadline)
+            heap_sift_up(heap, timer->heap_index);
+        else
+            heap_sift_down(heap, timer->heap_index);
+    }
+    soundio_os_cond_signal(sid->timer_cond, sid->mutex);
+}
+
+// Called with the mutex held.
+static void timer_unschedule(struct SoundIoDummy *sid, struct SoundIoDummyTimer *timer) {
+    struct SoundIoListDummyTimerPtr *heap = &sid->timer_heap;
+    int index = timer->heap_index;
+    if (index < 0)
+        return;
+    timer->heap_index = -1;
+    heap->length -= 1;
+    if (index == heap->length)
+        return;
+    struct SoundIoDummyTimer *moved = heap->items[heap->length];
+    heap_set(heap, index, moved);
+    heap_sift_up(heap, index);
+    heap_sift_down(heap, moved->heap_index);
+}
+
+// Makes a started stream run as soon as possible. Called with the mutex held.
+static void timer_wake_locked(struct SoundIoDummy *sid, struct SoundIoDummyTimer *timer) {
+    if (!timer->started || timer->stopped)
+        return;
+    if (sid->timer_current == timer) {
+        // It is running right now, and may be about to leave the heap.
+        timer->wake = true;
+        return;
+    }
+    double deadline = soundio_double_max(timer_now(sid), timer->stall_end);
+    if (timer->heap_index < 0 || deadline < timer->deadline)
+        timer_schedule(sid, timer, deadline);
+}
+
+// Runs every stream of the backend, each when its deadline comes. When
+// freewheeling, virtual time jumps from one deadline to the next.
+static void timer_thread_run(void *arg) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)arg;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    struct SoundIoListDummyTimerPtr *heap = &sid->timer_heap;
+
+    soundio_os_mutex_lock(sid->mutex);
+    while (!sid->timer_abort) {
+        if (heap->length == 0) {
+            soundio_os_cond_wait(sid->timer_cond, sid->mutex);
+            continue;
+        }
+        struct SoundIoDummyTimer *timer = heap->items[0];
+        double now;
+        if (sid->freewheel) {
+            now = soundio_double_max(sid->virtual_now, timer->deadline);
+            sid->virtual_now = now;
+        } else {
+            now = soundio_os_get_time();
+            if (timer->deadline > now) {
+                soundio_os_cond_timed_wait(sid->timer_cond, sid->mutex, timer->deadline - now);
+                continue;
+            }
+        }
+        timer_unschedule(sid, timer);
+        timer->wake = false;
+        sid->timer_current = timer;
+        soundio_os_mutex_unlock(sid->mutex);
+
+        double deadline = timer->run(si, timer, now);
+
+        soundio_os_mutex_lock(sid->mutex);
+        sid->timer_current = NULL;
+        if (timer->wake) {
+            double wake_deadline = soundio_double_max(timer_now(sid), timer->stall_end);
+            if (deadline < 0.0 || wake_deadline < deadline)
+                deadline = wake_deadline;
+        }
+        if (deadline >= 0.0 && !timer->stopped)
+            timer_schedule(sid, timer, deadline);
+        soundio_os_cond_signal(sid->timer_idle_cond, sid->mutex);
+    }
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
+static int timer_start(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer,
+        double (*run)(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer, double now), void *stream)
+{
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    int err;
+
+    soundio_os_mutex_lock(sid->mutex);
+    if ((err = SoundIoListDummyTimerPtr_ensure_capacity(&sid->timer_heap, sid->timer_count + 1))) {
+        soundio_os_mutex_unlock(sid->mutex);
+        return err;
+    }
+    if (!sid->timer_thread) {
+        if ((err = soundio_os_thread_create(timer_thread_run, si,
+                        soundio->emit_rtprio_warning, soundio->lock_memory, &sid->timer_thread)))
+        {
+            soundio_os_mutex_unlock(sid->mutex);
+            return err;
+        }
+    }
+    sid->timer_count += 1;
+    timer->run = run;
+    timer->stream = stream;
+    timer->started = true;
+    timer->stopped = false;
+    timer->wake = false;
+    timer->stall_end = 0.0;
+    timer->heap_index = -1;
+    timer_schedule(sid, timer, timer_now(sid));
+    soundio_os_mutex_unlock(sid->mutex);
+    return 0;
+}
+
+// Afterwards the stream does not run, and is not running.
+static void timer_stop(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    if (!timer->started)
+        return;
+    soundio_os_mutex_lock(sid->mutex);
+    timer->stopped = true;
+    timer_unschedule(sid, timer);
+    while (sid->timer_current == timer)
+        soundio_os_cond_wait(sid->timer_idle_cond, sid->mutex);
+    timer->started = false;
+    sid->timer_count -= 1;
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
+static void clock_init(struct SoundIoDummyClock *clock, bool freewheel, int sample_rate,
+        double period_duration, const struct SoundIoDummyFaults *faults)
+{
+    clock->freewheel = freewheel;
+    clock->sample_rate = sample_rate;
+    clock->period_duration = period_duration;
+    clock->period_frame_count = soundio_int_max((int)(period_duration * sample_rate + 0.5), 1);
+    clock->start_time = 0.0;
+    clock->frame = 0;
+    clock->jitter = faults->jitter;
+    clock->jitter_seconds = faults->jitter_seconds;
+    clock->rng = faults->seed ? faults->seed : 1;
+}
+
+static double clock_jitter(struct SoundIoDummyClock *clock) {
+    if (clock->jitter == SoundIoDummyJitterNone)
+        return 0.0;
+    uint32_t x = clock->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    clock->rng = x;
+    double u = (x >> 8) / 16777216.0;
+    if (clock->jitter == SoundIoDummyJitterUniform)
+        return u * clock->jitter_seconds;
+    return -log(1.0 - u) * clock->jitter_seconds;
+}
+
+static void clock_start(struct SoundIoDummyClock *clock, double now) {
+    clock->start_time = now;
+    clock->frame = 0;
+}
+
+// When the next period begins. A freewheeling clock gets there right away.
+static double clock_next(struct SoundIoDummyClock *clock, double now) {
+    if (clock->freewheel) {
+        clock->frame = (clock->frame / clock->period_frame_count + 1) * clock->period_frame_count;
+        return clock->start_time + clock->frame / (double)clock->sample_rate;
+    }
+    double periods = floor((now - clock->start_time) / clock->period_duration) + 1.0;
+    return clock->start_time + periods * clock->period_duration + clock_jitter(clock);
+}
+
+// When the stream runs again after stalling for `seconds`, during which the
+// device carries on.
+static double clock_stall(struct SoundIoDummyClock *clock, double now, double seconds) {
+    if (clock->freewheel) {
+        clock->frame += (long)(seconds * clock->sample_rate + 0.5);
+        return clock->start_time + clock->frame / (double)clock->sample_rate;
+    }
+    return now + seconds;
+}
+
+// How many frames the device has played or recorded since clock_start.
+static long clock_frames(const struct SoundIoDummyClock *clock, double now) {
+    if (clock->freewheel)
+        return clock->frame;
+    return (now - clock->start_time) * clock->sample_rate;
+}
+
+static void timer_wake(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    soundio_os_mutex_lock(sid->mutex);
+    timer_wake_locked(sid, timer);
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
+// Makes waking leave the stream alone until `deadline`, which is returned.
+static double timer_stall(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer, double deadline) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    soundio_os_mutex_lock(sid->mutex);
+    timer->stall_end = deadline;
+    soundio_os_mutex_unlock(sid->mutex);
+    return deadline;
+}
+
+static const float silence = 0.0f;
+
+// Appends `frame_count` frames of interleaved float with `src_channel_count`
+// channels to the ring buffer of `is`. Channels which `src` lacks, or all of
+// them when it is NULL, are silent.
+static void record_frames(struct SoundIoInStreamPrivate *is, const char *src, int src_channel_count,
+        int frame_count)
+{
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
+    char *write_ptr = soundio_ring_buffer_write_ptr(&isd->ring_buffer);
+    struct SoundIoChannelArea dst_areas[SOUNDIO_MAX_CHANNELS];
+    struct SoundIoChannelArea src_areas[SOUNDIO_MAX_CHANNELS];
+    for (int ch = 0; ch < instream->layout.channel_count; ch += 1) {
+        dst_areas[ch].ptr = write_ptr + instream->bytes_per_sample * ch;
+        dst_areas[ch].step = instream->bytes_per_frame;
+        if (ch < src_channel_count) {
+            src_areas[ch].ptr = (char *)src + sizeof(float) * ch;
+            src_areas[ch].step = sizeof(float) * src_channel_count;
+        } else {
+            src_areas[ch].ptr = (char *)&silence;
+            src_areas[ch].step = 0;
+        }
+    }
+    soundio_convert_samples(instream->format, dst_areas, SoundIoFormatFloat32NE, src_areas,
+            instream->layout.channel_count, frame_count);
+    soundio_ring_buffer_advance_write_ptr(&isd->ring_buffer, frame_count * instream->bytes_per_frame);
+    isd->device_frame += frame_count;
+}
+
+static int record_free_frames(struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
+    int free_bytes = soundio_ring_buffer_free_count(&isd->ring_buffer);
+    return free_bytes / is->pub.bytes_per_frame;
+}
+
+// Called with the mutex held, before the frames are played.
+static void loopback_start(struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
+    int bytes_per_frame = sizeof(float) * os->pub.layout.channel_count;
+    int byte_count = osd->loopback_delay_frame_count * bytes_per_frame;
+    soundio_ring_buffer_clear(&osd->loopback_delay);
+    memset(soundio_ring_buffer_write_ptr(&osd->loopback_delay), 0, byte_count);
+    soundio_ring_buffer_advance_write_ptr(&osd->loopback_delay, byte_count);
+}
+
+// Passes `frame_count` frames at the read pointer of the playback ring buffer
+// through the delay line, and the ones which come out of it on to the
+// recording stream. The recording stream runs before this one does again,
+// so that on a virtual clock it keeps up.
+static void loopback_play(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os, int frame_count) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
     struct SoundIoOutStream *outstream = &os->pub;
     struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
+    int channel_count = outstream->layout.channel_count;
+    int delay_bytes_per_frame = sizeof(float) * channel_count;
 
-    int fill_bytes = soundio_ring_buffer_fill_count(&osd->ring_buffer);
-    int free_bytes = soundio_ring_buffer_capacity(&osd->ring_buffer) - fill_bytes;
+    soundio_os_mutex_lock(sid->mutex);
+    if (sid->loopback_source != os || frame_count <= 0) {
+        soundio_os_mutex_unlock(sid->mutex);
+        return;
+    }
+
+    char *read_ptr = soundio_ring_buffer_read_ptr(&osd->ring_buffer);
+    char *delay_ptr = soundio_ring_buffer_write_ptr(&osd->loopback_delay);
+    struct SoundIoChannelArea src_areas[SOUNDIO_MAX_CHANNELS];
+    struct SoundIoChannelArea dst_areas[SOUNDIO_MAX_CHANNELS];
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        src_areas[ch].ptr = read_ptr + outstream->bytes_per_sample * ch;
+        src_areas[ch].step = outstream->bytes_per_frame;
+        dst_areas[ch].ptr = delay_ptr + sizeof(float) * ch;
+        dst_areas[ch].step = delay_bytes_per_frame;
+    }
+    soundio_convert_samples(SoundIoFormatFloat32NE, dst_areas, outstream->format, src_areas,
+            channel_count, frame_count);
+    soundio_ring_buffer_advance_write_ptr(&osd->loopback_delay, frame_count * delay_bytes_per_frame);
+
+    int delay_fill_frames = soundio_ring_buffer_fill_count(&osd->loopback_delay) / delay_bytes_per_frame;
+    int ready_frames = delay_fill_frames - osd->loopback_delay_frame_count;
+
+    struct SoundIoInStreamPrivate *is = sid->loopback_sink;
+    if (is && !SOUNDIO_ATOMIC_LOAD(is->backend_data.dummy.pause_requested)) {
+        struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
+        int record_count = soundio_int_min(ready_frames, record_free_frames(is));
+        if (record_count < ready_frames)
+            SOUNDIO_ATOMIC_STORE(isd->loopback_overflow, true);
+        record_frames(is, soundio_ring_buffer_read_ptr(&osd->loopback_delay), channel_count, record_count);
+        timer_wake_locked(sid, &isd->timer);
+    }
+    soundio_ring_buffer_advance_read_ptr(&osd->loopback_delay, ready_frames * delay_bytes_per_frame);
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
+// Hands the application all the room there is in the buffer.
+static void outstream_fill(struct SoundIoOutStreamPrivate *os, int free_bytes) {
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
     int free_frames = free_bytes / outstream->bytes_per_frame;
     osd->frames_left = free_frames;
     if (free_frames > 0)
         outstream->write_callback(outstream, 0, free_frames);
-    double start_time = soundio_os_get_time();
-    long frames_consumed = 0;
-
-    while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osd->abort_flag)) {
-        double now = soundio_os_get_time();
-        double time_passed = now - start_time;
-        double next_period = start_time +
-            ceil_dbl(time_passed / osd->period_duration) * osd->period_duration;
-        double relative_time = next_period - now;
-        soundio_os_cond_timed_wait(osd->cond, NULL, relative_time);
-        if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osd->clear_buffer_flag)) {
-            soundio_ring_buffer_clear(&osd->ring_buffer);
-            int free_bytes = soundio_ring_buffer_capacity(&osd->ring_buffer);
-            int free_frames = free_bytes / outstream->bytes_per_frame;
-            osd->frames_left = free_frames;
-            if (free_frames > 0)
-                outstream->write_callback(outstream, 0, free_frames);
-            frames_consumed = 0;
-            start_time = soundio_os_get_time();
-            continue;
-        }
+}
 
-        if (SOUNDIO_ATOMIC_LOAD(osd->pause_requested)) {
-            start_time = now;
-            frames_consumed = 0;
-            continue;
-        }
+static double outstream_tick(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer, double now) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)timer->stream;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
 
+    if (!osd->primed || !SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osd->clear_buffer_flag)) {
+        if (osd->primed)
+            soundio_ring_buffer_clear(&osd->ring_buffer);
+        osd->primed = true;
         int fill_bytes = soundio_ring_buffer_fill_count(&osd->ring_buffer);
-        int fill_frames = fill_bytes / outstream->bytes_per_frame;
-        int free_bytes = soundio_ring_buffer_capacity(&osd->ring_buffer) - fill_bytes;
-        int free_frames = free_bytes / outstream->bytes_per_frame;
-
-        double total_time = soundio_os_get_time() - start_time;
-        long total_frames = total_time * outstream->sample_rate;
-        int frames_to_kill = total_frames - frames_consumed;
-        int read_count = soundio_int_min(frames_to_kill, fill_frames);
-        int byte_count = read_count * outstream->bytes_per_frame;
-        soundio_ring_buffer_advance_read_ptr(&osd->ring_buffer, byte_count);
-        frames_consumed += read_count;
-
-        if (frames_to_kill > fill_frames) {
-            outstream->underflow_callback(outstream);
-            osd->frames_left = free_frames;
-            if (free_frames > 0)
-                outstream->write_callback(outstream, 0, free_frames);
-            frames_consumed = 0;
-            start_time = soundio_os_get_time();
-        } else if (free_frames > 0) {
-            osd->frames_left = free_frames;
-            outstream->write_callback(outstream, 0, free_frames);
-        }
+        outstream_fill(os, soundio_ring_buffer_capacity(&osd->ring_buffer) - fill_bytes);
+        osd->frames_consumed = 0;
+        clock_start(&osd->clock, now);
+        return clock_next(&osd->clock, now);
+    }
+
+    // Until outstream_pause_dummy wakes it up.
+    if (SOUNDIO_ATOMIC_LOAD(osd->pause_requested)) {
+        osd->paused = true;
+        return -1.0;
+    }
+    if (osd->paused) {
+        osd->paused = false;
+        osd->frames_consumed = 0;
+        clock_start(&osd->clock, now);
+        return clock_next(&osd->clock, now);
+    }
+
+    if (device_removed(si)) {
+        outstream->error_callback(outstream, SoundIoErrorStreaming);
+        return -1.0;
+    }
+
+    const struct SoundIoDummyFault *fault;
+    while ((fault = due_fault(&sid->faults, &osd->fault_index, osd->device_frame))) {
+        if (fault->kind == SoundIoDummyFaultUnderflow)
+            osd->forced_xrun = true;
+        else if (fault->kind == SoundIoDummyFaultStall)
+            return timer_stall(si, timer, clock_stall(&osd->clock, now, fault->seconds));
+    }
+
+    int fill_bytes = soundio_ring_buffer_fill_count(&osd->ring_buffer);
+    int fill_frames = fill_bytes / outstream->bytes_per_frame;
+
+    long total_frames = clock_frames(&osd->clock, now);
+    int frames_to_kill = total_frames - osd->frames_consumed;
+    // The device plays past the end of what is buffered.
+    if (osd->forced_xrun)
+        frames_to_kill = soundio_int_max(frames_to_kill, fill_frames + 1);
+    osd->forced_xrun = false;
+    int read_count = soundio_int_min(frames_to_kill, fill_frames);
+    int byte_count = read_count * outstream->bytes_per_frame;
+    if (osd->loopback)
+        loopback_play(si, os, read_count);
+    soundio_ring_buffer_advance_read_ptr(&osd->ring_buffer, byte_count);
+    osd->frames_consumed += read_count;
+    osd->device_frame += read_count;
+
+    // Including what was just played, so that a freewheeling stream is
+    // topped up to the full buffer every period.
+    int free_bytes = soundio_ring_buffer_capacity(&osd->ring_buffer) - (fill_bytes - byte_count);
+
+    if (frames_to_kill > fill_frames) {
+        outstream->underflow_callback(outstream);
+        osd->frames_consumed = 0;
+        clock_start(&osd->clock, now);
     }
+    outstream_fill(os, free_bytes);
+    return clock_next(&osd->clock, now);
 }
 
-static void capture_thread_run(void *arg) {
-    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)arg;
+static double instream_tick(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer, double now) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)timer->stream;
     struct SoundIoInStream *instream = &is->pub;
     struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
 
-    long frames_consumed = 0;
-    double start_time = soundio_os_get_time();
-    while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isd->abort_flag)) {
-        double now = soundio_os_get_time();
-        double time_passed = now - start_time;
-        double next_period = start_time +
-            ceil_dbl(time_passed / isd->period_duration) * isd->period_duration;
-        double relative_time = next_period - now;
-        soundio_os_cond_timed_wait(isd->cond, NULL, relative_time);
-
-        if (SOUNDIO_ATOMIC_LOAD(isd->pause_requested)) {
-            start_time = now;
-            frames_consumed = 0;
-            continue;
-        }
+    // Until instream_pause_dummy wakes it up.
+    if (SOUNDIO_ATOMIC_LOAD(isd->pause_requested)) {
+        isd->paused = true;
+        return -1.0;
+    }
+    // Starting and resuming alike: the device records from now on.
+    if (!isd->primed || isd->paused) {
+        isd->primed = true;
+        isd->paused = false;
+        isd->frames_consumed = 0;
+        clock_start(&isd->clock, now);
+        return clock_next(&isd->clock, now);
+    }
 
-        int fill_bytes = soundio_ring_buffer_fill_count(&isd->ring_buffer);
-        int free_bytes = soundio_ring_buffer_capacity(&isd->ring_buffer) - fill_bytes;
-        int fill_frames = fill_bytes / instream->bytes_per_frame;
-        int free_frames = free_bytes / instream->bytes_per_frame;
-
-        double total_time = soundio_os_get_time() - start_time;
-        long total_frames = total_time * instream->sample_rate;
-        int frames_to_kill = total_frames - frames_consumed;
-        int write_count = soundio_int_min(frames_to_kill, free_frames);
-        int byte_count = write_count * instream->bytes_per_frame;
-        soundio_ring_buffer_advance_write_ptr(&isd->ring_buffer, byte_count);
-        frames_consumed += write_count;
-
-        if (frames_to_kill > free_frames) {
-            instream->overflow_callback(instream);
-            frames_consumed = 0;
-            start_time = soundio_os_get_time();
-        }
-        if (fill_frames > 0) {
-            isd->frames_left = fill_frames;
-            instream->read_callback(instream, 0, fill_frames);
-        }
+    if (device_removed(si)) {
+        instream->error_callback(instream, SoundIoErrorStreaming);
+        return -1.0;
+    }
+
+    const struct SoundIoDummyFault *fault;
+    while ((fault = due_fault(&sid->faults, &isd->fault_index, isd->device_frame))) {
+        if (fault->kind == SoundIoDummyFaultOverflow)
+            isd->forced_xrun = true;
+        else if (fault->kind == SoundIoDummyFaultStall)
+            return timer_stall(si, timer, clock_stall(&isd->clock, now, fault->seconds));
+    }
+
+    int fill_bytes = soundio_ring_buffer_fill_count(&isd->ring_buffer);
+    int free_bytes = soundio_ring_buffer_capacity(&isd->ring_buffer) - fill_bytes;
+    int fill_frames = fill_bytes / instream->bytes_per_frame;
+    int free_frames = free_bytes / instream->bytes_per_frame;
+
+    long total_frames = clock_frames(&isd->clock, now);
+    int frames_to_kill = total_frames - isd->frames_consumed;
+    // The device records more than there is room for.
+    if (isd->forced_xrun)
+        frames_to_kill = soundio_int_max(frames_to_kill, free_frames + 1);
+    isd->forced_xrun = false;
+    int write_count = soundio_int_min(frames_to_kill, free_frames);
+    record_frames(is, NULL, 0, write_count);
+    isd->frames_consumed += write_count;
+
+    if (frames_to_kill > free_frames) {
+        instream->overflow_callback(instream);
+        isd->frames_consumed = 0;
+        clock_start(&isd->clock, now);
+    }
+    if (fill_frames > 0) {
+        isd->frames_left = fill_frames;
+        instream->read_callback(instream, 0, fill_frames);
+    }
+    return clock_next(&isd->clock, now);
+}
+
+// Records what the loopback source plays, when it is woken up by it rather
+// than on a clock of its own. On the wall clock it also looks every period
+// for the device going away.
+static double loopback_sink_tick(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer, double now) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)timer->stream;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    double next = isd->clock.freewheel ? -1.0 : now + isd->clock.period_duration;
+
+    if (SOUNDIO_ATOMIC_LOAD(isd->pause_requested))
+        return -1.0;
+
+    if (device_removed(si)) {
+        instream->error_callback(instream, SoundIoErrorStreaming);
+        return -1.0;
     }
+
+    // Written by the source along with the ring buffer.
+    soundio_os_mutex_lock(sid->mutex);
+    long device_frame = isd->device_frame;
+    int fill_bytes = soundio_ring_buffer_fill_count(&isd->ring_buffer);
+    soundio_os_mutex_unlock(sid->mutex);
+    int fill_frames = fill_bytes / instream->bytes_per_frame;
+
+    const struct SoundIoDummyFault *fault;
+    while ((fault = due_fault(&sid->faults, &isd->fault_index, device_frame))) {
+        if (fault->kind == SoundIoDummyFaultOverflow)
+            isd->forced_xrun = true;
+        else if (fault->kind == SoundIoDummyFaultStall)
+            return timer_stall(si, timer, now + fault->seconds);
+    }
+
+    bool overflow = SOUNDIO_ATOMIC_EXCHANGE(isd->loopback_overflow, false);
+    if (isd->forced_xrun) {
+        // What was recorded is lost.
+        soundio_ring_buffer_advance_read_ptr(&isd->ring_buffer, fill_bytes);
+        fill_frames = 0;
+        overflow = true;
+        isd->forced_xrun = false;
+    }
+
+    if (overflow)
+        instream->overflow_callback(instream);
+    isd->frames_left = fill_frames;
+    if (fill_frames > 0)
+        instream->read_callback(instream, 0, fill_frames);
+    return next;
 }
 
 static void destroy_dummy(struct SoundIoPrivate *si) {
     struct SoundIoDummy *sid = &si->backend_data.dummy;
 
+    if (sid->timer_thread) {
+        soundio_os_mutex_lock(sid->mutex);
+        sid->timer_abort = true;
+        soundio_os_cond_signal(sid->timer_cond, sid->mutex);
+        soundio_os_mutex_unlock(sid->mutex);
+        soundio_os_thread_destroy(sid->timer_thread);
+        sid->timer_thread = NULL;
+    }
+    SoundIoListDummyTimerPtr_deinit(&sid->timer_heap);
+
+    if (sid->timer_idle_cond)
+        soundio_os_cond_destroy(sid->timer_idle_cond);
+
+    if (sid->timer_cond)
+        soundio_os_cond_destroy(sid->timer_cond);
+
     if (sid->cond)
         soundio_os_cond_destroy(sid->cond);
 
@@ -136,16 +705,35 @@ static void destroy_dummy(struct SoundIoPrivate *si) {
 static void flush_events_dummy(struct SoundIoPrivate *si) {
     struct SoundIo *soundio = &si->pub;
     struct SoundIoDummy *sid = &si->backend_data.dummy;
-    if (sid->devices_emitted)
-        return;
-    sid->devices_emitted = true;
-    soundio->on_devices_change(soundio);
+    if (!sid->devices_emitted) {
+        sid->devices_emitted = true;
+        soundio->on_devices_change(soundio);
+    }
+    if (!sid->removal_emitted && device_removed(si)) {
+        sid->removal_emitted = true;
+        struct SoundIoDevicesInfo *devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
+        if (devices_info) {
+            devices_info->default_input_index = -1;
+            devices_info->default_output_index = -1;
+            soundio_destroy_devices_info(si->safe_devices_info);
+            si->safe_devices_info = devices_info;
+        }
+        soundio->on_devices_change(soundio);
+        soundio->on_backend_disconnect(soundio, SoundIoErrorBackendDisconnected);
+    }
 }
 
 static void wait_events_dummy(struct SoundIoPrivate *si) {
     struct SoundIoDummy *sid = &si->backend_data.dummy;
     flush_events_dummy(si);
-    soundio_os_cond_wait(sid->cond, NULL);
+    if (sid->faults.remove_after >= 0.0 && !sid->removal_emitted) {
+        double remaining = sid->remove_time - soundio_os_get_time();
+        if (remaining > 0.0)
+            soundio_os_cond_timed_wait(sid->cond, NULL, remaining);
+        flush_events_dummy(si);
+    } else {
+        soundio_os_cond_wait(sid->cond, NULL);
+    }
 }
 
 static void wakeup_dummy(struct SoundIoPrivate *si) {
@@ -158,18 +746,17 @@ static void force_device_scan_dummy(struct SoundIoPrivate *si) {
 }
 
 static void outstream_destroy_dummy(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
     struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
 
-    if (osd->thread) {
-        SOUNDIO_ATOMIC_FLAG_CLEAR(osd->abort_flag);
-        soundio_os_cond_signal(osd->cond, NULL);
-        soundio_os_thread_destroy(osd->thread);
-        osd->thread = NULL;
-    }
-    soundio_os_cond_destroy(osd->cond);
-    osd->cond = NULL;
+    timer_stop(si, &osd->timer);
+    soundio_os_mutex_lock(sid->mutex);
+    if (sid->loopback_source == os)
+        sid->loopback_source = NULL;
+    soundio_os_mutex_unlock(sid->mutex);
 
     soundio_ring_buffer_deinit(&osd->ring_buffer);
+    soundio_ring_buffer_deinit(&osd->loopback_delay);
 }
 
 static int outstream_open_dummy(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
@@ -180,16 +767,23 @@ static int outstream_open_dummy(struct SoundIoPrivate *si, struct SoundIoOutStre
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osd->clear_buffer_flag);
     SOUNDIO_ATOMIC_STORE(osd->pause_requested, false);
 
+    if (si->pub.dummy_loopback && !(si->pub.dummy_loopback_latency >= 0.0))
+        return SoundIoErrorInvalid;
+    if (device_removed(si))
+        return SoundIoErrorNoSuchDevice;
+
     if (outstream->software_latency == 0.0) {
         outstream->software_latency = soundio_double_clamp(
                 device->software_latency_min, 1.0, device->software_latency_max);
     }
 
-    osd->period_duration = outstream->software_latency / 2.0;
+    clock_init(&osd->clock, si->backend_data.dummy.freewheel, outstream->sample_rate,
+            outstream->software_latency / 2.0, &si->backend_data.dummy.faults);
 
     int err;
     int buffer_size = outstream->bytes_per_frame * outstream->sample_rate * outstream->software_latency;
-    if ((err = soundio_ring_buffer_init(&osd->ring_buffer, buffer_size))) {
+    int rb_flags = si->pub.lock_memory ? SoundIoRingBufferFlagLockMemory : SoundIoRingBufferFlagNone;
+    if ((err = soundio_ring_buffer_init_flags(&osd->ring_buffer, buffer_size, rb_flags))) {
         outstream_destroy_dummy(si, os);
         return err;
     }
@@ -197,10 +791,16 @@ static int outstream_open_dummy(struct SoundIoPrivate *si, struct SoundIoOutStre
     osd->buffer_frame_count = actual_capacity / outstream->bytes_per_frame;
     outstream->software_latency = osd->buffer_frame_count / (double) outstream->sample_rate;
 
-    osd->cond = soundio_os_cond_create();
-    if (!osd->cond) {
-        outstream_destroy_dummy(si, os);
-        return SoundIoErrorNoMem;
+    osd->loopback = si->pub.dummy_loopback;
+    if (osd->loopback) {
+        osd->loopback_delay_frame_count = (int)(si->pub.dummy_loopback_latency * outstream->sample_rate + 0.5);
+        // Room for the delay and everything played in one go on top of it.
+        int delay_size = (int)sizeof(float) * outstream->layout.channel_count *
+            (osd->loopback_delay_frame_count + osd->buffer_frame_count);
+        if ((err = soundio_ring_buffer_init_flags(&osd->loopback_delay, delay_size, rb_flags))) {
+            outstream_destroy_dummy(si, os);
+            return err;
+        }
     }
 
     return 0;
@@ -209,21 +809,29 @@ static int outstream_open_dummy(struct SoundIoPrivate *si, struct SoundIoOutStre
 static int outstream_pause_dummy(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os, bool pause) {
     struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
     SOUNDIO_ATOMIC_STORE(osd->pause_requested, pause);
+    if (!pause)
+        timer_wake(si, &osd->timer);
     return 0;
 }
 
 static int outstream_start_dummy(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
     struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
-    struct SoundIo *soundio = &si->pub;
-    assert(!osd->thread);
-    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osd->abort_flag);
-    int err;
-    if ((err = soundio_os_thread_create(playback_thread_run, os,
-                    soundio->emit_rtprio_warning, &osd->thread)))
-    {
-        return err;
+    assert(!osd->timer.started);
+    osd->primed = false;
+    osd->paused = false;
+    osd->forced_xrun = false;
+    osd->device_frame = 0;
+    osd->fault_index = 0;
+    if (osd->loopback) {
+        soundio_os_mutex_lock(sid->mutex);
+        if (!sid->loopback_source) {
+            loopback_start(os);
+            sid->loopback_source = os;
+        }
+        soundio_os_mutex_unlock(sid->mutex);
     }
-    return 0;
+    return timer_start(si, &osd->timer, outstream_tick, os);
 }
 
 static int outstream_begin_write_dummy(struct SoundIoPrivate *si,
@@ -258,7 +866,7 @@ static int outstream_end_write_dummy(struct SoundIoPrivate *si, struct SoundIoOu
 static int outstream_clear_buffer_dummy(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
     struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
     SOUNDIO_ATOMIC_FLAG_CLEAR(osd->clear_buffer_flag);
-    soundio_os_cond_signal(osd->cond, NULL);
+    timer_wake(si, &osd->timer);
     return 0;
 }
 
@@ -271,17 +879,24 @@ static int outstream_get_latency_dummy(struct SoundIoPrivate *si, struct SoundIo
     return 0;
 }
 
+static int outstream_get_page_faults_dummy(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        long *out_minor_faults, long *out_major_faults)
+{
+    // Shared with every other stream.
+    struct SoundIoOsThread *thread = os->backend_data.dummy.timer.started ?
+        si->backend_data.dummy.timer_thread : NULL;
+    return soundio_os_thread_page_faults(thread, out_minor_faults, out_major_faults);
+}
+
 static void instream_destroy_dummy(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
     struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
 
-    if (isd->thread) {
-        SOUNDIO_ATOMIC_FLAG_CLEAR(isd->abort_flag);
-        soundio_os_cond_signal(isd->cond, NULL);
-        soundio_os_thread_destroy(isd->thread);
-        isd->thread = NULL;
-    }
-    soundio_os_cond_destroy(isd->cond);
-    isd->cond = NULL;
+    timer_stop(si, &isd->timer);
+    soundio_os_mutex_lock(sid->mutex);
+    if (sid->loopback_sink == is)
+        sid->loopback_sink = NULL;
+    soundio_os_mutex_unlock(sid->mutex);
 
     soundio_ring_buffer_deinit(&isd->ring_buffer);
 }
@@ -292,19 +907,27 @@ static int instream_open_dummy(struct SoundIoPrivate *si, struct SoundIoInStream
     struct SoundIoDevice *device = instream->device;
 
     SOUNDIO_ATOMIC_STORE(isd->pause_requested, false);
+    SOUNDIO_ATOMIC_STORE(isd->loopback_overflow, false);
+    isd->loopback = si->pub.dummy_loopback;
+
+    if (device_removed(si))
+        return SoundIoErrorNoSuchDevice;
 
     if (instream->software_latency == 0.0) {
         instream->software_latency = soundio_double_clamp(
                 device->software_latency_min, 1.0, device->software_latency_max);
     }
 
-    isd->period_duration = instream->software_latency;
+    double period_duration = instream->software_latency;
+    clock_init(&isd->clock, si->backend_data.dummy.freewheel, instream->sample_rate, period_duration,
+            &si->backend_data.dummy.faults);
 
-    double target_buffer_duration = isd->period_duration * 4.0;
+    double target_buffer_duration = period_duration * 4.0;
 
     int err;
     int buffer_size = instream->bytes_per_frame * instream->sample_rate * target_buffer_duration;
-    if ((err = soundio_ring_buffer_init(&isd->ring_buffer, buffer_size))) {
+    int rb_flags = si->pub.lock_memory ? SoundIoRingBufferFlagLockMemory : SoundIoRingBufferFlagNone;
+    if ((err = soundio_ring_buffer_init_flags(&isd->ring_buffer, buffer_size, rb_flags))) {
         instream_destroy_dummy(si, is);
         return err;
     }
@@ -312,33 +935,36 @@ static int instream_open_dummy(struct SoundIoPrivate *si, struct SoundIoInStream
     int actual_capacity = soundio_ring_buffer_capacity(&isd->ring_buffer);
     isd->buffer_frame_count = actual_capacity / instream->bytes_per_frame;
 
-    isd->cond = soundio_os_cond_create();
-    if (!isd->cond) {
-        instream_destroy_dummy(si, is);
-        return SoundIoErrorNoMem;
-    }
-
     return 0;
 }
 
 static int instream_pause_dummy(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is, bool pause) {
     struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
     SOUNDIO_ATOMIC_STORE(isd->pause_requested, pause);
+    if (!pause)
+        timer_wake(si, &isd->timer);
     return 0;
 }
 
 static int instream_start_dummy(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
     struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
-    struct SoundIo *soundio = &si->pub;
-    assert(!isd->thread);
-    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isd->abort_flag);
-    int err;
-    if ((err = soundio_os_thread_create(capture_thread_run, is,
-                    soundio->emit_rtprio_warning, &isd->thread)))
-    {
-        return err;
+    assert(!isd->timer.started);
+    isd->primed = false;
+    isd->paused = false;
+    isd->forced_xrun = false;
+    isd->device_frame = 0;
+    isd->fault_index = 0;
+    double (*run)(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer, double now) = instream_tick;
+    if (isd->loopback) {
+        soundio_os_mutex_lock(sid->mutex);
+        if (!sid->loopback_sink) {
+            sid->loopback_sink = is;
+            run = loopback_sink_tick;
+        }
+        soundio_os_mutex_unlock(sid->mutex);
     }
-    return 0;
+    return timer_start(si, &isd->timer, run, is);
 }
 
 static int instream_begin_read_dummy(struct SoundIoPrivate *si,
@@ -379,56 +1005,343 @@ static int instream_get_latency_dummy(struct SoundIoPrivate *si, struct SoundIoI
     return 0;
 }
 
-static int set_all_device_formats(struct SoundIoDevice *device) {
-    device->format_count = 18;
-    device->formats = ALLOCATE(enum SoundIoFormat, device->format_count);
-    if (!device->formats)
-        return SoundIoErrorNoMem;
+static int instream_get_page_faults_dummy(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is,
+        long *out_minor_faults, long *out_major_faults)
+{
+    struct SoundIoOsThread *thread = is->backend_data.dummy.timer.started ?
+        si->backend_data.dummy.timer_thread : NULL;
+    return soundio_os_thread_page_faults(thread, out_minor_faults, out_major_faults);
+}
+
+// Every format the dummy backend supports, in order of preference.
+static const enum SoundIoFormat all_formats[SOUNDIO_DUMMY_FORMAT_COUNT] = {
+    SoundIoFormatFloat32NE,
+    SoundIoFormatFloat32FE,
+    SoundIoFormatS32NE,
+    SoundIoFormatS32FE,
+    SoundIoFormatU32NE,
+    SoundIoFormatU32FE,
+    SoundIoFormatS24NE,
+    SoundIoFormatS24FE,
+    SoundIoFormatU24NE,
+    SoundIoFormatU24FE,
+    SoundIoFormatFloat64NE,
+    SoundIoFormatFloat64FE,
+    SoundIoFormatS16NE,
+    SoundIoFormatS16FE,
+    SoundIoFormatU16NE,
+    SoundIoFormatU16FE,
+    SoundIoFormatS8,
+    SoundIoFormatU8,
+};
+
+struct FormatName {
+    const char *name;
+    enum SoundIoFormat format;
+};
+
+static const struct FormatName format_names[SOUNDIO_DUMMY_MAX_FORMATS] = {
+    {"s8", SoundIoFormatS8},
+    {"u8", SoundIoFormatU8},
+    {"s16le", SoundIoFormatS16LE},
+    {"s16be", SoundIoFormatS16BE},
+    {"u16le", SoundIoFormatU16LE},
+    {"u16be", SoundIoFormatU16BE},
+    {"s24le", SoundIoFormatS24LE},
+    {"s24be", SoundIoFormatS24BE},
+    {"u24le", SoundIoFormatU24LE},
+    {"u24be", SoundIoFormatU24BE},
+    {"s24packedle", SoundIoFormatS24PackedLE},
+    {"s24packedbe", SoundIoFormatS24PackedBE},
+    {"u24packedle", SoundIoFormatU24PackedLE},
+    {"u24packedbe", SoundIoFormatU24PackedBE},
+    {"s32le", SoundIoFormatS32LE},
+    {"s32be", SoundIoFormatS32BE},
+    {"u32le", SoundIoFormatU32LE},
+    {"u32be", SoundIoFormatU32BE},
+    {"float32le", SoundIoFormatFloat32LE},
+    {"float32be", SoundIoFormatFloat32BE},
+    {"float64le", SoundIoFormatFloat64LE},
+    {"float64be", SoundIoFormatFloat64BE},
+};
+
+static bool parse_int(const char **str, int min_value, int max_value, int *out) {
+    long value;
+    if (!parse_frame(str, &value) || value < min_value || value > max_value)
+        return false;
+    *out = value;
+    return true;
+}
+
+// A number, or two of them separated by a dash.
+static bool parse_int_range(const char **str, int min_value, int max_value, int *out_min, int *out_max) {
+    if (!parse_int(str, min_value, max_value, out_min))
+        return false;
+    *out_max = *out_min;
+    if (parse_prefix(str, "-"))
+        return parse_int(str, *out_min, max_value, out_max);
+    return true;
+}
+
+static bool parse_format(const char **str, enum SoundIoFormat *out) {
+    for (size_t i = 0; i < ARRAY_LENGTH(format_names); i += 1) {
+        if (parse_prefix(str, format_names[i].name)) {
+            *out = format_names[i].format;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_device_separator(char c) {
+    return !c || strchr(";, \t\n", c);
+}
+
+static void device_spec_init(struct SoundIoDummyDeviceSpec *spec, enum SoundIoDeviceAim aim) {
+    memset(spec, 0, sizeof(struct SoundIoDummyDeviceSpec));
+    spec->aim = aim;
+    spec->count = 1;
+    spec->channel_count_min = 1;
+    spec->channel_count_max = SOUNDIO_MAX_CHANNELS;
+    spec->format_count = SOUNDIO_DUMMY_FORMAT_COUNT;
+    memcpy(spec->formats, all_formats, sizeof(all_formats));
+    spec->sample_rate_count = 1;
+    spec->sample_rates[0].min = SOUNDIO_MIN_SAMPLE_RATE;
+    spec->sample_rates[0].max = SOUNDIO_MAX_SAMPLE_RATE;
+    spec->software_latency_min = 0.01;
+    spec->software_latency_max = 4.0;
+    spec->software_latency_current = -1.0;
+}
+
+static bool device_spec_supports_rate(const struct SoundIoDummyDeviceSpec *spec, int sample_rate) {
+    for (int i = 0; i < spec->sample_rate_count; i += 1) {
+        if (sample_rate >= spec->sample_rates[i].min && sample_rate <= spec->sample_rates[i].max)
+            return true;
+    }
+    return false;
+}
+
+// Parses the settings of one device of SoundIo::dummy_devices, up to the
+// semicolon which ends it, and fills in what was not given.
+static int parse_device_spec(struct SoundIoDummyDeviceSpec *spec, const char **str) {
+    const char *p = *str;
+    for (;;) {
+        p += strspn(p, ", \t\n");
+        if (!*p || *p == ';')
+            break;
+        double seconds;
+        if (parse_prefix(&p, "count=")) {
+            if (!parse_int(&p, 1, SOUNDIO_DUMMY_MAX_DEVICE_COUNT, &spec->count))
+                return SoundIoErrorInvalid;
+        } else if (parse_prefix(&p, "channels=")) {
+            if (!parse_int_range(&p, 1, SOUNDIO_MAX_CHANNELS, &spec->channel_count_min, &spec->channel_count_max))
+                return SoundIoErrorInvalid;
+        } else if (parse_prefix(&p, "formats=")) {
+            spec->format_count = 0;
+            do {
+                if (spec->format_count >= SOUNDIO_DUMMY_MAX_FORMATS ||
+                    !parse_format(&p, &spec->formats[spec->format_count]))
+                {
+                    return SoundIoErrorInvalid;
+                }
+                spec->format_count += 1;
+            } while (parse_prefix(&p, "|"));
+        } else if (parse_prefix(&p, "rates=")) {
+            spec->sample_rate_count = 0;
+            do {
+                if (spec->sample_rate_count >= SOUNDIO_DUMMY_MAX_RATE_RANGES)
+                    return SoundIoErrorInvalid;
+                struct SoundIoSampleRateRange *range = &spec->sample_rates[spec->sample_rate_count];
+                if (!parse_int_range(&p, SOUNDIO_MIN_SAMPLE_RATE, SOUNDIO_MAX_SAMPLE_RATE,
+                            &range->min, &range->max))
+                {
+                    return SoundIoErrorInvalid;
+                }
+                spec->sample_rate_count += 1;
+            } while (parse_prefix(&p, "|"));
+        } else if (parse_prefix(&p, "rate=")) {
+            if (!parse_int(&p, SOUNDIO_MIN_SAMPLE_RATE, SOUNDIO_MAX_SAMPLE_RATE, &spec->sample_rate_current))
+                return SoundIoErrorInvalid;
+        } else if (parse_prefix(&p, "latency=")) {
+            if (!parse_seconds(&p, &spec->software_latency_min) || !parse_prefix(&p, "-") ||
+                !parse_seconds(&p, &spec->software_latency_max))
+            {
+                return SoundIoErrorInvalid;
+            }
+        } else if (parse_prefix(&p, "latency_current=")) {
+            if (!parse_seconds(&p, &seconds))
+                return SoundIoErrorInvalid;
+            spec->software_latency_current = seconds;
+        } else {
+            return SoundIoErrorInvalid;
+        }
+        if (!is_device_separator(*p))
+            return SoundIoErrorInvalid;
+    }
+    *str = p;
 
-    device->formats[0] = SoundIoFormatFloat32NE;
-    device->formats[1] = SoundIoFormatFloat32FE;
-    device->formats[2] = SoundIoFormatS32NE;
-    device->formats[3] = SoundIoFormatS32FE;
-    device->formats[4] = SoundIoFormatU32NE;
-    device->formats[5] = SoundIoFormatU32FE;
-    device->formats[6] = SoundIoFormatS24NE;
-    device->formats[7] = SoundIoFormatS24FE;
-    device->formats[8] = SoundIoFormatU24NE;
-    device->formats[9] = SoundIoFormatU24FE;
-    device->formats[10] = SoundIoFormatFloat64NE;
-    device->formats[11] = SoundIoFormatFloat64FE;
-    device->formats[12] = SoundIoFormatS16NE;
-    device->formats[13] = SoundIoFormatS16FE;
-    device->formats[14] = SoundIoFormatU16NE;
-    device->formats[15] = SoundIoFormatU16FE;
-    device->formats[16] = SoundIoFormatS8;
-    device->formats[17] = SoundIoFormatU8;
+    if (!(spec->software_latency_min > 0.0) || spec->software_latency_min > spec->software_latency_max)
+        return SoundIoErrorInvalid;
+    if (spec->software_latency_current < 0.0) {
+        spec->software_latency_current = soundio_double_clamp(
+                spec->software_latency_min, 0.1, spec->software_latency_max);
+    } else if (spec->software_latency_current < spec->software_latency_min ||
+            spec->software_latency_current > spec->software_latency_max)
+    {
+        return SoundIoErrorInvalid;
+    }
 
+    if (spec->sample_rate_current == 0) {
+        spec->sample_rate_current = device_spec_supports_rate(spec, 48000) ?
+            48000 : spec->sample_rates[0].max;
+    } else if (!device_spec_supports_rate(spec, spec->sample_rate_current)) {
+        return SoundIoErrorInvalid;
+    }
     return 0;
 }
 
-static void set_all_device_sample_rates(struct SoundIoDevice *device) {
+static int set_device_channel_layouts(struct SoundIoDevice *device, int channel_count_min,
+        int channel_count_max)
+{
+    int builtin_count = soundio_channel_layout_builtin_count();
+    device->layouts = ALLOCATE(struct SoundIoChannelLayout, builtin_count);
+    if (!device->layouts)
+        return SoundIoErrorNoMem;
+    device->layout_count = 0;
+    for (int i = 0; i < builtin_count; i += 1) {
+        const struct SoundIoChannelLayout *layout = soundio_channel_layout_get_builtin(i);
+        if (layout->channel_count >= channel_count_min && layout->channel_count <= channel_count_max) {
+            device->layouts[device->layout_count] = *layout;
+            device->layout_count += 1;
+        }
+    }
+    // No built in layout has that many channels.
+    if (device->layout_count == 0)
+        return SoundIoErrorInvalid;
+    return 0;
+}
+
+static int set_device_sample_rates(struct SoundIoDevice *device, const struct SoundIoDummyDeviceSpec *spec) {
     struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)device;
-    device->sample_rate_count = 1;
-    device->sample_rates = &dev->prealloc_sample_rate_range;
-    device->sample_rates[0].min = SOUNDIO_MIN_SAMPLE_RATE;
-    device->sample_rates[0].max = SOUNDIO_MAX_SAMPLE_RATE;
+    if (spec->sample_rate_count == 1) {
+        device->sample_rate_count = 1;
+        device->sample_rates = &dev->prealloc_sample_rate_range;
+        device->sample_rates[0] = spec->sample_rates[0];
+        return 0;
+    }
+    for (int i = 0; i < spec->sample_rate_count; i += 1) {
+        if (SoundIoListSampleRateRange_append(&dev->sample_rates, spec->sample_rates[i]))
+            return SoundIoErrorNoMem;
+    }
+    device->sample_rate_count = dev->sample_rates.length;
+    device->sample_rates = dev->sample_rates.items;
+    return 0;
 }
 
-static int set_all_device_channel_layouts(struct SoundIoDevice *device) {
-    device->layout_count = soundio_channel_layout_builtin_count();
-    device->layouts = ALLOCATE(struct SoundIoChannelLayout, device->layout_count);
-    if (!device->layouts)
+// The first device of each aim is `dummy-out` or `dummy-in`, the rest are
+// numbered after it.
+static int create_device(struct SoundIoPrivate *si, const struct SoundIoDummyDeviceSpec *spec) {
+    struct SoundIo *soundio = &si->pub;
+    bool is_output = spec->aim == SoundIoDeviceAimOutput;
+    struct SoundIoListDevicePtr *devices = is_output ?
+        &si->safe_devices_info->output_devices : &si->safe_devices_info->input_devices;
+    int index = devices->length;
+
+    struct SoundIoDevicePrivate *dev = ALLOCATE(struct SoundIoDevicePrivate, 1);
+    if (!dev)
+        return SoundIoErrorNoMem;
+    struct SoundIoDevice *device = &dev->pub;
+
+    device->ref_count = 1;
+    device->soundio = soundio;
+    char id[32];
+    char name[48];
+    const char *kind = is_output ? "out" : "in";
+    const char *kind_name = is_output ? "Output" : "Input";
+    if (index == 0) {
+        snprintf(id, sizeof(id), "dummy-%s", kind);
+        snprintf(name, sizeof(name), "Dummy %s Device", kind_name);
+    } else {
+        snprintf(id, sizeof(id), "dummy-%s-%d", kind, index);
+        snprintf(name, sizeof(name), "Dummy %s Device %d", kind_name, index);
+    }
+    device->id = strdup(id);
+    device->name = strdup(name);
+    if (!device->id || !device->name) {
+        soundio_device_unref(device);
+        return SoundIoErrorNoMem;
+    }
+
+    int err;
+    if ((err = set_device_channel_layouts(device, spec->channel_count_min, spec->channel_count_max))) {
+        soundio_device_unref(device);
+        return err;
+    }
+
+    device->format_count = spec->format_count;
+    device->formats = ALLOCATE(enum SoundIoFormat, device->format_count);
+    if (!device->formats) {
+        soundio_device_unref(device);
+        return SoundIoErrorNoMem;
+    }
+    memcpy(device->formats, spec->formats, sizeof(enum SoundIoFormat) * spec->format_count);
+
+    if ((err = set_device_sample_rates(device, spec))) {
+        soundio_device_unref(device);
+        return err;
+    }
+
+    device->software_latency_current = spec->software_latency_current;
+    device->software_latency_min = spec->software_latency_min;
+    device->software_latency_max = spec->software_latency_max;
+
+    device->sample_rate_current = spec->sample_rate_current;
+    device->aim = spec->aim;
+
+    if (SoundIoListDevicePtr_append(devices, device)) {
+        soundio_device_unref(device);
         return SoundIoErrorNoMem;
-    for (int i = 0; i < device->layout_count; i += 1)
-        device->layouts[i] = *soundio_channel_layout_get_builtin(i);
+    }
     return 0;
 }
 
+// See SoundIo::dummy_devices for the syntax.
+static int create_devices(struct SoundIoPrivate *si, const char *description) {
+    const char *p = description;
+    for (;;) {
+        p += strspn(p, "; \t\n");
+        if (!*p)
+            return 0;
+        struct SoundIoDummyDeviceSpec spec;
+        if (parse_prefix(&p, "out"))
+            device_spec_init(&spec, SoundIoDeviceAimOutput);
+        else if (parse_prefix(&p, "in"))
+            device_spec_init(&spec, SoundIoDeviceAimInput);
+        else
+            return SoundIoErrorInvalid;
+        if (!is_device_separator(*p))
+            return SoundIoErrorInvalid;
+        int err;
+        if ((err = parse_device_spec(&spec, &p)))
+            return err;
+        for (int i = 0; i < spec.count; i += 1) {
+            if ((err = create_device(si, &spec)))
+                return err;
+        }
+    }
+}
+
 int soundio_dummy_init(struct SoundIoPrivate *si) {
     struct SoundIo *soundio = &si->pub;
     struct SoundIoDummy *sid = &si->backend_data.dummy;
 
+    const char *schedule = soundio->dummy_faults ? soundio->dummy_faults : getenv("SOUNDIO_DUMMY_FAULTS");
+    int err;
+    if ((err = parse_faults(&sid->faults, schedule)))
+        return err;
+    sid->remove_time = soundio_os_get_time() + sid->faults.remove_after;
+    sid->freewheel = soundio->dummy_freewheel;
+
     sid->mutex = soundio_os_mutex_create();
     if (!sid->mutex) {
         destroy_dummy(si);
@@ -441,107 +1354,34 @@ int soundio_dummy_init(struct SoundIoPrivate *si) {
         return SoundIoErrorNoMem;
     }
 
-    assert(!si->safe_devices_info);
-    si->safe_devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
-    if (!si->safe_devices_info) {
+    sid->timer_cond = soundio_os_cond_create();
+    if (!sid->timer_cond) {
         destroy_dummy(si);
         return SoundIoErrorNoMem;
     }
 
-    si->safe_devices_info->default_input_index = 0;
-    si->safe_devices_info->default_output_index = 0;
-
-    // create output device
-    {
-        struct SoundIoDevicePrivate *dev = ALLOCATE(struct SoundIoDevicePrivate, 1);
-        if (!dev) {
-            destroy_dummy(si);
-            return SoundIoErrorNoMem;
-        }
-        struct SoundIoDevice *device = &dev->pub;
-
-        device->ref_count = 1;
-        device->soundio = soundio;
-        device->id = strdup("dummy-out");
-        device->name = strdup("Dummy Output Device");
-        if (!device->id || !device->name) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return SoundIoErrorNoMem;
-        }
-
-        int err;
-        if ((err = set_all_device_channel_layouts(device))) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return err;
-        }
-        if ((err = set_all_device_formats(device))) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return err;
-        }
-        set_all_device_sample_rates(device);
-
-        device->software_latency_current = 0.1;
-        device->software_latency_min = 0.01;
-        device->software_latency_max = 4.0;
-
-        device->sample_rate_current = 48000;
-        device->aim = SoundIoDeviceAimOutput;
-
-        if (SoundIoListDevicePtr_append(&si->safe_devices_info->output_devices, device)) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return SoundIoErrorNoMem;
-        }
+    sid->timer_idle_cond = soundio_os_cond_create();
+    if (!sid->timer_idle_cond) {
+        destroy_dummy(si);
+        return SoundIoErrorNoMem;
     }
 
-    // create input device
-    {
-        struct SoundIoDevicePrivate *dev = ALLOCATE(struct SoundIoDevicePrivate, 1);
-        if (!dev) {
-            destroy_dummy(si);
-            return SoundIoErrorNoMem;
-        }
-        struct SoundIoDevice *device = &dev->pub;
-
-        device->ref_count = 1;
-        device->soundio = soundio;
-        device->id = strdup("dummy-in");
-        device->name = strdup("Dummy Input Device");
-        if (!device->id || !device->name) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return SoundIoErrorNoMem;
-        }
-
-        int err;
-        if ((err = set_all_device_channel_layouts(device))) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return err;
-        }
+    assert(!si->safe_devices_info);
+    si->safe_devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
+    if (!si->safe_devices_info) {
+        destroy_dummy(si);
+        return SoundIoErrorNoMem;
+    }
 
-        if ((err = set_all_device_formats(device))) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return err;
-        }
-        set_all_device_sample_rates(device);
-        device->software_latency_current = 0.1;
-        device->software_latency_min = 0.01;
-        device->software_latency_max = 4.0;
-        device->sample_rate_current = 48000;
-        device->aim = SoundIoDeviceAimInput;
-
-        if (SoundIoListDevicePtr_append(&si->safe_devices_info->input_devices, device)) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return SoundIoErrorNoMem;
-        }
+    const char *description = soundio->dummy_devices ? soundio->dummy_devices : getenv("SOUNDIO_DUMMY_DEVICES");
+    if ((err = create_devices(si, description ? description : "out; in"))) {
+        destroy_dummy(si);
+        return err;
     }
 
+    // The first device of each aim, if there is one.
+    si->safe_devices_info->default_input_index = si->safe_devices_info->input_devices.length > 0 ? 0 : -1;
+    si->safe_devices_info->default_output_index = si->safe_devices_info->output_devices.length > 0 ? 0 : -1;
 
     si->destroy = destroy_dummy;
     si->flush_events = flush_events_dummy;
@@ -557,6 +1397,7 @@ int soundio_dummy_init(struct SoundIoPrivate *si) {
     si->outstream_clear_buffer = outstream_clear_buffer_dummy;
     si->outstream_pause = outstream_pause_dummy;
     si->outstream_get_latency = outstream_get_latency_dummy;
+    si->outstream_get_page_faults = outstream_get_page_faults_dummy;
 
     si->instream_open = instream_open_dummy;
     si->instream_destroy = instream_destroy_dummy;
@@ -565,6 +1406,7 @@ int soundio_dummy_init(struct SoundIoPrivate *si) {
     si->instream_end_read = instream_end_read_dummy;
     si->instream_pause = instream_pause_dummy;
     si->instream_get_latency = instream_get_latency_dummy;
+    si->instream_get_page_faults = instream_get_page_faults_dummy;
 
     return 0;
 }
@@ -12,44 +12,182 @@
 #include "os.h"
 #include "ring_buffer.h"
 #include "atomics.h"
+#include "list.h"
+
+#include <stdint.h>
 
 struct SoundIoPrivate;
+struct SoundIoOutStreamPrivate;
+struct SoundIoInStreamPrivate;
 int soundio_dummy_init(struct SoundIoPrivate *si);
 
+#define SOUNDIO_DUMMY_MAX_FAULTS 32
+
+enum SoundIoDummyJitter {
+    SoundIoDummyJitterNone,
+    SoundIoDummyJitterUniform,
+    SoundIoDummyJitterExponential,
+};
+
+enum SoundIoDummyFaultKind {
+    SoundIoDummyFaultUnderflow,
+    SoundIoDummyFaultOverflow,
+    SoundIoDummyFaultStall,
+};
+
+// Happens to each stream once it has played or recorded `frame` frames.
+struct SoundIoDummyFault {
+    enum SoundIoDummyFaultKind kind;
+    long frame;
+    // Stalls only.
+    double seconds;
+};
+
+// Parsed from SoundIo::dummy_faults.
+struct SoundIoDummyFaults {
+    enum SoundIoDummyJitter jitter;
+    // The largest lateness of uniform jitter, the mean of exponential.
+    double jitter_seconds;
+    uint32_t seed;
+    // Seconds after connecting, or negative for never.
+    double remove_after;
+    // Sorted by frame.
+    int count;
+    struct SoundIoDummyFault items[SOUNDIO_DUMMY_MAX_FAULTS];
+};
+
+// The formats devices have by default, all but the packed 24 bit ones.
+#define SOUNDIO_DUMMY_FORMAT_COUNT 18
+// Every format that SoundIo::dummy_devices can name.
+#define SOUNDIO_DUMMY_MAX_FORMATS 22
+#define SOUNDIO_DUMMY_MAX_RATE_RANGES 16
+#define SOUNDIO_DUMMY_MAX_DEVICE_COUNT 4096
+
+// One item of SoundIo::dummy_devices.
+struct SoundIoDummyDeviceSpec {
+    enum SoundIoDeviceAim aim;
+    int count;
+    int channel_count_min;
+    int channel_count_max;
+    int format_count;
+    enum SoundIoFormat formats[SOUNDIO_DUMMY_MAX_FORMATS];
+    int sample_rate_count;
+    struct SoundIoSampleRateRange sample_rates[SOUNDIO_DUMMY_MAX_RATE_RANGES];
+    // 0 and negative respectively until given.
+    int sample_rate_current;
+    double software_latency_min;
+    double software_latency_max;
+    double software_latency_current;
+};
+
+// A started stream, as the timer thread sees it.
+struct SoundIoDummyTimer {
+    // When `run` is due, in wall clock or virtual time.
+    double deadline;
+    // Where in the heap, or -1 while not scheduled.
+    int heap_index;
+    bool started;
+    bool stopped;
+    // Asked to run again while running.
+    bool wake;
+    // Until then waking does not make it run sooner.
+    double stall_end;
+    // Returns the next deadline, or a negative number to be left alone until
+    // woken. Called without the mutex held.
+    double (*run)(struct SoundIoPrivate *si, struct SoundIoDummyTimer *timer, double now);
+    void *stream;
+};
+
+SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoDummyTimer *, SoundIoListDummyTimerPtr, SOUNDIO_LIST_STATIC)
+
 struct SoundIoDummy {
     struct SoundIoOsMutex *mutex;
     struct SoundIoOsCond *cond;
     bool devices_emitted;
+    // One thread runs every stream, each when the heap says it is next.
+    // Guarded by `mutex`.
+    struct SoundIoOsThread *timer_thread;
+    struct SoundIoOsCond *timer_cond;
+    struct SoundIoOsCond *timer_idle_cond;
+    struct SoundIoListDummyTimerPtr timer_heap;
+    struct SoundIoDummyTimer *timer_current;
+    int timer_count;
+    bool timer_abort;
+    // SoundIo::dummy_freewheel, and the virtual time it makes the streams
+    // run on.
+    bool freewheel;
+    double virtual_now;
+    struct SoundIoDummyFaults faults;
+    double remove_time;
+    bool removal_emitted;
+    // With SoundIo::dummy_loopback, the streams which play into and record
+    // from the loopback. Guarded by `mutex`.
+    struct SoundIoOutStreamPrivate *loopback_source;
+    struct SoundIoInStreamPrivate *loopback_sink;
 };
 
 struct SoundIoDeviceDummy { int make_the_struct_not_empty; };
 
-struct SoundIoOutStreamDummy {
-    struct SoundIoOsThread *thread;
-    struct SoundIoOsCond *cond;
-    struct SoundIoAtomicFlag abort_flag;
+// How far the device of a stream has got. Wall clock time, or with
+// SoundIo::dummy_freewheel virtual time, which jumps straight to the next
+// period instead of waiting for it.
+struct SoundIoDummyClock {
+    bool freewheel;
+    int sample_rate;
     double period_duration;
+    double start_time;
+    // Freewheel only: frames since the start, and how many a period is.
+    long frame;
+    long period_frame_count;
+    // Wall clock only: how late each wakeup is.
+    enum SoundIoDummyJitter jitter;
+    double jitter_seconds;
+    uint32_t rng;
+};
+
+struct SoundIoOutStreamDummy {
+    struct SoundIoDummyTimer timer;
+    struct SoundIoDummyClock clock;
+    // Only touched by the timer thread.
+    bool primed;
+    bool paused;
+    bool forced_xrun;
+    long frames_consumed;
     int buffer_frame_count;
     int frames_left;
     int write_frame_count;
     struct SoundIoRingBuffer ring_buffer;
-    double playback_start_time;
     struct SoundIoAtomicFlag clear_buffer_flag;
     struct SoundIoAtomicBool pause_requested;
     struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+    // With SoundIo::dummy_loopback: what has been played, as interleaved
+    // float, until it is old enough to be recorded.
+    bool loopback;
+    int loopback_delay_frame_count;
+    struct SoundIoRingBuffer loopback_delay;
+    // Frames played since the start, which faults are scheduled by, and the
+    // next fault which has not happened yet.
+    long device_frame;
+    int fault_index;
 };
 
 struct SoundIoInStreamDummy {
-    struct SoundIoOsThread *thread;
-    struct SoundIoOsCond *cond;
-    struct SoundIoAtomicFlag abort_flag;
-    double period_duration;
+    struct SoundIoDummyTimer timer;
+    struct SoundIoDummyClock clock;
+    bool primed;
+    bool paused;
+    bool forced_xrun;
+    long frames_consumed;
     int frames_left;
     int read_frame_count;
     int buffer_frame_count;
     struct SoundIoRingBuffer ring_buffer;
     struct SoundIoAtomicBool pause_requested;
     struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+    bool loopback;
+    struct SoundIoAtomicBool loopback_overflow;
+    long device_frame;
+    int fault_index;
 };
 
 #endif
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "meter.h"
+#include "convert.h"
+#include "util.h"
+
+#include <math.h>
+#include <string.h>
+
+// The kernels keep this many sums side by side. Sample i of a run goes to
+// lane i % METER_LANES, so interleaved frames of a channel count which
+// divides it land on the same lanes every frame.
+#define METER_LANES 8
+// Frames other formats and layouts are converted through float in.
+#define METER_CHUNK_SIZE 256
+
+struct MeterLanes {
+    float peak[METER_LANES];
+    float sum_squares[METER_LANES];
+    int32_t clip_count[METER_LANES];
+};
+
+typedef void (*MeterRun)(const float *samples, size_t count, float clip_level, struct MeterLanes *lanes);
+
+static void meter_run_scalar(const float *samples, size_t count, float clip_level, struct MeterLanes *lanes) {
+    for (size_t i = 0; i < count; i += 1) {
+        int lane = (int)(i % METER_LANES);
+        float x = samples[i];
+        float magnitude = fabsf(x);
+        if (magnitude > lanes->peak[lane])
+            lanes->peak[lane] = magnitude;
+        lanes->sum_squares[lane] += x * x;
+        if (magnitude >= clip_level)
+            lanes->clip_count[lane] += 1;
+    }
+}
+
+#if defined(SOUNDIO_SIMD_X86)
+
+SOUNDIO_TARGET_SSE2
+static void meter_run_sse2(const float *samples, size_t count, float clip_level, struct MeterLanes *lanes) {
+    __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 clip = _mm_set1_ps(clip_level);
+    __m128 peak0 = _mm_loadu_ps(lanes->peak);
+    __m128 peak1 = _mm_loadu_ps(lanes->peak + 4);
+    __m128 sum0 = _mm_loadu_ps(lanes->sum_squares);
+    __m128 sum1 = _mm_loadu_ps(lanes->sum_squares + 4);
+    __m128i clips0 = _mm_loadu_si128((const __m128i *)lanes->clip_count);
+    __m128i clips1 = _mm_loadu_si128((const __m128i *)(lanes->clip_count + 4));
+    size_t i = 0;
+    for (; i + METER_LANES <= count; i += METER_LANES) {
+        __m128 x0 = _mm_loadu_ps(samples + i);
+        __m128 x1 = _mm_loadu_ps(samples + i + 4);
+        __m128 m0 = _mm_and_ps(x0, abs_mask);
+        __m128 m1 = _mm_and_ps(x1, abs_mask);
+        // With the new value first, NaN leaves the peak alone.
+        peak0 = _mm_max_ps(m0, peak0);
+        peak1 = _mm_max_ps(m1, peak1);
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(x0, x0));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(x1, x1));
+        // A true comparison is -1.
+        clips0 = _mm_sub_epi32(clips0, _mm_castps_si128(_mm_cmpge_ps(m0, clip)));
+        clips1 = _mm_sub_epi32(clips1, _mm_castps_si128(_mm_cmpge_ps(m1, clip)));
+    }
+    _mm_storeu_ps(lanes->peak, peak0);
+    _mm_storeu_ps(lanes->peak + 4, peak1);
+    _mm_storeu_ps(lanes->sum_squares, sum0);
+    _mm_storeu_ps(lanes->sum_squares + 4, sum1);
+    _mm_storeu_si128((__m128i *)lanes->clip_count, clips0);
+    _mm_storeu_si128((__m128i *)(lanes->clip_count + 4), clips1);
+    meter_run_scalar(samples + i, count - i, clip_level, lanes);
+}
+
+SOUNDIO_TARGET_AVX2
+static void meter_run_avx2(const float *samples, size_t count, float clip_level, struct MeterLanes *lanes) {
+    __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 clip = _mm256_set1_ps(clip_level);
+    __m256 peak = _mm256_loadu_ps(lanes->peak);
+    __m256 sum = _mm256_loadu_ps(lanes->sum_squares);
+    // A second sum, so that the additions of two vectors overlap.
+    __m256 sum_odd = _mm256_setzero_ps();
+    __m256i clips = _mm256_loadu_si256((const __m256i *)lanes->clip_count);
+    size_t i = 0;
+    for (; i + 2 * METER_LANES <= count; i += 2 * METER_LANES) {
+        __m256 x0 = _mm256_loadu_ps(samples + i);
+        __m256 x1 = _mm256_loadu_ps(samples + i + METER_LANES);
+        __m256 m0 = _mm256_and_ps(x0, abs_mask);
+        __m256 m1 = _mm256_and_ps(x1, abs_mask);
+        peak = _mm256_max_ps(m0, peak);
+        peak = _mm256_max_ps(m1, peak);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(x0, x0));
+        sum_odd = _mm256_add_ps(sum_odd, _mm256_mul_ps(x1, x1));
+        clips = _mm256_sub_epi32(clips, _mm256_castps_si256(_mm256_cmp_ps(m0, clip, _CMP_GE_OQ)));
+        clips = _mm256_sub_epi32(clips, _mm256_castps_si256(_mm256_cmp_ps(m1, clip, _CMP_GE_OQ)));
+    }
+    _mm256_storeu_ps(lanes->peak, peak);
+    _mm256_storeu_ps(lanes->sum_squares, _mm256_add_ps(sum, sum_odd));
+    _mm256_storeu_si256((__m256i *)lanes->clip_count, clips);
+    _mm256_zeroupper();
+    meter_run_scalar(samples + i, count - i, clip_level, lanes);
+}
+
+#endif
+
+// Indexed by SoundIoSimdLevel.
+static const MeterRun meter_runs[] = {
+    meter_run_scalar,
+#if defined(SOUNDIO_SIMD_X86)
+    meter_run_sse2,
+    meter_run_avx2,
+#endif
+};
+
+static inline int float_bits(float x) {
+    int bits;
+    memcpy(&bits, &x, sizeof(float));
+    return bits;
+}
+
+static inline float bits_float(int bits) {
+    float x;
+    memcpy(&x, &bits, sizeof(float));
+    return x;
+}
+
+void soundio_meter_init(struct SoundIoMeter *meter, enum SoundIoFormat format, int channel_count,
+        int window_frame_count)
+{
+    // The published side starts out zeroed with the rest of the stream.
+    meter->format = format;
+    meter->channel_count = channel_count;
+    meter->window_frame_count = soundio_int_max(window_frame_count, 1);
+    // The largest integer is a hair below 1.0.
+    struct SoundIoSampleFormat fmt;
+    meter->clip_level = 1.0f;
+    if (soundio_get_sample_format(format, &fmt) && !fmt.is_float)
+        meter->clip_level = (float)((fmt.scale - 1.0) / fmt.scale);
+    meter->frame_count = 0;
+    for (int ch = 0; ch < SOUNDIO_MAX_CHANNELS; ch += 1) {
+        meter->peak[ch] = 0.0f;
+        meter->sum_squares[ch] = 0.0;
+        meter->clip_count[ch] = 0;
+    }
+}
+
+// Lane l of `lanes` is channel `first + l % stride`.
+static void add_lanes(struct SoundIoMeter *meter, const struct MeterLanes *lanes, int first, int stride) {
+    for (int lane = 0; lane < METER_LANES; lane += 1) {
+        int ch = first + lane % stride;
+        if (lanes->peak[lane] > meter->peak[ch])
+            meter->peak[ch] = lanes->peak[lane];
+        meter->sum_squares[ch] += lanes->sum_squares[lane];
+        meter->clip_count[ch] += lanes->clip_count[lane];
+    }
+}
+
+static void measure(struct SoundIoMeter *meter, const struct SoundIoChannelArea *areas, int frame_count) {
+    MeterRun run = meter_runs[soundio_convert_get_simd_level()];
+    int channel_count = meter->channel_count;
+    struct MeterLanes lanes;
+    bool is_float32 = (meter->format == SoundIoFormatFloat32NE);
+
+    if (is_float32 && METER_LANES % channel_count == 0 &&
+        soundio_channel_areas_interleaved(areas, channel_count, sizeof(float)))
+    {
+        memset(&lanes, 0, sizeof(struct MeterLanes));
+        run((const float *)areas[0].ptr, (size_t)frame_count * channel_count, meter->clip_level, &lanes);
+        add_lanes(meter, &lanes, 0, channel_count);
+        return;
+    }
+
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        memset(&lanes, 0, sizeof(struct MeterLanes));
+        if (is_float32 && areas[ch].step == (int)sizeof(float)) {
+            run((const float *)areas[ch].ptr, frame_count, meter->clip_level, &lanes);
+        } else {
+            float chunk[METER_CHUNK_SIZE];
+            struct SoundIoChannelArea chunk_area = {(char *)chunk, sizeof(float)};
+            struct SoundIoChannelArea area = areas[ch];
+            for (int start = 0; start < frame_count; start += METER_CHUNK_SIZE) {
+                int count = soundio_int_min(frame_count - start, METER_CHUNK_SIZE);
+                soundio_convert_samples(SoundIoFormatFloat32NE, &chunk_area, meter->format, &area, 1, count);
+                run(chunk, count, meter->clip_level, &lanes);
+                area.ptr += count * area.step;
+            }
+        }
+        add_lanes(meter, &lanes, ch, 1);
+    }
+}
+
+static void publish(struct SoundIoMeter *meter) {
+    unsigned long sequence = SOUNDIO_ATOMIC_LOAD_RELAXED(meter->sequence);
+    SOUNDIO_ATOMIC_STORE_RELAXED(meter->sequence, sequence + 1);
+    SOUNDIO_ATOMIC_FENCE_RELEASE();
+    for (int ch = 0; ch < meter->channel_count; ch += 1) {
+        float rms = (float)sqrt(meter->sum_squares[ch] / meter->frame_count);
+        SOUNDIO_ATOMIC_STORE_RELAXED(meter->published_peak[ch], float_bits(meter->peak[ch]));
+        SOUNDIO_ATOMIC_STORE_RELAXED(meter->published_rms[ch], float_bits(rms));
+        SOUNDIO_ATOMIC_STORE_RELAXED(meter->published_clip_count[ch], meter->clip_count[ch]);
+        meter->peak[ch] = 0.0f;
+        meter->sum_squares[ch] = 0.0;
+    }
+    SOUNDIO_ATOMIC_STORE_RELEASE(meter->sequence, sequence + 2);
+    meter->frame_count = 0;
+}
+
+void soundio_meter_run(struct SoundIoMeter *meter, const struct SoundIoChannelArea *areas,
+        int frame_count)
+{
+    struct SoundIoChannelArea rest[SOUNDIO_MAX_CHANNELS];
+    if (areas)
+        memcpy(rest, areas, sizeof(struct SoundIoChannelArea) * meter->channel_count);
+    while (frame_count > 0) {
+        int count = soundio_int_min(frame_count, meter->window_frame_count - meter->frame_count);
+        if (areas) {
+            measure(meter, rest, count);
+            for (int ch = 0; ch < meter->channel_count; ch += 1)
+                rest[ch].ptr += count * rest[ch].step;
+        }
+        meter->frame_count += count;
+        if (meter->frame_count == meter->window_frame_count)
+            publish(meter);
+        frame_count -= count;
+    }
+}
+
+void soundio_meter_read(struct SoundIoMeter *meter, struct SoundIoMeters *out) {
+    for (;;) {
+        unsigned long sequence = SOUNDIO_ATOMIC_LOAD_ACQUIRE(meter->sequence);
+        // The callback is in the middle of publishing, which is quick.
+        if (sequence & 1)
+            continue;
+        out->window_count = (long)(sequence / 2);
+        out->channel_count = meter->channel_count;
+        for (int ch = 0; ch < meter->channel_count; ch += 1) {
+            out->peak[ch] = bits_float(SOUNDIO_ATOMIC_LOAD_RELAXED(meter->published_peak[ch]));
+            out->rms[ch] = bits_float(SOUNDIO_ATOMIC_LOAD_RELAXED(meter->published_rms[ch]));
+            out->clip_count[ch] = SOUNDIO_ATOMIC_LOAD_RELAXED(meter->published_clip_count[ch]);
+        }
+        SOUNDIO_ATOMIC_FENCE_ACQUIRE();
+        if (SOUNDIO_ATOMIC_LOAD_RELAXED(meter->sequence) == sequence)
+            return;
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_METER_H
+#define SOUNDIO_METER_H
+
+#include "soundio_internal.h"
+#include "atomics.h"
+
+// Peak, RMS and clips of each channel of a stream, measured by its callback
+// a window at a time. Each finished window is published with a sequence
+// lock, so that any thread can read the latest one while the callback never
+// waits.
+struct SoundIoMeter {
+    enum SoundIoFormat format;
+    int channel_count;
+    int window_frame_count;
+    // At or past this magnitude a sample counts as clipped.
+    float clip_level;
+
+    // Callback only: the window so far.
+    int frame_count;
+    float peak[SOUNDIO_MAX_CHANNELS];
+    double sum_squares[SOUNDIO_MAX_CHANNELS];
+    long clip_count[SOUNDIO_MAX_CHANNELS];
+
+    // Odd while the callback is publishing. Every window adds 2.
+    struct SoundIoAtomicULong sequence;
+    // The floats are stored as their bits.
+    struct SoundIoAtomicInt published_peak[SOUNDIO_MAX_CHANNELS];
+    struct SoundIoAtomicInt published_rms[SOUNDIO_MAX_CHANNELS];
+    struct SoundIoAtomicLong published_clip_count[SOUNDIO_MAX_CHANNELS];
+};
+
+void soundio_meter_init(struct SoundIoMeter *meter, enum SoundIoFormat format, int channel_count,
+        int window_frame_count);
+// `areas` of NULL is silence, as for a hole in an input stream.
+void soundio_meter_run(struct SoundIoMeter *meter, const struct SoundIoChannelArea *areas,
+        int frame_count);
+// Safe to call from any thread.
+void soundio_meter_read(struct SoundIoMeter *meter, struct SoundIoMeters *out);
+
+#endif
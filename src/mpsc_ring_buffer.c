@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "mpsc_ring_buffer.h"
+#include "soundio_private.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <limits.h>
+
+struct SoundIoMpscRingBuffer *soundio_mpsc_ring_buffer_create(struct SoundIo *soundio,
+        int slot_size, int requested_slot_count)
+{
+    struct SoundIoMpscRingBuffer *rb = ALLOCATE(struct SoundIoMpscRingBuffer, 1);
+
+    assert(slot_size > 0);
+    assert(requested_slot_count > 0);
+
+    if (!rb) {
+        soundio_mpsc_ring_buffer_destroy(rb);
+        return NULL;
+    }
+
+    int os_flags = (soundio && soundio->lock_memory) ? SoundIoOsMemoryFlagLock : 0;
+    if (soundio_mpsc_ring_buffer_init(rb, slot_size, requested_slot_count, os_flags)) {
+        soundio_mpsc_ring_buffer_destroy(rb);
+        return NULL;
+    }
+
+    return rb;
+}
+
+void soundio_mpsc_ring_buffer_destroy(struct SoundIoMpscRingBuffer *rb) {
+    if (!rb)
+        return;
+
+    soundio_mpsc_ring_buffer_deinit(rb);
+
+    free(rb);
+}
+
+int soundio_mpsc_ring_buffer_slot_size(struct SoundIoMpscRingBuffer *rb) {
+    return rb->slot_size;
+}
+
+int soundio_mpsc_ring_buffer_slot_count(struct SoundIoMpscRingBuffer *rb) {
+    return rb->slot_count;
+}
+
+char *soundio_mpsc_ring_buffer_claim(struct SoundIoMpscRingBuffer *rb) {
+    size_t pos = SOUNDIO_ATOMIC_FETCH_ADD(rb->write_pos, 1);
+    int index = pos % rb->slot_count;
+    // Only waits when the buffer is full, for the consumer to release this
+    // slot from the previous lap.
+    while (SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->sequence[index]) != pos)
+        soundio_os_thread_yield();
+    return rb->mem.address + (size_t)index * rb->slot_size;
+}
+
+void soundio_mpsc_ring_buffer_publish(struct SoundIoMpscRingBuffer *rb, char *slot) {
+    size_t offset = slot - rb->mem.address;
+    assert(offset % rb->slot_size == 0);
+    int index = offset / rb->slot_size;
+    assert(index >= 0 && index < rb->slot_count);
+    // Nobody else touches the marker between claim and publish.
+    size_t pos = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->sequence[index]);
+    SOUNDIO_ATOMIC_STORE_RELEASE(rb->sequence[index], pos + 1);
+}
+
+int soundio_mpsc_ring_buffer_free_count(struct SoundIoMpscRingBuffer *rb) {
+    size_t read_pos = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->read_pos);
+    size_t write_pos = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->write_pos);
+    size_t claimed = write_pos - read_pos;
+    if (claimed >= (size_t)rb->slot_count)
+        return 0;
+    return rb->slot_count - (int)claimed;
+}
+
+int soundio_mpsc_ring_buffer_fill_count(struct SoundIoMpscRingBuffer *rb) {
+    size_t read_pos = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->read_pos);
+    int count = 0;
+    while (count < rb->slot_count) {
+        size_t pos = read_pos + count;
+        if (SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->sequence[pos % rb->slot_count]) != pos + 1)
+            break;
+        count += 1;
+    }
+    return count;
+}
+
+char *soundio_mpsc_ring_buffer_read_ptr(struct SoundIoMpscRingBuffer *rb) {
+    size_t read_pos = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->read_pos);
+    return rb->mem.address + (size_t)(read_pos % rb->slot_count) * rb->slot_size;
+}
+
+void soundio_mpsc_ring_buffer_advance_read_ptr(struct SoundIoMpscRingBuffer *rb, int count) {
+    assert(count >= 0);
+    assert(count <= soundio_mpsc_ring_buffer_fill_count(rb));
+    size_t read_pos = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->read_pos);
+    for (int i = 0; i < count; i += 1) {
+        size_t pos = read_pos + i;
+        SOUNDIO_ATOMIC_STORE_RELEASE(rb->sequence[pos % rb->slot_count], pos + rb->slot_count);
+    }
+    SOUNDIO_ATOMIC_STORE_RELEASE(rb->read_pos, read_pos + count);
+}
+
+static size_t gcd_size_t(size_t a, size_t b) {
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+int soundio_mpsc_ring_buffer_init(struct SoundIoMpscRingBuffer *rb, int slot_size,
+        int requested_slot_count, int os_flags)
+{
+    // The mirrored mapping only lines up with slot boundaries if its size is
+    // a multiple of both the page size and the slot size. At least 2 slots
+    // are needed so that "published" and "released" markers differ.
+    size_t page_size = soundio_os_page_size();
+    size_t granularity = page_size / gcd_size_t(page_size, slot_size) * slot_size;
+    size_t requested_capacity = (size_t)soundio_int_max(requested_slot_count, 2) * slot_size;
+    size_t capacity = (requested_capacity + granularity - 1) / granularity * granularity;
+    if (capacity / slot_size > INT_MAX)
+        return SoundIoErrorNoMem;
+
+    int err;
+    if ((err = soundio_os_init_mirrored_memory_flags(&rb->mem, capacity, os_flags, NULL)))
+        return err;
+    assert(rb->mem.capacity == capacity);
+
+    rb->slot_size = slot_size;
+    rb->slot_count = capacity / slot_size;
+    rb->sequence = ALLOCATE_NONZERO(struct SoundIoAtomicSize, rb->slot_count);
+    if (!rb->sequence) {
+        soundio_mpsc_ring_buffer_deinit(rb);
+        return SoundIoErrorNoMem;
+    }
+    for (int i = 0; i < rb->slot_count; i += 1)
+        SOUNDIO_ATOMIC_STORE(rb->sequence[i], i);
+    SOUNDIO_ATOMIC_STORE(rb->write_pos, 0);
+    SOUNDIO_ATOMIC_STORE(rb->read_pos, 0);
+
+    return 0;
+}
+
+void soundio_mpsc_ring_buffer_deinit(struct SoundIoMpscRingBuffer *rb) {
+    free(rb->sequence);
+    rb->sequence = NULL;
+    soundio_os_deinit_mirrored_memory(&rb->mem);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_MPSC_RING_BUFFER_H
+#define SOUNDIO_MPSC_RING_BUFFER_H
+
+#include "os.h"
+#include "atomics.h"
+
+// Producers claim a position with a fetch-add on write_pos and publish the
+// slot at that position through its entry in sequence. For the slot at index
+// pos % slot_count:
+//   sequence == pos               free, may be filled by the claimer of pos
+//   sequence == pos + 1           published, may be read by the consumer
+//   sequence == pos + slot_count  released by the consumer for the next lap
+// The consumer only ever loads markers, so it never waits on a producer.
+// Positions only ever grow, and pos % slot_count only stays continuous across
+// a wrap if slot_count is a power of two, which it need not be. With 64-bit
+// size_t that takes longer than any stream runs.
+struct SoundIoMpscRingBuffer {
+    struct SoundIoOsMirroredMemory mem;
+    int slot_size;
+    int slot_count;
+    struct SoundIoAtomicSize *sequence;
+
+    // Producers
+    char pad0[SOUNDIO_CACHE_LINE_SIZE];
+    struct SoundIoAtomicSize write_pos;
+
+    // Consumer. Atomic only so that producers can read it for free_count.
+    char pad1[SOUNDIO_CACHE_LINE_SIZE];
+    struct SoundIoAtomicSize read_pos;
+
+    char pad2[SOUNDIO_CACHE_LINE_SIZE];
+};
+
+// os_flags is a bitmask of SoundIoOsMemoryFlag
+int soundio_mpsc_ring_buffer_init(struct SoundIoMpscRingBuffer *rb, int slot_size,
+        int requested_slot_count, int os_flags);
+void soundio_mpsc_ring_buffer_deinit(struct SoundIoMpscRingBuffer *rb);
+
+#endif
@@ -15,12 +15,15 @@
 #include "os.h"
 #include "soundio_internal.h"
 #include "util.h"
+#include "atomics.h"
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <time.h>
 #include <assert.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
 
 #if defined(_WIN32)
 #define SOUNDIO_OS_WINDOWS
@@ -58,6 +61,7 @@
 #else
 
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
@@ -66,6 +70,43 @@
 
 #endif
 
+#if defined(__linux__)
+#define SOUNDIO_OS_EVENTFD
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#if defined(SYS_memfd_create)
+#define SOUNDIO_OS_MEMFD
+// These are missing from older libc headers even when the kernel supports them.
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB 0x0004U
+#endif
+#ifndef MFD_HUGE_2MB
+#define MFD_HUGE_2MB (21U << 26)
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#endif
+#ifndef F_SEAL_SEAL
+#define F_SEAL_SEAL 0x0001
+#endif
+#ifndef F_SEAL_SHRINK
+#define F_SEAL_SHRINK 0x0002
+#endif
+#ifndef F_SEAL_GROW
+#define F_SEAL_GROW 0x0004
+#endif
+#endif
+#endif
+
 #if defined(__FreeBSD__) || defined(__MACH__)
 #define SOUNDIO_OS_KQUEUE
 #include <sys/types.h>
@@ -91,6 +132,15 @@ struct SoundIoOsThread {
 #endif
     void *arg;
     void (*run)(void *arg);
+    bool lock_memory;
+
+#if defined(__linux__)
+    // Written by the thread itself before setting fault_baseline_ready.
+    pid_t tid;
+    long base_minor_faults;
+    long base_major_faults;
+    struct SoundIoAtomicBool fault_baseline_ready;
+#endif
 };
 
 struct SoundIoOsMutex {
@@ -125,6 +175,18 @@ struct SoundIoOsCond {
 };
 #endif
 
+// An auto-reset event. With eventfd the signaled state is the counter of the
+// fd, otherwise a flag guarded by mutex.
+struct SoundIoOsEvent {
+#if defined(SOUNDIO_OS_EVENTFD)
+    int fd;
+#else
+    struct SoundIoOsMutex *mutex;
+    struct SoundIoOsCond *cond;
+    bool signaled;
+#endif
+};
+
 #if defined(SOUNDIO_OS_WINDOWS)
 static INIT_ONCE win32_init_once = INIT_ONCE_STATIC_INIT;
 static double win32_time_resolution;
@@ -138,6 +200,9 @@ static clock_serv_t cclock;
 #endif
 
 static int page_size;
+// The stride for touching every page of a region. Not page_size because on
+// Windows that is the allocation granularity, which spans many pages.
+static const size_t min_page_size = 4096;
 
 double soundio_os_get_time(void) {
 #if defined(SOUNDIO_OS_WINDOWS)
@@ -163,11 +228,48 @@ double soundio_os_get_time(void) {
 #endif
 }
 
+// How much of the top of the stack a thread created with lock_memory touches
+// before calling run.
+#define PREFAULT_STACK_SIZE (128 * 1024)
+// Such threads get at least this much stack, so that there is room for run
+// beyond what was touched. The default thread stack is 128 KiB on musl, and
+// 1 MiB or more elsewhere.
+#define LOCKED_THREAD_STACK_SIZE (512 * 1024)
+
+// Must not be inlined: the array has to be popped again before run is called
+// so that run's frames land on the pages touched here.
+static SOUNDIO_ATTR_NOINLINE void prefault_stack(void) {
+    volatile char stack[PREFAULT_STACK_SIZE];
+    for (size_t i = 0; i < PREFAULT_STACK_SIZE; i += min_page_size)
+        stack[i] = 0;
+    // Best effort. The touched pages are at least resident now.
+#if defined(SOUNDIO_OS_WINDOWS)
+    VirtualLock((LPVOID)stack, PREFAULT_STACK_SIZE);
+#else
+    mlock((const void *)stack, PREFAULT_STACK_SIZE);
+#endif
+}
+
+static void thread_enter(struct SoundIoOsThread *thread) {
+    if (thread->lock_memory)
+        prefault_stack();
+#if defined(__linux__)
+    struct rusage usage;
+    thread->tid = syscall(SYS_gettid);
+    if (!getrusage(RUSAGE_THREAD, &usage)) {
+        thread->base_minor_faults = usage.ru_minflt;
+        thread->base_major_faults = usage.ru_majflt;
+        SOUNDIO_ATOMIC_STORE_RELEASE(thread->fault_baseline_ready, true);
+    }
+#endif
+}
+
 #if defined(SOUNDIO_OS_WINDOWS)
 static DWORD WINAPI run_win32_thread(LPVOID userdata) {
     struct SoundIoOsThread *thread = (struct SoundIoOsThread *)userdata;
     HRESULT err = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
     assert(err == S_OK);
+    thread_enter(thread);
     thread->run(thread->arg);
     CoUninitialize();
     return 0;
@@ -179,6 +281,7 @@ static void assert_no_err(int err) {
 
 static void *run_pthread(void *userdata) {
     struct SoundIoOsThread *thread = (struct SoundIoOsThread *)userdata;
+    thread_enter(thread);
     thread->run(thread->arg);
     return NULL;
 }
@@ -187,6 +290,7 @@ static void *run_pthread(void *userdata) {
 int soundio_os_thread_create(
         void (*run)(void *arg), void *arg,
         void (*emit_rtprio_warning)(void),
+        bool lock_memory,
         struct SoundIoOsThread ** out_thread)
 {
     *out_thread = NULL;
@@ -199,6 +303,10 @@ int soundio_os_thread_create(
 
     thread->run = run;
     thread->arg = arg;
+    thread->lock_memory = lock_memory;
+#if defined(__linux__)
+    SOUNDIO_ATOMIC_STORE(thread->fault_baseline_ready, false);
+#endif
 
 #if defined(SOUNDIO_OS_WINDOWS)
     thread->handle = CreateThread(NULL, 0, run_win32_thread, thread, 0, &thread->id);
@@ -218,7 +326,19 @@ int soundio_os_thread_create(
         return SoundIoErrorNoMem;
     }
     thread->attr_init = true;
-    
+
+    if (lock_memory) {
+        size_t stack_size;
+        if ((err = pthread_attr_getstacksize(&thread->attr, &stack_size)))
+            stack_size = 0;
+        if (stack_size < LOCKED_THREAD_STACK_SIZE &&
+            (err = pthread_attr_setstacksize(&thread->attr, LOCKED_THREAD_STACK_SIZE)))
+        {
+            soundio_os_thread_destroy(thread);
+            return SoundIoErrorSystemResources;
+        }
+    }
+
     if (emit_rtprio_warning) {
         int max_priority = sched_get_priority_max(SCHED_FIFO);
         if (max_priority == -1) {
@@ -243,7 +363,14 @@ int soundio_os_thread_create(
     if ((err = pthread_create(&thread->id, &thread->attr, run_pthread, thread))) {
         if (err == EPERM && emit_rtprio_warning) {
             emit_rtprio_warning();
-            err = pthread_create(&thread->id, NULL, run_pthread, thread);
+            // Without the real time priority, but keeping the stack size.
+            struct sched_param param;
+            param.sched_priority = 0;
+            if (!pthread_attr_setschedpolicy(&thread->attr, SCHED_OTHER) &&
+                !pthread_attr_setschedparam(&thread->attr, &param))
+            {
+                err = pthread_create(&thread->id, &thread->attr, run_pthread, thread);
+            }
         }
         if (err) {
             soundio_os_thread_destroy(thread);
@@ -282,6 +409,52 @@ void soundio_os_thread_destroy(struct SoundIoOsThread *thread) {
     free(thread);
 }
 
+int soundio_os_thread_page_faults(struct SoundIoOsThread *thread,
+        long *out_minor_faults, long *out_major_faults)
+{
+    *out_minor_faults = 0;
+    *out_major_faults = 0;
+#if defined(__linux__)
+    if (!thread || !SOUNDIO_ATOMIC_LOAD_ACQUIRE(thread->fault_baseline_ready))
+        return 0;
+
+    // getrusage can only report on the calling thread, but the same counters
+    // are readable by any thread from procfs.
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int)thread->tid);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return SoundIoErrorSystemResources;
+    char buf[512];
+    size_t amt = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[amt] = 0;
+
+    // The thread name is in parentheses and may itself contain spaces or
+    // parentheses, so start after the last closing one.
+    char *fields = strrchr(buf, ')');
+    unsigned long minor_faults, major_faults;
+    if (!fields || sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %lu %*u %lu",
+                &minor_faults, &major_faults) != 2)
+    {
+        return SoundIoErrorSystemResources;
+    }
+    *out_minor_faults = (long)minor_faults - thread->base_minor_faults;
+    *out_major_faults = (long)major_faults - thread->base_major_faults;
+    return 0;
+#else
+    return thread ? SoundIoErrorIncompatibleBackend : 0;
+#endif
+}
+
+void soundio_os_thread_yield(void) {
+#if defined(SOUNDIO_OS_WINDOWS)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
 struct SoundIoOsMutex *soundio_os_mutex_create(void) {
     struct SoundIoOsMutex *mutex = ALLOCATE(struct SoundIoOsMutex, 1);
     if (!mutex) {
@@ -554,6 +727,95 @@ void soundio_os_cond_wait(struct SoundIoOsCond *cond,
 #endif
 }
 
+struct SoundIoOsEvent *soundio_os_event_create(void) {
+    struct SoundIoOsEvent *event = ALLOCATE(struct SoundIoOsEvent, 1);
+    if (!event)
+        return NULL;
+#if defined(SOUNDIO_OS_EVENTFD)
+    event->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event->fd < 0) {
+        free(event);
+        return NULL;
+    }
+#else
+    event->mutex = soundio_os_mutex_create();
+    event->cond = soundio_os_cond_create();
+    if (!event->mutex || !event->cond) {
+        soundio_os_event_destroy(event);
+        return NULL;
+    }
+#endif
+    return event;
+}
+
+void soundio_os_event_destroy(struct SoundIoOsEvent *event) {
+    if (!event)
+        return;
+#if defined(SOUNDIO_OS_EVENTFD)
+    close(event->fd);
+#else
+    soundio_os_cond_destroy(event->cond);
+    soundio_os_mutex_destroy(event->mutex);
+#endif
+    free(event);
+}
+
+void soundio_os_event_signal(struct SoundIoOsEvent *event) {
+#if defined(SOUNDIO_OS_EVENTFD)
+    uint64_t one = 1;
+    // Only fails if the counter would overflow, in which case it is signaled
+    // already.
+    ssize_t amt = write(event->fd, &one, sizeof(one));
+    (void)amt;
+#else
+    soundio_os_mutex_lock(event->mutex);
+    event->signaled = true;
+    soundio_os_cond_signal(event->cond, event->mutex);
+    soundio_os_mutex_unlock(event->mutex);
+#endif
+}
+
+void soundio_os_event_reset(struct SoundIoOsEvent *event) {
+#if defined(SOUNDIO_OS_EVENTFD)
+    uint64_t value;
+    ssize_t amt = read(event->fd, &value, sizeof(value));
+    (void)amt;
+#else
+    soundio_os_mutex_lock(event->mutex);
+    event->signaled = false;
+    soundio_os_mutex_unlock(event->mutex);
+#endif
+}
+
+void soundio_os_event_timed_wait(struct SoundIoOsEvent *event, double seconds) {
+#if defined(SOUNDIO_OS_EVENTFD)
+    struct pollfd pfd;
+    pfd.fd = event->fd;
+    pfd.events = POLLIN;
+    int timeout_ms = (seconds < 0.0) ? -1 : (int)ceil_dbl(seconds * 1000.0);
+    poll(&pfd, 1, timeout_ms);
+    soundio_os_event_reset(event);
+#else
+    soundio_os_mutex_lock(event->mutex);
+    if (!event->signaled) {
+        if (seconds < 0.0)
+            soundio_os_cond_wait(event->cond, event->mutex);
+        else
+            soundio_os_cond_timed_wait(event->cond, event->mutex, seconds);
+    }
+    event->signaled = false;
+    soundio_os_mutex_unlock(event->mutex);
+#endif
+}
+
+int soundio_os_event_fd(struct SoundIoOsEvent *event) {
+#if defined(SOUNDIO_OS_EVENTFD)
+    return event->fd;
+#else
+    return -1;
+#endif
+}
+
 static int internal_init(void) {
 #if defined(SOUNDIO_OS_WINDOWS)
     unsigned __int64 frequency;
@@ -609,17 +871,164 @@ int soundio_os_page_size(void) {
     return page_size;
 }
 
-static inline size_t ceil_dbl_to_size_t(double x) {
-    const double truncation = (size_t)x;
-    return truncation + (truncation < x);
+// Integer arithmetic, because a double cannot represent every size_t exactly.
+// The caller makes sure that the result does not overflow.
+static inline size_t round_up_size_t(size_t x, size_t multiple) {
+    return (x + multiple - 1) / multiple * multiple;
+}
+
+#if !defined(SOUNDIO_OS_WINDOWS)
+// Opens a file of `size` bytes which is not reachable through the file
+// system. On Linux this is a sealed memfd, which needs no writable tmpfs.
+// Elsewhere, or if memfd_create is not available, fall back to creating and
+// unlinking a file in /dev/shm or /tmp.
+static int open_mirror_fd(size_t size, int *out_fd) {
+    int fd;
+#if defined(SOUNDIO_OS_MEMFD)
+    fd = syscall(SYS_memfd_create, "soundio", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd >= 0) {
+        if (ftruncate(fd, size)) {
+            close(fd);
+            return SoundIoErrorSystemResources;
+        }
+        // The size of the file must never change while it is mapped.
+        // Sealing is not essential, so a failure here is not an error.
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+        *out_fd = fd;
+        return 0;
+    }
+#endif
+
+    char shm_path[] = "/dev/shm/soundio-XXXXXX";
+    char tmp_path[] = "/tmp/soundio-XXXXXX";
+    char *chosen_path;
+
+    fd = mkstemp(shm_path);
+    if (fd < 0) {
+        fd = mkstemp(tmp_path);
+        if (fd < 0) {
+            return SoundIoErrorSystemResources;
+        } else {
+            chosen_path = tmp_path;
+        }
+    } else {
+        chosen_path = shm_path;
+    }
+
+    if (unlink(chosen_path)) {
+        close(fd);
+        return SoundIoErrorSystemResources;
+    }
+
+    if (ftruncate(fd, size)) {
+        close(fd);
+        return SoundIoErrorSystemResources;
+    }
+
+    *out_fd = fd;
+    return 0;
+}
+#endif
+
+#if defined(SOUNDIO_OS_MEMFD)
+static const size_t huge_page_size = 2 * 1024 * 1024;
+
+// Like the normal path but with 2 MiB pages from hugetlbfs. Fails if the
+// system has no huge pages to spare, in which case the caller falls back to
+// normal pages.
+static int init_huge_mirrored_memory(struct SoundIoOsMirroredMemory *mem, size_t requested_capacity) {
+    size_t actual_capacity = round_up_size_t(requested_capacity, huge_page_size);
+
+    int fd = syscall(SYS_memfd_create, "soundio", MFD_CLOEXEC | MFD_HUGETLB | MFD_HUGE_2MB);
+    if (fd < 0)
+        return SoundIoErrorSystemResources;
+
+    if (ftruncate(fd, actual_capacity)) {
+        close(fd);
+        return SoundIoErrorSystemResources;
+    }
+
+    // Huge page mappings must start on a huge page boundary, so reserve
+    // enough extra address space to align the start and trim the rest.
+    size_t reserve_size = actual_capacity * 2 + huge_page_size;
+    char *reserved = (char*)mmap(NULL, reserve_size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (reserved == MAP_FAILED) {
+        close(fd);
+        return SoundIoErrorNoMem;
+    }
+    char *address = (char*)(((uintptr_t)reserved + huge_page_size - 1) & ~(uintptr_t)(huge_page_size - 1));
+    size_t head_size = address - reserved;
+    size_t tail_size = reserve_size - head_size - actual_capacity * 2;
+    if (head_size)
+        munmap(reserved, head_size);
+    if (tail_size)
+        munmap(address + actual_capacity * 2, tail_size);
+
+    char *other_address = (char*)mmap(address, actual_capacity, PROT_READ|PROT_WRITE,
+            MAP_FIXED|MAP_SHARED, fd, 0);
+    if (other_address != address) {
+        munmap(address, 2 * actual_capacity);
+        close(fd);
+        return SoundIoErrorNoMem;
+    }
+
+    other_address = (char*)mmap(address + actual_capacity, actual_capacity,
+            PROT_READ|PROT_WRITE, MAP_FIXED|MAP_SHARED, fd, 0);
+    if (other_address != address + actual_capacity) {
+        munmap(address, 2 * actual_capacity);
+        close(fd);
+        return SoundIoErrorNoMem;
+    }
+
+    close(fd);
+    mem->address = address;
+    mem->capacity = actual_capacity;
+    return 0;
 }
+#endif
 
 int soundio_os_init_mirrored_memory(struct SoundIoOsMirroredMemory *mem, size_t requested_capacity) {
-    size_t actual_capacity = ceil_dbl_to_size_t(requested_capacity / (double)page_size) * page_size;
+    return soundio_os_init_mirrored_memory_flags(mem, requested_capacity, 0, NULL);
+}
+
+static void lock_mirrored_memory(struct SoundIoOsMirroredMemory *mem) {
+    // Both views share the same pages, so touching the first view faults in
+    // everything. The second view still needs its page table entries, which
+    // reading one byte per page provides without dirtying anything.
+    volatile char *address = mem->address;
+    for (size_t i = 0; i < mem->capacity; i += min_page_size) {
+        address[i] = 0;
+        (void)address[mem->capacity + i];
+    }
+#if defined(SOUNDIO_OS_WINDOWS)
+    VirtualLock(mem->address, 2 * mem->capacity);
+#else
+    mlock(mem->address, 2 * mem->capacity);
+#endif
+}
+
+static int init_mirrored_memory(struct SoundIoOsMirroredMemory *mem,
+        size_t requested_capacity, int flags, size_t *out_page_size)
+{
+    *out_page_size = page_size;
+
+    // Leaves room to round the capacity up to a page and then double it.
+    if (requested_capacity > SIZE_MAX / 4)
+        return SoundIoErrorNoMem;
+
+#if defined(SOUNDIO_OS_MEMFD)
+    if ((flags & SoundIoOsMemoryFlagHugePages) && !init_huge_mirrored_memory(mem, requested_capacity)) {
+        *out_page_size = huge_page_size;
+        return 0;
+    }
+#endif
+
+    size_t actual_capacity = round_up_size_t(requested_capacity, page_size);
 
 #if defined(SOUNDIO_OS_WINDOWS)
     BOOL ok;
-    HANDLE hMapFile = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, actual_capacity * 2, NULL);
+    HANDLE hMapFile = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+            (DWORD)((uint64_t)actual_capacity * 2 >> 32), (DWORD)(actual_capacity * 2), NULL);
     if (!hMapFile)
         return SoundIoErrorNoMem;
 
@@ -670,47 +1079,21 @@ int soundio_os_init_mirrored_memory(struct SoundIoOsMirroredMemory *mem, size_t
         break;
     }
 #else
-    char shm_path[] = "/dev/shm/soundio-XXXXXX";
-    char tmp_path[] = "/tmp/soundio-XXXXXX";
-    char *chosen_path;
-
-    int fd = mkstemp(shm_path);
-    if (fd < 0) {
-        fd = mkstemp(tmp_path);
-        if (fd < 0) {
-            return SoundIoErrorSystemResources;
-        } else {
-            chosen_path = tmp_path;
-        }
-    } else {
-        chosen_path = shm_path;
-    }
-
-    if (unlink(chosen_path)) {
-        close(fd);
-        return SoundIoErrorSystemResources;
-    }
-
-    if (ftruncate(fd, actual_capacity)) {
-        close(fd);
-        return SoundIoErrorSystemResources;
-    }
+    int fd;
+    int err;
+    if ((err = open_mirror_fd(actual_capacity, &fd)))
+        return err;
 
-    char *address = (char*)mmap(NULL, actual_capacity * 2, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    // Mapping the whole range to the file reserves the address space in the
+    // same call. The second half lies past the end of the file until it is
+    // replaced with a second view of the first half.
+    char *address = (char*)mmap(NULL, actual_capacity * 2, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
     if (address == MAP_FAILED) {
         close(fd);
         return SoundIoErrorNoMem;
     }
 
-    char *other_address = (char*)mmap(address, actual_capacity, PROT_READ|PROT_WRITE,
-            MAP_FIXED|MAP_SHARED, fd, 0);
-    if (other_address != address) {
-        munmap(address, 2 * actual_capacity);
-        close(fd);
-        return SoundIoErrorNoMem;
-    }
-
-    other_address = (char*)mmap(address + actual_capacity, actual_capacity,
+    char *other_address = (char*)mmap(address + actual_capacity, actual_capacity,
             PROT_READ|PROT_WRITE, MAP_FIXED|MAP_SHARED, fd, 0);
     if (other_address != address + actual_capacity) {
         munmap(address, 2 * actual_capacity);
@@ -728,6 +1111,20 @@ int soundio_os_init_mirrored_memory(struct SoundIoOsMirroredMemory *mem, size_t
     return 0;
 }
 
+int soundio_os_init_mirrored_memory_flags(struct SoundIoOsMirroredMemory *mem,
+        size_t requested_capacity, int flags, size_t *out_page_size)
+{
+    size_t mem_page_size;
+    int err;
+    if ((err = init_mirrored_memory(mem, requested_capacity, flags, &mem_page_size)))
+        return err;
+    if (flags & SoundIoOsMemoryFlagLock)
+        lock_mirrored_memory(mem);
+    if (out_page_size)
+        *out_page_size = mem_page_size;
+    return 0;
+}
+
 void soundio_os_deinit_mirrored_memory(struct SoundIoOsMirroredMemory *mem) {
     if (!mem->address)
         return;
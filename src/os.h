@@ -19,13 +19,27 @@ int soundio_os_init(void);
 double soundio_os_get_time(void);
 
 struct SoundIoOsThread;
+// If lock_memory is true the thread touches and locks the top of its stack
+// before calling run, so that run does not take page faults on it.
 int soundio_os_thread_create(
         void (*run)(void *arg), void *arg,
         void (*emit_rtprio_warning)(void),
+        bool lock_memory,
         struct SoundIoOsThread ** out_thread);
 
 void soundio_os_thread_destroy(struct SoundIoOsThread *thread);
 
+// Page faults taken by the thread since it entered run. Safe to call from any
+// thread. thread may be NULL, in which case the counts are 0. Returns
+// SoundIoErrorIncompatibleBackend on systems which do not count faults per
+// thread.
+int soundio_os_thread_page_faults(struct SoundIoOsThread *thread,
+        long *out_minor_faults, long *out_major_faults);
+
+// Give up the rest of the calling thread's time slice. For spin loops that
+// are waiting on another thread to make progress.
+void soundio_os_thread_yield(void);
+
 
 struct SoundIoOsMutex;
 struct SoundIoOsMutex *soundio_os_mutex_create(void);
@@ -49,6 +63,21 @@ void soundio_os_cond_timed_wait(struct SoundIoOsCond *cond,
 void soundio_os_cond_wait(struct SoundIoOsCond *cond,
         struct SoundIoOsMutex *locked_mutex);
 
+// An auto-reset event for waking one waiting thread. Signaling before the
+// wait is not lost. Unlike SoundIoOsCond there is no mutex to hold.
+struct SoundIoOsEvent;
+struct SoundIoOsEvent *soundio_os_event_create(void);
+void soundio_os_event_destroy(struct SoundIoOsEvent *event);
+// On Linux this is a single write syscall. Elsewhere it takes a mutex.
+void soundio_os_event_signal(struct SoundIoOsEvent *event);
+void soundio_os_event_reset(struct SoundIoOsEvent *event);
+// Returns when the event is signaled or after seconds, whichever comes first,
+// and resets the event. Negative seconds waits without a timeout. May return
+// early for no reason.
+void soundio_os_event_timed_wait(struct SoundIoOsEvent *event, double seconds);
+// A file descriptor which polls readable while the event is signaled, or -1
+// on systems where events are not backed by one.
+int soundio_os_event_fd(struct SoundIoOsEvent *event);
 
 int soundio_os_page_size(void);
 
@@ -59,9 +88,24 @@ struct SoundIoOsMirroredMemory {
     void *priv;
 };
 
+enum SoundIoOsMemoryFlag {
+    // Use huge pages where the system supports them and has some available.
+    // Otherwise fall back to normal pages.
+    SoundIoOsMemoryFlagHugePages = 1,
+    // Touch every page up front and lock them into RAM so that the first
+    // access from a real-time thread does not fault. Locking is best effort
+    // since it is limited by RLIMIT_MEMLOCK.
+    SoundIoOsMemoryFlagLock = 2,
+};
+
 // returned capacity might be increased from capacity to be a multiple of the
 // system page size
 int soundio_os_init_mirrored_memory(struct SoundIoOsMirroredMemory *mem, size_t capacity);
+// flags is a bitmask of SoundIoOsMemoryFlag. If out_page_size is not NULL it
+// is set to the size of the pages that back the memory, which the returned
+// capacity is a multiple of.
+int soundio_os_init_mirrored_memory_flags(struct SoundIoOsMirroredMemory *mem, size_t capacity,
+        int flags, size_t *out_page_size);
 void soundio_os_deinit_mirrored_memory(struct SoundIoOsMirroredMemory *mem);
 
 #endif
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "remix.h"
+#include "convert.h"
+#include "util.h"
+
+#include <stdlib.h>
+
+// Kernels compute a whole vector of output channels at once, from every
+// input channel in turn, and store it unmasked. The lanes past the last
+// output channel land on the next frame, which is written after, so only
+// the last few frames are left to the scalar kernel.
+#define REMIX_VECTOR_WIDTH 8
+
+typedef void (*RemixRun)(const struct SoundIoRemix *remix, float *dst, const float *src, int frame_count);
+
+static void remix_run_scalar(const struct SoundIoRemix *remix, float *dst, const float *src, int frame_count) {
+    int in_channel_count = remix->in_channel_count;
+    int out_channel_count = remix->out_channel_count;
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        for (int out = 0; out < out_channel_count; out += 1) {
+            float sum = 0.0f;
+            for (int in = 0; in < in_channel_count; in += 1)
+                sum += src[in] * remix->coefs[in * remix->stride + out];
+            dst[out] = sum;
+        }
+        src += in_channel_count;
+        dst += out_channel_count;
+    }
+}
+
+// How many frames at the end the unmasked stores of `width` lanes would
+// write past.
+static int spill_frame_count(const struct SoundIoRemix *remix, int width) {
+    int out_channel_count = remix->out_channel_count;
+    int spill = (out_channel_count + width - 1) / width * width - out_channel_count;
+    return (spill + out_channel_count - 1) / out_channel_count;
+}
+
+#if defined(SOUNDIO_SIMD_X86)
+
+SOUNDIO_TARGET_SSE2
+static void remix_run_sse2(const struct SoundIoRemix *remix, float *dst, const float *src, int frame_count) {
+    int in_channel_count = remix->in_channel_count;
+    int out_channel_count = remix->out_channel_count;
+    int vector_frames = soundio_int_max(frame_count - spill_frame_count(remix, 4), 0);
+    for (int frame = 0; frame < vector_frames; frame += 1) {
+        for (int out = 0; out < out_channel_count; out += 4) {
+            const float *c = remix->coefs + out;
+            __m128 sum = _mm_setzero_ps();
+            for (int in = 0; in < in_channel_count; in += 1)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(src[in]), _mm_loadu_ps(c + in * remix->stride)));
+            _mm_storeu_ps(dst + out, sum);
+        }
+        src += in_channel_count;
+        dst += out_channel_count;
+    }
+    remix_run_scalar(remix, dst, src, frame_count - vector_frames);
+}
+
+SOUNDIO_TARGET_AVX2
+static void remix_run_avx2(const struct SoundIoRemix *remix, float *dst, const float *src, int frame_count) {
+    int in_channel_count = remix->in_channel_count;
+    int out_channel_count = remix->out_channel_count;
+    int vector_frames = soundio_int_max(frame_count - spill_frame_count(remix, 8), 0);
+    for (int frame = 0; frame < vector_frames; frame += 1) {
+        for (int out = 0; out < out_channel_count; out += 8) {
+            const float *c = remix->coefs + out;
+            __m256 sum = _mm256_setzero_ps();
+            for (int in = 0; in < in_channel_count; in += 1) {
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(src[in]),
+                            _mm256_loadu_ps(c + in * remix->stride)));
+            }
+            _mm256_storeu_ps(dst + out, sum);
+        }
+        src += in_channel_count;
+        dst += out_channel_count;
+    }
+    _mm256_zeroupper();
+    remix_run_scalar(remix, dst, src, frame_count - vector_frames);
+}
+
+#endif
+
+// Indexed by SoundIoSimdLevel.
+static const RemixRun remix_runs[] = {
+    remix_run_scalar,
+#if defined(SOUNDIO_SIMD_X86)
+    remix_run_sse2,
+    remix_run_avx2,
+#endif
+};
+
+int soundio_remix_init(struct SoundIoRemix *remix, const struct SoundIoChannelLayout *from,
+        const struct SoundIoChannelLayout *to)
+{
+    remix->coefs = NULL;
+    if (from->channel_count <= 0 || from->channel_count > SOUNDIO_MAX_CHANNELS ||
+        to->channel_count <= 0 || to->channel_count > SOUNDIO_MAX_CHANNELS)
+    {
+        return SoundIoErrorInvalid;
+    }
+    remix->in_channel_count = from->channel_count;
+    remix->out_channel_count = to->channel_count;
+    remix->stride = (to->channel_count + REMIX_VECTOR_WIDTH - 1) / REMIX_VECTOR_WIDTH * REMIX_VECTOR_WIDTH;
+
+    float matrix[SOUNDIO_MAX_CHANNELS * SOUNDIO_MAX_CHANNELS];
+    soundio_channel_layout_remix_matrix(from, to, matrix);
+    remix->coefs = ALLOCATE(float, (size_t)remix->stride * from->channel_count);
+    if (!remix->coefs)
+        return SoundIoErrorNoMem;
+    for (int out = 0; out < to->channel_count; out += 1) {
+        for (int in = 0; in < from->channel_count; in += 1)
+            remix->coefs[in * remix->stride + out] = matrix[out * from->channel_count + in];
+    }
+    return 0;
+}
+
+void soundio_remix_deinit(struct SoundIoRemix *remix) {
+    free(remix->coefs);
+    remix->coefs = NULL;
+}
+
+void soundio_remix_run(const struct SoundIoRemix *remix, float *dst, const float *src, int frame_count) {
+    remix_runs[soundio_convert_get_simd_level()](remix, dst, src, frame_count);
+}
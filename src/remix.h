@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_REMIX_H
+#define SOUNDIO_REMIX_H
+
+#include "soundio_internal.h"
+
+// Mixes interleaved float frames from one channel layout to another with
+// the matrix from soundio_channel_layout_remix_matrix.
+struct SoundIoRemix {
+    int in_channel_count;
+    int out_channel_count;
+    // For each input channel, its gain into every output channel, padded
+    // with zeros to `stride`, so that kernels can work on whole vectors of
+    // output channels.
+    float *coefs;
+    int stride;
+};
+
+int soundio_remix_init(struct SoundIoRemix *remix, const struct SoundIoChannelLayout *from,
+        const struct SoundIoChannelLayout *to);
+void soundio_remix_deinit(struct SoundIoRemix *remix);
+
+// `dst` and `src` must not overlap.
+void soundio_remix_run(const struct SoundIoRemix *remix, float *dst, const float *src, int frame_count);
+
+#endif
@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "resampler.h"
+#include "convert.h"
+#include "util.h"
+
+#include <math.h>
+#include <string.h>
+
+// Each output frame interpolates `taps` input frames with a windowed sinc.
+// The filter is tabulated at 2^phase_bits fractional positions, and the
+// coefficients for positions in between are interpolated linearly, so any
+// ratio works, including one which changes while running. The filter only
+// looks back, which delays the output by half of its length.
+
+#define RESAMPLER_CHUNK_SIZE 128
+#define RESAMPLER_MAX_TAPS 64
+
+struct ResampleQuality {
+    int taps;
+    int phase_bits;
+    // Of the passband, relative to the lower of the two Nyquist frequencies.
+    double cutoff;
+};
+
+// Indexed by SoundIoResampleQuality.
+static const struct ResampleQuality qualities[] = {
+    {16, 7, 0.88},
+    {8, 6, 0.80},
+    {16, 7, 0.88},
+    {32, 8, 0.92},
+    {64, 9, 0.95},
+};
+
+static const double PI = 3.14159265358979323846;
+
+// Blackman windowed sinc, zero outside of -half to half.
+static double filter_kernel(double t, double cutoff, double half) {
+    if (t <= -half || t >= half)
+        return 0.0;
+    double x = PI * cutoff * t;
+    double sinc = (x == 0.0) ? 1.0 : sin(x) / x;
+    double window = 0.42 + 0.5 * cos(PI * t / half) + 0.08 * cos(2.0 * PI * t / half);
+    return cutoff * sinc * window;
+}
+
+// Normalized so that each phase passes DC unchanged.
+static void filter_phase(double *out, int taps, double fraction, double cutoff) {
+    double half = taps / 2;
+    double sum = 0.0;
+    for (int j = 0; j < taps; j += 1) {
+        out[j] = filter_kernel(half - 1.0 + fraction - j, cutoff, half);
+        sum += out[j];
+    }
+    for (int j = 0; j < taps; j += 1)
+        out[j] /= sum;
+}
+
+static void init_coefs(struct SoundIoResampler *rs, double cutoff) {
+    int phase_count = 1 << rs->phase_bits;
+    double this_phase[RESAMPLER_MAX_TAPS];
+    double next_phase[RESAMPLER_MAX_TAPS];
+    filter_phase(next_phase, rs->taps, 0.0, cutoff);
+    for (int phase = 0; phase < phase_count; phase += 1) {
+        memcpy(this_phase, next_phase, sizeof(this_phase));
+        filter_phase(next_phase, rs->taps, (phase + 1) / (double)phase_count, cutoff);
+        float *c = rs->coefs + (size_t)phase * rs->taps * 2;
+        for (int j = 0; j < rs->taps; j += 1) {
+            c[j] = (float)this_phase[j];
+            c[rs->taps + j] = (float)(next_phase[j] - this_phase[j]);
+        }
+    }
+}
+
+static inline float *history_row(const struct SoundIoResampler *rs, int ch) {
+    return rs->history + (size_t)ch * rs->capacity;
+}
+
+// Computes `count` output frames into `out`, one row of
+// RESAMPLER_CHUNK_SIZE per channel, and moves `position` past them.
+typedef void (*ResampleRun)(struct SoundIoResampler *rs, float *out, int count);
+
+static void resample_run_scalar(struct SoundIoResampler *rs, float *out, int count) {
+    int taps = rs->taps;
+    int shift = 32 - rs->phase_bits;
+    float inverse = 1.0f / (float)(1 << shift);
+    uint64_t position = rs->position;
+    float h[RESAMPLER_MAX_TAPS];
+    for (int k = 0; k < count; k += 1) {
+        uint32_t frac = (uint32_t)position;
+        const float *c = rs->coefs + (size_t)(frac >> shift) * taps * 2;
+        const float *d = c + taps;
+        float t = (float)(frac & ((1u << shift) - 1)) * inverse;
+        for (int j = 0; j < taps; j += 1)
+            h[j] = c[j] + t * d[j];
+        size_t offset = rs->start + (size_t)(position >> 32);
+        for (int ch = 0; ch < rs->channel_count; ch += 1) {
+            const float *x = history_row(rs, ch) + offset;
+            float sum = 0.0f;
+            for (int j = 0; j < taps; j += 1)
+                sum += x[j] * h[j];
+            out[ch * RESAMPLER_CHUNK_SIZE + k] = sum;
+        }
+        position += rs->step;
+    }
+    rs->position = position;
+}
+
+#if defined(SOUNDIO_SIMD_X86)
+
+SOUNDIO_TARGET_SSE2
+static void resample_run_sse2(struct SoundIoResampler *rs, float *out, int count) {
+    int taps = rs->taps;
+    int shift = 32 - rs->phase_bits;
+    float inverse = 1.0f / (float)(1 << shift);
+    uint64_t position = rs->position;
+    __m128 h[RESAMPLER_MAX_TAPS / 4];
+    for (int k = 0; k < count; k += 1) {
+        uint32_t frac = (uint32_t)position;
+        const float *c = rs->coefs + (size_t)(frac >> shift) * taps * 2;
+        const float *d = c + taps;
+        __m128 t = _mm_set1_ps((float)(frac & ((1u << shift) - 1)) * inverse);
+        for (int j = 0; j < taps; j += 4)
+            h[j / 4] = _mm_add_ps(_mm_loadu_ps(c + j), _mm_mul_ps(t, _mm_loadu_ps(d + j)));
+        size_t offset = rs->start + (size_t)(position >> 32);
+        for (int ch = 0; ch < rs->channel_count; ch += 1) {
+            const float *x = history_row(rs, ch) + offset;
+            __m128 sum0 = _mm_setzero_ps();
+            __m128 sum1 = _mm_setzero_ps();
+            for (int j = 0; j < taps; j += 8) {
+                sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(x + j), h[j / 4]));
+                sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(x + j + 4), h[j / 4 + 1]));
+            }
+            __m128 sum = _mm_add_ps(sum0, sum1);
+            sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+            sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+            out[ch * RESAMPLER_CHUNK_SIZE + k] = _mm_cvtss_f32(sum);
+        }
+        position += rs->step;
+    }
+    rs->position = position;
+}
+
+SOUNDIO_TARGET_AVX2
+static void resample_run_avx2(struct SoundIoResampler *rs, float *out, int count) {
+    int taps = rs->taps;
+    int shift = 32 - rs->phase_bits;
+    float inverse = 1.0f / (float)(1 << shift);
+    uint64_t position = rs->position;
+    __m256 h[RESAMPLER_MAX_TAPS / 8];
+    for (int k = 0; k < count; k += 1) {
+        uint32_t frac = (uint32_t)position;
+        const float *c = rs->coefs + (size_t)(frac >> shift) * taps * 2;
+        const float *d = c + taps;
+        __m256 t = _mm256_set1_ps((float)(frac & ((1u << shift) - 1)) * inverse);
+        for (int j = 0; j < taps; j += 8)
+            h[j / 8] = _mm256_add_ps(_mm256_loadu_ps(c + j), _mm256_mul_ps(t, _mm256_loadu_ps(d + j)));
+        size_t offset = rs->start + (size_t)(position >> 32);
+        for (int ch = 0; ch < rs->channel_count; ch += 1) {
+            const float *x = history_row(rs, ch) + offset;
+            __m256 sum = _mm256_setzero_ps();
+            for (int j = 0; j < taps; j += 8)
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(x + j), h[j / 8]));
+            __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+            half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+            half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+            out[ch * RESAMPLER_CHUNK_SIZE + k] = _mm_cvtss_f32(half);
+        }
+        position += rs->step;
+    }
+    rs->position = position;
+    _mm256_zeroupper();
+}
+
+#endif
+
+// Indexed by SoundIoSimdLevel.
+static const ResampleRun resample_runs[] = {
+    resample_run_scalar,
+#if defined(SOUNDIO_SIMD_X86)
+    resample_run_sse2,
+    resample_run_avx2,
+#endif
+};
+
+int soundio_resampler_init(struct SoundIoResampler *rs, int channel_count,
+        int in_rate, int out_rate, enum SoundIoResampleQuality quality, int max_buffered)
+{
+    memset(rs, 0, sizeof(struct SoundIoResampler));
+    if (channel_count <= 0 || channel_count > SOUNDIO_MAX_CHANNELS || in_rate <= 0 || out_rate <= 0 ||
+        (int)quality < 0 || (size_t)quality >= ARRAY_LENGTH(qualities) || max_buffered <= 0)
+    {
+        return SoundIoErrorInvalid;
+    }
+
+    const struct ResampleQuality *q = &qualities[quality];
+    rs->channel_count = channel_count;
+    rs->taps = q->taps;
+    rs->phase_bits = q->phase_bits;
+    rs->capacity = max_buffered + q->taps;
+    rs->nominal_step = ((uint64_t)in_rate << 32) / out_rate;
+    rs->step = rs->nominal_step;
+
+    size_t coef_count = ((size_t)1 << q->phase_bits) * q->taps * 2;
+    size_t history_count = (size_t)channel_count * rs->capacity;
+    size_t scratch_count = (size_t)channel_count * RESAMPLER_CHUNK_SIZE;
+    rs->coefs = ALLOCATE_NONZERO(float, coef_count);
+    rs->history = ALLOCATE_NONZERO(float, history_count);
+    rs->scratch = ALLOCATE_NONZERO(float, scratch_count);
+    if (!rs->coefs || !rs->history || !rs->scratch) {
+        soundio_resampler_deinit(rs);
+        return SoundIoErrorNoMem;
+    }
+    // Touch everything now rather than on the real-time thread.
+    memset(rs->history, 0, history_count * sizeof(float));
+    memset(rs->scratch, 0, scratch_count * sizeof(float));
+
+    // Downsampling moves the cutoff down to the output's Nyquist frequency.
+    double cutoff = q->cutoff;
+    if (out_rate < in_rate)
+        cutoff *= out_rate / (double)in_rate;
+    init_coefs(rs, cutoff);
+
+    soundio_resampler_reset(rs);
+    return 0;
+}
+
+void soundio_resampler_deinit(struct SoundIoResampler *rs) {
+    free(rs->coefs);
+    free(rs->history);
+    free(rs->scratch);
+    rs->coefs = NULL;
+    rs->history = NULL;
+    rs->scratch = NULL;
+}
+
+void soundio_resampler_reset(struct SoundIoResampler *rs) {
+    for (int ch = 0; ch < rs->channel_count; ch += 1)
+        memset(history_row(rs, ch), 0, (size_t)(rs->taps - 1) * sizeof(float));
+    rs->start = 0;
+    rs->end = rs->taps - 1;
+    rs->position = 0;
+}
+
+void soundio_resampler_set_ratio(struct SoundIoResampler *rs, double ratio) {
+    rs->step = (uint64_t)(rs->nominal_step * ratio + 0.5);
+}
+
+int soundio_resampler_free_count(const struct SoundIoResampler *rs) {
+    return rs->capacity - (rs->end - rs->start);
+}
+
+int soundio_resampler_output_count(const struct SoundIoResampler *rs) {
+    int filled = rs->end - rs->start;
+    if (filled < rs->taps)
+        return 0;
+    // The first position which needs a frame that is not there yet.
+    uint64_t limit = (uint64_t)(filled - rs->taps + 1) << 32;
+    if (rs->position >= limit)
+        return 0;
+    uint64_t count = (limit - rs->position - 1) / rs->step + 1;
+    return (count > INT32_MAX) ? INT32_MAX : (int)count;
+}
+
+int soundio_resampler_input_needed(const struct SoundIoResampler *rs, int output_count) {
+    if (output_count <= 0)
+        return 0;
+    uint64_t last = rs->position + (uint64_t)(output_count - 1) * rs->step;
+    int64_t needed = (int64_t)(last >> 32) + rs->taps - (rs->end - rs->start);
+    return (needed > 0) ? (int)needed : 0;
+}
+
+double soundio_resampler_delay(const struct SoundIoResampler *rs) {
+    return (rs->end - rs->start) - rs->position / 4294967296.0 - rs->taps / 2;
+}
+
+static void make_room(struct SoundIoResampler *rs, int frame_count) {
+    if (rs->end + frame_count <= rs->capacity)
+        return;
+    int filled = rs->end - rs->start;
+    for (int ch = 0; ch < rs->channel_count; ch += 1) {
+        float *row = history_row(rs, ch);
+        memmove(row, row + rs->start, (size_t)filled * sizeof(float));
+    }
+    rs->start = 0;
+    rs->end = filled;
+}
+
+void soundio_resampler_write(struct SoundIoResampler *rs, enum SoundIoFormat format,
+        const struct SoundIoChannelArea *areas, int frame_count)
+{
+    make_room(rs, frame_count);
+    struct SoundIoChannelArea rows[SOUNDIO_MAX_CHANNELS];
+    for (int ch = 0; ch < rs->channel_count; ch += 1) {
+        rows[ch].ptr = (char *)(history_row(rs, ch) + rs->end);
+        rows[ch].step = sizeof(float);
+    }
+    soundio_convert_samples(SoundIoFormatFloat32NE, rows, format, areas, rs->channel_count, frame_count);
+    rs->end += frame_count;
+}
+
+void soundio_resampler_write_silence(struct SoundIoResampler *rs, int frame_count) {
+    make_room(rs, frame_count);
+    for (int ch = 0; ch < rs->channel_count; ch += 1)
+        memset(history_row(rs, ch) + rs->end, 0, (size_t)frame_count * sizeof(float));
+    rs->end += frame_count;
+}
+
+void soundio_resampler_read(struct SoundIoResampler *rs, enum SoundIoFormat format,
+        const struct SoundIoChannelArea *areas, int frame_count)
+{
+    ResampleRun run = resample_runs[soundio_convert_get_simd_level()];
+    struct SoundIoChannelArea src[SOUNDIO_MAX_CHANNELS];
+    struct SoundIoChannelArea dst[SOUNDIO_MAX_CHANNELS];
+    for (int ch = 0; ch < rs->channel_count; ch += 1) {
+        src[ch].ptr = (char *)(rs->scratch + ch * RESAMPLER_CHUNK_SIZE);
+        src[ch].step = sizeof(float);
+        dst[ch] = areas[ch];
+    }
+    while (frame_count > 0) {
+        int count = soundio_int_min(frame_count, RESAMPLER_CHUNK_SIZE);
+        run(rs, rs->scratch, count);
+        soundio_convert_samples(format, dst, SoundIoFormatFloat32NE, src, rs->channel_count, count);
+        for (int ch = 0; ch < rs->channel_count; ch += 1)
+            dst[ch].ptr += count * dst[ch].step;
+        frame_count -= count;
+    }
+
+    // Drop the frames no output needs anymore. Downsampling can step past
+    // the newest frame, in which case the position keeps the rest.
+    uint64_t advance = rs->position >> 32;
+    int filled = rs->end - rs->start;
+    int drop = (advance < (uint64_t)filled) ? (int)advance : filled;
+    rs->start += drop;
+    rs->position -= (uint64_t)drop << 32;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_RESAMPLER_H
+#define SOUNDIO_RESAMPLER_H
+
+#include "soundio_internal.h"
+
+#include <stdint.h>
+
+// A windowed sinc polyphase resampler for float frames. Input is written in
+// any format and buffered, output is read in any format. Everything is
+// allocated by init, so that writing and reading are real-time safe.
+struct SoundIoResampler {
+    int channel_count;
+    int taps;
+    int phase_bits;
+    // For each phase, the taps of the filter followed by how much each
+    // changes until the next phase.
+    float *coefs;
+    // One row of `capacity` frames per channel. Frames `start` up to `end`
+    // are buffered; the first `taps - 1` frames are the start of the stream.
+    float *history;
+    int capacity;
+    int start;
+    int end;
+    // The next output is at `position` from `start`, in input frames as 32.32
+    // fixed point, and each output moves it by `step`.
+    uint64_t position;
+    uint64_t nominal_step;
+    uint64_t step;
+    // Planar output on its way to being converted.
+    float *scratch;
+};
+
+// `max_buffered` is the most input frames that can be buffered at a time.
+int soundio_resampler_init(struct SoundIoResampler *rs, int channel_count,
+        int in_rate, int out_rate, enum SoundIoResampleQuality quality, int max_buffered);
+void soundio_resampler_deinit(struct SoundIoResampler *rs);
+// Back to the state right after init, keeping the ratio.
+void soundio_resampler_reset(struct SoundIoResampler *rs);
+
+// Scales how fast input is consumed relative to the nominal ratio, for
+// following a clock which drifts. 1.0 is the nominal ratio.
+void soundio_resampler_set_ratio(struct SoundIoResampler *rs, double ratio);
+
+// How many input frames can be written.
+int soundio_resampler_free_count(const struct SoundIoResampler *rs);
+// How many output frames can be read.
+int soundio_resampler_output_count(const struct SoundIoResampler *rs);
+// How many more input frames it takes before `output_count` output frames
+// can be read.
+int soundio_resampler_input_needed(const struct SoundIoResampler *rs, int output_count);
+// How far the next output frame lags the newest input frame, in input
+// frames, counting the delay of the filter.
+double soundio_resampler_delay(const struct SoundIoResampler *rs);
+
+// `frame_count` must not be more than soundio_resampler_free_count.
+void soundio_resampler_write(struct SoundIoResampler *rs, enum SoundIoFormat format,
+        const struct SoundIoChannelArea *areas, int frame_count);
+void soundio_resampler_write_silence(struct SoundIoResampler *rs, int frame_count);
+// `frame_count` must not be more than soundio_resampler_output_count.
+void soundio_resampler_read(struct SoundIoResampler *rs, enum SoundIoFormat format,
+        const struct SoundIoChannelArea *areas, int frame_count);
+
+#endif
@@ -10,8 +10,22 @@
 #include "util.h"
 
 #include <stdlib.h>
+#include <limits.h>
 
 struct SoundIoRingBuffer *soundio_ring_buffer_create(struct SoundIo *soundio, int requested_capacity) {
+    return soundio_ring_buffer_create_flags(soundio, requested_capacity, SoundIoRingBufferFlagNone);
+}
+
+struct SoundIoRingBuffer *soundio_ring_buffer_create_flags(struct SoundIo *soundio,
+        int requested_capacity, int flags)
+{
+    assert(requested_capacity > 0);
+    return soundio_ring_buffer_create_size(soundio, requested_capacity, flags);
+}
+
+struct SoundIoRingBuffer *soundio_ring_buffer_create_size(struct SoundIo *soundio,
+        size_t requested_capacity, int flags)
+{
     struct SoundIoRingBuffer *rb = ALLOCATE(struct SoundIoRingBuffer, 1);
 
     assert(requested_capacity > 0);
@@ -21,7 +35,10 @@ struct SoundIoRingBuffer *soundio_ring_buffer_create(struct SoundIo *soundio, in
         return NULL;
     }
 
-    if (soundio_ring_buffer_init(rb, requested_capacity)) {
+    if (soundio && soundio->lock_memory)
+        flags |= SoundIoRingBufferFlagLockMemory;
+
+    if (soundio_ring_buffer_init_flags(rb, requested_capacity, flags)) {
         soundio_ring_buffer_destroy(rb);
         return NULL;
     }
@@ -38,61 +55,382 @@ void soundio_ring_buffer_destroy(struct SoundIoRingBuffer *rb) {
     free(rb);
 }
 
+static int clamp_to_int(size_t count) {
+    return (count > INT_MAX) ? INT_MAX : (int)count;
+}
+
 int soundio_ring_buffer_capacity(struct SoundIoRingBuffer *rb) {
+    return clamp_to_int(rb->capacity);
+}
+
+size_t soundio_ring_buffer_capacity_size(struct SoundIoRingBuffer *rb) {
     return rb->capacity;
 }
 
+int soundio_ring_buffer_page_size(struct SoundIoRingBuffer *rb) {
+    return rb->page_size;
+}
+
+// Must be called by the producer. Returns at least `needed` if that much
+// space is free, only loading read_offset when the cached copy is too stale
+// to tell.
+static size_t producer_free_count(struct SoundIoRingBuffer *rb, size_t needed) {
+    if (rb->overwrite)
+        return rb->capacity;
+    size_t write_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->write_offset);
+    size_t free_count = rb->capacity - (write_offset - rb->cached_read_offset);
+    if (free_count < needed) {
+        rb->cached_read_offset = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->read_offset);
+        free_count = rb->capacity - (write_offset - rb->cached_read_offset);
+    }
+    return free_count;
+}
+
+// Overwrite mode only. The oldest offset that the producer is not writing
+// over and has not written over yet.
+static size_t oldest_intact_offset(struct SoundIoRingBuffer *rb) {
+    return SOUNDIO_ATOMIC_LOAD_RELAXED(rb->reserve_end) - rb->capacity;
+}
+
+// Overwrite mode only. Must be called by the consumer. If the producer lapped
+// the consumer, move read_offset up to the oldest intact data.
+static size_t consumer_resync(struct SoundIoRingBuffer *rb) {
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->read_offset);
+    size_t write_offset = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->write_offset);
+    size_t oldest = oldest_intact_offset(rb);
+    if ((ptrdiff_t)(oldest - read_offset) > 0) {
+        rb->overrun_bytes += oldest - read_offset;
+        read_offset = oldest;
+        SOUNDIO_ATOMIC_STORE_RELEASE(rb->read_offset, read_offset);
+    }
+    return write_offset - read_offset;
+}
+
+// Must be called by the consumer. The counterpart of producer_free_count.
+static size_t consumer_fill_count(struct SoundIoRingBuffer *rb, size_t needed) {
+    if (rb->overwrite)
+        return consumer_resync(rb);
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->read_offset);
+    unsigned long generation = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->clear_generation);
+    size_t fill_count = rb->cached_write_offset - read_offset;
+    if (fill_count < needed || generation != rb->cached_clear_generation) {
+        rb->cached_clear_generation = generation;
+        rb->cached_write_offset = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->write_offset);
+        fill_count = rb->cached_write_offset - read_offset;
+    }
+    return fill_count;
+}
+
+// Must be called by the producer after publishing write_offset. The fence
+// pairs with the one in soundio_ring_buffer_arm_wakeup: either the consumer
+// sees the new write_offset before it parks, or we see its threshold here.
+static void wake_waiter(struct SoundIoRingBuffer *rb, size_t write_offset) {
+    SOUNDIO_ATOMIC_FENCE_SEQ_CST();
+    size_t threshold = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->waiter_threshold);
+    if (!threshold)
+        return;
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->read_offset);
+    if (write_offset - read_offset < threshold)
+        return;
+    // Only one wakeup per arming, however many writes follow.
+    if (SOUNDIO_ATOMIC_EXCHANGE(rb->waiter_threshold, 0))
+        soundio_os_event_signal(rb->wakeup_event);
+}
+
 char *soundio_ring_buffer_write_ptr(struct SoundIoRingBuffer *rb) {
-    unsigned long write_offset = SOUNDIO_ATOMIC_LOAD(rb->write_offset);
+    size_t write_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->write_offset);
     return rb->mem.address + (write_offset % rb->capacity);
 }
 
 void soundio_ring_buffer_advance_write_ptr(struct SoundIoRingBuffer *rb, int count) {
-    SOUNDIO_ATOMIC_FETCH_ADD(rb->write_offset, count);
-    assert(soundio_ring_buffer_fill_count(rb) >= 0);
+    assert(count >= 0);
+    soundio_ring_buffer_advance_write_ptr_size(rb, count);
+}
+
+void soundio_ring_buffer_advance_write_ptr_size(struct SoundIoRingBuffer *rb, size_t count) {
+    // Usually answered from the cache, since the producer asked for the
+    // space before writing to it.
+    size_t free_count = producer_free_count(rb, count);
+    assert(count <= free_count);
+    (void)free_count;
+    // Only the producer stores write_offset, so there is no need for an atomic
+    // read-modify-write here. The release pairs with the consumer's acquire
+    // so that the bytes written are visible before the new offset is.
+    size_t write_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->write_offset);
+    // Without soundio_ring_buffer_reserve_write the span was not announced.
+    // Keep reserve_end from falling behind anyway.
+    if (rb->overwrite && (ptrdiff_t)(SOUNDIO_ATOMIC_LOAD_RELAXED(rb->reserve_end) - (write_offset + count)) < 0)
+        SOUNDIO_ATOMIC_STORE_RELAXED(rb->reserve_end, write_offset + count);
+    SOUNDIO_ATOMIC_STORE_RELEASE(rb->write_offset, write_offset + count);
+    if (rb->wakeup_event)
+        wake_waiter(rb, write_offset + count);
 }
 
 char *soundio_ring_buffer_read_ptr(struct SoundIoRingBuffer *rb) {
-    unsigned long read_offset = SOUNDIO_ATOMIC_LOAD(rb->read_offset);
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->read_offset);
     return rb->mem.address + (read_offset % rb->capacity);
 }
 
+// Overwrite mode only. Returns SoundIoErrorOverflow if the producer wrote
+// over any of the count bytes before the consumer finished with them.
+static int overwrite_advance_read_ptr(struct SoundIoRingBuffer *rb, size_t count) {
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->read_offset);
+    size_t new_offset = read_offset + count;
+    // Pairs with the fence in soundio_ring_buffer_reserve_write: if any byte
+    // that was read belonged to a newer span, that span's reserve_end is
+    // visible now.
+    SOUNDIO_ATOMIC_FENCE_ACQUIRE();
+    size_t oldest = oldest_intact_offset(rb);
+    int err = 0;
+    if ((ptrdiff_t)(oldest - read_offset) > 0) {
+        rb->overrun_bytes += oldest - read_offset;
+        if ((ptrdiff_t)(oldest - new_offset) > 0)
+            new_offset = oldest;
+        err = SoundIoErrorOverflow;
+    }
+    SOUNDIO_ATOMIC_STORE_RELEASE(rb->read_offset, new_offset);
+    return err;
+}
+
 void soundio_ring_buffer_advance_read_ptr(struct SoundIoRingBuffer *rb, int count) {
-    SOUNDIO_ATOMIC_FETCH_ADD(rb->read_offset, count);
-    assert(soundio_ring_buffer_fill_count(rb) >= 0);
+    assert(count >= 0);
+    soundio_ring_buffer_advance_read_ptr_size(rb, count);
 }
 
-int soundio_ring_buffer_fill_count(struct SoundIoRingBuffer *rb) {
+void soundio_ring_buffer_advance_read_ptr_size(struct SoundIoRingBuffer *rb, size_t count) {
+    if (rb->overwrite) {
+        overwrite_advance_read_ptr(rb, count);
+        return;
+    }
+    size_t fill_count = consumer_fill_count(rb, count);
+    assert(count <= fill_count);
+    (void)fill_count;
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->read_offset);
+    SOUNDIO_ATOMIC_STORE_RELEASE(rb->read_offset, read_offset + count);
+}
+
+size_t soundio_ring_buffer_fill_count_size(struct SoundIoRingBuffer *rb) {
     // Whichever offset we load first might have a smaller value. So we load
     // the read_offset first.
-    unsigned long read_offset = SOUNDIO_ATOMIC_LOAD(rb->read_offset);
-    unsigned long write_offset = SOUNDIO_ATOMIC_LOAD(rb->write_offset);
-    int count = write_offset - read_offset;
-    assert(count >= 0);
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->read_offset);
+    size_t write_offset = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->write_offset);
+    if (rb->overwrite) {
+        // Count only what is still intact, without moving the consumer.
+        size_t oldest = oldest_intact_offset(rb);
+        if ((ptrdiff_t)(oldest - read_offset) > 0)
+            read_offset = oldest;
+    }
+    // Unsigned subtraction, so this is right even after the offsets wrap.
+    size_t count = write_offset - read_offset;
     assert(count <= rb->capacity);
     return count;
 }
 
+int soundio_ring_buffer_fill_count(struct SoundIoRingBuffer *rb) {
+    return clamp_to_int(soundio_ring_buffer_fill_count_size(rb));
+}
+
+size_t soundio_ring_buffer_free_count_size(struct SoundIoRingBuffer *rb) {
+    if (rb->overwrite)
+        return rb->capacity;
+    // Same order as in soundio_ring_buffer_fill_count_size.
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->read_offset);
+    size_t write_offset = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->write_offset);
+    size_t count = write_offset - read_offset;
+    assert(count <= rb->capacity);
+    return rb->capacity - count;
+}
+
 int soundio_ring_buffer_free_count(struct SoundIoRingBuffer *rb) {
-    return rb->capacity - soundio_ring_buffer_fill_count(rb);
+    return clamp_to_int(soundio_ring_buffer_free_count_size(rb));
 }
 
 void soundio_ring_buffer_clear(struct SoundIoRingBuffer *rb) {
-    unsigned long read_offset = SOUNDIO_ATOMIC_LOAD(rb->read_offset);
-    SOUNDIO_ATOMIC_STORE(rb->write_offset, read_offset);
+    size_t read_offset = SOUNDIO_ATOMIC_LOAD_ACQUIRE(rb->read_offset);
+    // In overwrite mode read_offset may be more than capacity behind, and
+    // reserve_end must not be left ahead of the new write_offset.
+    if (rb->overwrite)
+        SOUNDIO_ATOMIC_STORE_RELAXED(rb->reserve_end, read_offset);
+    SOUNDIO_ATOMIC_STORE_RELEASE(rb->write_offset, read_offset);
+    rb->cached_read_offset = read_offset;
+    // Tell the consumer that its cached write_offset may now be ahead of the
+    // real one.
+    SOUNDIO_ATOMIC_FETCH_ADD(rb->clear_generation, 1);
+}
+
+int soundio_ring_buffer_reserve_write(struct SoundIoRingBuffer *rb,
+        int min_count, int max_count, char **out_ptr, int *out_count)
+{
+    if (min_count < 0 || min_count > max_count)
+        return SoundIoErrorInvalid;
+
+    size_t count = 0;
+    int err = soundio_ring_buffer_reserve_write_size(rb, min_count, max_count, out_ptr, &count);
+    *out_count = count;
+    return err;
+}
+
+int soundio_ring_buffer_reserve_write_size(struct SoundIoRingBuffer *rb,
+        size_t min_count, size_t max_count, char **out_ptr, size_t *out_count)
+{
+    if (min_count > max_count)
+        return SoundIoErrorInvalid;
+
+    size_t count = producer_free_count(rb, max_count);
+    if (count > max_count)
+        count = max_count;
+    if (count < min_count)
+        count = 0;
+    if (count > 0 && rb->overwrite) {
+        // Consumers must be able to see the new reserve_end before they can
+        // see any of the bytes about to be written. It never moves back: an
+        // earlier, longer reservation may have written further already.
+        size_t reserve_end = SOUNDIO_ATOMIC_LOAD_RELAXED(rb->write_offset) + count;
+        if ((ptrdiff_t)(SOUNDIO_ATOMIC_LOAD_RELAXED(rb->reserve_end) - reserve_end) < 0)
+            SOUNDIO_ATOMIC_STORE_RELAXED(rb->reserve_end, reserve_end);
+        SOUNDIO_ATOMIC_FENCE_RELEASE();
+    }
+    *out_ptr = soundio_ring_buffer_write_ptr(rb);
+    *out_count = count;
+    return 0;
+}
+
+void soundio_ring_buffer_commit_write(struct SoundIoRingBuffer *rb, int count) {
+    soundio_ring_buffer_advance_write_ptr(rb, count);
+}
+
+void soundio_ring_buffer_commit_write_size(struct SoundIoRingBuffer *rb, size_t count) {
+    soundio_ring_buffer_advance_write_ptr_size(rb, count);
+}
+
+int soundio_ring_buffer_reserve_read(struct SoundIoRingBuffer *rb,
+        int min_count, int max_count, char **out_ptr, int *out_count)
+{
+    if (min_count < 0 || min_count > max_count)
+        return SoundIoErrorInvalid;
+
+    size_t count = 0;
+    int err = soundio_ring_buffer_reserve_read_size(rb, min_count, max_count, out_ptr, &count);
+    *out_count = count;
+    return err;
+}
+
+int soundio_ring_buffer_reserve_read_size(struct SoundIoRingBuffer *rb,
+        size_t min_count, size_t max_count, char **out_ptr, size_t *out_count)
+{
+    if (min_count > max_count)
+        return SoundIoErrorInvalid;
+
+    size_t count = consumer_fill_count(rb, max_count);
+    if (count > max_count)
+        count = max_count;
+    *out_ptr = soundio_ring_buffer_read_ptr(rb);
+    *out_count = (count >= min_count) ? count : 0;
+    return 0;
+}
+
+int soundio_ring_buffer_commit_read(struct SoundIoRingBuffer *rb, int count) {
+    assert(count >= 0);
+    return soundio_ring_buffer_commit_read_size(rb, count);
+}
+
+int soundio_ring_buffer_commit_read_size(struct SoundIoRingBuffer *rb, size_t count) {
+    if (rb->overwrite)
+        return overwrite_advance_read_ptr(rb, count);
+    soundio_ring_buffer_advance_read_ptr_size(rb, count);
+    return 0;
+}
+
+long soundio_ring_buffer_overrun_count(struct SoundIoRingBuffer *rb) {
+    return rb->overrun_bytes;
+}
+
+int soundio_ring_buffer_arm_wakeup(struct SoundIoRingBuffer *rb, int min_count) {
+    assert(rb->wakeup_event);
+    assert(min_count > 0);
+    soundio_os_event_reset(rb->wakeup_event);
+    SOUNDIO_ATOMIC_STORE(rb->waiter_threshold, (size_t)min_count);
+    SOUNDIO_ATOMIC_FENCE_SEQ_CST();
+    return soundio_ring_buffer_fill_count(rb);
+}
+
+int soundio_ring_buffer_wait(struct SoundIoRingBuffer *rb, int min_count, double timeout) {
+    if (!rb->wakeup_event || min_count <= 0 || (size_t)min_count > rb->capacity)
+        return SoundIoErrorInvalid;
+
+    double deadline = soundio_os_get_time() + timeout;
+    for (;;) {
+        if (SOUNDIO_ATOMIC_EXCHANGE(rb->wakeup_interrupt, false)) {
+            SOUNDIO_ATOMIC_STORE(rb->waiter_threshold, 0);
+            return SoundIoErrorInterrupted;
+        }
+        if (soundio_ring_buffer_arm_wakeup(rb, min_count) >= min_count) {
+            SOUNDIO_ATOMIC_STORE(rb->waiter_threshold, 0);
+            return 0;
+        }
+        double remaining = -1.0;
+        if (timeout >= 0.0) {
+            remaining = deadline - soundio_os_get_time();
+            if (remaining <= 0.0) {
+                SOUNDIO_ATOMIC_STORE(rb->waiter_threshold, 0);
+                return SoundIoErrorInterrupted;
+            }
+        }
+        soundio_os_event_timed_wait(rb->wakeup_event, remaining);
+    }
+}
+
+void soundio_ring_buffer_wakeup(struct SoundIoRingBuffer *rb) {
+    assert(rb->wakeup_event);
+    SOUNDIO_ATOMIC_STORE(rb->wakeup_interrupt, true);
+    soundio_os_event_signal(rb->wakeup_event);
+}
+
+int soundio_ring_buffer_wakeup_fd(struct SoundIoRingBuffer *rb) {
+    return rb->wakeup_event ? soundio_os_event_fd(rb->wakeup_event) : -1;
 }
 
 int soundio_ring_buffer_init(struct SoundIoRingBuffer *rb, int requested_capacity) {
+    return soundio_ring_buffer_init_flags(rb, requested_capacity, SoundIoRingBufferFlagNone);
+}
+
+int soundio_ring_buffer_init_flags(struct SoundIoRingBuffer *rb, size_t requested_capacity, int flags) {
+    int os_flags = 0;
+    if (flags & SoundIoRingBufferFlagHugePages)
+        os_flags |= SoundIoOsMemoryFlagHugePages;
+    if (flags & SoundIoRingBufferFlagLockMemory)
+        os_flags |= SoundIoOsMemoryFlagLock;
+
     int err;
-    if ((err = soundio_os_init_mirrored_memory(&rb->mem, requested_capacity)))
+    size_t page_size;
+    if ((err = soundio_os_init_mirrored_memory_flags(&rb->mem, requested_capacity, os_flags, &page_size)))
         return err;
+    rb->page_size = page_size;
+    rb->overwrite = (flags & SoundIoRingBufferFlagOverwrite) != 0;
+    rb->overrun_bytes = 0;
+    rb->wakeup_event = NULL;
+    if (flags & SoundIoRingBufferFlagWakeup) {
+        if (!(rb->wakeup_event = soundio_os_event_create())) {
+            soundio_ring_buffer_deinit(rb);
+            return SoundIoErrorSystemResources;
+        }
+    }
+    SOUNDIO_ATOMIC_STORE(rb->waiter_threshold, 0);
+    SOUNDIO_ATOMIC_STORE(rb->wakeup_interrupt, false);
+    SOUNDIO_ATOMIC_STORE(rb->reserve_end, 0);
     SOUNDIO_ATOMIC_STORE(rb->write_offset, 0);
     SOUNDIO_ATOMIC_STORE(rb->read_offset, 0);
+    SOUNDIO_ATOMIC_STORE(rb->clear_generation, 0);
+    rb->cached_read_offset = 0;
+    rb->cached_write_offset = 0;
+    rb->cached_clear_generation = 0;
     rb->capacity = rb->mem.capacity;
 
     return 0;
 }
 
 void soundio_ring_buffer_deinit(struct SoundIoRingBuffer *rb) {
+    soundio_os_event_destroy(rb->wakeup_event);
+    rb->wakeup_event = NULL;
     soundio_os_deinit_mirrored_memory(&rb->mem);
 }
@@ -11,14 +11,58 @@
 #include "os.h"
 #include "atomics.h"
 
+// The producer and the consumer each own one cache line. Each side keeps the
+// last value it observed of the other side's offset and only loads the real
+// one when the cached value says there is not enough room or data, so in the
+// common case neither side touches the other side's cache line. Fill and free
+// counts may be asked from any thread, so they do not use the cached values.
 struct SoundIoRingBuffer {
     struct SoundIoOsMirroredMemory mem;
-    struct SoundIoAtomicULong write_offset;
-    struct SoundIoAtomicULong read_offset;
-    int capacity;
+    // The offsets below only ever grow. Counts are differences of offsets,
+    // which stay correct when an offset wraps around, but offset % capacity
+    // only stays continuous across the wrap if capacity is a power of two.
+    // With 64-bit size_t that takes longer than any stream runs.
+    size_t capacity;
+    int page_size;
+    // SoundIoRingBufferFlagOverwrite
+    bool overwrite;
+    // SoundIoRingBufferFlagWakeup, otherwise NULL
+    struct SoundIoOsEvent *wakeup_event;
+
+    // Incremented by the producer in soundio_ring_buffer_clear, which is the
+    // only time write_offset moves backwards. Written rarely, so it gets its
+    // own line which stays shared in the consumer's cache.
+    char pad0[SOUNDIO_CACHE_LINE_SIZE];
+    struct SoundIoAtomicULong clear_generation;
+    // Wakeup mode only. Non-zero while the consumer is parked waiting for
+    // that many bytes. Checked by the producer after every write, written
+    // rarely, so it shares this line.
+    struct SoundIoAtomicSize waiter_threshold;
+    struct SoundIoAtomicBool wakeup_interrupt;
+
+    // Producer
+    char pad1[SOUNDIO_CACHE_LINE_SIZE];
+    struct SoundIoAtomicSize write_offset;
+    size_t cached_read_offset;
+    // Overwrite mode only. The end of the last span the producer reserved,
+    // stored before any byte of it is written, so that the consumer can tell
+    // after reading whether the bytes it read were overwritten meanwhile.
+    struct SoundIoAtomicSize reserve_end;
+
+    // Consumer
+    char pad2[SOUNDIO_CACHE_LINE_SIZE];
+    struct SoundIoAtomicSize read_offset;
+    size_t cached_write_offset;
+    unsigned long cached_clear_generation;
+    // Overwrite mode only. Bytes the consumer lost to the producer.
+    long overrun_bytes;
+
+    char pad3[SOUNDIO_CACHE_LINE_SIZE];
 };
 
 int soundio_ring_buffer_init(struct SoundIoRingBuffer *rb, int requested_capacity);
+// flags is a bitmask of SoundIoRingBufferFlag
+int soundio_ring_buffer_init_flags(struct SoundIoRingBuffer *rb, size_t requested_capacity, int flags);
 void soundio_ring_buffer_deinit(struct SoundIoRingBuffer *rb);
 
 #endif
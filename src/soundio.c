@@ -91,6 +91,7 @@ const char *soundio_strerror(int error) {
         case SoundIoErrorInterrupted: return "interrupted; try again";
         case SoundIoErrorUnderflow: return "buffer underflow";
         case SoundIoErrorEncodingString: return "failed to encode string";
+        case SoundIoErrorOverflow: return "buffer overflow";
     }
     return "(invalid error)";
 }
@@ -115,6 +116,10 @@ int soundio_get_bytes_per_sample(enum SoundIoFormat format) {
     case SoundIoFormatFloat32BE:  return 4;
     case SoundIoFormatFloat64LE:  return 8;
     case SoundIoFormatFloat64BE:  return 8;
+    case SoundIoFormatS24PackedLE: return 3;
+    case SoundIoFormatS24PackedBE: return 3;
+    case SoundIoFormatU24PackedLE: return 3;
+    case SoundIoFormatU24PackedBE: return 3;
 
     case SoundIoFormatInvalid:    return -1;
     }
@@ -141,6 +146,10 @@ const char * soundio_format_string(enum SoundIoFormat format) {
     case SoundIoFormatFloat32BE:  return "float 32-bit BE";
     case SoundIoFormatFloat64LE:  return "float 64-bit LE";
     case SoundIoFormatFloat64BE:  return "float 64-bit BE";
+    case SoundIoFormatS24PackedLE: return "signed 24-bit packed LE";
+    case SoundIoFormatS24PackedBE: return "signed 24-bit packed BE";
+    case SoundIoFormatU24PackedLE: return "unsigned 24-bit packed LE";
+    case SoundIoFormatU24PackedBE: return "unsigned 24-bit packed BE";
 
     case SoundIoFormatInvalid:
         return "(invalid sample format)";
@@ -273,6 +282,7 @@ void soundio_disconnect(struct SoundIo *soundio) {
     si->outstream_pause = NULL;
     si->outstream_get_latency = NULL;
     si->outstream_set_volume = NULL;
+    si->outstream_get_page_faults = NULL;
 
     si->instream_open = NULL;
     si->instream_destroy = NULL;
@@ -281,6 +291,7 @@ void soundio_disconnect(struct SoundIo *soundio) {
     si->instream_end_read = NULL;
     si->instream_pause = NULL;
     si->instream_get_latency = NULL;
+    si->instream_get_page_faults = NULL;
 }
 
 void soundio_flush_events(struct SoundIo *soundio) {
@@ -439,7 +450,244 @@ void soundio_force_device_scan(struct SoundIo *soundio) {
     si->force_device_scan(si);
 }
 
-int soundio_outstream_begin_write(struct SoundIoOutStream *outstream,
+// Native float mode. Big enough for a whole buffer, which is the most any
+// backend asks for in one callback.
+static int alloc_float_buffer(double software_latency, int sample_rate, int channel_count,
+        float **out_buffer, int *out_frame_count)
+{
+    int frame_count = (int)(software_latency * sample_rate) + 1;
+    if (software_latency <= 0.0)
+        frame_count = sample_rate;
+    float *buffer = ALLOCATE_NONZERO(float, (size_t)frame_count * channel_count);
+    if (!buffer)
+        return SoundIoErrorNoMem;
+    // Touch it now rather than in the first callback.
+    memset(buffer, 0, (size_t)frame_count * channel_count * sizeof(float));
+    *out_buffer = buffer;
+    *out_frame_count = frame_count;
+    return 0;
+}
+
+// Lay out the float areas like the device areas, so that the conversion
+// between them works on contiguous runs.
+static void set_float_areas(struct SoundIoChannelArea *float_areas, float *buffer, int buffer_frame_count,
+        const struct SoundIoChannelArea *device_areas, int channel_count, int bytes_per_sample)
+{
+    bool planar = device_areas[0].step == bytes_per_sample;
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        if (planar) {
+            float_areas[ch].ptr = (char *)(buffer + (size_t)ch * buffer_frame_count);
+            float_areas[ch].step = sizeof(float);
+        } else {
+            float_areas[ch].ptr = (char *)(buffer + ch);
+            float_areas[ch].step = sizeof(float) * channel_count;
+        }
+    }
+}
+
+// Resampling always hands out interleaved areas.
+static void set_interleaved_float_areas(struct SoundIoChannelArea *float_areas, float *buffer,
+        int channel_count)
+{
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        float_areas[ch].ptr = (char *)(buffer + ch);
+        float_areas[ch].step = sizeof(float) * channel_count;
+    }
+}
+
+// Room for twice what the device holds, at the rate of the resampler's
+// input, so that the app can fall behind by a buffer.
+static int create_resampler(struct SoundIoResampler **out_resampler, int channel_count,
+        int in_rate, int out_rate, enum SoundIoResampleQuality quality, double software_latency)
+{
+    int buffer_frame_count = (int)(software_latency * in_rate) + 1;
+    if (software_latency <= 0.0)
+        buffer_frame_count = in_rate;
+    struct SoundIoResampler *rs = ALLOCATE(struct SoundIoResampler, 1);
+    if (!rs)
+        return SoundIoErrorNoMem;
+    int err;
+    if ((err = soundio_resampler_init(rs, channel_count, in_rate, out_rate, quality, 2 * buffer_frame_count))) {
+        free(rs);
+        return err;
+    }
+    *out_resampler = rs;
+    return 0;
+}
+
+static void destroy_resampler(struct SoundIoResampler *rs) {
+    if (!rs)
+        return;
+    soundio_resampler_deinit(rs);
+    free(rs);
+}
+
+// Also allocates room for `frame_count` interleaved frames in the device's
+// layout, which is `to` for output and `from` for input.
+static int create_remix(struct SoundIoRemix **out_remix, float **out_buffer,
+        const struct SoundIoChannelLayout *from, const struct SoundIoChannelLayout *to,
+        int device_channel_count, int frame_count)
+{
+    struct SoundIoRemix *remix = ALLOCATE(struct SoundIoRemix, 1);
+    if (!remix)
+        return SoundIoErrorNoMem;
+    *out_remix = remix;
+    int err;
+    if ((err = soundio_remix_init(remix, from, to)))
+        return err;
+    size_t sample_count = (size_t)frame_count * device_channel_count;
+    float *buffer = ALLOCATE_NONZERO(float, sample_count);
+    if (!buffer)
+        return SoundIoErrorNoMem;
+    memset(buffer, 0, sample_count * sizeof(float));
+    *out_buffer = buffer;
+    return 0;
+}
+
+static void destroy_remix(struct SoundIoRemix *remix) {
+    if (!remix)
+        return;
+    soundio_remix_deinit(remix);
+    free(remix);
+}
+
+// Only for integer formats the float frames are converted to.
+static int create_dither(struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStream *outstream = &os->pub;
+    if (outstream->dither == SoundIoDitherNone || !soundio_dither_wanted(outstream->format))
+        return 0;
+    struct SoundIoDitherer *d = ALLOCATE(struct SoundIoDitherer, 1);
+    if (!d)
+        return SoundIoErrorNoMem;
+    os->dither = d;
+    return soundio_dither_init(d, outstream->dither, outstream->format, outstream->layout.channel_count);
+}
+
+static void destroy_dither(struct SoundIoDitherer *d) {
+    if (!d)
+        return;
+    soundio_dither_deinit(d);
+    free(d);
+}
+
+static bool software_volume_active(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    return !si->outstream_set_volume && soundio_volume_active(&os->volume);
+}
+
+// Everything written to the device goes through these two, so that
+// software volume gets to see it. With dither, the volume has to come
+// first, so outstream_convert_float applies it instead.
+static int device_begin_write(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        struct SoundIoChannelArea **areas, int *frame_count)
+{
+    int err;
+    if ((err = si->outstream_begin_write(si, os, areas, frame_count)))
+        return err;
+    os->volume_frame_count = 0;
+    // The app may move the pointers of the areas as it writes.
+    if (!os->dither && software_volume_active(si, os)) {
+        memcpy(os->volume_areas, *areas, sizeof(struct SoundIoChannelArea) * os->pub.layout.channel_count);
+        os->volume_frame_count = *frame_count;
+    }
+    return 0;
+}
+
+static int device_end_write(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    if (os->volume_frame_count > 0) {
+        soundio_volume_apply(&os->volume, os->pub.format, os->volume_areas, os->pub.layout.channel_count,
+                os->volume_frame_count);
+    }
+    return si->outstream_end_write(si, os);
+}
+
+// Float frames, which are the library's own, on their way to the device.
+static void outstream_convert_float(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        const struct SoundIoChannelArea *device_areas, const struct SoundIoChannelArea *float_areas,
+        int frame_count)
+{
+    struct SoundIoOutStream *outstream = &os->pub;
+    int channel_count = outstream->layout.channel_count;
+    if (os->dither) {
+        if (software_volume_active(si, os)) {
+            soundio_volume_apply(&os->volume, SoundIoFormatFloat32NE, float_areas, channel_count,
+                    frame_count);
+        }
+        soundio_dither_apply(os->dither, float_areas, frame_count);
+    }
+    soundio_convert_samples(outstream->format, device_areas, SoundIoFormatFloat32NE,
+            float_areas, channel_count, frame_count);
+}
+
+// Dither needs the resampled frames in float, so they go through the
+// ditherer's buffer a chunk at a time.
+static void read_resampler_dithered(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        const struct SoundIoChannelArea *areas, int frame_count)
+{
+    int channel_count = os->pub.layout.channel_count;
+    struct SoundIoChannelArea float_areas[SOUNDIO_MAX_CHANNELS];
+    struct SoundIoChannelArea dst[SOUNDIO_MAX_CHANNELS];
+    set_interleaved_float_areas(float_areas, os->dither->buffer, channel_count);
+    memcpy(dst, areas, sizeof(struct SoundIoChannelArea) * channel_count);
+    while (frame_count > 0) {
+        int count = soundio_int_min(frame_count, SOUNDIO_DITHER_CHUNK_SIZE);
+        soundio_resampler_read(os->resampler, SoundIoFormatFloat32NE, float_areas, count);
+        outstream_convert_float(si, os, dst, float_areas, count);
+        for (int ch = 0; ch < channel_count; ch += 1)
+            dst[ch].ptr += count * dst[ch].step;
+        frame_count -= count;
+    }
+}
+
+// Gives the device what the resampler has, up to what is left of what it
+// asked for in the current callback.
+static int outstream_drain_resampler(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStream *outstream = &os->pub;
+    for (;;) {
+        int frame_count = soundio_int_min(soundio_resampler_output_count(os->resampler),
+                os->resample_frames_left);
+        if (frame_count <= 0)
+            return 0;
+        struct SoundIoChannelArea *areas;
+        int err;
+        if ((err = device_begin_write(si, os, &areas, &frame_count)))
+            return err;
+        if (!frame_count)
+            return 0;
+        if (os->dither)
+            read_resampler_dithered(si, os, areas, frame_count);
+        else
+            soundio_resampler_read(os->resampler, outstream->format, areas, frame_count);
+        if ((err = device_end_write(si, os)))
+            return err;
+        os->resample_frames_left -= frame_count;
+    }
+}
+
+// What was left over from last time goes out first. Then the app is asked
+// for as many frames as it takes to fill the rest.
+static void resample_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)outstream->device->soundio;
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    struct SoundIoResampler *rs = os->resampler;
+    if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(os->resampler_keep_flag))
+        soundio_resampler_reset(rs);
+    os->resample_frames_left = frame_count_max;
+    int err;
+    if ((err = outstream_drain_resampler(si, os)) && err != SoundIoErrorUnderflow) {
+        outstream->error_callback(outstream, err);
+        return;
+    }
+    int written = frame_count_max - os->resample_frames_left;
+    int app_max = soundio_int_min(soundio_resampler_input_needed(rs, os->resample_frames_left),
+            soundio_resampler_free_count(rs));
+    int app_min = soundio_int_min(soundio_resampler_input_needed(rs, frame_count_min - written), app_max);
+    if (app_max > 0)
+        os->app_write_callback(outstream, app_min, app_max);
+}
+
+static int outstream_begin_write(struct SoundIoOutStream *outstream,
         struct SoundIoChannelArea **areas, int *frame_count)
 {
     struct SoundIo *soundio = outstream->device->soundio;
@@ -447,14 +695,68 @@ int soundio_outstream_begin_write(struct SoundIoOutStream *outstream,
     struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
     if (*frame_count <= 0)
         return SoundIoErrorInvalid;
-    return si->outstream_begin_write(si, os, areas, frame_count);
+    if (!os->float_buffer)
+        return device_begin_write(si, os, areas, frame_count);
+
+    if (os->resampler) {
+        *frame_count = soundio_int_min(*frame_count, os->float_buffer_frame_count);
+        *frame_count = soundio_int_min(*frame_count, soundio_resampler_free_count(os->resampler));
+        os->float_frame_count = *frame_count;
+        *areas = os->float_areas;
+        return 0;
+    }
+
+    *frame_count = soundio_int_min(*frame_count, os->float_buffer_frame_count);
+    int err;
+    if ((err = device_begin_write(si, os, &os->device_areas, frame_count)))
+        return err;
+    if (!os->remix) {
+        set_float_areas(os->float_areas, os->float_buffer, os->float_buffer_frame_count,
+                os->device_areas, outstream->layout.channel_count, outstream->bytes_per_sample);
+    }
+    os->float_frame_count = *frame_count;
+    *areas = os->float_areas;
+    return 0;
+}
+
+int soundio_outstream_begin_write(struct SoundIoOutStream *outstream,
+        struct SoundIoChannelArea **areas, int *frame_count)
+{
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    int err;
+    if ((err = outstream_begin_write(outstream, areas, frame_count)))
+        return err;
+    // The app may move the pointers of the areas as it writes.
+    if (os->meter_enabled) {
+        memcpy(os->meter_areas, *areas, sizeof(struct SoundIoChannelArea) * os->meter.channel_count);
+        os->meter_frame_count = *frame_count;
+    }
+    return 0;
 }
 
 int soundio_outstream_end_write(struct SoundIoOutStream *outstream) {
     struct SoundIo *soundio = outstream->device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
-    return si->outstream_end_write(si, os);
+    if (os->meter_frame_count > 0) {
+        soundio_meter_run(&os->meter, os->meter_areas, os->meter_frame_count);
+        os->meter_frame_count = 0;
+    }
+    const struct SoundIoChannelArea *float_areas = os->float_areas;
+    if (os->remix && os->float_frame_count > 0) {
+        soundio_remix_run(os->remix, os->remix_buffer, os->float_buffer, os->float_frame_count);
+        float_areas = os->remix_areas;
+    }
+    if (os->resampler) {
+        soundio_resampler_write(os->resampler, SoundIoFormatFloat32NE, float_areas, os->float_frame_count);
+        os->float_frame_count = 0;
+        return outstream_drain_resampler(si, os);
+    }
+    if (os->float_buffer && os->float_frame_count > 0) {
+        outstream_convert_float(si, os, os->device_areas, float_areas, os->float_frame_count);
+        os->float_frame_count = 0;
+    }
+    return device_end_write(si, os);
 }
 
 static void default_outstream_error_callback(struct SoundIoOutStream *os, int err) {
@@ -481,7 +783,13 @@ struct SoundIoOutStream *soundio_outstream_create(struct SoundIoDevice *device)
     return outstream;
 }
 
-int soundio_outstream_open(struct SoundIoOutStream *outstream) {
+// The resampler hands the backend however many frames it has room or data
+// for, which JACK does not accept: it wants the whole period in one go.
+static bool backend_takes_partial_counts(struct SoundIo *soundio) {
+    return soundio->current_backend != SoundIoBackendJack;
+}
+
+static int outstream_open(struct SoundIoOutStream *outstream) {
     struct SoundIoDevice *device = outstream->device;
 
     if (device->aim != SoundIoDeviceAimOutput)
@@ -490,8 +798,11 @@ int soundio_outstream_open(struct SoundIoOutStream *outstream) {
     if (device->probe_error)
         return device->probe_error;
 
-    if (outstream->layout.channel_count > SOUNDIO_MAX_CHANNELS)
+    if (outstream->layout.channel_count > SOUNDIO_MAX_CHANNELS ||
+        outstream->app_layout.channel_count > SOUNDIO_MAX_CHANNELS)
+    {
         return SoundIoErrorInvalid;
+    }
 
     if (outstream->format == SoundIoFormatInvalid) {
         outstream->format = soundio_device_supports_format(device, SoundIoFormatFloat32NE) ?
@@ -501,13 +812,30 @@ int soundio_outstream_open(struct SoundIoOutStream *outstream) {
     if (outstream->format <= SoundIoFormatInvalid)
         return SoundIoErrorInvalid;
 
+    if (!outstream->layout.channel_count && outstream->app_layout.channel_count &&
+        soundio_device_supports_layout(device, &outstream->app_layout))
+    {
+        outstream->layout = outstream->app_layout;
+    }
+
     if (!outstream->layout.channel_count) {
         const struct SoundIoChannelLayout *stereo = soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdStereo);
         outstream->layout = soundio_device_supports_layout(device, stereo) ? *stereo : device->layouts[0];
     }
 
-    if (!outstream->sample_rate)
-        outstream->sample_rate = soundio_device_nearest_sample_rate(device, 48000);
+    if (outstream->app_sample_rate < 0)
+        return SoundIoErrorInvalid;
+
+    if (!outstream->sample_rate) {
+        outstream->sample_rate = soundio_device_nearest_sample_rate(device,
+                outstream->app_sample_rate ? outstream->app_sample_rate : 48000);
+    }
+
+    if (outstream->app_sample_rate && outstream->app_sample_rate != outstream->sample_rate &&
+        !backend_takes_partial_counts(device->soundio))
+    {
+        return SoundIoErrorIncompatibleBackend;
+    }
 
     struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
     outstream->bytes_per_frame = soundio_get_bytes_per_frame(outstream->format, outstream->layout.channel_count);
@@ -515,7 +843,85 @@ int soundio_outstream_open(struct SoundIoOutStream *outstream) {
 
     struct SoundIo *soundio = device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
-    return si->outstream_open(si, os);
+    int err;
+    if ((err = si->outstream_open(si, os)))
+        return err;
+
+    if (!si->outstream_set_volume) {
+        if ((err = soundio_volume_init(&os->volume, outstream->sample_rate, outstream->volume_ramp)))
+            return err;
+        outstream->volume = 1.0f;
+    }
+
+    bool remix = outstream->app_layout.channel_count &&
+        !soundio_channel_layout_equal(&outstream->app_layout, &outstream->layout);
+    bool resample = outstream->app_sample_rate && outstream->app_sample_rate != outstream->sample_rate;
+    if (!remix && !resample) {
+        if (outstream->native_float && outstream->format != SoundIoFormatFloat32NE) {
+            if ((err = alloc_float_buffer(outstream->software_latency, outstream->sample_rate,
+                            outstream->layout.channel_count, &os->float_buffer, &os->float_buffer_frame_count)))
+            {
+                return err;
+            }
+            return create_dither(os);
+        }
+        return 0;
+    }
+
+    // The app writes interleaved float frames in its own layout and rate.
+    int channel_count = outstream->layout.channel_count;
+    int app_channel_count = remix ? outstream->app_layout.channel_count : channel_count;
+    int app_sample_rate = resample ? outstream->app_sample_rate : outstream->sample_rate;
+    if ((err = alloc_float_buffer(outstream->software_latency, app_sample_rate, app_channel_count,
+                    &os->float_buffer, &os->float_buffer_frame_count)))
+    {
+        return err;
+    }
+    set_interleaved_float_areas(os->float_areas, os->float_buffer, app_channel_count);
+    if (remix) {
+        if ((err = create_remix(&os->remix, &os->remix_buffer, &outstream->app_layout, &outstream->layout,
+                        channel_count, os->float_buffer_frame_count)))
+        {
+            return err;
+        }
+        set_interleaved_float_areas(os->remix_areas, os->remix_buffer, channel_count);
+    }
+    if (resample) {
+        if ((err = create_resampler(&os->resampler, channel_count, outstream->app_sample_rate,
+                        outstream->sample_rate, outstream->resample_quality, outstream->software_latency)))
+        {
+            return err;
+        }
+        SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(os->resampler_keep_flag);
+        os->app_write_callback = outstream->write_callback;
+        outstream->write_callback = resample_write_callback;
+    }
+    return create_dither(os);
+}
+
+// Measures what the app sees, in its own format, layout and rate.
+static int meter_window_frame_count(double meter_window, int sample_rate) {
+    if (meter_window == 0.0)
+        meter_window = 0.05;
+    return (int)(meter_window * sample_rate + 0.5);
+}
+
+int soundio_outstream_open(struct SoundIoOutStream *outstream) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    if (outstream->meter_window < 0.0)
+        return SoundIoErrorInvalid;
+    int err;
+    if ((err = outstream_open(outstream)))
+        return err;
+    if (outstream->metering) {
+        enum SoundIoFormat format = os->float_buffer ? SoundIoFormatFloat32NE : outstream->format;
+        int channel_count = os->remix ? outstream->app_layout.channel_count : outstream->layout.channel_count;
+        int sample_rate = os->resampler ? outstream->app_sample_rate : outstream->sample_rate;
+        soundio_meter_init(&os->meter, format, channel_count,
+                meter_window_frame_count(outstream->meter_window, sample_rate));
+        os->meter_enabled = true;
+    }
+    return 0;
 }
 
 void soundio_outstream_destroy(struct SoundIoOutStream *outstream) {
@@ -529,6 +935,11 @@ void soundio_outstream_destroy(struct SoundIoOutStream *outstream) {
     if (si->outstream_destroy)
         si->outstream_destroy(si, os);
 
+    destroy_resampler(os->resampler);
+    destroy_remix(os->remix);
+    destroy_dither(os->dither);
+    free(os->remix_buffer);
+    free(os->float_buffer);
     soundio_device_unref(outstream->device);
     free(os);
 }
@@ -551,21 +962,57 @@ int soundio_outstream_clear_buffer(struct SoundIoOutStream *outstream) {
     struct SoundIo *soundio = outstream->device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
-    return si->outstream_clear_buffer(si, os);
+    int err;
+    if ((err = si->outstream_clear_buffer(si, os)))
+        return err;
+    if (os->resampler)
+        SOUNDIO_ATOMIC_FLAG_CLEAR(os->resampler_keep_flag);
+    return 0;
 }
 
 int soundio_outstream_get_latency(struct SoundIoOutStream *outstream, double *out_latency) {
     struct SoundIo *soundio = outstream->device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
-    return si->outstream_get_latency(si, os, out_latency);
+    int err;
+    if ((err = si->outstream_get_latency(si, os, out_latency)))
+        return err;
+    if (os->resampler)
+        *out_latency += soundio_resampler_delay(os->resampler) / outstream->app_sample_rate;
+    return 0;
 }
 
 int soundio_outstream_set_volume(struct SoundIoOutStream *outstream, double volume) {
     struct SoundIo *soundio = outstream->device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
-    return si->outstream_set_volume(si, os, volume);
+    if (si->outstream_set_volume)
+        return si->outstream_set_volume(si, os, volume);
+
+    if (!(volume >= 0.0 && volume <= 1.0))
+        return SoundIoErrorInvalid;
+    soundio_volume_set(&os->volume, (float)volume);
+    outstream->volume = (float)volume;
+    return 0;
+}
+
+int soundio_outstream_get_page_faults(struct SoundIoOutStream *outstream,
+        long *out_minor_faults, long *out_major_faults)
+{
+    struct SoundIo *soundio = outstream->device->soundio;
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    if (!si->outstream_get_page_faults)
+        return SoundIoErrorIncompatibleBackend;
+    return si->outstream_get_page_faults(si, os, out_minor_faults, out_major_faults);
+}
+
+int soundio_outstream_get_meters(struct SoundIoOutStream *outstream, struct SoundIoMeters *out_meters) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    if (!os->meter_enabled)
+        return SoundIoErrorInvalid;
+    soundio_meter_read(&os->meter, out_meters);
+    return 0;
 }
 
 static void default_instream_error_callback(struct SoundIoInStream *is, int err) {
@@ -592,7 +1039,43 @@ struct SoundIoInStream *soundio_instream_create(struct SoundIoDevice *device) {
     return instream;
 }
 
-int soundio_instream_open(struct SoundIoInStream *instream) {
+// Everything the device has goes into the resampler, and then the app is
+// asked to take out what that makes.
+static void resample_read_callback(struct SoundIoInStream *instream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)instream->device->soundio;
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    struct SoundIoResampler *rs = is->resampler;
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        int frame_count = soundio_int_min(frames_left, soundio_resampler_free_count(rs));
+        if (frame_count <= 0)
+            break;
+        struct SoundIoChannelArea *areas;
+        int err;
+        if ((err = si->instream_begin_read(si, is, &areas, &frame_count))) {
+            instream->error_callback(instream, err);
+            return;
+        }
+        if (!frame_count)
+            break;
+        if (areas)
+            soundio_resampler_write(rs, instream->format, areas, frame_count);
+        else
+            soundio_resampler_write_silence(rs, frame_count);
+        if ((err = si->instream_end_read(si, is))) {
+            instream->error_callback(instream, err);
+            return;
+        }
+        frames_left -= frame_count;
+    }
+    int output_count = soundio_resampler_output_count(rs);
+    if (output_count > 0)
+        is->app_read_callback(instream, (frame_count_min > 0) ? output_count : 0, output_count);
+}
+
+static int instream_open(struct SoundIoInStream *instream) {
     struct SoundIoDevice *device = instream->device;
     if (device->aim != SoundIoDeviceAimInput)
         return SoundIoErrorInvalid;
@@ -600,8 +1083,11 @@ int soundio_instream_open(struct SoundIoInStream *instream) {
     if (instream->format <= SoundIoFormatInvalid)
         return SoundIoErrorInvalid;
 
-    if (instream->layout.channel_count > SOUNDIO_MAX_CHANNELS)
+    if (instream->layout.channel_count > SOUNDIO_MAX_CHANNELS ||
+        instream->app_layout.channel_count > SOUNDIO_MAX_CHANNELS)
+    {
         return SoundIoErrorInvalid;
+    }
 
     if (device->probe_error)
         return device->probe_error;
@@ -611,13 +1097,30 @@ int soundio_instream_open(struct SoundIoInStream *instream) {
             SoundIoFormatFloat32NE : device->formats[0];
     }
 
+    if (!instream->layout.channel_count && instream->app_layout.channel_count &&
+        soundio_device_supports_layout(device, &instream->app_layout))
+    {
+        instream->layout = instream->app_layout;
+    }
+
     if (!instream->layout.channel_count) {
         const struct SoundIoChannelLayout *stereo = soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdStereo);
         instream->layout = soundio_device_supports_layout(device, stereo) ? *stereo : device->layouts[0];
     }
 
-    if (!instream->sample_rate)
-        instream->sample_rate = soundio_device_nearest_sample_rate(device, 48000);
+    if (instream->app_sample_rate < 0)
+        return SoundIoErrorInvalid;
+
+    if (!instream->sample_rate) {
+        instream->sample_rate = soundio_device_nearest_sample_rate(device,
+                instream->app_sample_rate ? instream->app_sample_rate : 48000);
+    }
+
+    if (instream->app_sample_rate && instream->app_sample_rate != instream->sample_rate &&
+        !backend_takes_partial_counts(device->soundio))
+    {
+        return SoundIoErrorIncompatibleBackend;
+    }
 
 
     instream->bytes_per_frame = soundio_get_bytes_per_frame(instream->format, instream->layout.channel_count);
@@ -625,7 +1128,49 @@ int soundio_instream_open(struct SoundIoInStream *instream) {
     struct SoundIo *soundio = device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
-    return si->instream_open(si, is);
+    int err;
+    if ((err = si->instream_open(si, is)))
+        return err;
+
+    bool remix = instream->app_layout.channel_count &&
+        !soundio_channel_layout_equal(&instream->app_layout, &instream->layout);
+    bool resample = instream->app_sample_rate && instream->app_sample_rate != instream->sample_rate;
+    if (!remix && !resample) {
+        if (instream->native_float && instream->format != SoundIoFormatFloat32NE) {
+            return alloc_float_buffer(instream->software_latency, instream->sample_rate,
+                    instream->layout.channel_count, &is->float_buffer, &is->float_buffer_frame_count);
+        }
+        return 0;
+    }
+
+    // The app reads interleaved float frames in its own layout and rate.
+    int channel_count = instream->layout.channel_count;
+    int app_channel_count = remix ? instream->app_layout.channel_count : channel_count;
+    int app_sample_rate = resample ? instream->app_sample_rate : instream->sample_rate;
+    if ((err = alloc_float_buffer(instream->software_latency, app_sample_rate, app_channel_count,
+                    &is->float_buffer, &is->float_buffer_frame_count)))
+    {
+        return err;
+    }
+    set_interleaved_float_areas(is->float_areas, is->float_buffer, app_channel_count);
+    if (remix) {
+        if ((err = create_remix(&is->remix, &is->remix_buffer, &instream->layout, &instream->app_layout,
+                        channel_count, is->float_buffer_frame_count)))
+        {
+            return err;
+        }
+        set_interleaved_float_areas(is->remix_areas, is->remix_buffer, channel_count);
+    }
+    if (resample) {
+        if ((err = create_resampler(&is->resampler, channel_count, instream->sample_rate,
+                        instream->app_sample_rate, instream->resample_quality, instream->software_latency)))
+        {
+            return err;
+        }
+        is->app_read_callback = instream->read_callback;
+        instream->read_callback = resample_read_callback;
+    }
+    return 0;
 }
 
 int soundio_instream_start(struct SoundIoInStream *instream) {
@@ -635,6 +1180,24 @@ int soundio_instream_start(struct SoundIoInStream *instream) {
     return si->instream_start(si, is);
 }
 
+int soundio_instream_open(struct SoundIoInStream *instream) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    if (instream->meter_window < 0.0)
+        return SoundIoErrorInvalid;
+    int err;
+    if ((err = instream_open(instream)))
+        return err;
+    if (instream->metering) {
+        enum SoundIoFormat format = is->float_buffer ? SoundIoFormatFloat32NE : instream->format;
+        int channel_count = is->remix ? instream->app_layout.channel_count : instream->layout.channel_count;
+        int sample_rate = is->resampler ? instream->app_sample_rate : instream->sample_rate;
+        soundio_meter_init(&is->meter, format, channel_count,
+                meter_window_frame_count(instream->meter_window, sample_rate));
+        is->meter_enabled = true;
+    }
+    return 0;
+}
+
 void soundio_instream_destroy(struct SoundIoInStream *instream) {
     if (!instream)
         return;
@@ -646,6 +1209,10 @@ void soundio_instream_destroy(struct SoundIoInStream *instream) {
     if (si->instream_destroy)
         si->instream_destroy(si, is);
 
+    destroy_resampler(is->resampler);
+    destroy_remix(is->remix);
+    free(is->remix_buffer);
+    free(is->float_buffer);
     soundio_device_unref(instream->device);
     free(is);
 }
@@ -657,19 +1224,79 @@ int soundio_instream_pause(struct SoundIoInStream *instream, bool pause) {
     return si->instream_pause(si, is, pause);
 }
 
-int soundio_instream_begin_read(struct SoundIoInStream *instream,
+static int instream_begin_read(struct SoundIoInStream *instream,
         struct SoundIoChannelArea **areas, int *frame_count)
 {
     struct SoundIo *soundio = instream->device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
-    return si->instream_begin_read(si, is, areas, frame_count);
+    if (!is->float_buffer)
+        return si->instream_begin_read(si, is, areas, frame_count);
+
+    // When remixing, float frames in the device's layout go to remix_buffer
+    // first.
+    struct SoundIoChannelArea *float_areas = is->remix ? is->remix_areas : is->float_areas;
+    if (is->resampler) {
+        *frame_count = soundio_int_min(*frame_count, is->float_buffer_frame_count);
+        *frame_count = soundio_int_min(*frame_count, soundio_resampler_output_count(is->resampler));
+        if (*frame_count > 0) {
+            soundio_resampler_read(is->resampler, SoundIoFormatFloat32NE, float_areas, *frame_count);
+            if (is->remix)
+                soundio_remix_run(is->remix, is->float_buffer, is->remix_buffer, *frame_count);
+        }
+        *areas = is->float_areas;
+        return 0;
+    }
+
+    *frame_count = soundio_int_min(*frame_count, is->float_buffer_frame_count);
+    struct SoundIoChannelArea *device_areas;
+    int err;
+    if ((err = si->instream_begin_read(si, is, &device_areas, frame_count)))
+        return err;
+    // A hole in the buffer stays a hole.
+    if (!device_areas) {
+        *areas = NULL;
+        return 0;
+    }
+    if (!is->remix) {
+        set_float_areas(is->float_areas, is->float_buffer, is->float_buffer_frame_count,
+                device_areas, instream->layout.channel_count, instream->bytes_per_sample);
+    }
+    soundio_convert_samples(SoundIoFormatFloat32NE, float_areas, instream->format,
+            device_areas, instream->layout.channel_count, *frame_count);
+    if (is->remix)
+        soundio_remix_run(is->remix, is->float_buffer, is->remix_buffer, *frame_count);
+    *areas = is->float_areas;
+    return 0;
+}
+
+int soundio_instream_begin_read(struct SoundIoInStream *instream,
+        struct SoundIoChannelArea **areas, int *frame_count)
+{
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    int err;
+    if ((err = instream_begin_read(instream, areas, frame_count)))
+        return err;
+    if (is->meter_enabled) {
+        is->meter_hole = !*areas;
+        if (*areas)
+            memcpy(is->meter_areas, *areas, sizeof(struct SoundIoChannelArea) * is->meter.channel_count);
+        is->meter_frame_count = *frame_count;
+    }
+    return 0;
 }
 
 int soundio_instream_end_read(struct SoundIoInStream *instream) {
     struct SoundIo *soundio = instream->device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    if (is->meter_frame_count > 0) {
+        soundio_meter_run(&is->meter, is->meter_hole ? NULL : is->meter_areas, is->meter_frame_count);
+        is->meter_frame_count = 0;
+    }
+    // begin_read already took the frames out of the resampler.
+    if (is->resampler)
+        return 0;
     return si->instream_end_read(si, is);
 }
 
@@ -677,7 +1304,31 @@ int soundio_instream_get_latency(struct SoundIoInStream *instream, double *out_l
     struct SoundIo *soundio = instream->device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
-    return si->instream_get_latency(si, is, out_latency);
+    int err;
+    if ((err = si->instream_get_latency(si, is, out_latency)))
+        return err;
+    if (is->resampler)
+        *out_latency += soundio_resampler_delay(is->resampler) / instream->sample_rate;
+    return 0;
+}
+
+int soundio_instream_get_page_faults(struct SoundIoInStream *instream,
+        long *out_minor_faults, long *out_major_faults)
+{
+    struct SoundIo *soundio = instream->device->soundio;
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    if (!si->instream_get_page_faults)
+        return SoundIoErrorIncompatibleBackend;
+    return si->instream_get_page_faults(si, is, out_minor_faults, out_major_faults);
+}
+
+int soundio_instream_get_meters(struct SoundIoInStream *instream, struct SoundIoMeters *out_meters) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    if (!is->meter_enabled)
+        return SoundIoErrorInvalid;
+    soundio_meter_read(&is->meter, out_meters);
+    return 0;
 }
 
 void soundio_destroy_devices_info(struct SoundIoDevicesInfo *devices_info) {
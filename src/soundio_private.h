@@ -11,6 +11,11 @@
 #include "soundio_internal.h"
 #include "config.h"
 #include "list.h"
+#include "resampler.h"
+#include "remix.h"
+#include "volume.h"
+#include "dither.h"
+#include "meter.h"
 
 #ifdef SOUNDIO_HAVE_JACK
 #include "jack.h"
@@ -124,11 +129,81 @@ struct SoundIoDevicesInfo {
 struct SoundIoOutStreamPrivate {
     struct SoundIoOutStream pub;
     union SoundIoOutStreamBackendData backend_data;
+
+    // SoundIoOutStream::native_float, if the device format is something
+    // else. The callback writes to float_areas, which point into
+    // float_buffer, and end_write converts to device_areas.
+    float *float_buffer;
+    int float_buffer_frame_count;
+    struct SoundIoChannelArea float_areas[SOUNDIO_MAX_CHANNELS];
+    struct SoundIoChannelArea *device_areas;
+    int float_frame_count;
+
+    // SoundIoOutStream::app_sample_rate. The callback writes to
+    // float_buffer, end_write resamples as much as the device asked for in
+    // its callback, and write_callback is swapped for one that feeds the
+    // device before asking the app for more.
+    struct SoundIoResampler *resampler;
+    void (*app_write_callback)(struct SoundIoOutStream *, int frame_count_min, int frame_count_max);
+    int resample_frames_left;
+    // Cleared by soundio_outstream_clear_buffer. The write callback resets
+    // the resampler the next time it runs.
+    struct SoundIoAtomicFlag resampler_keep_flag;
+
+    // SoundIoOutStream::app_layout. end_write mixes float_buffer into
+    // remix_buffer, which is in the device's layout, and takes it from there.
+    struct SoundIoRemix *remix;
+    float *remix_buffer;
+    struct SoundIoChannelArea remix_areas[SOUNDIO_MAX_CHANNELS];
+
+    // For backends without outstream_set_volume. While the gain is not
+    // unity, begin_write keeps a copy of the device's areas, and end_write
+    // scales them before handing them to the backend.
+    struct SoundIoVolume volume;
+    struct SoundIoChannelArea volume_areas[SOUNDIO_MAX_CHANNELS];
+    int volume_frame_count;
+
+    // Only when float frames are converted to an integer format and
+    // SoundIoOutStream::dither asks for it.
+    struct SoundIoDitherer *dither;
+
+    // SoundIoOutStream::metering. begin_write keeps a copy of the app's
+    // areas, which end_write measures.
+    bool meter_enabled;
+    struct SoundIoMeter meter;
+    struct SoundIoChannelArea meter_areas[SOUNDIO_MAX_CHANNELS];
+    int meter_frame_count;
 };
 
 struct SoundIoInStreamPrivate {
     struct SoundIoInStream pub;
     union SoundIoInStreamBackendData backend_data;
+
+    // SoundIoInStream::native_float, if the device format is something
+    // else. begin_read converts from the device into float_buffer.
+    float *float_buffer;
+    int float_buffer_frame_count;
+    struct SoundIoChannelArea float_areas[SOUNDIO_MAX_CHANNELS];
+
+    // SoundIoInStream::app_sample_rate. read_callback is swapped for one that
+    // reads everything the device has into the resampler before asking the
+    // app to take it out.
+    struct SoundIoResampler *resampler;
+    void (*app_read_callback)(struct SoundIoInStream *, int frame_count_min, int frame_count_max);
+
+    // SoundIoInStream::app_layout. begin_read gets device frames into
+    // remix_buffer and mixes them into float_buffer.
+    struct SoundIoRemix *remix;
+    float *remix_buffer;
+    struct SoundIoChannelArea remix_areas[SOUNDIO_MAX_CHANNELS];
+
+    // SoundIoInStream::metering. begin_read keeps a copy of the areas, or
+    // that they were a hole, which end_read measures.
+    bool meter_enabled;
+    bool meter_hole;
+    struct SoundIoMeter meter;
+    struct SoundIoChannelArea meter_areas[SOUNDIO_MAX_CHANNELS];
+    int meter_frame_count;
 };
 
 struct SoundIoPrivate {
@@ -153,6 +228,8 @@ struct SoundIoPrivate {
     int (*outstream_pause)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *, bool pause);
     int (*outstream_get_latency)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *, double *out_latency);
     int (*outstream_set_volume)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *, float volume);
+    int (*outstream_get_page_faults)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *,
+            long *out_minor_faults, long *out_major_faults);
 
     int (*instream_open)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *);
     void (*instream_destroy)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *);
@@ -162,6 +239,8 @@ struct SoundIoPrivate {
     int (*instream_end_read)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *);
     int (*instream_pause)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *, bool pause);
     int (*instream_get_latency)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *, double *out_latency);
+    int (*instream_get_page_faults)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *,
+            long *out_minor_faults, long *out_major_faults);
 
     union SoundIoBackendData backend_data;
 };
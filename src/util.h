@@ -27,12 +27,14 @@
 #define SOUNDIO_ATTR_FORMAT(...)
 #define SOUNDIO_ATTR_UNUSED __pragma(warning(suppress:4100))
 #define SOUNDIO_ATTR_WARN_UNUSED_RESULT _Check_return_
+#define SOUNDIO_ATTR_NOINLINE __declspec(noinline)
 #else
 #define SOUNDIO_ATTR_COLD __attribute__((cold))
 #define SOUNDIO_ATTR_NORETURN __attribute__((noreturn))
 #define SOUNDIO_ATTR_FORMAT(...) __attribute__((format(__VA_ARGS__)))
 #define SOUNDIO_ATTR_UNUSED __attribute__((unused))
 #define SOUNDIO_ATTR_WARN_UNUSED_RESULT __attribute__((warn_unused_result))
+#define SOUNDIO_ATTR_NOINLINE __attribute__((noinline))
 #endif
 
 
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "volume.h"
+#include "convert.h"
+#include "util.h"
+
+#include <string.h>
+#include <math.h>
+
+// Long enough not to click, short enough to feel immediate.
+#define VOLUME_RAMP_TIME 0.01
+// -60 dB. Exponential ramps cannot reach 0, so they start and end here
+// instead.
+#define VOLUME_RAMP_FLOOR 0.001f
+// Frames other formats are converted through float in.
+#define VOLUME_CHUNK_SIZE 256
+
+typedef void (*ScaleRun)(float *samples, size_t count, float gain);
+
+static void scale_run_scalar(float *samples, size_t count, float gain) {
+    for (size_t i = 0; i < count; i += 1)
+        samples[i] *= gain;
+}
+
+#if defined(SOUNDIO_SIMD_X86)
+
+SOUNDIO_TARGET_SSE2
+static void scale_run_sse2(float *samples, size_t count, float gain) {
+    __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+        _mm_storeu_ps(samples + i + 4, _mm_mul_ps(_mm_loadu_ps(samples + i + 4), g));
+    }
+    scale_run_scalar(samples + i, count - i, gain);
+}
+
+SOUNDIO_TARGET_AVX2
+static void scale_run_avx2(float *samples, size_t count, float gain) {
+    __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), g));
+        _mm256_storeu_ps(samples + i + 8, _mm256_mul_ps(_mm256_loadu_ps(samples + i + 8), g));
+    }
+    _mm256_zeroupper();
+    scale_run_scalar(samples + i, count - i, gain);
+}
+
+#endif
+
+// Indexed by SoundIoSimdLevel.
+static const ScaleRun scale_runs[] = {
+    scale_run_scalar,
+#if defined(SOUNDIO_SIMD_X86)
+    scale_run_sse2,
+    scale_run_avx2,
+#endif
+};
+
+static float load_target(struct SoundIoVolume *volume) {
+    int bits = SOUNDIO_ATOMIC_LOAD_RELAXED(volume->target_bits);
+    float gain;
+    memcpy(&gain, &bits, sizeof(float));
+    return gain;
+}
+
+int soundio_volume_init(struct SoundIoVolume *volume, int sample_rate, enum SoundIoVolumeRamp ramp) {
+    if ((int)ramp < SoundIoVolumeRampLinear || (int)ramp > SoundIoVolumeRampExponential)
+        return SoundIoErrorInvalid;
+    soundio_volume_set(volume, 1.0f);
+    volume->ramp = ramp;
+    volume->gain = 1.0f;
+    volume->ramp_target = 1.0f;
+    volume->ramp_step = 0.0f;
+    volume->ramp_ratio = 1.0f;
+    volume->ramp_frames_left = 0;
+    volume->ramp_frame_count = soundio_int_max((int)(sample_rate * VOLUME_RAMP_TIME), 1);
+    return 0;
+}
+
+void soundio_volume_set(struct SoundIoVolume *volume, float gain) {
+    int bits;
+    memcpy(&bits, &gain, sizeof(float));
+    SOUNDIO_ATOMIC_STORE_RELAXED(volume->target_bits, bits);
+}
+
+bool soundio_volume_active(struct SoundIoVolume *volume) {
+    return volume->gain != 1.0f || volume->ramp_frames_left > 0 || load_target(volume) != 1.0f;
+}
+
+// The gain `frame_count` frames into a ramp.
+static float ramp_gain(float gain, float step, float ratio, int frame_count) {
+    return gain * powf(ratio, frame_count) + step * frame_count;
+}
+
+// `samples` is `frame_count` frames of `stride` floats, of which the
+// first `channel_count` are scaled.
+static void scale_frames(float *samples, int stride, int channel_count, int frame_count,
+        float gain, float step, float ratio)
+{
+    if (step == 0.0f && ratio == 1.0f && stride == channel_count) {
+        scale_runs[soundio_convert_get_simd_level()](samples, (size_t)frame_count * stride, gain);
+        return;
+    }
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        for (int ch = 0; ch < channel_count; ch += 1)
+            samples[ch] *= gain;
+        samples += stride;
+        gain = gain * ratio + step;
+    }
+}
+
+// Float samples are scaled where they are, anything else goes through float
+// a chunk at a time.
+static void scale_areas(enum SoundIoFormat format, const struct SoundIoChannelArea *areas,
+        int channel_count, int frame_count, float gain, float step, float ratio)
+{
+    if (format == SoundIoFormatFloat32NE && soundio_channel_areas_interleaved(areas, channel_count, sizeof(float))) {
+        scale_frames((float *)areas[0].ptr, channel_count, channel_count, frame_count, gain, step, ratio);
+        return;
+    }
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        struct SoundIoChannelArea area = areas[ch];
+        if (format == SoundIoFormatFloat32NE && area.step % sizeof(float) == 0) {
+            scale_frames((float *)area.ptr, area.step / sizeof(float), 1, frame_count, gain, step, ratio);
+            continue;
+        }
+        float chunk[VOLUME_CHUNK_SIZE];
+        struct SoundIoChannelArea chunk_area = {(char *)chunk, sizeof(float)};
+        float chunk_gain = gain;
+        for (int start = 0; start < frame_count; start += VOLUME_CHUNK_SIZE) {
+            int count = soundio_int_min(frame_count - start, VOLUME_CHUNK_SIZE);
+            soundio_convert_samples(SoundIoFormatFloat32NE, &chunk_area, format, &area, 1, count);
+            scale_frames(chunk, 1, 1, count, chunk_gain, step, ratio);
+            soundio_convert_samples(format, &area, SoundIoFormatFloat32NE, &chunk_area, 1, count);
+            area.ptr += count * area.step;
+            chunk_gain = ramp_gain(chunk_gain, step, ratio, count);
+        }
+    }
+}
+
+static void start_ramp(struct SoundIoVolume *volume, float target) {
+    volume->ramp_target = target;
+    volume->ramp_frames_left = volume->ramp_frame_count;
+    if (volume->ramp == SoundIoVolumeRampExponential) {
+        float from = fmaxf(volume->gain, VOLUME_RAMP_FLOOR);
+        float to = fmaxf(target, VOLUME_RAMP_FLOOR);
+        volume->gain = from;
+        volume->ramp_step = 0.0f;
+        volume->ramp_ratio = powf(to / from, 1.0f / volume->ramp_frame_count);
+    } else {
+        volume->ramp_step = (target - volume->gain) / volume->ramp_frame_count;
+        volume->ramp_ratio = 1.0f;
+    }
+}
+
+void soundio_volume_apply(struct SoundIoVolume *volume, enum SoundIoFormat format,
+        const struct SoundIoChannelArea *areas, int channel_count, int frame_count)
+{
+    float target = load_target(volume);
+    if (target != volume->ramp_target)
+        start_ramp(volume, target);
+
+    struct SoundIoChannelArea rest[SOUNDIO_MAX_CHANNELS];
+    memcpy(rest, areas, sizeof(struct SoundIoChannelArea) * channel_count);
+    if (volume->ramp_frames_left > 0) {
+        int count = soundio_int_min(frame_count, volume->ramp_frames_left);
+        scale_areas(format, rest, channel_count, count, volume->gain, volume->ramp_step, volume->ramp_ratio);
+        volume->ramp_frames_left -= count;
+        volume->gain = (volume->ramp_frames_left > 0) ?
+            ramp_gain(volume->gain, volume->ramp_step, volume->ramp_ratio, count) : target;
+        for (int ch = 0; ch < channel_count; ch += 1)
+            rest[ch].ptr += count * rest[ch].step;
+        frame_count -= count;
+    }
+    if (frame_count > 0 && volume->gain != 1.0f)
+        scale_areas(format, rest, channel_count, frame_count, volume->gain, 0.0f, 1.0f);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_VOLUME_H
+#define SOUNDIO_VOLUME_H
+
+#include "soundio_internal.h"
+#include "atomics.h"
+
+#include <stdbool.h>
+
+// Software gain on what goes to the device, for backends without volume of
+// their own. Any thread sets the target. The write callback moves towards it
+// with a short linear or exponential ramp, so that changes do not click.
+struct SoundIoVolume {
+    // The float target gain, stored as its bits.
+    struct SoundIoAtomicInt target_bits;
+    enum SoundIoVolumeRamp ramp;
+
+    // Write callback only. Each frame of a ramp the gain is multiplied by
+    // ramp_ratio and then ramp_step is added.
+    float gain;
+    float ramp_target;
+    float ramp_step;
+    float ramp_ratio;
+    int ramp_frames_left;
+    int ramp_frame_count;
+};
+
+int soundio_volume_init(struct SoundIoVolume *volume, int sample_rate, enum SoundIoVolumeRamp ramp);
+// Safe to call from any thread.
+void soundio_volume_set(struct SoundIoVolume *volume, float gain);
+
+// Whether soundio_volume_apply would do anything. False at unity gain, so
+// that it costs nothing.
+bool soundio_volume_active(struct SoundIoVolume *volume);
+void soundio_volume_apply(struct SoundIoVolume *volume, enum SoundIoFormat format,
+        const struct SoundIoChannelArea *areas, int channel_count, int frame_count);
+
+#endif
@@ -55,7 +55,7 @@ int main(int argc, char **argv) {
             } else if (strcmp(arg, "--timeout") == 0) {
                 timeout = atoi(argv[i]);
             } else if (strcmp(arg, "--backend") == 0) {
-                if (strcmp("-dummy", argv[i]) == 0) {
+                if (strcmp("dummy", argv[i]) == 0) {
                     backend = SoundIoBackendDummy;
                 } else if (strcmp("alsa", argv[i]) == 0) {
                     backend = SoundIoBackendAlsa;
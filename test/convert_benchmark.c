@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "soundio_private.h"
+#include "convert.h"
+#include "os.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int usage(char *exe) {
+    fprintf(stderr, "Usage: %s [--seconds seconds] [--frames count]\n", exe);
+    return 1;
+}
+
+static const char *level_names[] = {
+    "scalar",
+    "sse2",
+    "avx2",
+};
+
+struct Conversion {
+    enum SoundIoFormat src;
+    enum SoundIoFormat dst;
+    enum SoundIoDither dither;
+};
+
+static const char *dither_names[] = {
+    "",
+    " tpdf",
+    " shaped",
+};
+
+static const struct Conversion conversions[] = {
+    {SoundIoFormatFloat32NE, SoundIoFormatS16NE},
+    {SoundIoFormatFloat32NE, SoundIoFormatS16NE, SoundIoDitherTpdf},
+    {SoundIoFormatFloat32NE, SoundIoFormatS16NE, SoundIoDitherShaped},
+    {SoundIoFormatS16NE, SoundIoFormatFloat32NE},
+    {SoundIoFormatFloat32NE, SoundIoFormatS16FE},
+    {SoundIoFormatFloat32NE, SoundIoFormatS24NE},
+    {SoundIoFormatS24NE, SoundIoFormatFloat32NE},
+    {SoundIoFormatFloat32NE, SoundIoFormatS24PackedNE},
+    {SoundIoFormatS24PackedNE, SoundIoFormatFloat32NE},
+    {SoundIoFormatFloat32NE, SoundIoFormatS32NE},
+    {SoundIoFormatS32FE, SoundIoFormatFloat32NE},
+    {SoundIoFormatFloat32NE, SoundIoFormatU8},
+    {SoundIoFormatU8, SoundIoFormatFloat32NE},
+    {SoundIoFormatFloat64NE, SoundIoFormatS32NE},
+    {SoundIoFormatS16NE, SoundIoFormatFloat64NE},
+};
+
+static const int channel_count = 2;
+
+// Samples per second, converting interleaved buffers of `frame_count`
+// frames over and over for `seconds`. Dither goes into `src` each time, as
+// it does into the float buffer of a stream.
+static double measure(const struct Conversion *conversion, char *src, char *dst,
+        int frame_count, double seconds)
+{
+    struct SoundIoChannelArea src_areas[2];
+    struct SoundIoChannelArea dst_areas[2];
+    int src_bytes = soundio_get_bytes_per_sample(conversion->src);
+    int dst_bytes = soundio_get_bytes_per_sample(conversion->dst);
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        src_areas[ch].ptr = src + ch * src_bytes;
+        src_areas[ch].step = channel_count * src_bytes;
+        dst_areas[ch].ptr = dst + ch * dst_bytes;
+        dst_areas[ch].step = channel_count * dst_bytes;
+    }
+
+    struct SoundIoDitherer dither;
+    int err;
+    if ((err = soundio_dither_init(&dither, conversion->dither, conversion->dst, channel_count)))
+        soundio_panic("%s", soundio_strerror(err));
+
+    long iterations = 0;
+    double start = soundio_os_get_time();
+    double elapsed;
+    do {
+        for (int i = 0; i < 16; i += 1) {
+            soundio_dither_apply(&dither, src_areas, frame_count);
+            err = soundio_convert_samples(conversion->dst, dst_areas,
+                    conversion->src, src_areas, channel_count, frame_count);
+            if (err)
+                soundio_panic("%s", soundio_strerror(err));
+        }
+        iterations += 16;
+        elapsed = soundio_os_get_time() - start;
+    } while (elapsed < seconds);
+
+    soundio_dither_deinit(&dither);
+    return (double)iterations * frame_count * channel_count / elapsed;
+}
+
+int main(int argc, char **argv) {
+    char *exe = argv[0];
+    double seconds = 0.25;
+    int frame_count = 4096;
+    for (int i = 1; i < argc; i += 1) {
+        char *arg = argv[i];
+        if (arg[0] == '-' && arg[1] == '-') {
+            i += 1;
+            if (i >= argc) {
+                return usage(exe);
+            } else if (strcmp(arg, "--seconds") == 0) {
+                seconds = atof(argv[i]);
+            } else if (strcmp(arg, "--frames") == 0) {
+                frame_count = atoi(argv[i]);
+            } else {
+                return usage(exe);
+            }
+        } else {
+            return usage(exe);
+        }
+    }
+    if (seconds <= 0.0 || frame_count <= 0)
+        return usage(exe);
+
+    int err;
+    if ((err = soundio_os_init()))
+        soundio_panic("%s", soundio_strerror(err));
+
+    // Room for the widest format. Filled with sensible data for every format
+    // by converting from float.
+    size_t sample_count = (size_t)frame_count * channel_count;
+    char *src = ALLOCATE(char, sample_count * 8);
+    char *dst = ALLOCATE(char, sample_count * 8);
+    float *noise = ALLOCATE(float, sample_count);
+    if (!src || !dst || !noise)
+        soundio_panic("out of memory");
+    unsigned seed = 1;
+    for (size_t i = 0; i < sample_count; i += 1) {
+        seed = seed * 1103515245 + 12345;
+        noise[i] = (float)((seed >> 8) & 0xffff) / 32768.0f - 1.0f;
+    }
+
+    enum SoundIoSimdLevel best = soundio_convert_detect_simd_level();
+    fprintf(stderr, "Msamples/s, %d frames of %d interleaved channels\n", frame_count, channel_count);
+    fprintf(stderr, "%-44s", "");
+    for (int level = 0; level <= (int)best; level += 1)
+        fprintf(stderr, "%10s", level_names[level]);
+    fprintf(stderr, "\n");
+
+    for (size_t i = 0; i < ARRAY_LENGTH(conversions); i += 1) {
+        const struct Conversion *conversion = &conversions[i];
+        struct SoundIoChannelArea noise_area = {(char *)noise, 4};
+        struct SoundIoChannelArea src_area = {src, soundio_get_bytes_per_sample(conversion->src)};
+        if ((err = soundio_convert_samples(conversion->src, &src_area, SoundIoFormatFloat32NE, &noise_area,
+                        1, (int)sample_count)))
+        {
+            soundio_panic("%s", soundio_strerror(err));
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "%s -> %s%s", soundio_format_string(conversion->src),
+                soundio_format_string(conversion->dst), dither_names[conversion->dither]);
+        fprintf(stderr, "%-44s", name);
+        for (int level = 0; level <= (int)best; level += 1) {
+            soundio_convert_set_simd_level((enum SoundIoSimdLevel)level);
+            double rate = measure(conversion, src, dst, frame_count, seconds);
+            fprintf(stderr, "%10.0f", rate / 1000000.0);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    free(noise);
+    free(dst);
+    free(src);
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "soundio_private.h"
+#include "resampler.h"
+#include "convert.h"
+#include "os.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int usage(char *exe) {
+    fprintf(stderr, "Usage: %s [--seconds seconds] [--frames count] [--channels count]\n", exe);
+    return 1;
+}
+
+static const char *level_names[] = {
+    "scalar",
+    "sse2",
+    "avx2",
+};
+
+static const char *quality_names[] = {
+    "default",
+    "low",
+    "medium",
+    "high",
+    "best",
+};
+
+struct Ratio {
+    int in_rate;
+    int out_rate;
+};
+
+static const struct Ratio ratios[] = {
+    {44100, 48000},
+    {48000, 44100},
+    {48000, 96000},
+    {96000, 48000},
+};
+
+// Nanoseconds per output frame, pushing `frame_count` interleaved float
+// input frames through and reading out all that makes, for `seconds`.
+static double measure(struct SoundIoResampler *rs, int channel_count, float *src, float *dst,
+        int frame_count, double seconds)
+{
+    struct SoundIoChannelArea src_areas[SOUNDIO_MAX_CHANNELS];
+    struct SoundIoChannelArea dst_areas[SOUNDIO_MAX_CHANNELS];
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        src_areas[ch].ptr = (char *)(src + ch);
+        src_areas[ch].step = channel_count * sizeof(float);
+        dst_areas[ch].ptr = (char *)(dst + ch);
+        dst_areas[ch].step = channel_count * sizeof(float);
+    }
+
+    long output_frames = 0;
+    double start = soundio_os_get_time();
+    double elapsed;
+    do {
+        for (int i = 0; i < 16; i += 1) {
+            soundio_resampler_write(rs, SoundIoFormatFloat32NE, src_areas, frame_count);
+            int output_count = soundio_resampler_output_count(rs);
+            soundio_resampler_read(rs, SoundIoFormatFloat32NE, dst_areas, output_count);
+            output_frames += output_count;
+        }
+        elapsed = soundio_os_get_time() - start;
+    } while (elapsed < seconds);
+
+    return elapsed * 1000000000.0 / output_frames;
+}
+
+int main(int argc, char **argv) {
+    char *exe = argv[0];
+    double seconds = 0.25;
+    int frame_count = 1024;
+    int channel_count = 2;
+    for (int i = 1; i < argc; i += 1) {
+        char *arg = argv[i];
+        if (arg[0] == '-' && arg[1] == '-') {
+            i += 1;
+            if (i >= argc) {
+                return usage(exe);
+            } else if (strcmp(arg, "--seconds") == 0) {
+                seconds = atof(argv[i]);
+            } else if (strcmp(arg, "--frames") == 0) {
+                frame_count = atoi(argv[i]);
+            } else if (strcmp(arg, "--channels") == 0) {
+                channel_count = atoi(argv[i]);
+            } else {
+                return usage(exe);
+            }
+        } else {
+            return usage(exe);
+        }
+    }
+    if (seconds <= 0.0 || frame_count <= 0 || channel_count <= 0 || channel_count > SOUNDIO_MAX_CHANNELS)
+        return usage(exe);
+
+    int err;
+    if ((err = soundio_os_init()))
+        soundio_panic("%s", soundio_strerror(err));
+
+    // Output is at most twice the input for the ratios above, plus what
+    // was left over in the filter.
+    size_t sample_count = (size_t)frame_count * channel_count;
+    float *src = ALLOCATE(float, sample_count);
+    float *dst = ALLOCATE(float, (sample_count + 64 * channel_count) * 2);
+    if (!src || !dst)
+        soundio_panic("out of memory");
+    unsigned seed = 1;
+    for (size_t i = 0; i < sample_count; i += 1) {
+        seed = seed * 1103515245 + 12345;
+        src[i] = (float)((seed >> 8) & 0xffff) / 32768.0f - 1.0f;
+    }
+
+    enum SoundIoSimdLevel best = soundio_convert_detect_simd_level();
+    fprintf(stderr, "ns/frame, %d frames of %d interleaved channels\n", frame_count, channel_count);
+    for (size_t r = 0; r < ARRAY_LENGTH(ratios); r += 1) {
+        const struct Ratio *ratio = &ratios[r];
+        fprintf(stderr, "%d -> %d\n", ratio->in_rate, ratio->out_rate);
+        for (int quality = SoundIoResampleQualityLow; quality <= SoundIoResampleQualityBest; quality += 1) {
+            fprintf(stderr, "    %-12s", quality_names[quality]);
+            for (int level = 0; level <= (int)best; level += 1) {
+                soundio_convert_set_simd_level((enum SoundIoSimdLevel)level);
+                struct SoundIoResampler rs;
+                if ((err = soundio_resampler_init(&rs, channel_count, ratio->in_rate, ratio->out_rate,
+                                (enum SoundIoResampleQuality)quality, 2 * frame_count)))
+                {
+                    soundio_panic("%s", soundio_strerror(err));
+                }
+                double ns = measure(&rs, channel_count, src, dst, frame_count, seconds);
+                fprintf(stderr, "%8s %7.1f", level_names[level], ns);
+                soundio_resampler_deinit(&rs);
+            }
+            fprintf(stderr, "\n");
+        }
+    }
+
+    free(dst);
+    free(src);
+    return 0;
+}
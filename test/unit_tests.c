@@ -4,11 +4,16 @@
 #include "os.h"
 #include "util.h"
 #include "atomics.h"
+#include "convert.h"
+#include "bridge.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
 
 static inline void ok_or_panic(int err) {
     if (err)
@@ -149,10 +154,10 @@ static void test_ring_buffer_threaded(void) {
     SOUNDIO_ATOMIC_STORE(rb_done, false);
 
     struct SoundIoOsThread *reader_thread;
-    ok_or_panic(soundio_os_thread_create(reader_thread_run, NULL, NULL, &reader_thread));
+    ok_or_panic(soundio_os_thread_create(reader_thread_run, NULL, NULL, false, &reader_thread));
 
     struct SoundIoOsThread *writer_thread;
-    ok_or_panic(soundio_os_thread_create(writer_thread_run, NULL, NULL, &writer_thread));
+    ok_or_panic(soundio_os_thread_create(writer_thread_run, NULL, NULL, false, &writer_thread));
 
     while (SOUNDIO_ATOMIC_LOAD(rb_read_it) < 100000 || SOUNDIO_ATOMIC_LOAD(rb_write_it) < 100000) {}
     SOUNDIO_ATOMIC_STORE(rb_done, true);
@@ -166,22 +171,2166 @@ static void test_ring_buffer_threaded(void) {
     soundio_destroy(soundio);
 }
 
+static struct SoundIoRingBuffer *bench_rb = NULL;
+static const int bench_chunk_size = 4096;
+static const long bench_total_bytes = 64L * 1024L * 1024L;
+static unsigned char bench_pattern[256 + 4096];
+
+// Without spans each thread asks for its own side's count before advancing,
+// the way callers of the pointer and advance functions do.
+static bool bench_use_spans;
+
+static void bench_writer_thread_run(void *arg) {
+    long written = 0;
+    while (written < bench_total_bytes) {
+        int max_count = (int)soundio_double_min(bench_chunk_size, bench_total_bytes - written);
+        char *write_ptr;
+        int amt;
+        if (bench_use_spans) {
+            ok_or_panic(soundio_ring_buffer_reserve_write(bench_rb, 1, max_count, &write_ptr, &amt));
+        } else {
+            amt = soundio_int_min(soundio_ring_buffer_free_count(bench_rb), max_count);
+            write_ptr = soundio_ring_buffer_write_ptr(bench_rb);
+        }
+        if (amt <= 0) {
+            soundio_os_thread_yield();
+            continue;
+        }
+        memcpy(write_ptr, &bench_pattern[written & 0xff], amt);
+        if (bench_use_spans)
+            soundio_ring_buffer_commit_write(bench_rb, amt);
+        else
+            soundio_ring_buffer_advance_write_ptr(bench_rb, amt);
+        written += amt;
+    }
+}
+
+static void bench_reader_thread_run(void *arg) {
+    long read = 0;
+    while (read < bench_total_bytes) {
+        char *read_ptr;
+        int amt;
+        if (bench_use_spans) {
+            ok_or_panic(soundio_ring_buffer_reserve_read(bench_rb, 1, bench_chunk_size, &read_ptr, &amt));
+        } else {
+            amt = soundio_int_min(soundio_ring_buffer_fill_count(bench_rb), bench_chunk_size);
+            read_ptr = soundio_ring_buffer_read_ptr(bench_rb);
+        }
+        if (amt <= 0) {
+            soundio_os_thread_yield();
+            continue;
+        }
+        assert(memcmp(read_ptr, &bench_pattern[read & 0xff], amt) == 0);
+        if (bench_use_spans)
+            soundio_ring_buffer_commit_read(bench_rb, amt);
+        else
+            soundio_ring_buffer_advance_read_ptr(bench_rb, amt);
+        read += amt;
+    }
+}
+
+// Moves bench_total_bytes from one thread to another and reports throughput.
+// The data is checked on the way out so this doubles as a correctness test.
+static void run_ring_buffer_throughput(bool use_spans) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    bench_rb = soundio_ring_buffer_create(soundio, 16 * bench_chunk_size);
+    assert(bench_rb);
+    bench_use_spans = use_spans;
+    for (int i = 0; i < ARRAY_LENGTH(bench_pattern); i += 1)
+        bench_pattern[i] = i & 0xff;
+
+    double start_time = soundio_os_get_time();
+
+    struct SoundIoOsThread *reader_thread;
+    ok_or_panic(soundio_os_thread_create(bench_reader_thread_run, NULL, NULL, false, &reader_thread));
+    struct SoundIoOsThread *writer_thread;
+    ok_or_panic(soundio_os_thread_create(bench_writer_thread_run, NULL, NULL, false, &writer_thread));
+
+    soundio_os_thread_destroy(writer_thread);
+    soundio_os_thread_destroy(reader_thread);
+
+    double elapsed = soundio_os_get_time() - start_time;
+    fprintf(stderr, "%s %.0f MiB/s...", use_spans ? "reserve/commit" : "ptr/advance",
+            bench_total_bytes / elapsed / (1024.0 * 1024.0));
+
+    assert(soundio_ring_buffer_fill_count(bench_rb) == 0);
+    soundio_ring_buffer_destroy(bench_rb);
+    bench_rb = NULL;
+    soundio_destroy(soundio);
+}
+
+static void test_ring_buffer_throughput(void) {
+    run_ring_buffer_throughput(false);
+    run_ring_buffer_throughput(true);
+}
+
+static void test_ring_buffer_reserve_commit(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    struct SoundIoRingBuffer *rb = soundio_ring_buffer_create(soundio, 10);
+    assert(rb);
+    int capacity = soundio_ring_buffer_capacity(rb);
+    char *ptr;
+    int count;
+
+    assert(soundio_ring_buffer_reserve_write(rb, 2, 1, &ptr, &count) == SoundIoErrorInvalid);
+    assert(soundio_ring_buffer_reserve_read(rb, -1, 1, &ptr, &count) == SoundIoErrorInvalid);
+
+    ok_or_panic(soundio_ring_buffer_reserve_read(rb, 1, capacity, &ptr, &count));
+    assert(count == 0);
+
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, 0, capacity * 2, &ptr, &count));
+    assert(count == capacity);
+    assert(ptr == soundio_ring_buffer_write_ptr(rb));
+    memset(ptr, 'a', capacity - 3);
+    soundio_ring_buffer_commit_write(rb, capacity - 3);
+
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, 4, 100, &ptr, &count));
+    assert(count == 0);
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, 3, 100, &ptr, &count));
+    assert(count == 3);
+    soundio_ring_buffer_commit_write(rb, 1);
+
+    ok_or_panic(soundio_ring_buffer_reserve_read(rb, 0, 10, &ptr, &count));
+    assert(count == 10);
+    assert(ptr[0] == 'a');
+    soundio_ring_buffer_commit_read(rb, 10);
+    assert(soundio_ring_buffer_fill_count(rb) == capacity - 12);
+
+    // The span handed out crosses the end of the buffer.
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, 10, 10, &ptr, &count));
+    assert(count == 10);
+    memcpy(ptr, "0123456789", 10);
+    soundio_ring_buffer_commit_write(rb, 10);
+    ok_or_panic(soundio_ring_buffer_reserve_read(rb, 0, capacity, &ptr, &count));
+    assert(count == capacity - 2);
+    assert(memcmp(ptr + capacity - 12, "0123456789", 10) == 0);
+    soundio_ring_buffer_commit_read(rb, count);
+
+    // Clearing moves the write offset back; the reader must not keep using
+    // the write offset it saw before.
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, 5, 5, &ptr, &count));
+    soundio_ring_buffer_commit_write(rb, 5);
+    ok_or_panic(soundio_ring_buffer_reserve_read(rb, 0, 1, &ptr, &count));
+    assert(count == 1);
+    soundio_ring_buffer_clear(rb);
+    ok_or_panic(soundio_ring_buffer_reserve_read(rb, 0, 1, &ptr, &count));
+    assert(count == 0);
+
+    soundio_ring_buffer_destroy(rb);
+    soundio_destroy(soundio);
+}
+
 static void test_mirrored_memory(void) {
     struct SoundIoOsMirroredMemory mem;
     ok_or_panic(soundio_os_init());
 
-    static const int requested_bytes = 1024;
-    ok_or_panic(soundio_os_init_mirrored_memory(&mem, requested_bytes));
-    const int size_bytes = mem.capacity;
+    static const int requested_bytes = 1024;
+    ok_or_panic(soundio_os_init_mirrored_memory(&mem, requested_bytes));
+    const int size_bytes = mem.capacity;
+
+    for (int i = 0; i < size_bytes; i += 1) {
+        mem.address[i] = rand() % CHAR_MAX;
+    }
+    for (int i = 0; i < size_bytes; i += 1) {
+        assert(mem.address[i] == mem.address[size_bytes+i]);
+    }
+
+    soundio_os_deinit_mirrored_memory(&mem);
+}
+
+// Streams are created and destroyed often, for example when switching
+// sessions, and each one creates a ring buffer.
+static void test_ring_buffer_create_speed(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    static const int iterations = 2000;
+    double start_time = soundio_os_get_time();
+    for (int i = 0; i < iterations; i += 1) {
+        struct SoundIoRingBuffer *rb = soundio_ring_buffer_create(soundio, 48000 * 8);
+        assert(rb);
+        soundio_ring_buffer_destroy(rb);
+    }
+    double elapsed = soundio_os_get_time() - start_time;
+    fprintf(stderr, "%.1f us per create/destroy...", elapsed / iterations * 1000000.0);
+    soundio_destroy(soundio);
+}
+
+static void test_ring_buffer_overwrite(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    struct SoundIoRingBuffer *rb = soundio_ring_buffer_create_flags(soundio, 10,
+            SoundIoRingBufferFlagOverwrite);
+    assert(rb);
+    int capacity = soundio_ring_buffer_capacity(rb);
+    char *ptr;
+    int count;
+
+    // Writing three times the capacity keeps only the last capacity bytes.
+    for (int i = 0; i < 3; i += 1) {
+        ok_or_panic(soundio_ring_buffer_reserve_write(rb, capacity, capacity, &ptr, &count));
+        assert(count == capacity);
+        memset(ptr, 'a' + i, capacity);
+        soundio_ring_buffer_commit_write(rb, count);
+        assert(soundio_ring_buffer_free_count(rb) == capacity);
+    }
+    assert(soundio_ring_buffer_fill_count(rb) == capacity);
+    ok_or_panic(soundio_ring_buffer_reserve_read(rb, 0, capacity, &ptr, &count));
+    assert(count == capacity);
+    assert(ptr[0] == 'c' && ptr[capacity - 1] == 'c');
+    assert(soundio_ring_buffer_overrun_count(rb) == 2 * capacity);
+    ok_or_panic(soundio_ring_buffer_commit_read(rb, count));
+
+    // A snapshot which the writer laps while it is being read is rejected.
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, 100, 100, &ptr, &count));
+    memset(ptr, 'd', count);
+    soundio_ring_buffer_commit_write(rb, count);
+    ok_or_panic(soundio_ring_buffer_reserve_read(rb, 0, capacity, &ptr, &count));
+    assert(count == 100 && ptr[0] == 'd');
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, capacity, capacity, &ptr, &count));
+    assert(soundio_ring_buffer_commit_read(rb, 100) == SoundIoErrorOverflow);
+    memset(ptr, 'e', count);
+    soundio_ring_buffer_commit_write(rb, count);
+    ok_or_panic(soundio_ring_buffer_reserve_read(rb, 0, capacity, &ptr, &count));
+    assert(count == capacity && ptr[0] == 'e');
+    ok_or_panic(soundio_ring_buffer_commit_read(rb, count));
+
+    // A shorter reservation after a partly committed one does not take back
+    // the bytes the longer one may have written over.
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, 100, 100, &ptr, &count));
+    soundio_ring_buffer_commit_write(rb, count);
+    ok_or_panic(soundio_ring_buffer_reserve_read(rb, 0, capacity, &ptr, &count));
+    assert(count == 100);
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, capacity, capacity, &ptr, &count));
+    soundio_ring_buffer_commit_write(rb, 10);
+    ok_or_panic(soundio_ring_buffer_reserve_write(rb, 50, 50, &ptr, &count));
+    assert(soundio_ring_buffer_commit_read(rb, 100) == SoundIoErrorOverflow);
+
+    soundio_ring_buffer_destroy(rb);
+    soundio_destroy(soundio);
+}
+
+static struct SoundIoRingBuffer *overwrite_rb;
+static struct SoundIoAtomicBool overwrite_writer_done;
+static const long overwrite_total_bytes = 64L * 1024 * 1024;
+
+static unsigned char overwrite_pattern(unsigned long pos) {
+    return (unsigned char)(pos ^ (pos >> 8) ^ (pos >> 16));
+}
+
+static void overwrite_writer_thread_run(void *arg) {
+    unsigned long written = 0;
+    while (written < overwrite_total_bytes) {
+        char *ptr;
+        int count;
+        ok_or_panic(soundio_ring_buffer_reserve_write(overwrite_rb, 1, 1024, &ptr, &count));
+        for (int i = 0; i < count; i += 1)
+            ptr[i] = overwrite_pattern(written + i);
+        soundio_ring_buffer_commit_write(overwrite_rb, count);
+        written += count;
+    }
+    SOUNDIO_ATOMIC_STORE(overwrite_writer_done, true);
+}
+
+// The reader is slower than the writer, so it keeps getting lapped. Every span
+// that commits cleanly must hold exactly what was written at its position.
+static void test_ring_buffer_overwrite_threaded(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    overwrite_rb = soundio_ring_buffer_create_flags(soundio, 10, SoundIoRingBufferFlagOverwrite);
+    assert(overwrite_rb);
+    SOUNDIO_ATOMIC_STORE(overwrite_writer_done, false);
+
+    struct SoundIoOsThread *writer_thread;
+    ok_or_panic(soundio_os_thread_create(overwrite_writer_thread_run, NULL, NULL, false, &writer_thread));
+
+    static char copy[4096];
+    unsigned long consumed = 0;
+    long good_spans = 0;
+    long bad_spans = 0;
+    for (;;) {
+        bool done = SOUNDIO_ATOMIC_LOAD(overwrite_writer_done);
+        char *ptr;
+        int count;
+        ok_or_panic(soundio_ring_buffer_reserve_read(overwrite_rb, 0, sizeof(copy), &ptr, &count));
+        if (!count) {
+            if (done)
+                break;
+            soundio_os_thread_yield();
+            continue;
+        }
+        unsigned long pos = consumed + soundio_ring_buffer_overrun_count(overwrite_rb);
+        memcpy(copy, ptr, count);
+        if (soundio_ring_buffer_commit_read(overwrite_rb, count)) {
+            bad_spans += 1;
+        } else {
+            for (int i = 0; i < count; i += 1)
+                assert((unsigned char)copy[i] == overwrite_pattern(pos + i));
+            good_spans += 1;
+            consumed += count;
+        }
+    }
+    soundio_os_thread_destroy(writer_thread);
+
+    assert(consumed + soundio_ring_buffer_overrun_count(overwrite_rb) >= overwrite_total_bytes);
+    fprintf(stderr, "%ld good %ld lapped spans...", good_spans, bad_spans);
+
+    soundio_ring_buffer_destroy(overwrite_rb);
+    overwrite_rb = NULL;
+    soundio_destroy(soundio);
+}
+
+static struct SoundIoRingBuffer *wakeup_rb;
+
+static void wakeup_writer_thread_run(void *arg) {
+    // Trickle in data so that the reader has to sleep more than once.
+    for (int i = 0; i < 10; i += 1) {
+        double end_time = soundio_os_get_time() + 0.002;
+        while (soundio_os_get_time() < end_time)
+            soundio_os_thread_yield();
+        char *ptr;
+        int count;
+        ok_or_panic(soundio_ring_buffer_reserve_write(wakeup_rb, 100, 100, &ptr, &count));
+        assert(count == 100);
+        memset(ptr, i, count);
+        soundio_ring_buffer_commit_write(wakeup_rb, count);
+    }
+}
+
+static void test_ring_buffer_wakeup(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+
+    struct SoundIoRingBuffer *rb = soundio_ring_buffer_create(soundio, 10);
+    assert(rb);
+    assert(soundio_ring_buffer_wait(rb, 1, 0.0) == SoundIoErrorInvalid);
+    assert(soundio_ring_buffer_wakeup_fd(rb) == -1);
+    soundio_ring_buffer_destroy(rb);
+
+    wakeup_rb = soundio_ring_buffer_create_flags(soundio, 10, SoundIoRingBufferFlagWakeup);
+    assert(wakeup_rb);
+    assert(soundio_ring_buffer_wait(wakeup_rb, 1, 0.01) == SoundIoErrorInterrupted);
+    soundio_ring_buffer_wakeup(wakeup_rb);
+    assert(soundio_ring_buffer_wait(wakeup_rb, 1, -1.0) == SoundIoErrorInterrupted);
+
+    struct SoundIoOsThread *writer_thread;
+    ok_or_panic(soundio_os_thread_create(wakeup_writer_thread_run, NULL, NULL, false, &writer_thread));
+    ok_or_panic(soundio_ring_buffer_wait(wakeup_rb, 1000, 5.0));
+    assert(soundio_ring_buffer_fill_count(wakeup_rb) == 1000);
+    soundio_os_thread_destroy(writer_thread);
+
+    // Already enough data: no need to wait for the fd.
+    assert(soundio_ring_buffer_arm_wakeup(wakeup_rb, 1) == 1000);
+    ok_or_panic(soundio_ring_buffer_wait(wakeup_rb, 1000, 0.0));
+
+    soundio_ring_buffer_destroy(wakeup_rb);
+    wakeup_rb = NULL;
+    soundio_destroy(soundio);
+}
+
+static void test_mpsc_ring_buffer_basic(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    static const int slot_size = 48;
+    struct SoundIoMpscRingBuffer *rb = soundio_mpsc_ring_buffer_create(soundio, slot_size, 10);
+    assert(rb);
+    int slot_count = soundio_mpsc_ring_buffer_slot_count(rb);
+    assert(slot_count >= 10);
+    assert(((long)slot_count * slot_size) % soundio_os_page_size() == 0);
+    assert(soundio_mpsc_ring_buffer_free_count(rb) == slot_count);
+
+    // Publishing out of order holds the reader back until the gap is filled.
+    char *a = soundio_mpsc_ring_buffer_claim(rb);
+    char *b = soundio_mpsc_ring_buffer_claim(rb);
+    assert(b == a + slot_size);
+    strcpy(a, "first");
+    strcpy(b, "second");
+    soundio_mpsc_ring_buffer_publish(rb, b);
+    assert(soundio_mpsc_ring_buffer_fill_count(rb) == 0);
+    soundio_mpsc_ring_buffer_publish(rb, a);
+    assert(soundio_mpsc_ring_buffer_fill_count(rb) == 2);
+    assert(soundio_mpsc_ring_buffer_free_count(rb) == slot_count - 2);
+    assert(strcmp(soundio_mpsc_ring_buffer_read_ptr(rb), "first") == 0);
+    soundio_mpsc_ring_buffer_advance_read_ptr(rb, 1);
+    assert(strcmp(soundio_mpsc_ring_buffer_read_ptr(rb), "second") == 0);
+    soundio_mpsc_ring_buffer_advance_read_ptr(rb, 1);
+    assert(soundio_mpsc_ring_buffer_fill_count(rb) == 0);
+
+    // Move up to the last slot, then check that a run of slots across the end
+    // is contiguous.
+    for (int i = 2; i < slot_count - 1; i += 1) {
+        soundio_mpsc_ring_buffer_publish(rb, soundio_mpsc_ring_buffer_claim(rb));
+        soundio_mpsc_ring_buffer_advance_read_ptr(rb, 1);
+    }
+    a = soundio_mpsc_ring_buffer_claim(rb);
+    b = soundio_mpsc_ring_buffer_claim(rb);
+    memset(a, 'a', slot_size);
+    memset(b, 'b', slot_size);
+    soundio_mpsc_ring_buffer_publish(rb, a);
+    soundio_mpsc_ring_buffer_publish(rb, b);
+    assert(soundio_mpsc_ring_buffer_fill_count(rb) == 2);
+    char *read_ptr = soundio_mpsc_ring_buffer_read_ptr(rb);
+    assert(read_ptr == a);
+    assert(read_ptr[slot_size - 1] == 'a' && read_ptr[slot_size] == 'b');
+    assert(read_ptr[2 * slot_size - 1] == 'b');
+    soundio_mpsc_ring_buffer_advance_read_ptr(rb, 2);
+    assert(soundio_mpsc_ring_buffer_free_count(rb) == slot_count);
+
+    soundio_mpsc_ring_buffer_destroy(rb);
+    soundio_destroy(soundio);
+}
+
+struct MpscBenchSlot {
+    int producer;
+    long seq;
+    char payload[48];
+};
+
+struct MpscBenchProducer {
+    int id;
+    long slot_count;
+};
+
+static struct SoundIoMpscRingBuffer *bench_mpsc_rb;
+static const long bench_mpsc_total_slots = 1L << 20;
+
+static void bench_mpsc_producer_run(void *arg) {
+    struct MpscBenchProducer *producer = (struct MpscBenchProducer *)arg;
+    for (long seq = 0; seq < producer->slot_count; seq += 1) {
+        struct MpscBenchSlot *slot = (struct MpscBenchSlot *)soundio_mpsc_ring_buffer_claim(bench_mpsc_rb);
+        slot->producer = producer->id;
+        slot->seq = seq;
+        soundio_mpsc_ring_buffer_publish(bench_mpsc_rb, (char *)slot);
+    }
+}
+
+// The main thread is the consumer. Every producer's slots must arrive in the
+// order that producer published them.
+static void run_mpsc_ring_buffer_scaling(int producer_count) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    bench_mpsc_rb = soundio_mpsc_ring_buffer_create(soundio, sizeof(struct MpscBenchSlot), 1024);
+    assert(bench_mpsc_rb);
+
+    struct MpscBenchProducer producers[16];
+    struct SoundIoOsThread *threads[16];
+    long next_seq[16];
+    assert(producer_count <= ARRAY_LENGTH(producers));
+
+    double start_time = soundio_os_get_time();
+
+    long slots_per_producer = bench_mpsc_total_slots / producer_count;
+    for (int i = 0; i < producer_count; i += 1) {
+        producers[i].id = i;
+        producers[i].slot_count = slots_per_producer;
+        next_seq[i] = 0;
+        ok_or_panic(soundio_os_thread_create(bench_mpsc_producer_run, &producers[i], NULL, false, &threads[i]));
+    }
+
+    long read = 0;
+    long total = slots_per_producer * producer_count;
+    while (read < total) {
+        int count = soundio_mpsc_ring_buffer_fill_count(bench_mpsc_rb);
+        if (!count) {
+            soundio_os_thread_yield();
+            continue;
+        }
+        struct MpscBenchSlot *slots = (struct MpscBenchSlot *)soundio_mpsc_ring_buffer_read_ptr(bench_mpsc_rb);
+        for (int i = 0; i < count; i += 1) {
+            assert(slots[i].producer >= 0 && slots[i].producer < producer_count);
+            assert(slots[i].seq == next_seq[slots[i].producer]);
+            next_seq[slots[i].producer] += 1;
+        }
+        soundio_mpsc_ring_buffer_advance_read_ptr(bench_mpsc_rb, count);
+        read += count;
+    }
+
+    for (int i = 0; i < producer_count; i += 1)
+        soundio_os_thread_destroy(threads[i]);
+
+    double elapsed = soundio_os_get_time() - start_time;
+    fprintf(stderr, "%d:%.1f", producer_count, total / elapsed / 1000000.0);
+
+    assert(soundio_mpsc_ring_buffer_fill_count(bench_mpsc_rb) == 0);
+    soundio_mpsc_ring_buffer_destroy(bench_mpsc_rb);
+    bench_mpsc_rb = NULL;
+    soundio_destroy(soundio);
+}
+
+static void test_mpsc_ring_buffer_scaling(void) {
+    fprintf(stderr, "Mslots/s for producers ");
+    for (int producer_count = 1; producer_count <= 16; producer_count *= 2) {
+        run_mpsc_ring_buffer_scaling(producer_count);
+        fprintf(stderr, producer_count < 16 ? " " : "...");
+    }
+}
+
+static void broadcast_write(struct SoundIoBroadcastRingBuffer *rb, char c, int count) {
+    char *ptr;
+    int amt;
+    ok_or_panic(soundio_broadcast_ring_buffer_reserve_write(rb, count, count, &ptr, &amt));
+    assert(amt == count);
+    memset(ptr, c, amt);
+    soundio_broadcast_ring_buffer_commit_write(rb, amt);
+}
+
+static void test_broadcast_ring_buffer_basic(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+
+    struct SoundIoBroadcastRingBuffer *rb = soundio_broadcast_ring_buffer_create(soundio, 10, 2,
+            SoundIoBroadcastPolicyBlock);
+    assert(rb);
+    int capacity = soundio_broadcast_ring_buffer_capacity(rb);
+    int a, b, c;
+    ok_or_panic(soundio_broadcast_ring_buffer_add_reader(rb, &a));
+    ok_or_panic(soundio_broadcast_ring_buffer_add_reader(rb, &b));
+    assert(soundio_broadcast_ring_buffer_add_reader(rb, &c) == SoundIoErrorSystemResources);
+
+    // Both readers see the same bytes and the writer waits for the slower.
+    broadcast_write(rb, 'x', 100);
+    char *ptr_a, *ptr_b;
+    int amt_a, amt_b;
+    ok_or_panic(soundio_broadcast_ring_buffer_reserve_read(rb, a, 0, capacity, &ptr_a, &amt_a));
+    ok_or_panic(soundio_broadcast_ring_buffer_reserve_read(rb, b, 0, 40, &ptr_b, &amt_b));
+    assert(ptr_a == ptr_b && amt_a == 100 && amt_b == 40);
+    ok_or_panic(soundio_broadcast_ring_buffer_commit_read(rb, a, amt_a));
+    ok_or_panic(soundio_broadcast_ring_buffer_commit_read(rb, b, amt_b));
+    assert(soundio_broadcast_ring_buffer_fill_count(rb, a) == 0);
+    assert(soundio_broadcast_ring_buffer_fill_count(rb, b) == 60);
+    assert(soundio_broadcast_ring_buffer_free_count(rb) == capacity - 60);
+    soundio_broadcast_ring_buffer_remove_reader(rb, b);
+    assert(soundio_broadcast_ring_buffer_free_count(rb) == capacity);
+    assert(soundio_broadcast_ring_buffer_overrun_count(rb, a) == 0);
+    soundio_broadcast_ring_buffer_destroy(rb);
+
+    rb = soundio_broadcast_ring_buffer_create(soundio, 10, 1, SoundIoBroadcastPolicyOverwrite);
+    assert(rb);
+    capacity = soundio_broadcast_ring_buffer_capacity(rb);
+    ok_or_panic(soundio_broadcast_ring_buffer_add_reader(rb, &a));
+
+    // Lapping the reader makes it skip to the oldest intact data.
+    broadcast_write(rb, 'x', capacity);
+    broadcast_write(rb, 'y', 100);
+    assert(soundio_broadcast_ring_buffer_free_count(rb) == capacity);
+    assert(soundio_broadcast_ring_buffer_fill_count(rb, a) == capacity);
+    assert(soundio_broadcast_ring_buffer_overrun_count(rb, a) == 100);
+    ok_or_panic(soundio_broadcast_ring_buffer_reserve_read(rb, a, 0, capacity, &ptr_a, &amt_a));
+    assert(amt_a == capacity);
+    assert(ptr_a[0] == 'x' && ptr_a[capacity - 101] == 'x' && ptr_a[capacity - 100] == 'y');
+
+    // The writer overwrites the start of the span before the reader is done.
+    broadcast_write(rb, 'z', 50);
+    assert(soundio_broadcast_ring_buffer_commit_read(rb, a, amt_a) == SoundIoErrorOverflow);
+    assert(soundio_broadcast_ring_buffer_overrun_count(rb, a) == 150);
+    assert(soundio_broadcast_ring_buffer_fill_count(rb, a) == 50);
+    ok_or_panic(soundio_broadcast_ring_buffer_reserve_read(rb, a, 0, capacity, &ptr_a, &amt_a));
+    assert(amt_a == 50 && ptr_a[0] == 'z');
+    ok_or_panic(soundio_broadcast_ring_buffer_commit_read(rb, a, amt_a));
+
+    // A shorter reservation after a partly committed one does not take back
+    // the bytes the longer one may have written over.
+    broadcast_write(rb, 'w', 100);
+    ok_or_panic(soundio_broadcast_ring_buffer_reserve_read(rb, a, 0, capacity, &ptr_a, &amt_a));
+    assert(amt_a == 100);
+    char *write_ptr;
+    int write_count;
+    ok_or_panic(soundio_broadcast_ring_buffer_reserve_write(rb, capacity, capacity, &write_ptr, &write_count));
+    soundio_broadcast_ring_buffer_commit_write(rb, 10);
+    ok_or_panic(soundio_broadcast_ring_buffer_reserve_write(rb, 50, 50, &write_ptr, &write_count));
+    assert(soundio_broadcast_ring_buffer_commit_read(rb, a, amt_a) == SoundIoErrorOverflow);
+    soundio_broadcast_ring_buffer_destroy(rb);
+
+    soundio_destroy(soundio);
+}
+
+static struct SoundIoBroadcastRingBuffer *bench_broadcast_rb;
+static const long broadcast_total_bytes = 16L * 1024 * 1024;
+
+static void broadcast_reader_thread_run(void *arg) {
+    int reader = *(int *)arg;
+    long read = 0;
+    while (read < broadcast_total_bytes) {
+        char *read_ptr;
+        int amt;
+        ok_or_panic(soundio_broadcast_ring_buffer_reserve_read(bench_broadcast_rb, reader,
+                    1, bench_chunk_size, &read_ptr, &amt));
+        if (!amt) {
+            soundio_os_thread_yield();
+            continue;
+        }
+        assert(memcmp(read_ptr, &bench_pattern[read & 0xff], amt) == 0);
+        ok_or_panic(soundio_broadcast_ring_buffer_commit_read(bench_broadcast_rb, reader, amt));
+        read += amt;
+    }
+}
+
+// One writer fanned out to three readers which each check every byte.
+static void test_broadcast_ring_buffer_threaded(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    bench_broadcast_rb = soundio_broadcast_ring_buffer_create(soundio, 16 * bench_chunk_size, 3,
+            SoundIoBroadcastPolicyBlock);
+    assert(bench_broadcast_rb);
+    for (int i = 0; i < ARRAY_LENGTH(bench_pattern); i += 1)
+        bench_pattern[i] = i & 0xff;
+
+    int readers[3];
+    struct SoundIoOsThread *threads[3];
+    for (int i = 0; i < 3; i += 1) {
+        ok_or_panic(soundio_broadcast_ring_buffer_add_reader(bench_broadcast_rb, &readers[i]));
+        ok_or_panic(soundio_os_thread_create(broadcast_reader_thread_run, &readers[i], NULL, false, &threads[i]));
+    }
+
+    long written = 0;
+    while (written < broadcast_total_bytes) {
+        int max_count = (int)soundio_double_min(bench_chunk_size, broadcast_total_bytes - written);
+        char *write_ptr;
+        int amt;
+        ok_or_panic(soundio_broadcast_ring_buffer_reserve_write(bench_broadcast_rb, 1, max_count,
+                    &write_ptr, &amt));
+        if (!amt) {
+            soundio_os_thread_yield();
+            continue;
+        }
+        memcpy(write_ptr, &bench_pattern[written & 0xff], amt);
+        soundio_broadcast_ring_buffer_commit_write(bench_broadcast_rb, amt);
+        written += amt;
+    }
+
+    for (int i = 0; i < 3; i += 1) {
+        soundio_os_thread_destroy(threads[i]);
+        assert(soundio_broadcast_ring_buffer_fill_count(bench_broadcast_rb, readers[i]) == 0);
+    }
+    soundio_broadcast_ring_buffer_destroy(bench_broadcast_rb);
+    bench_broadcast_rb = NULL;
+    soundio_destroy(soundio);
+}
+
+static void test_ring_buffer_huge_pages(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    struct SoundIoRingBuffer *rb = soundio_ring_buffer_create_flags(soundio, 10,
+            SoundIoRingBufferFlagHugePages);
+    assert(rb);
+
+    // Falls back to normal pages if the system has no huge pages to spare.
+    int page_size = soundio_ring_buffer_page_size(rb);
+    int capacity = soundio_ring_buffer_capacity(rb);
+    assert(page_size == soundio_os_page_size() || page_size == 2 * 1024 * 1024);
+    assert(capacity == page_size);
+    fprintf(stderr, "%d KiB pages...", page_size / 1024);
+
+    soundio_ring_buffer_advance_write_ptr(rb, capacity - 2);
+    soundio_ring_buffer_advance_read_ptr(rb, capacity - 2);
+    int amt = sprintf(soundio_ring_buffer_write_ptr(rb), "writing past the end") + 1;
+    soundio_ring_buffer_advance_write_ptr(rb, amt);
+    assert(strcmp(soundio_ring_buffer_read_ptr(rb), "writing past the end") == 0);
+    assert(strcmp(soundio_ring_buffer_write_ptr(rb) - amt + 2, "iting past the end") == 0);
+    soundio_ring_buffer_advance_read_ptr(rb, amt);
+
+    soundio_ring_buffer_destroy(rb);
+
+    rb = soundio_ring_buffer_create_flags(soundio, 10, SoundIoRingBufferFlagNone);
+    assert(rb);
+    assert(soundio_ring_buffer_page_size(rb) == soundio_os_page_size());
+    soundio_ring_buffer_destroy(rb);
+    soundio_destroy(soundio);
+}
+
+static void test_ring_buffer_large(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+
+    // Offsets wrap around without disturbing the counts.
+    struct SoundIoRingBuffer *rb = soundio_ring_buffer_create(soundio, 4096);
+    assert(rb);
+    size_t start = SIZE_MAX - 100;
+    SOUNDIO_ATOMIC_STORE(rb->write_offset, start);
+    SOUNDIO_ATOMIC_STORE(rb->read_offset, start);
+    rb->cached_read_offset = start;
+    rb->cached_write_offset = start;
+    soundio_ring_buffer_advance_write_ptr(rb, 200);
+    assert(SOUNDIO_ATOMIC_LOAD(rb->write_offset) < start);
+    assert(soundio_ring_buffer_fill_count(rb) == 200);
+    assert(soundio_ring_buffer_free_count(rb) == 4096 - 200);
+    char *ptr;
+    size_t count;
+    ok_or_panic(soundio_ring_buffer_reserve_read_size(rb, 1, SIZE_MAX, &ptr, &count));
+    assert(count == 200);
+    ok_or_panic(soundio_ring_buffer_commit_read_size(rb, count));
+    assert(soundio_ring_buffer_fill_count_size(rb) == 0);
+    soundio_ring_buffer_destroy(rb);
+
+    if (sizeof(size_t) < 8) {
+        fprintf(stderr, "skipping 3 GiB buffer...");
+        soundio_destroy(soundio);
+        return;
+    }
+
+    // Nothing touches most of the pages, so this costs address space only.
+    size_t capacity = (size_t)3 << 30;
+    rb = soundio_ring_buffer_create_size(soundio, capacity, SoundIoRingBufferFlagNone);
+    assert(rb);
+    assert(soundio_ring_buffer_capacity_size(rb) == capacity);
+    assert(soundio_ring_buffer_capacity(rb) == INT_MAX);
+
+    size_t fill = capacity - 1000;
+    soundio_ring_buffer_advance_write_ptr_size(rb, fill);
+    assert(soundio_ring_buffer_fill_count_size(rb) == fill);
+    assert(soundio_ring_buffer_free_count_size(rb) == 1000);
+    assert(soundio_ring_buffer_fill_count(rb) == INT_MAX);
+    assert(soundio_ring_buffer_free_count(rb) == 1000);
+
+    soundio_ring_buffer_advance_read_ptr_size(rb, fill);
+    ok_or_panic(soundio_ring_buffer_reserve_write_size(rb, 0, 2000, &ptr, &count));
+    assert(count == 2000);
+    strcpy(ptr, "writing past the end");
+    soundio_ring_buffer_commit_write_size(rb, count);
+    assert(strcmp(soundio_ring_buffer_read_ptr(rb), "writing past the end") == 0);
+    assert(soundio_ring_buffer_fill_count(rb) == 2000);
+
+    soundio_ring_buffer_destroy(rb);
+    soundio_destroy(soundio);
+}
+
+static void convert_one_channel(enum SoundIoFormat dst_format, void *dst,
+        enum SoundIoFormat src_format, const void *src, int count)
+{
+    struct SoundIoChannelArea dst_area = {(char *)dst, soundio_get_bytes_per_sample(dst_format)};
+    struct SoundIoChannelArea src_area = {(char *)src, soundio_get_bytes_per_sample(src_format)};
+    ok_or_panic(soundio_convert_samples(dst_format, &dst_area, src_format, &src_area, 1, count));
+}
+
+static void test_convert_values(void) {
+    float in[] = {0.0f, 0.5f, -1.0f, 1.0f, 2.0f, -2.0f, 0.5f / 32768.0f, 1.5f / 32768.0f};
+    int count = ARRAY_LENGTH(in);
+
+    int16_t s16[ARRAY_LENGTH(in)];
+    convert_one_channel(SoundIoFormatS16NE, s16, SoundIoFormatFloat32NE, in, count);
+    int16_t s16_expected[] = {0, 16384, -32768, 32767, 32767, -32768, 0, 2};
+    assert(memcmp(s16, s16_expected, sizeof(s16)) == 0);
+
+    uint16_t s16fe[ARRAY_LENGTH(in)];
+    convert_one_channel(SoundIoFormatS16FE, s16fe, SoundIoFormatFloat32NE, in, count);
+    assert(s16fe[1] == 0x0040 && s16fe[2] == 0x0080);
+
+    uint8_t u8[ARRAY_LENGTH(in)];
+    convert_one_channel(SoundIoFormatU8, u8, SoundIoFormatFloat32NE, in, count);
+    assert(u8[0] == 0x80 && u8[1] == 0xc0 && u8[2] == 0x00 && u8[3] == 0xff);
+
+    int32_t s24[ARRAY_LENGTH(in)];
+    convert_one_channel(SoundIoFormatS24NE, s24, SoundIoFormatFloat32NE, in, count);
+    assert(s24[0] == 0 && s24[2] == -8388608 && s24[3] == 8388607);
+    uint32_t u24[ARRAY_LENGTH(in)];
+    convert_one_channel(SoundIoFormatU24NE, u24, SoundIoFormatFloat32NE, in, count);
+    assert(u24[0] == 0x800000 && u24[2] == 0 && u24[3] == 0xffffff);
+
+    uint8_t packed[ARRAY_LENGTH(in) * 3];
+    convert_one_channel(SoundIoFormatS24PackedLE, packed, SoundIoFormatFloat32NE, in, count);
+    uint8_t s24_packed_le[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x80, 0xff, 0xff, 0x7f};
+    assert(memcmp(packed, s24_packed_le, sizeof(s24_packed_le)) == 0);
+    convert_one_channel(SoundIoFormatU24PackedBE, packed, SoundIoFormatFloat32NE, in, count);
+    uint8_t u24_packed_be[] = {0x80, 0x00, 0x00, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff};
+    assert(memcmp(packed, u24_packed_be, sizeof(u24_packed_be)) == 0);
+
+    int32_t s32[ARRAY_LENGTH(in)];
+    convert_one_channel(SoundIoFormatS32NE, s32, SoundIoFormatFloat32NE, in, count);
+    assert(s32[1] == 1073741824 && s32[2] == INT32_MIN && s32[3] == INT32_MAX && s32[4] == INT32_MAX);
+
+    float back[ARRAY_LENGTH(in)];
+    convert_one_channel(SoundIoFormatFloat32NE, back, SoundIoFormatS16NE, s16, count);
+    assert(back[0] == 0.0f && back[1] == 0.5f && back[2] == -1.0f);
+    convert_one_channel(SoundIoFormatFloat32NE, back, SoundIoFormatU24NE, u24, count);
+    assert(back[0] == 0.0f && back[1] == 0.5f && back[2] == -1.0f);
+    convert_one_channel(SoundIoFormatFloat32NE, back, SoundIoFormatU24PackedBE, packed, count);
+    assert(back[0] == 0.0f && back[1] == 0.5f && back[2] == -1.0f);
+
+    double f64[ARRAY_LENGTH(in)];
+    convert_one_channel(SoundIoFormatFloat64NE, f64, SoundIoFormatFloat32NE, in, count);
+    for (int i = 0; i < count; i += 1)
+        assert(f64[i] == in[i]);
+
+    assert(soundio_convert_samples(SoundIoFormatInvalid, NULL, SoundIoFormatS16NE, NULL, 1, 1) ==
+            SoundIoErrorInvalid);
+}
+
+// Every SIMD level must produce exactly what the scalar code does.
+static void test_convert_simd_levels(void) {
+    static const enum SoundIoFormat int_formats[] = {
+        SoundIoFormatS8, SoundIoFormatU8,
+        SoundIoFormatS16LE, SoundIoFormatS16BE, SoundIoFormatU16LE, SoundIoFormatU16BE,
+        SoundIoFormatS24LE, SoundIoFormatS24BE, SoundIoFormatU24LE, SoundIoFormatU24BE,
+        SoundIoFormatS32LE, SoundIoFormatS32BE, SoundIoFormatU32LE, SoundIoFormatU32BE,
+        SoundIoFormatS24PackedLE, SoundIoFormatS24PackedBE,
+        SoundIoFormatU24PackedLE, SoundIoFormatU24PackedBE,
+    };
+    static const enum SoundIoFormat float_formats[] = {
+        SoundIoFormatFloat32NE, SoundIoFormatFloat64NE,
+    };
+    // Not a multiple of any vector width, to cover the tails.
+    enum { count = 1021 };
+    static char float_in[count * 8];
+    static char int_in[count * 4];
+    static char expected[count * 8];
+    static char actual[count * 8];
+
+    unsigned seed = 1;
+    for (int i = 0; i < count; i += 1) {
+        seed = seed * 1103515245 + 12345;
+        // Mostly in range, some beyond full scale, and some exact ties.
+        double value = (double)(int)(seed >> 8 & 0xffff) / 24576.0 - 1.25;
+        if (i % 7 == 0)
+            value = (double)(i - 500) / 65536.0;
+        ((float *)float_in)[i] = (float)value;
+        ((double *)float_in)[count / 2 + i / 2] = value;
+        int_in[i * 4 + 0] = (char)seed;
+        int_in[i * 4 + 1] = (char)(seed >> 8);
+        int_in[i * 4 + 2] = (char)(seed >> 16);
+        int_in[i * 4 + 3] = (char)(seed >> 24);
+    }
+    float_in[0] = 0;
+
+    enum SoundIoSimdLevel original = soundio_convert_get_simd_level();
+    enum SoundIoSimdLevel best = soundio_convert_detect_simd_level();
+    for (int level = SoundIoSimdLevelSse2; level <= (int)best; level += 1) {
+        for (size_t f = 0; f < ARRAY_LENGTH(float_formats); f += 1) {
+            int float_count = (float_formats[f] == SoundIoFormatFloat32NE) ? count : count / 2;
+            const char *float_src = (float_formats[f] == SoundIoFormatFloat32NE) ?
+                float_in : float_in + count / 2 * 8;
+            for (size_t i = 0; i < ARRAY_LENGTH(int_formats); i += 1) {
+                ok_or_panic(soundio_convert_set_simd_level(SoundIoSimdLevelScalar));
+                convert_one_channel(int_formats[i], expected, float_formats[f], float_src, float_count);
+                ok_or_panic(soundio_convert_set_simd_level((enum SoundIoSimdLevel)level));
+                convert_one_channel(int_formats[i], actual, float_formats[f], float_src, float_count);
+                assert(memcmp(expected, actual, float_count * soundio_get_bytes_per_sample(int_formats[i])) == 0);
+
+                ok_or_panic(soundio_convert_set_simd_level(SoundIoSimdLevelScalar));
+                convert_one_channel(float_formats[f], expected, int_formats[i], int_in, float_count);
+                ok_or_panic(soundio_convert_set_simd_level((enum SoundIoSimdLevel)level));
+                convert_one_channel(float_formats[f], actual, int_formats[i], int_in, float_count);
+                assert(memcmp(expected, actual, float_count * soundio_get_bytes_per_sample(float_formats[f])) == 0);
+            }
+        }
+    }
+    ok_or_panic(soundio_convert_set_simd_level(original));
+    fprintf(stderr, "checked up to level %d...", (int)best);
+}
+
+static void test_convert_areas(void) {
+    enum { frames = 37 };
+    int16_t planar[2][frames];
+    for (int i = 0; i < frames; i += 1) {
+        planar[0][i] = (int16_t)(i * 100);
+        planar[1][i] = (int16_t)(-i * 100);
+    }
+    struct SoundIoChannelArea planar_areas[2] = {
+        {(char *)planar[0], 2},
+        {(char *)planar[1], 2},
+    };
+
+    float interleaved[frames * 2];
+    struct SoundIoChannelArea interleaved_areas[2] = {
+        {(char *)&interleaved[0], 8},
+        {(char *)&interleaved[1], 8},
+    };
+    ok_or_panic(soundio_convert_samples(SoundIoFormatFloat32NE, interleaved_areas,
+                SoundIoFormatS16NE, planar_areas, 2, frames));
+    for (int i = 0; i < frames; i += 1) {
+        assert(interleaved[i * 2] == (float)(i * 100) / 32768.0f);
+        assert(interleaved[i * 2 + 1] == (float)(-i * 100) / 32768.0f);
+    }
+
+    // Back again, swapping the channels, so that neither side is interleaved
+    // the same way as the other.
+    int16_t swapped[frames * 2];
+    struct SoundIoChannelArea swapped_areas[2] = {
+        {(char *)&swapped[1], 4},
+        {(char *)&swapped[0], 4},
+    };
+    ok_or_panic(soundio_convert_samples(SoundIoFormatS16NE, swapped_areas,
+                SoundIoFormatFloat32NE, interleaved_areas, 2, frames));
+    for (int i = 0; i < frames; i += 1) {
+        assert(swapped[i * 2] == planar[1][i]);
+        assert(swapped[i * 2 + 1] == planar[0][i]);
+    }
+}
+
+static void test_interleave(void) {
+    static const int layouts[][2] = {
+        // channel count, bytes per sample
+        {1, 4}, {2, 2}, {2, 4}, {2, 8}, {3, 3}, {8, 2}, {8, 4},
+    };
+    // Not a multiple of any vector width, to cover the tails.
+    enum { frames = 37 };
+    static char planes_in[8][frames * 8];
+    static char planes_out[8][frames * 8];
+    static char interleaved[8 * frames * 8];
+    static char copied[8 * frames * 8];
+    char *in[8];
+    char *out[8];
+    for (int ch = 0; ch < 8; ch += 1) {
+        in[ch] = planes_in[ch];
+        out[ch] = planes_out[ch];
+        for (int i = 0; i < frames * 8; i += 1)
+            planes_in[ch][i] = (char)(ch * 31 + i * 7 + 1);
+    }
+
+    enum SoundIoSimdLevel original = soundio_convert_get_simd_level();
+    enum SoundIoSimdLevel best = soundio_convert_detect_simd_level();
+    for (int level = SoundIoSimdLevelScalar; level <= (int)best; level += 1) {
+        ok_or_panic(soundio_convert_set_simd_level((enum SoundIoSimdLevel)level));
+        for (size_t l = 0; l < ARRAY_LENGTH(layouts); l += 1) {
+            int channel_count = layouts[l][0];
+            int bytes = layouts[l][1];
+            int frame_bytes = channel_count * bytes;
+
+            memset(interleaved, 0, sizeof(interleaved));
+            soundio_interleave(interleaved, in, channel_count, frames, bytes);
+            for (int frame = 0; frame < frames; frame += 1) {
+                for (int ch = 0; ch < channel_count; ch += 1) {
+                    assert(memcmp(interleaved + frame * frame_bytes + ch * bytes,
+                                planes_in[ch] + frame * bytes, bytes) == 0);
+                }
+            }
+
+            memset(planes_out, 0, sizeof(planes_out));
+            soundio_deinterleave(out, interleaved, channel_count, frames, bytes);
+            for (int ch = 0; ch < channel_count; ch += 1)
+                assert(memcmp(planes_out[ch], planes_in[ch], frames * bytes) == 0);
+
+            // The same through areas, and through areas that are neither
+            // interleaved nor planar: every other frame of the planes.
+            struct SoundIoChannelArea planar_areas[8];
+            struct SoundIoChannelArea interleaved_areas[8];
+            struct SoundIoChannelArea sparse_areas[8];
+            for (int ch = 0; ch < channel_count; ch += 1) {
+                planar_areas[ch].ptr = planes_in[ch];
+                planar_areas[ch].step = bytes;
+                interleaved_areas[ch].ptr = copied + ch * bytes;
+                interleaved_areas[ch].step = frame_bytes;
+                sparse_areas[ch].ptr = planes_out[ch];
+                sparse_areas[ch].step = bytes * 2;
+            }
+            memset(copied, 0, sizeof(copied));
+            soundio_channel_areas_copy(interleaved_areas, planar_areas, channel_count, frames, bytes);
+            assert(memcmp(copied, interleaved, frames * frame_bytes) == 0);
+
+            memset(planes_out, 0, sizeof(planes_out));
+            soundio_channel_areas_copy(sparse_areas, interleaved_areas, channel_count, frames / 2, bytes);
+            for (int ch = 0; ch < channel_count; ch += 1) {
+                for (int frame = 0; frame < frames / 2; frame += 1) {
+                    assert(memcmp(planes_out[ch] + frame * bytes * 2,
+                                planes_in[ch] + frame * bytes, bytes) == 0);
+                }
+            }
+        }
+    }
+    ok_or_panic(soundio_convert_set_simd_level(original));
+}
+
+static struct SoundIoAtomicLong silence_frames;
+
+static void silence_write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
+                memset(areas[ch].ptr, 0, outstream->bytes_per_sample);
+                areas[ch].ptr += areas[ch].step;
+            }
+        }
+        ok_or_panic(soundio_outstream_end_write(outstream));
+        frames_left -= frame_count;
+        SOUNDIO_ATOMIC_FETCH_ADD(silence_frames, frame_count);
+    }
+}
+
+static void instream_error_callback(struct SoundIoInStream *instream, int err) {
+    soundio_panic("%s", soundio_strerror(err));
+}
+
+static struct SoundIo *connect_dummy(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    return soundio;
+}
+
+// A Float32NE stream on the default device with 0.02 s of latency, changed
+// by `setup` if it is not NULL, and not opened yet.
+static struct SoundIoOutStream *create_dummy_outstream(struct SoundIo *soundio,
+        void (*write_callback)(struct SoundIoOutStream *, int frame_count_min, int frame_count_max),
+        void (*setup)(struct SoundIoOutStream *))
+{
+    struct SoundIoDevice *device = soundio_get_output_device(soundio,
+            soundio_default_output_device_index(soundio));
+    assert(device);
+    struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+    assert(outstream);
+    soundio_device_unref(device);
+    outstream->format = SoundIoFormatFloat32NE;
+    outstream->software_latency = 0.02;
+    outstream->write_callback = write_callback;
+    outstream->error_callback = error_callback;
+    if (setup)
+        setup(outstream);
+    return outstream;
+}
+
+static struct SoundIoInStream *create_dummy_instream(struct SoundIo *soundio,
+        void (*read_callback)(struct SoundIoInStream *, int frame_count_min, int frame_count_max),
+        void (*setup)(struct SoundIoInStream *))
+{
+    struct SoundIoDevice *device = soundio_get_input_device(soundio,
+            soundio_default_input_device_index(soundio));
+    assert(device);
+    struct SoundIoInStream *instream = soundio_instream_create(device);
+    assert(instream);
+    soundio_device_unref(device);
+    instream->format = SoundIoFormatFloat32NE;
+    instream->software_latency = 0.02;
+    instream->read_callback = read_callback;
+    instream->error_callback = instream_error_callback;
+    if (setup)
+        setup(instream);
+    return instream;
+}
+
+static void wait_for_frames(struct SoundIoAtomicLong *frames, long frame_goal) {
+    double end_time = soundio_os_get_time() + 2.0;
+    while (SOUNDIO_ATOMIC_LOAD((*frames)) < frame_goal) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_os_thread_yield();
+    }
+}
+
+// A stream made by create_dummy_outstream runs until its callback has
+// counted `frame_goal` frames in `frames`.
+struct OutStreamTest {
+    void (*write_callback)(struct SoundIoOutStream *, int frame_count_min, int frame_count_max);
+    // Before the stream is opened.
+    void (*setup)(struct SoundIoOutStream *);
+    // After it is opened, before it starts.
+    void (*opened)(struct SoundIoOutStream *);
+    // Once it gets to `frame_goal`, while it still runs.
+    void (*check)(struct SoundIoOutStream *);
+    struct SoundIoAtomicLong *frames;
+    long frame_goal;
+};
+
+static void run_outstream_test(const struct OutStreamTest *test) {
+    struct SoundIo *soundio = connect_dummy();
+    struct SoundIoOutStream *outstream = create_dummy_outstream(soundio, test->write_callback, test->setup);
+    ok_or_panic(soundio_outstream_open(outstream));
+    if (test->opened)
+        test->opened(outstream);
+    SOUNDIO_ATOMIC_STORE((*test->frames), 0);
+    ok_or_panic(soundio_outstream_start(outstream));
+    wait_for_frames(test->frames, test->frame_goal);
+    if (test->check)
+        test->check(outstream);
+    soundio_outstream_destroy(outstream);
+    soundio_destroy(soundio);
+}
+
+struct InStreamTest {
+    void (*read_callback)(struct SoundIoInStream *, int frame_count_min, int frame_count_max);
+    void (*setup)(struct SoundIoInStream *);
+    struct SoundIoAtomicLong *frames;
+    long frame_goal;
+};
+
+static void run_instream_test(const struct InStreamTest *test) {
+    struct SoundIo *soundio = connect_dummy();
+    struct SoundIoInStream *instream = create_dummy_instream(soundio, test->read_callback, test->setup);
+    ok_or_panic(soundio_instream_open(instream));
+    SOUNDIO_ATOMIC_STORE((*test->frames), 0);
+    ok_or_panic(soundio_instream_start(instream));
+    wait_for_frames(test->frames, test->frame_goal);
+    soundio_instream_destroy(instream);
+    soundio_destroy(soundio);
+}
+
+static struct SoundIoAtomicLong native_float_frames;
+
+static void native_float_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    assert(outstream->format == SoundIoFormatS16NE);
+    int channel_count = outstream->layout.channel_count;
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        // The dummy backend plays from the same thread, so what end_write
+        // leaves in its ring buffer stays there until this callback returns.
+        int16_t *device = (int16_t *)soundio_ring_buffer_write_ptr(&os->backend_data.dummy.ring_buffer);
+        ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < channel_count; ch += 1) {
+                float *sample = (float *)(areas[ch].ptr + areas[ch].step * frame);
+                *sample = (float)((frame + ch) % 64) / 64.0f;
+            }
+        }
+        ok_or_panic(soundio_outstream_end_write(outstream));
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < channel_count; ch += 1)
+                assert(device[frame * channel_count + ch] == ((frame + ch) % 64) * 512);
+        }
+        frames_left -= frame_count;
+        SOUNDIO_ATOMIC_FETCH_ADD(native_float_frames, frame_count);
+    }
+}
+
+static void native_float_read_callback(struct SoundIoInStream *instream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    assert(instream->format == SoundIoFormatS16NE);
+    int channel_count = instream->layout.channel_count;
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        // Stand in for the device, which is the thread running this callback.
+        int16_t *device = (int16_t *)soundio_ring_buffer_read_ptr(&is->backend_data.dummy.ring_buffer);
+        for (int i = 0; i < frame_count * channel_count; i += 1)
+            device[i] = (int16_t)((i % 64) * -512);
+        ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        assert(areas);
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < channel_count; ch += 1) {
+                float *sample = (float *)(areas[ch].ptr + areas[ch].step * frame);
+                assert(*sample == (float)((frame * channel_count + ch) % 64) / -64.0f);
+            }
+        }
+        ok_or_panic(soundio_instream_end_read(instream));
+        frames_left -= frame_count;
+        SOUNDIO_ATOMIC_FETCH_ADD(native_float_frames, frame_count);
+    }
+}
+
+static void native_float_setup_outstream(struct SoundIoOutStream *outstream) {
+    outstream->format = SoundIoFormatS16NE;
+    outstream->native_float = true;
+}
+
+static void native_float_check_outstream(struct SoundIoOutStream *outstream) {
+    assert(outstream->bytes_per_sample == 2);
+}
+
+static void native_float_setup_instream(struct SoundIoInStream *instream) {
+    instream->format = SoundIoFormatS16NE;
+    instream->native_float = true;
+}
+
+static void test_native_float_streams(void) {
+    struct OutStreamTest out_test = {
+        .write_callback = native_float_write_callback,
+        .setup = native_float_setup_outstream,
+        .check = native_float_check_outstream,
+        .frames = &native_float_frames,
+        .frame_goal = 4800,
+    };
+    run_outstream_test(&out_test);
+    struct InStreamTest in_test = {
+        .read_callback = native_float_read_callback,
+        .setup = native_float_setup_instream,
+        .frames = &native_float_frames,
+        .frame_goal = 4800,
+    };
+    run_instream_test(&in_test);
+}
+
+// Output k of the resampler is the input at k * in_rate / out_rate, delayed
+// by half of the filter.
+static double resampled_sine_error(enum SoundIoResampleQuality quality, int in_rate, int out_rate) {
+    const int channel_count = 2;
+    const double frequency = 1000.0;
+    struct SoundIoResampler rs;
+    ok_or_panic(soundio_resampler_init(&rs, channel_count, in_rate, out_rate, quality, 512));
+    float input[300 * 2];
+    float output[1024 * 2];
+    struct SoundIoChannelArea in_areas[2];
+    struct SoundIoChannelArea out_areas[2];
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        in_areas[ch].ptr = (char *)(input + ch);
+        in_areas[ch].step = channel_count * sizeof(float);
+        out_areas[ch].ptr = (char *)(output + ch);
+        out_areas[ch].step = channel_count * sizeof(float);
+    }
+
+    double max_error = 0.0;
+    int input_frames = 0;
+    int output_frames = 0;
+    while (output_frames < 20000) {
+        // Uneven chunks, to cross the ends of the history at odd places.
+        int frame_count = soundio_int_min(100 + input_frames % 199, soundio_resampler_free_count(&rs));
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            double x = sin(2.0 * 3.14159265358979 * frequency * (input_frames + frame) / in_rate);
+            input[frame * 2] = (float)x;
+            input[frame * 2 + 1] = (float)-x;
+        }
+        soundio_resampler_write(&rs, SoundIoFormatFloat32NE, in_areas, frame_count);
+        input_frames += frame_count;
+
+        int output_count = soundio_resampler_output_count(&rs);
+        assert(output_count <= 1024);
+        soundio_resampler_read(&rs, SoundIoFormatFloat32NE, out_areas, output_count);
+        for (int frame = 0; frame < output_count; frame += 1) {
+            int k = output_frames + frame;
+            if (k < rs.taps * 2)
+                continue;
+            double t = k * (double)in_rate / out_rate - rs.taps / 2;
+            double x = sin(2.0 * 3.14159265358979 * frequency * t / in_rate);
+            assert(fabs(output[frame * 2] + output[frame * 2 + 1]) < 0.0001);
+            max_error = fmax(max_error, fabs(output[frame * 2] - x));
+        }
+        output_frames += output_count;
+    }
+    soundio_resampler_deinit(&rs);
+    return max_error;
+}
+
+static void test_resampler(void) {
+    // Loosest for the fewest taps.
+    static const double tolerances[] = {0.002, 0.02, 0.002, 0.001, 0.001};
+    enum SoundIoSimdLevel original = soundio_convert_get_simd_level();
+    enum SoundIoSimdLevel best = soundio_convert_detect_simd_level();
+    for (int level = 0; level <= (int)best; level += 1) {
+        ok_or_panic(soundio_convert_set_simd_level((enum SoundIoSimdLevel)level));
+        for (int quality = 0; quality < (int)ARRAY_LENGTH(tolerances); quality += 1) {
+            enum SoundIoResampleQuality q = (enum SoundIoResampleQuality)quality;
+            assert(resampled_sine_error(q, 44100, 48000) < tolerances[quality]);
+            assert(resampled_sine_error(q, 48000, 44100) < tolerances[quality]);
+            assert(resampled_sine_error(q, 48000, 48000) < tolerances[quality]);
+        }
+    }
+    ok_or_panic(soundio_convert_set_simd_level(original));
+
+    // What input_needed asks for is enough, and no more than that.
+    struct SoundIoResampler rs;
+    ok_or_panic(soundio_resampler_init(&rs, 1, 44100, 48000, SoundIoResampleQualityHigh, 4096));
+    for (int output_count = 1; output_count < 2000; output_count += 97) {
+        int needed = soundio_resampler_input_needed(&rs, output_count);
+        assert(needed <= soundio_resampler_free_count(&rs));
+        if (needed > 0) {
+            soundio_resampler_write_silence(&rs, needed - 1);
+            assert(soundio_resampler_output_count(&rs) < output_count);
+            soundio_resampler_write_silence(&rs, 1);
+        }
+        assert(soundio_resampler_output_count(&rs) >= output_count);
+        assert(soundio_resampler_input_needed(&rs, output_count) == 0);
+        float sink[2000];
+        struct SoundIoChannelArea area = {(char *)sink, sizeof(float)};
+        soundio_resampler_read(&rs, SoundIoFormatFloat32NE, &area, output_count);
+    }
+    soundio_resampler_deinit(&rs);
+
+    assert(soundio_resampler_init(&rs, 1, 44100, 0, SoundIoResampleQualityHigh, 4096) == SoundIoErrorInvalid);
+    assert(soundio_resampler_init(&rs, 1, 44100, 48000, (enum SoundIoResampleQuality)99, 4096) ==
+            SoundIoErrorInvalid);
+}
+
+static struct SoundIoAtomicLong resample_app_frames;
+static struct SoundIoAtomicLong resample_device_frames;
+
+static void resample_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    struct SoundIoRingBuffer *ring_buffer = &os->backend_data.dummy.ring_buffer;
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < outstream->layout.channel_count; ch += 1)
+                *(float *)(areas[ch].ptr + areas[ch].step * frame) = 0.5f;
+        }
+        // The dummy backend plays from this thread, so whatever end_write
+        // adds to the ring buffer is still there right after.
+        int16_t *device = (int16_t *)soundio_ring_buffer_write_ptr(ring_buffer);
+        int fill_count = soundio_ring_buffer_fill_count(ring_buffer);
+        ok_or_panic(soundio_outstream_end_write(outstream));
+        int sample_count = (soundio_ring_buffer_fill_count(ring_buffer) - fill_count) / 2;
+        // Past the start of the filter, DC goes through as it is.
+        if (SOUNDIO_ATOMIC_LOAD(resample_device_frames) > 256) {
+            for (int i = 0; i < sample_count; i += 1)
+                assert(abs(device[i] - 16384) <= 2);
+        }
+        SOUNDIO_ATOMIC_FETCH_ADD(resample_device_frames, sample_count / outstream->layout.channel_count);
+        SOUNDIO_ATOMIC_FETCH_ADD(resample_app_frames, frame_count);
+        frames_left -= frame_count;
+    }
+}
+
+static void resample_read_callback(struct SoundIoInStream *instream,
+        int frame_count_min, int frame_count_max)
+{
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        assert(areas[0].step == (int)sizeof(float) * instream->layout.channel_count);
+        ok_or_panic(soundio_instream_end_read(instream));
+        SOUNDIO_ATOMIC_FETCH_ADD(resample_app_frames, frame_count);
+        frames_left -= frame_count;
+    }
+}
+
+static void resample_setup_outstream(struct SoundIoOutStream *outstream) {
+    outstream->format = SoundIoFormatS16NE;
+    outstream->sample_rate = 48000;
+    outstream->app_sample_rate = 44100;
+    SOUNDIO_ATOMIC_STORE(resample_app_frames, 0);
+}
+
+static void resample_check_outstream(struct SoundIoOutStream *outstream) {
+    assert(outstream->sample_rate == 48000);
+    ok_or_panic(soundio_outstream_pause(outstream, true));
+    double expected = SOUNDIO_ATOMIC_LOAD(resample_app_frames) * 48000.0 / 44100.0;
+    assert(fabs(SOUNDIO_ATOMIC_LOAD(resample_device_frames) - expected) < 64.0);
+}
+
+static void resample_setup_instream(struct SoundIoInStream *instream) {
+    instream->format = SoundIoFormatS16NE;
+    instream->sample_rate = 48000;
+    instream->app_sample_rate = 22050;
+}
+
+static void test_resampled_streams(void) {
+    struct OutStreamTest out_test = {
+        .write_callback = resample_write_callback,
+        .setup = resample_setup_outstream,
+        .check = resample_check_outstream,
+        .frames = &resample_device_frames,
+        .frame_goal = 9600,
+    };
+    run_outstream_test(&out_test);
+    struct InStreamTest in_test = {
+        .read_callback = resample_read_callback,
+        .setup = resample_setup_instream,
+        .frames = &resample_app_frames,
+        .frame_goal = 4410,
+    };
+    run_instream_test(&in_test);
+}
+
+static void test_bridge_control(void) {
+    // An input clock 200 ppm fast, starting 2 ms off target, with the
+    // measurement jumping around by a 4 ms input period, for an hour.
+    const double target = 0.005;
+    const double drift = 0.0002;
+    const double dt = 0.005;
+    struct SoundIoBridgeControl control;
+    soundio_bridge_control_reset(&control, target);
+    double latency = target + 0.002;
+    for (int i = 0; i < 3600 * 200; i += 1) {
+        double measured = latency + 0.001 * ((i % 4) - 1.5);
+        double ratio = soundio_bridge_control_update(&control, measured, dt);
+        latency += (1.0 + drift - ratio) * dt;
+        if (i > 60 * 200)
+            assert(fabs(latency - target) < 0.0005);
+    }
+    assert(fabs(latency - target) < 0.00001);
+    assert(fabs(soundio_bridge_control_drift_ppm(&control) - 200.0) < 1.0);
+}
+
+static struct SoundIoBridge *bridge;
+
+static void bridge_write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
+    ok_or_panic(soundio_bridge_write(bridge, frame_count_min, frame_count_max));
+}
+
+static void bridge_read_callback(struct SoundIoInStream *instream, int frame_count_min, int frame_count_max) {
+    ok_or_panic(soundio_bridge_read(bridge, frame_count_min, frame_count_max));
+}
+
+static void bridge_setup_instream(struct SoundIoInStream *instream) {
+    instream->format = SoundIoFormatS16NE;
+    instream->sample_rate = 48000;
+    instream->software_latency = 0.01;
+}
+
+static void bridge_setup_outstream(struct SoundIoOutStream *outstream) {
+    outstream->format = SoundIoFormatS24NE;
+    outstream->sample_rate = 44100;
+    outstream->software_latency = 0.01;
+}
+
+static void test_bridge(void) {
+    struct SoundIo *soundio = connect_dummy();
+    struct SoundIoInStream *instream = create_dummy_instream(soundio, bridge_read_callback, bridge_setup_instream);
+    ok_or_panic(soundio_instream_open(instream));
+    struct SoundIoOutStream *outstream = create_dummy_outstream(soundio, bridge_write_callback,
+            bridge_setup_outstream);
+    ok_or_panic(soundio_outstream_open(outstream));
+
+    outstream->layout.channel_count += 1;
+    assert(soundio_bridge_create(instream, outstream, 0.02, &bridge) == SoundIoErrorInvalid);
+    outstream->layout.channel_count -= 1;
+    assert(soundio_bridge_create(instream, outstream, -1.0, &bridge) == SoundIoErrorInvalid);
+    ok_or_panic(soundio_bridge_create(instream, outstream, 0.02, &bridge));
+
+    ok_or_panic(soundio_instream_start(instream));
+    ok_or_panic(soundio_outstream_start(outstream));
+    double end_time = soundio_os_get_time() + 0.5;
+    while (soundio_os_get_time() < end_time)
+        soundio_os_thread_yield();
+    soundio_outstream_destroy(outstream);
+    soundio_instream_destroy(instream);
+
+    double latency = soundio_bridge_get_latency(bridge);
+    fprintf(stderr, "%.1f ms...", latency * 1000.0);
+    assert(latency > 0.01 && latency < 0.03);
+    assert(fabs(soundio_bridge_get_drift_ppm(bridge)) < 1000.0);
+    assert(soundio_bridge_get_overflow_count(bridge) == 0);
+    soundio_bridge_destroy(bridge);
+    soundio_destroy(soundio);
+}
+
+static void test_remix_matrix(void) {
+    const struct SoundIoChannelLayout *mono = soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdMono);
+    const struct SoundIoChannelLayout *stereo = soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdStereo);
+    const struct SoundIoChannelLayout *surround = soundio_channel_layout_get_builtin(SoundIoChannelLayoutId5Point1Back);
+    float matrix[SOUNDIO_MAX_CHANNELS * SOUNDIO_MAX_CHANNELS];
+
+    soundio_channel_layout_remix_matrix(stereo, stereo, matrix);
+    assert(matrix[0] == 1.0f && matrix[1] == 0.0f && matrix[2] == 0.0f && matrix[3] == 1.0f);
+
+    soundio_channel_layout_remix_matrix(mono, stereo, matrix);
+    assert(fabs(matrix[0] - 0.7071) < 0.0001 && fabs(matrix[1] - 0.7071) < 0.0001);
+
+    // Left gets front left, center and back left, scaled so as not to clip.
+    soundio_channel_layout_remix_matrix(surround, stereo, matrix);
+    int fl = soundio_channel_layout_find_channel(surround, SoundIoChannelIdFrontLeft);
+    int fc = soundio_channel_layout_find_channel(surround, SoundIoChannelIdFrontCenter);
+    int lfe = soundio_channel_layout_find_channel(surround, SoundIoChannelIdLfe);
+    int bl = soundio_channel_layout_find_channel(surround, SoundIoChannelIdBackLeft);
+    int br = soundio_channel_layout_find_channel(surround, SoundIoChannelIdBackRight);
+    double scale = 1.0 + 2.0 * 0.70710678;
+    assert(fabs(matrix[fl] - 1.0 / scale) < 0.0001);
+    assert(fabs(matrix[fc] - 0.70710678 / scale) < 0.0001);
+    assert(fabs(matrix[bl] - 0.70710678 / scale) < 0.0001);
+    assert(matrix[lfe] == 0.0f && matrix[br] == 0.0f);
+    for (int out = 0; out < 2; out += 1) {
+        float sum = 0.0f;
+        for (int in = 0; in < surround->channel_count; in += 1)
+            sum += matrix[out * surround->channel_count + in];
+        assert(sum <= 1.0001f);
+    }
+
+    // Upmixing routes what is there and leaves the rest silent.
+    soundio_channel_layout_remix_matrix(stereo, surround, matrix);
+    for (int out = 0; out < surround->channel_count; out += 1) {
+        enum SoundIoChannelId id = surround->channels[out];
+        assert(matrix[out * 2] == ((id == SoundIoChannelIdFrontLeft) ? 1.0f : 0.0f));
+        assert(matrix[out * 2 + 1] == ((id == SoundIoChannelIdFrontRight) ? 1.0f : 0.0f));
+    }
+}
+
+static void test_remix_simd_levels(void) {
+    enum { frame_count = 37 };
+    float src[frame_count * SOUNDIO_MAX_CHANNELS];
+    float expected[frame_count * SOUNDIO_MAX_CHANNELS];
+    // With room past the end to catch stores which go too far.
+    float dst[frame_count * SOUNDIO_MAX_CHANNELS + 8];
+    unsigned seed = 1;
+    for (int i = 0; i < (int)ARRAY_LENGTH(src); i += 1) {
+        seed = seed * 1103515245 + 12345;
+        src[i] = (float)((seed >> 8) & 0xffff) / 32768.0f - 1.0f;
+    }
+
+    enum SoundIoSimdLevel original = soundio_convert_get_simd_level();
+    enum SoundIoSimdLevel best = soundio_convert_detect_simd_level();
+    int layout_count = soundio_channel_layout_builtin_count();
+    for (int from_index = 0; from_index < layout_count; from_index += 1) {
+        for (int to_index = 0; to_index < layout_count; to_index += 1) {
+            const struct SoundIoChannelLayout *from = soundio_channel_layout_get_builtin(from_index);
+            const struct SoundIoChannelLayout *to = soundio_channel_layout_get_builtin(to_index);
+            struct SoundIoRemix remix;
+            ok_or_panic(soundio_remix_init(&remix, from, to));
+            float matrix[SOUNDIO_MAX_CHANNELS * SOUNDIO_MAX_CHANNELS];
+            soundio_channel_layout_remix_matrix(from, to, matrix);
+            for (int frame = 0; frame < frame_count; frame += 1) {
+                for (int out = 0; out < to->channel_count; out += 1) {
+                    float sum = 0.0f;
+                    for (int in = 0; in < from->channel_count; in += 1)
+                        sum += matrix[out * from->channel_count + in] * src[frame * from->channel_count + in];
+                    expected[frame * to->channel_count + out] = sum;
+                }
+            }
+            for (int level = 0; level <= (int)best; level += 1) {
+                ok_or_panic(soundio_convert_set_simd_level((enum SoundIoSimdLevel)level));
+                for (int i = 0; i < (int)ARRAY_LENGTH(dst); i += 1)
+                    dst[i] = 123.0f;
+                soundio_remix_run(&remix, dst, src, frame_count);
+                int sample_count = frame_count * to->channel_count;
+                for (int i = 0; i < sample_count; i += 1)
+                    assert(fabs(dst[i] - expected[i]) < 0.00001);
+                for (int i = sample_count; i < (int)ARRAY_LENGTH(dst); i += 1)
+                    assert(dst[i] == 123.0f);
+            }
+            soundio_remix_deinit(&remix);
+        }
+    }
+    ok_or_panic(soundio_convert_set_simd_level(original));
+}
+
+static struct SoundIoAtomicLong remix_frames;
+
+static void remix_write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    int fc = soundio_channel_layout_find_channel(&outstream->app_layout, SoundIoChannelIdFrontCenter);
+    float matrix[SOUNDIO_MAX_CHANNELS * SOUNDIO_MAX_CHANNELS];
+    soundio_channel_layout_remix_matrix(&outstream->app_layout, &outstream->layout, matrix);
+    int16_t expected = (int16_t)(0.5f * matrix[fc] * 32767.0f + 0.5f);
+
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        int16_t *device = (int16_t *)soundio_ring_buffer_write_ptr(&os->backend_data.dummy.ring_buffer);
+        ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < outstream->app_layout.channel_count; ch += 1) {
+                float *sample = (float *)(areas[ch].ptr + areas[ch].step * frame);
+                *sample = (ch == fc) ? 0.5f : 0.0f;
+            }
+        }
+        ok_or_panic(soundio_outstream_end_write(outstream));
+        for (int i = 0; i < frame_count * outstream->layout.channel_count; i += 1)
+            assert(abs(device[i] - expected) <= 1);
+        frames_left -= frame_count;
+        SOUNDIO_ATOMIC_FETCH_ADD(remix_frames, frame_count);
+    }
+}
+
+static void remix_read_callback(struct SoundIoInStream *instream, int frame_count_min, int frame_count_max) {
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        assert(areas[0].step == (int)sizeof(float) * instream->app_layout.channel_count);
+        ok_or_panic(soundio_instream_end_read(instream));
+        frames_left -= frame_count;
+        SOUNDIO_ATOMIC_FETCH_ADD(remix_frames, frame_count);
+    }
+}
+
+static void remix_setup_outstream(struct SoundIoOutStream *outstream) {
+    outstream->format = SoundIoFormatS16NE;
+    outstream->layout = *soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdStereo);
+    outstream->app_layout = *soundio_channel_layout_get_builtin(SoundIoChannelLayoutId5Point1Back);
+}
+
+static void remix_setup_instream(struct SoundIoInStream *instream) {
+    instream->format = SoundIoFormatS16NE;
+    instream->layout = *soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdStereo);
+    instream->app_layout = *soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdMono);
+    instream->sample_rate = 48000;
+    instream->app_sample_rate = 44100;
+}
+
+static void test_remixed_streams(void) {
+    struct OutStreamTest out_test = {
+        .write_callback = remix_write_callback,
+        .setup = remix_setup_outstream,
+        .frames = &remix_frames,
+        .frame_goal = 4800,
+    };
+    run_outstream_test(&out_test);
+    struct InStreamTest in_test = {
+        .read_callback = remix_read_callback,
+        .setup = remix_setup_instream,
+        .frames = &remix_frames,
+        .frame_goal = 4800,
+    };
+    run_instream_test(&in_test);
+}
+
+static void test_volume(void) {
+    enum { sample_rate = 1000, frame_count = 100, channel_count = 2 };
+    // A ramp at 1000 Hz is 10 frames long.
+    float samples[frame_count * channel_count];
+    struct SoundIoChannelArea areas[channel_count];
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        areas[ch].ptr = (char *)(samples + ch);
+        areas[ch].step = sizeof(float) * channel_count;
+    }
 
-    for (int i = 0; i < size_bytes; i += 1) {
-        mem.address[i] = rand() % CHAR_MAX;
+    enum SoundIoSimdLevel original = soundio_convert_get_simd_level();
+    enum SoundIoSimdLevel best = soundio_convert_detect_simd_level();
+    for (int level = 0; level <= (int)best; level += 1) {
+        ok_or_panic(soundio_convert_set_simd_level((enum SoundIoSimdLevel)level));
+        struct SoundIoVolume volume;
+        ok_or_panic(soundio_volume_init(&volume, sample_rate, SoundIoVolumeRampLinear));
+        assert(!soundio_volume_active(&volume));
+
+        soundio_volume_set(&volume, 0.5f);
+        assert(soundio_volume_active(&volume));
+        // Split across calls, the ramp must carry on where it left off.
+        for (int i = 0; i < (int)ARRAY_LENGTH(samples); i += 1)
+            samples[i] = 1.0f;
+        soundio_volume_apply(&volume, SoundIoFormatFloat32NE, areas, channel_count, 7);
+        for (int ch = 0; ch < channel_count; ch += 1)
+            areas[ch].ptr += 7 * areas[ch].step;
+        soundio_volume_apply(&volume, SoundIoFormatFloat32NE, areas, channel_count, frame_count - 7);
+        for (int ch = 0; ch < channel_count; ch += 1)
+            areas[ch].ptr = (char *)(samples + ch);
+        float last = 1.0f;
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            float sample = samples[frame * channel_count];
+            assert(sample == samples[frame * channel_count + 1]);
+            assert(sample <= last && last - sample <= 0.05f + 0.0001f);
+            last = sample;
+        }
+        for (int frame = 10; frame < frame_count; frame += 1)
+            assert(samples[frame * channel_count] == 0.5f);
+
+        // Back to unity the ramp goes up, and then it stops costing anything.
+        soundio_volume_set(&volume, 1.0f);
+        int16_t ints[frame_count * channel_count];
+        for (int i = 0; i < (int)ARRAY_LENGTH(ints); i += 1)
+            ints[i] = 16000;
+        struct SoundIoChannelArea int_areas[channel_count];
+        for (int ch = 0; ch < channel_count; ch += 1) {
+            int_areas[ch].ptr = (char *)(ints + ch);
+            int_areas[ch].step = sizeof(int16_t) * channel_count;
+        }
+        soundio_volume_apply(&volume, SoundIoFormatS16NE, int_areas, channel_count, frame_count);
+        assert(abs(ints[0] - 8000) <= 1);
+        for (int frame = 1; frame < frame_count; frame += 1)
+            assert(ints[frame * channel_count] >= ints[(frame - 1) * channel_count]);
+        for (int frame = 10; frame < frame_count; frame += 1)
+            assert(ints[frame * channel_count] == 16000);
+        assert(!soundio_volume_active(&volume));
+
+        // An exponential ramp falls by the same ratio every frame, and to
+        // silence it goes by way of -60 dB.
+        ok_or_panic(soundio_volume_init(&volume, sample_rate, SoundIoVolumeRampExponential));
+        soundio_volume_set(&volume, 0.01f);
+        for (int i = 0; i < (int)ARRAY_LENGTH(samples); i += 1)
+            samples[i] = 1.0f;
+        soundio_volume_apply(&volume, SoundIoFormatFloat32NE, areas, channel_count, frame_count);
+        assert(samples[0] == 1.0f);
+        for (int frame = 1; frame < 10; frame += 1) {
+            float ratio = samples[frame * channel_count] / samples[(frame - 1) * channel_count];
+            assert(fabsf(ratio - powf(0.01f, 0.1f)) < 0.0001f);
+        }
+        for (int frame = 10; frame < frame_count; frame += 1)
+            assert(samples[frame * channel_count] == 0.01f);
+        soundio_volume_set(&volume, 0.0f);
+        for (int i = 0; i < (int)ARRAY_LENGTH(samples); i += 1)
+            samples[i] = 1.0f;
+        soundio_volume_apply(&volume, SoundIoFormatFloat32NE, areas, channel_count, frame_count);
+        assert(fabsf(samples[9 * channel_count] - 0.001f / powf(0.1f, 0.1f)) < 0.0001f);
+        for (int frame = 10; frame < frame_count; frame += 1)
+            assert(samples[frame * channel_count] == 0.0f);
     }
-    for (int i = 0; i < size_bytes; i += 1) {
-        assert(mem.address[i] == mem.address[size_bytes+i]);
+    ok_or_panic(soundio_convert_set_simd_level(original));
+
+    struct SoundIoVolume volume;
+    assert(soundio_volume_init(&volume, sample_rate, (enum SoundIoVolumeRamp)99) == SoundIoErrorInvalid);
+}
+
+static struct SoundIoAtomicLong volume_frames;
+
+static void volume_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    int channel_count = outstream->layout.channel_count;
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        float *device = (float *)soundio_ring_buffer_write_ptr(&os->backend_data.dummy.ring_buffer);
+        ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < channel_count; ch += 1)
+                *(float *)(areas[ch].ptr + areas[ch].step * frame) = 1.0f;
+        }
+        ok_or_panic(soundio_outstream_end_write(outstream));
+        // The ramp is over after the first 10 ms.
+        long frames_before = SOUNDIO_ATOMIC_LOAD(volume_frames);
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < channel_count; ch += 1) {
+                float sample = device[frame * channel_count + ch];
+                assert(sample >= 0.25f && sample <= 1.0f);
+                if (frames_before + frame >= outstream->sample_rate / 100)
+                    assert(sample == 0.25f);
+            }
+        }
+        frames_left -= frame_count;
+        SOUNDIO_ATOMIC_FETCH_ADD(volume_frames, frame_count);
+    }
+}
+
+static void volume_opened_outstream(struct SoundIoOutStream *outstream) {
+    assert(outstream->volume == 1.0f);
+    assert(soundio_outstream_set_volume(outstream, 1.5) == SoundIoErrorInvalid);
+    assert(soundio_outstream_set_volume(outstream, -0.1) == SoundIoErrorInvalid);
+    ok_or_panic(soundio_outstream_set_volume(outstream, 0.25));
+    assert(outstream->volume == 0.25f);
+}
+
+static void test_outstream_software_volume(void) {
+    struct OutStreamTest test = {
+        .write_callback = volume_write_callback,
+        .opened = volume_opened_outstream,
+        .frames = &volume_frames,
+        .frame_goal = 4800,
+    };
+    run_outstream_test(&test);
+}
+
+// Error against `value` in LSBs of S16, for each of `count` samples.
+static void dither_errors(enum SoundIoDither mode, float value, double *errors, int count) {
+    struct SoundIoDitherer d;
+    ok_or_panic(soundio_dither_init(&d, mode, SoundIoFormatS16NE, 1));
+    float samples[256];
+    int16_t ints[256];
+    struct SoundIoChannelArea float_area = {(char *)samples, sizeof(float)};
+    struct SoundIoChannelArea int_area = {(char *)ints, sizeof(int16_t)};
+    for (int start = 0; start < count; start += 256) {
+        for (int i = 0; i < 256; i += 1)
+            samples[i] = value;
+        soundio_dither_apply(&d, &float_area, 256);
+        ok_or_panic(soundio_convert_samples(SoundIoFormatS16NE, &int_area, SoundIoFormatFloat32NE,
+                    &float_area, 1, 256));
+        for (int i = 0; i < 256 && start + i < count; i += 1)
+            errors[start + i] = ints[i] - value * 32768.0;
+    }
+    soundio_dither_deinit(&d);
+}
+
+static void test_dither(void) {
+    enum { count = 1 << 16 };
+    double *errors = ALLOCATE(double, count);
+    assert(errors);
+    // A third of an LSB rounds away to nothing, dithered it is there on
+    // average.
+    float value = 0.3f / 32768.0f;
+    double tpdf_block_power = 0.0;
+    for (int mode = SoundIoDitherNone; mode <= SoundIoDitherShaped; mode += 1) {
+        dither_errors((enum SoundIoDither)mode, value, errors, count);
+        double sum = 0.0;
+        double power = 0.0;
+        // Sums of 64 are a crude low pass.
+        double block_power = 0.0;
+        for (int i = 0; i < count; i += 64) {
+            double block = 0.0;
+            for (int j = 0; j < 64; j += 1)
+                block += errors[i + j];
+            block_power += block * block;
+        }
+        for (int i = 0; i < count; i += 1) {
+            sum += errors[i];
+            power += errors[i] * errors[i];
+        }
+        double mean = sum / count;
+        power /= count;
+        block_power /= count / 64;
+        if (mode == SoundIoDitherNone) {
+            assert(fabs(mean + 0.3) < 0.0001);
+        } else if (mode == SoundIoDitherTpdf) {
+            // Rounding and the triangular noise together are 1/4 LSB^2.
+            assert(fabs(mean) < 0.01);
+            assert(fabs(power - 0.25) < 0.02);
+            tpdf_block_power = block_power;
+        } else {
+            assert(fabs(mean) < 0.01);
+            assert(block_power < tpdf_block_power / 10.0);
+        }
     }
+    free(errors);
 
-    soundio_os_deinit_mirrored_memory(&mem);
+    // Every SIMD level comes up with the same noise, interleaved or not, and
+    // with a channel count that fits the lanes or not.
+    enum { frame_count = 101, max_channel_count = 3 };
+    float reference[frame_count * max_channel_count];
+    float samples[frame_count * max_channel_count];
+    struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+    enum SoundIoSimdLevel original = soundio_convert_get_simd_level();
+    enum SoundIoSimdLevel best = soundio_convert_detect_simd_level();
+    for (int channel_count = 2; channel_count <= max_channel_count; channel_count += 1) {
+        int sample_count = frame_count * channel_count;
+        for (int planar = 0; planar < 2; planar += 1) {
+            for (int ch = 0; ch < channel_count; ch += 1) {
+                areas[ch].ptr = (char *)(planar ? samples + ch * frame_count : samples + ch);
+                areas[ch].step = planar ? sizeof(float) : sizeof(float) * channel_count;
+            }
+            for (int level = 0; level <= (int)best; level += 1) {
+                ok_or_panic(soundio_convert_set_simd_level((enum SoundIoSimdLevel)level));
+                struct SoundIoDitherer d;
+                ok_or_panic(soundio_dither_init(&d, SoundIoDitherTpdf, SoundIoFormatS16NE, channel_count));
+                for (int i = 0; i < sample_count; i += 1)
+                    samples[i] = (float)i / sample_count;
+                soundio_dither_apply(&d, areas, frame_count);
+                soundio_dither_apply(&d, areas, frame_count);
+                soundio_dither_deinit(&d);
+                if (level == 0)
+                    memcpy(reference, samples, sample_count * sizeof(float));
+                else
+                    assert(memcmp(reference, samples, sample_count * sizeof(float)) == 0);
+                for (int i = 0; i < sample_count; i += 1) {
+                    float expected = (float)i / sample_count;
+                    assert(fabs(samples[i] - expected) < 2.0 / 32768.0);
+                }
+            }
+        }
+    }
+    ok_or_panic(soundio_convert_set_simd_level(original));
+
+    // Each channel has noise of its own: the first of many channels gets
+    // the same as a single one, whatever the others take.
+    static float planes[SOUNDIO_MAX_CHANNELS][frame_count];
+    float single[frame_count];
+    for (int mode = SoundIoDitherTpdf; mode <= SoundIoDitherShaped; mode += 1) {
+        struct SoundIoDitherer many, one;
+        ok_or_panic(soundio_dither_init(&many, (enum SoundIoDither)mode, SoundIoFormatS16NE,
+                    SOUNDIO_MAX_CHANNELS));
+        ok_or_panic(soundio_dither_init(&one, (enum SoundIoDither)mode, SoundIoFormatS16NE, 1));
+        for (int ch = 0; ch < SOUNDIO_MAX_CHANNELS; ch += 1) {
+            areas[ch].ptr = (char *)planes[ch];
+            areas[ch].step = sizeof(float);
+        }
+        struct SoundIoChannelArea single_area = {(char *)single, sizeof(float)};
+        for (int pass = 0; pass < 2; pass += 1) {
+            memset(planes, 0, sizeof(planes));
+            memset(single, 0, sizeof(single));
+            soundio_dither_apply(&many, areas, frame_count);
+            soundio_dither_apply(&one, &single_area, frame_count);
+            assert(memcmp(planes[0], single, sizeof(single)) == 0);
+            assert(memcmp(planes[0], planes[SOUNDIO_DITHER_LANES], sizeof(single)) != 0);
+        }
+        soundio_dither_deinit(&many);
+        soundio_dither_deinit(&one);
+    }
+}
+
+static struct SoundIoAtomicLong dither_frames;
+static struct SoundIoAtomicLong dither_sum;
+
+static void dither_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    int channel_count = outstream->layout.channel_count;
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        int16_t *device = (int16_t *)soundio_ring_buffer_write_ptr(&os->backend_data.dummy.ring_buffer);
+        ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < channel_count; ch += 1)
+                *(float *)(areas[ch].ptr + areas[ch].step * frame) = 0.25f / 32768.0f;
+        }
+        ok_or_panic(soundio_outstream_end_write(outstream));
+        long sum = 0;
+        for (int i = 0; i < frame_count * channel_count; i += 1) {
+            assert(device[i] >= -1 && device[i] <= 2);
+            sum += device[i];
+        }
+        frames_left -= frame_count;
+        SOUNDIO_ATOMIC_FETCH_ADD(dither_sum, sum);
+        SOUNDIO_ATOMIC_FETCH_ADD(dither_frames, frame_count);
+    }
+}
+
+static void dither_setup_outstream(struct SoundIoOutStream *outstream) {
+    outstream->format = SoundIoFormatS16NE;
+    outstream->native_float = true;
+    outstream->dither = SoundIoDitherTpdf;
+    SOUNDIO_ATOMIC_STORE(dither_sum, 0);
+}
+
+static void test_dithered_streams(void) {
+    struct OutStreamTest test = {
+        .write_callback = dither_write_callback,
+        .setup = dither_setup_outstream,
+        .frames = &dither_frames,
+        .frame_goal = 48000,
+    };
+    run_outstream_test(&test);
+
+    // Plain rounding would have made it all zeros.
+    double mean = SOUNDIO_ATOMIC_LOAD(dither_sum) / (2.0 * SOUNDIO_ATOMIC_LOAD(dither_frames));
+    assert(fabs(mean - 0.25) < 0.02);
+}
+
+// The window is `frame_count` frames from `first_frame`, clips count from
+// the start.
+static void check_meters(const struct SoundIoMeters *meters, int channel_count, const float *samples,
+        int first_frame, int frame_count, float clip_level)
+{
+    assert(meters->channel_count == channel_count);
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        float peak = 0.0f;
+        double sum = 0.0;
+        long clips = 0;
+        for (int frame = 0; frame < first_frame + frame_count; frame += 1) {
+            float x = samples[frame * channel_count + ch];
+            clips += fabsf(x) >= clip_level;
+            if (frame < first_frame)
+                continue;
+            peak = fmaxf(peak, fabsf(x));
+            sum += x * x;
+        }
+        assert(fabsf(meters->peak[ch] - peak) < 0.0001f);
+        assert(fabs(meters->rms[ch] - sqrt(sum / frame_count)) < 0.0001);
+        assert(meters->clip_count[ch] == clips);
+    }
+}
+
+static void test_meter(void) {
+    enum { frame_count = 1000, window = 480, max_channels = 3 };
+    float samples[frame_count * max_channels];
+    int16_t ints[frame_count * max_channels];
+    enum SoundIoSimdLevel original = soundio_convert_get_simd_level();
+    enum SoundIoSimdLevel best = soundio_convert_detect_simd_level();
+    for (int level = 0; level <= (int)best; level += 1) {
+        ok_or_panic(soundio_convert_set_simd_level((enum SoundIoSimdLevel)level));
+        // Two channels interleaved run on the lanes, three and S16 do not.
+        for (int channel_count = 2; channel_count <= max_channels; channel_count += 1) {
+            for (int frame = 0; frame < frame_count; frame += 1) {
+                samples[frame * channel_count] = 0.5f * (float)sin(frame * 0.05);
+                // Full scale every 100 frames.
+                samples[frame * channel_count + 1] = (frame % 100 == 0) ? -1.0f : 0.25f;
+                if (channel_count > 2)
+                    samples[frame * channel_count + 2] = (frame % 7) / 7.0f;
+            }
+            for (int format_index = 0; format_index < 2; format_index += 1) {
+                enum SoundIoFormat format = format_index ? SoundIoFormatS16NE : SoundIoFormatFloat32NE;
+                int bytes = format_index ? 2 : 4;
+                char *buffer = format_index ? (char *)ints : (char *)samples;
+                struct SoundIoChannelArea areas[max_channels];
+                for (int ch = 0; ch < channel_count; ch += 1) {
+                    areas[ch].ptr = buffer + ch * bytes;
+                    areas[ch].step = bytes * channel_count;
+                }
+                if (format_index) {
+                    struct SoundIoChannelArea float_areas[max_channels];
+                    for (int ch = 0; ch < channel_count; ch += 1) {
+                        float_areas[ch].ptr = (char *)(samples + ch);
+                        float_areas[ch].step = sizeof(float) * channel_count;
+                    }
+                    ok_or_panic(soundio_convert_samples(SoundIoFormatS16NE, areas, SoundIoFormatFloat32NE,
+                                float_areas, channel_count, frame_count));
+                }
+
+                struct SoundIoMeter meter;
+                memset(&meter, 0, sizeof(meter));
+                soundio_meter_init(&meter, format, channel_count, window);
+                struct SoundIoMeters meters;
+                soundio_meter_read(&meter, &meters);
+                assert(meters.window_count == 0);
+                // Uneven pieces, which cross the end of the first window.
+                int done = 0;
+                for (int piece = 37; done < frame_count; piece = piece * 3 % 301 + 1) {
+                    int count = soundio_int_min(piece, frame_count - done);
+                    struct SoundIoChannelArea rest[max_channels];
+                    for (int ch = 0; ch < channel_count; ch += 1) {
+                        rest[ch].ptr = areas[ch].ptr + done * areas[ch].step;
+                        rest[ch].step = areas[ch].step;
+                    }
+                    soundio_meter_run(&meter, rest, count);
+                    done += count;
+                }
+                soundio_meter_read(&meter, &meters);
+                assert(meters.window_count == 2);
+                float clip_level = format_index ? 32767.0f / 32768.0f : 1.0f;
+                check_meters(&meters, channel_count, samples, window, window, clip_level);
+
+                // Silence, as from a hole, empties the levels but keeps the clips.
+                soundio_meter_run(&meter, NULL, window);
+                soundio_meter_read(&meter, &meters);
+                assert(meters.window_count == 3);
+                assert(meters.peak[0] <= 0.5f && meters.clip_count[1] == 10);
+            }
+        }
+    }
+    ok_or_panic(soundio_convert_set_simd_level(original));
+}
+
+static struct SoundIoMeter threaded_meter;
+static struct SoundIoAtomicBool meter_done;
+
+static void meter_writer_thread_run(void *arg) {
+    enum { channel_count = 8, window = 16 };
+    float samples[window * channel_count];
+    struct SoundIoChannelArea areas[channel_count];
+    for (int ch = 0; ch < channel_count; ch += 1) {
+        areas[ch].ptr = (char *)(samples + ch);
+        areas[ch].step = sizeof(float) * channel_count;
+    }
+    for (long w = 1; !SOUNDIO_ATOMIC_LOAD(meter_done); w += 1) {
+        float value = (float)(w % 100 + 1) / 128.0f;
+        for (int i = 0; i < window * channel_count; i += 1)
+            samples[i] = value;
+        soundio_meter_run(&threaded_meter, areas, window);
+    }
+}
+
+// Each window has its own level, so a torn read shows up as a level which
+// does not go with its window count.
+static void test_meter_threaded(void) {
+    memset(&threaded_meter, 0, sizeof(threaded_meter));
+    soundio_meter_init(&threaded_meter, SoundIoFormatFloat32NE, 8, 16);
+    SOUNDIO_ATOMIC_STORE(meter_done, false);
+    struct SoundIoOsThread *writer_thread;
+    ok_or_panic(soundio_os_thread_create(meter_writer_thread_run, NULL, NULL, false, &writer_thread));
+    long reads = 0;
+    long last_window_count = 0;
+    while (last_window_count < 100000) {
+        struct SoundIoMeters meters;
+        soundio_meter_read(&threaded_meter, &meters);
+        assert(meters.window_count >= last_window_count);
+        last_window_count = meters.window_count;
+        if (meters.window_count > 0) {
+            float value = (float)(meters.window_count % 100 + 1) / 128.0f;
+            for (int ch = 0; ch < 8; ch += 1)
+                assert(meters.peak[ch] == value);
+        }
+        reads += 1;
+        if (reads % 64 == 0)
+            soundio_os_thread_yield();
+    }
+    SOUNDIO_ATOMIC_STORE(meter_done, true);
+    soundio_os_thread_destroy(writer_thread);
+}
+
+static struct SoundIoAtomicLong metered_frames;
+
+static void metered_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < outstream->layout.channel_count; ch += 1)
+                *(float *)(areas[ch].ptr + areas[ch].step * frame) = (ch == 0) ? 0.5f : -0.25f;
+        }
+        ok_or_panic(soundio_outstream_end_write(outstream));
+        frames_left -= frame_count;
+        SOUNDIO_ATOMIC_FETCH_ADD(metered_frames, frame_count);
+    }
+}
+
+static void metered_setup_outstream(struct SoundIoOutStream *outstream) {
+    outstream->format = SoundIoFormatS16NE;
+    outstream->native_float = true;
+    outstream->metering = true;
+}
+
+static void metered_check_outstream(struct SoundIoOutStream *outstream) {
+    struct SoundIoMeters meters;
+    ok_or_panic(soundio_outstream_get_meters(outstream, &meters));
+    assert(meters.window_count >= 1);
+    assert(meters.channel_count == outstream->layout.channel_count);
+    assert(meters.peak[0] == 0.5f && meters.rms[0] == 0.5f && meters.clip_count[0] == 0);
+    assert(meters.peak[1] == 0.25f && meters.rms[1] == 0.25f);
+}
+
+static void test_metered_streams(void) {
+    struct SoundIo *soundio = connect_dummy();
+    struct SoundIoOutStream *outstream = create_dummy_outstream(soundio, metered_write_callback, NULL);
+    struct SoundIoMeters meters;
+    outstream->meter_window = -1.0;
+    assert(soundio_outstream_open(outstream) == SoundIoErrorInvalid);
+    outstream->meter_window = 0.0;
+    ok_or_panic(soundio_outstream_open(outstream));
+    assert(soundio_outstream_get_meters(outstream, &meters) == SoundIoErrorInvalid);
+    soundio_outstream_destroy(outstream);
+    soundio_destroy(soundio);
+
+    struct OutStreamTest test = {
+        .write_callback = metered_write_callback,
+        .setup = metered_setup_outstream,
+        .check = metered_check_outstream,
+        .frames = &metered_frames,
+        .frame_goal = 4800,
+    };
+    run_outstream_test(&test);
+}
+
+static bool page_faults_lock_memory;
+static long page_faults_minor;
+static long page_faults_major;
+
+static void page_faults_setup_outstream(struct SoundIoOutStream *outstream) {
+    // The dummy backend's thread is only made when the first stream starts.
+    outstream->device->soundio->lock_memory = page_faults_lock_memory;
+}
+
+static void page_faults_opened_outstream(struct SoundIoOutStream *outstream) {
+    long minor, major;
+    ok_or_panic(soundio_outstream_get_page_faults(outstream, &minor, &major));
+    assert(minor == 0 && major == 0);
+}
+
+static void page_faults_check_outstream(struct SoundIoOutStream *outstream) {
+    ok_or_panic(soundio_outstream_get_page_faults(outstream, &page_faults_minor, &page_faults_major));
+}
+
+static void run_outstream_page_faults(bool lock_memory, long *out_minor, long *out_major) {
+    struct OutStreamTest test = {
+        .write_callback = silence_write_callback,
+        .setup = page_faults_setup_outstream,
+        .opened = page_faults_opened_outstream,
+        .check = page_faults_check_outstream,
+        .frames = &silence_frames,
+        .frame_goal = 4800,
+    };
+    page_faults_lock_memory = lock_memory;
+    run_outstream_test(&test);
+    *out_minor = page_faults_minor;
+    *out_major = page_faults_major;
+}
+
+static void test_outstream_page_faults(void) {
+    long minor, major, locked_minor, locked_major;
+    run_outstream_page_faults(false, &minor, &major);
+    run_outstream_page_faults(true, &locked_minor, &locked_major);
+    // Locked memory is prefaulted, so the stream thread should not fault
+    // any more than it does without.
+    assert(locked_minor + locked_major <= minor + major);
 }
 
 static void test_nearest_sample_rate(void) {
@@ -211,6 +2360,644 @@ static void test_nearest_sample_rate(void) {
     assert(soundio_device_nearest_sample_rate(&device, 9999999) == 96000);
 }
 
+static struct SoundIoAtomicLong freewheel_frames;
+static struct SoundIoAtomicInt freewheel_xruns;
+
+static void freewheel_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    double latency;
+    ok_or_panic(soundio_outstream_get_latency(outstream, &latency));
+    // Virtual time: exactly one period has played since the last callback.
+    double expected = outstream->software_latency - frame_count_max / (double)outstream->sample_rate;
+    assert(fabs(latency - expected) < 1e-9);
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        for (int ch = 0; ch < outstream->layout.channel_count; ch += 1)
+            *(float *)(areas[ch].ptr + areas[ch].step * frame) = 0.0f;
+    }
+    ok_or_panic(soundio_outstream_end_write(outstream));
+    SOUNDIO_ATOMIC_FETCH_ADD(freewheel_frames, frame_count);
+}
+
+static void freewheel_underflow_callback(struct SoundIoOutStream *outstream) {
+    SOUNDIO_ATOMIC_FETCH_ADD(freewheel_xruns, 1);
+}
+
+static void freewheel_read_callback(struct SoundIoInStream *instream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+    ok_or_panic(soundio_instream_end_read(instream));
+    SOUNDIO_ATOMIC_FETCH_ADD(freewheel_frames, frame_count);
+}
+
+static void freewheel_overflow_callback(struct SoundIoInStream *instream) {
+    SOUNDIO_ATOMIC_FETCH_ADD(freewheel_xruns, 1);
+}
+
+// On the wall clock, an input stream which is read promptly never overflows.
+static void test_dummy_instream_clock(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    struct SoundIoDevice *device = soundio_get_input_device(soundio,
+            soundio_default_input_device_index(soundio));
+    assert(device);
+    struct SoundIoInStream *instream = soundio_instream_create(device);
+    instream->format = SoundIoFormatFloat32NE;
+    instream->sample_rate = 48000;
+    instream->software_latency = 0.02;
+    instream->read_callback = freewheel_read_callback;
+    instream->overflow_callback = freewheel_overflow_callback;
+    ok_or_panic(soundio_instream_open(instream));
+    SOUNDIO_ATOMIC_STORE(freewheel_frames, 0);
+    SOUNDIO_ATOMIC_STORE(freewheel_xruns, 0);
+    ok_or_panic(soundio_instream_start(instream));
+    struct SoundIoOsCond *cond = soundio_os_cond_create();
+    assert(cond);
+    soundio_os_cond_timed_wait(cond, NULL, 0.5);
+    soundio_os_cond_destroy(cond);
+    soundio_instream_destroy(instream);
+    assert(SOUNDIO_ATOMIC_LOAD(freewheel_xruns) == 0);
+    assert(SOUNDIO_ATOMIC_LOAD(freewheel_frames) > 0);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+}
+
+static void test_dummy_freewheel(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_freewheel = true;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+
+    // Ten minutes of audio, which must take a lot less than ten minutes.
+    long frame_goal = 48000L * 600;
+    struct SoundIoDevice *device = soundio_get_output_device(soundio,
+            soundio_default_output_device_index(soundio));
+    assert(device);
+    struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+    outstream->format = SoundIoFormatFloat32NE;
+    outstream->sample_rate = 48000;
+    outstream->software_latency = 0.02;
+    outstream->write_callback = freewheel_write_callback;
+    outstream->underflow_callback = freewheel_underflow_callback;
+    outstream->error_callback = error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+    SOUNDIO_ATOMIC_STORE(freewheel_frames, 0);
+    SOUNDIO_ATOMIC_STORE(freewheel_xruns, 0);
+    ok_or_panic(soundio_outstream_start(outstream));
+    double end_time = soundio_os_get_time() + 60.0;
+    while (SOUNDIO_ATOMIC_LOAD(freewheel_frames) < frame_goal) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_os_thread_yield();
+    }
+    soundio_outstream_destroy(outstream);
+    assert(SOUNDIO_ATOMIC_LOAD(freewheel_xruns) == 0);
+    soundio_device_unref(device);
+
+    device = soundio_get_input_device(soundio, soundio_default_input_device_index(soundio));
+    assert(device);
+    struct SoundIoInStream *instream = soundio_instream_create(device);
+    instream->format = SoundIoFormatFloat32NE;
+    instream->sample_rate = 48000;
+    instream->software_latency = 0.02;
+    instream->read_callback = freewheel_read_callback;
+    instream->overflow_callback = freewheel_overflow_callback;
+    ok_or_panic(soundio_instream_open(instream));
+    SOUNDIO_ATOMIC_STORE(freewheel_frames, 0);
+    ok_or_panic(soundio_instream_start(instream));
+    end_time = soundio_os_get_time() + 60.0;
+    while (SOUNDIO_ATOMIC_LOAD(freewheel_frames) < frame_goal) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_os_thread_yield();
+    }
+    soundio_instream_destroy(instream);
+    assert(SOUNDIO_ATOMIC_LOAD(freewheel_xruns) == 0);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+}
+
+static struct SoundIoAtomicLong loopback_played;
+static struct SoundIoAtomicLong loopback_recorded;
+static int loopback_delay;
+
+static int16_t loopback_value(long frame) {
+    return (int16_t)(frame % 30000 + 1);
+}
+
+static void loopback_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+    long played = SOUNDIO_ATOMIC_LOAD(loopback_played);
+    for (int frame = 0; frame < frame_count; frame += 1)
+        *(int16_t *)(areas[0].ptr + areas[0].step * frame) = loopback_value(played + frame);
+    ok_or_panic(soundio_outstream_end_write(outstream));
+    SOUNDIO_ATOMIC_STORE(loopback_played, played + frame_count);
+}
+
+// Channel 0 is what was played, converted from S16 to S32, after exactly
+// `loopback_delay` frames of silence. Channel 1 was not played.
+static void loopback_read_callback(struct SoundIoInStream *instream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+    long recorded = SOUNDIO_ATOMIC_LOAD(loopback_recorded);
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        long played_frame = recorded + frame - loopback_delay;
+        int32_t expected = played_frame < 0 ? 0 : loopback_value(played_frame) * 65536;
+        assert(*(int32_t *)(areas[0].ptr + areas[0].step * frame) == expected);
+        assert(*(int32_t *)(areas[1].ptr + areas[1].step * frame) == 0);
+    }
+    ok_or_panic(soundio_instream_end_read(instream));
+    SOUNDIO_ATOMIC_STORE(loopback_recorded, recorded + frame_count);
+}
+
+static void silence_read_callback(struct SoundIoInStream *instream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        for (int ch = 0; ch < instream->layout.channel_count; ch += 1)
+            assert(*(uint8_t *)(areas[ch].ptr + areas[ch].step * frame) == 0x80);
+    }
+    ok_or_panic(soundio_instream_end_read(instream));
+    SOUNDIO_ATOMIC_FETCH_ADD(loopback_recorded, frame_count);
+}
+
+static void test_dummy_loopback(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_freewheel = true;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    struct SoundIoDevice *in_device = soundio_get_input_device(soundio,
+            soundio_default_input_device_index(soundio));
+    struct SoundIoDevice *out_device = soundio_get_output_device(soundio,
+            soundio_default_output_device_index(soundio));
+    assert(in_device && out_device);
+
+    // Without loopback the input records silence.
+    struct SoundIoInStream *instream = soundio_instream_create(in_device);
+    instream->format = SoundIoFormatU8;
+    instream->sample_rate = 48000;
+    instream->software_latency = 0.02;
+    instream->read_callback = silence_read_callback;
+    instream->overflow_callback = freewheel_overflow_callback;
+    ok_or_panic(soundio_instream_open(instream));
+    SOUNDIO_ATOMIC_STORE(loopback_recorded, 0);
+    ok_or_panic(soundio_instream_start(instream));
+    double end_time = soundio_os_get_time() + 10.0;
+    while (SOUNDIO_ATOMIC_LOAD(loopback_recorded) < 48000) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_os_thread_yield();
+    }
+    soundio_instream_destroy(instream);
+
+    soundio->dummy_loopback = true;
+    soundio->dummy_loopback_latency = -0.1;
+    struct SoundIoOutStream *outstream = soundio_outstream_create(out_device);
+    outstream->format = SoundIoFormatS16NE;
+    outstream->layout = *soundio_channel_layout_get_default(1);
+    outstream->sample_rate = 48000;
+    outstream->software_latency = 0.02;
+    outstream->write_callback = loopback_write_callback;
+    outstream->underflow_callback = freewheel_underflow_callback;
+    outstream->error_callback = error_callback;
+    assert(soundio_outstream_open(outstream) == SoundIoErrorInvalid);
+    soundio_outstream_destroy(outstream);
+
+    soundio->dummy_loopback_latency = 0.05;
+    loopback_delay = 2400;
+    instream = soundio_instream_create(in_device);
+    instream->format = SoundIoFormatS32NE;
+    instream->layout = *soundio_channel_layout_get_default(2);
+    instream->sample_rate = 48000;
+    instream->software_latency = 0.02;
+    instream->read_callback = loopback_read_callback;
+    instream->overflow_callback = freewheel_overflow_callback;
+    ok_or_panic(soundio_instream_open(instream));
+    outstream = soundio_outstream_create(out_device);
+    outstream->format = SoundIoFormatS16NE;
+    outstream->layout = *soundio_channel_layout_get_default(1);
+    outstream->sample_rate = 48000;
+    outstream->software_latency = 0.02;
+    outstream->write_callback = loopback_write_callback;
+    outstream->underflow_callback = freewheel_underflow_callback;
+    outstream->error_callback = error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+
+    SOUNDIO_ATOMIC_STORE(loopback_played, 0);
+    SOUNDIO_ATOMIC_STORE(loopback_recorded, 0);
+    SOUNDIO_ATOMIC_STORE(freewheel_xruns, 0);
+    // Nothing is recorded until something plays.
+    ok_or_panic(soundio_instream_start(instream));
+    soundio_os_thread_yield();
+    assert(SOUNDIO_ATOMIC_LOAD(loopback_recorded) == 0);
+    ok_or_panic(soundio_outstream_start(outstream));
+    end_time = soundio_os_get_time() + 30.0;
+    while (SOUNDIO_ATOMIC_LOAD(loopback_recorded) < 48000L * 60) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_os_thread_yield();
+    }
+    soundio_outstream_destroy(outstream);
+    soundio_instream_destroy(instream);
+    assert(SOUNDIO_ATOMIC_LOAD(freewheel_xruns) == 0);
+
+    soundio_device_unref(in_device);
+    soundio_device_unref(out_device);
+    soundio_destroy(soundio);
+}
+
+static struct SoundIoAtomicInt fault_stream_errors;
+static int fault_devices_changes;
+static int fault_disconnects;
+
+static void fault_outstream_error_callback(struct SoundIoOutStream *outstream, int err) {
+    assert(err == SoundIoErrorStreaming);
+    SOUNDIO_ATOMIC_FETCH_ADD(fault_stream_errors, 1);
+}
+
+static void fault_devices_change(struct SoundIo *soundio) {
+    fault_devices_changes += 1;
+}
+
+static void fault_backend_disconnect(struct SoundIo *soundio, int err) {
+    assert(err == SoundIoErrorBackendDisconnected);
+    fault_disconnects += 1;
+}
+
+// Plays until `frame_goal` frames were written and returns the xruns.
+static int run_faulty_outstream(const char *faults, bool freewheel, long frame_goal) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_faults = faults;
+    soundio->dummy_freewheel = freewheel;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    struct SoundIoDevice *device = soundio_get_output_device(soundio,
+            soundio_default_output_device_index(soundio));
+    assert(device);
+    struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+    outstream->format = SoundIoFormatFloat32NE;
+    outstream->sample_rate = 48000;
+    outstream->software_latency = 0.02;
+    outstream->write_callback = freewheel_write_callback;
+    outstream->underflow_callback = freewheel_underflow_callback;
+    outstream->error_callback = error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+    SOUNDIO_ATOMIC_STORE(freewheel_frames, 0);
+    SOUNDIO_ATOMIC_STORE(freewheel_xruns, 0);
+    ok_or_panic(soundio_outstream_start(outstream));
+    double end_time = soundio_os_get_time() + 10.0;
+    while (SOUNDIO_ATOMIC_LOAD(freewheel_frames) < frame_goal) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_os_thread_yield();
+    }
+    soundio_outstream_destroy(outstream);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+    return SOUNDIO_ATOMIC_LOAD(freewheel_xruns);
+}
+
+static void test_dummy_faults(void) {
+    const char *bad_schedules[] = {"bogus", "underflow@", "stall@10", "jitter=normal:1",
+        "remove@-1", "underflow@10x"};
+    for (size_t i = 0; i < ARRAY_LENGTH(bad_schedules); i += 1) {
+        struct SoundIo *soundio = soundio_create();
+        assert(soundio);
+        soundio->dummy_faults = bad_schedules[i];
+        assert(soundio_connect_backend(soundio, SoundIoBackendDummy) == SoundIoErrorInvalid);
+        soundio_destroy(soundio);
+    }
+
+    // Out of order, and once the frame is passed each fault happens once.
+    assert(run_faulty_outstream("seed=7 underflow@96000,underflow@48000", true, 48000 * 4) == 2);
+    assert(run_faulty_outstream("", true, 48000 * 4) == 0);
+    // Stalling for longer than the buffer lasts underflows.
+    assert(run_faulty_outstream("jitter=uniform:0.001 stall@2400:0.1", false, 9600) >= 1);
+
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_freewheel = true;
+    soundio->dummy_faults = "overflow@48000";
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    struct SoundIoDevice *device = soundio_get_input_device(soundio,
+            soundio_default_input_device_index(soundio));
+    assert(device);
+    struct SoundIoInStream *instream = soundio_instream_create(device);
+    instream->format = SoundIoFormatFloat32NE;
+    instream->sample_rate = 48000;
+    instream->software_latency = 0.02;
+    instream->read_callback = freewheel_read_callback;
+    instream->overflow_callback = freewheel_overflow_callback;
+    ok_or_panic(soundio_instream_open(instream));
+    SOUNDIO_ATOMIC_STORE(freewheel_frames, 0);
+    SOUNDIO_ATOMIC_STORE(freewheel_xruns, 0);
+    ok_or_panic(soundio_instream_start(instream));
+    double end_time = soundio_os_get_time() + 10.0;
+    while (SOUNDIO_ATOMIC_LOAD(freewheel_frames) < 48000 * 4) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_os_thread_yield();
+    }
+    soundio_instream_destroy(instream);
+    assert(SOUNDIO_ATOMIC_LOAD(freewheel_xruns) == 1);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+
+    soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_faults = "remove@0.1";
+    soundio->on_devices_change = fault_devices_change;
+    soundio->on_backend_disconnect = fault_backend_disconnect;
+    fault_devices_changes = 0;
+    fault_disconnects = 0;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    assert(fault_devices_changes == 1);
+    device = soundio_get_output_device(soundio, soundio_default_output_device_index(soundio));
+    assert(device);
+    struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+    outstream->format = SoundIoFormatFloat32NE;
+    outstream->software_latency = 0.02;
+    outstream->write_callback = freewheel_write_callback;
+    outstream->error_callback = fault_outstream_error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+    SOUNDIO_ATOMIC_STORE(fault_stream_errors, 0);
+    ok_or_panic(soundio_outstream_start(outstream));
+    end_time = soundio_os_get_time() + 10.0;
+    while (!fault_disconnects) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_wait_events(soundio);
+    }
+    assert(fault_devices_changes == 2 && fault_disconnects == 1);
+    assert(soundio_output_device_count(soundio) == 0);
+    assert(soundio_default_output_device_index(soundio) == -1);
+    while (!SOUNDIO_ATOMIC_LOAD(fault_stream_errors)) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_os_thread_yield();
+    }
+    soundio_outstream_destroy(outstream);
+    assert(SOUNDIO_ATOMIC_LOAD(fault_stream_errors) == 1);
+    outstream = soundio_outstream_create(device);
+    outstream->write_callback = freewheel_write_callback;
+    assert(soundio_outstream_open(outstream) == SoundIoErrorNoSuchDevice);
+    soundio_outstream_destroy(outstream);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+}
+
+static void shared_timer_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoAtomicLong *frames = (struct SoundIoAtomicLong *)outstream->userdata;
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+    for (int frame = 0; frame < frame_count; frame += 1)
+        *(int16_t *)(areas[0].ptr + areas[0].step * frame) = 0;
+    ok_or_panic(soundio_outstream_end_write(outstream));
+    SOUNDIO_ATOMIC_FETCH_ADD((*frames), frame_count);
+}
+
+static long shared_timer_min_frames(struct SoundIoAtomicLong *frames, int first, int count) {
+    long min_frames = LONG_MAX;
+    for (int i = first; i < count; i += 1) {
+        long n = SOUNDIO_ATOMIC_LOAD(frames[i]);
+        if (n < min_frames)
+            min_frames = n;
+    }
+    return min_frames;
+}
+
+static void shared_timer_wait(struct SoundIoAtomicLong *frames, int first, int count, long goal) {
+    double end_time = soundio_os_get_time() + 60.0;
+    while (shared_timer_min_frames(frames, first, count) < goal) {
+        assert(soundio_os_get_time() < end_time);
+        soundio_os_thread_yield();
+    }
+}
+
+static void test_dummy_shared_timer(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_freewheel = true;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    struct SoundIoDevice *device = soundio_get_output_device(soundio,
+            soundio_default_output_device_index(soundio));
+    assert(device);
+
+    // Far more streams than it would be sensible to have threads for.
+    enum { stream_count = 200 };
+    static struct SoundIoAtomicLong frames[stream_count];
+    struct SoundIoOutStream *outstreams[stream_count];
+    SOUNDIO_ATOMIC_STORE(freewheel_xruns, 0);
+    for (int i = 0; i < stream_count; i += 1) {
+        SOUNDIO_ATOMIC_STORE(frames[i], 0);
+        struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+        outstream->format = SoundIoFormatS16NE;
+        outstream->layout = *soundio_channel_layout_get_default(1);
+        outstream->sample_rate = 48000;
+        outstream->software_latency = 0.02;
+        outstream->userdata = &frames[i];
+        outstream->write_callback = shared_timer_write_callback;
+        outstream->underflow_callback = freewheel_underflow_callback;
+        outstream->error_callback = error_callback;
+        ok_or_panic(soundio_outstream_open(outstream));
+        ok_or_panic(soundio_outstream_start(outstream));
+        outstreams[i] = outstream;
+    }
+    // Ten seconds of virtual time for every one of them.
+    shared_timer_wait(frames, 0, stream_count, 48000L * 10);
+
+    // A paused stream drops out while the rest carry on, and comes back
+    // when it is resumed.
+    ok_or_panic(soundio_outstream_pause(outstreams[0], true));
+    shared_timer_wait(frames, 1, stream_count, 48000L * 11);
+    long paused_frames = SOUNDIO_ATOMIC_LOAD(frames[0]);
+    shared_timer_wait(frames, 1, stream_count, 48000L * 12);
+    assert(SOUNDIO_ATOMIC_LOAD(frames[0]) == paused_frames);
+    ok_or_panic(soundio_outstream_pause(outstreams[0], false));
+    shared_timer_wait(frames, 0, 1, paused_frames + 48000L);
+
+    for (int i = 0; i < stream_count; i += 1)
+        soundio_outstream_destroy(outstreams[i]);
+    assert(SOUNDIO_ATOMIC_LOAD(freewheel_xruns) == 0);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+}
+
+static struct SoundIoAtomicLong packed_frames;
+// What 0.5 looks like in each of the packed formats, in the order
+// test_dummy_devices names them.
+static const unsigned char packed_half[][3] = {
+    {0x00, 0x00, 0x40},
+    {0x40, 0x00, 0x00},
+    {0x00, 0x00, 0xc0},
+    {0xc0, 0x00, 0x00},
+};
+static int packed_index;
+
+static void packed_write_callback(struct SoundIoOutStream *outstream,
+        int frame_count_min, int frame_count_max)
+{
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    int channel_count = outstream->layout.channel_count;
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        struct SoundIoChannelArea *areas;
+        int frame_count = frames_left;
+        unsigned char *device = (unsigned char *)soundio_ring_buffer_write_ptr(&os->backend_data.dummy.ring_buffer);
+        ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+        if (!frame_count)
+            break;
+        for (int frame = 0; frame < frame_count; frame += 1) {
+            for (int ch = 0; ch < channel_count; ch += 1)
+                *(float *)(areas[ch].ptr + areas[ch].step * frame) = 0.5f;
+        }
+        ok_or_panic(soundio_outstream_end_write(outstream));
+        for (int i = 0; i < frame_count * channel_count; i += 1)
+            assert(memcmp(device + 3 * i, packed_half[packed_index], 3) == 0);
+        frames_left -= frame_count;
+        SOUNDIO_ATOMIC_FETCH_ADD(packed_frames, frame_count);
+    }
+}
+
+static void packed_setup_outstream(struct SoundIoOutStream *outstream) {
+    outstream->format = outstream->device->formats[packed_index];
+    outstream->native_float = true;
+}
+
+static void test_dummy_devices(void) {
+    const char *bad_descriptions[] = {"speaker", "outx", "out count=0", "out count=4097",
+        "out count=1000000000", "out channels=0", "out channels=4-2", "out formats=s17le",
+        "out formats=", "out rates=100", "out rates=48000 rate=44100", "out latency=0.5-0.1", "out latency=0-1",
+        "out latency_current=9", "in bogus=1"};
+    for (size_t i = 0; i < ARRAY_LENGTH(bad_descriptions); i += 1) {
+        struct SoundIo *soundio = soundio_create();
+        assert(soundio);
+        soundio->dummy_devices = bad_descriptions[i];
+        assert(soundio_connect_backend(soundio, SoundIoBackendDummy) == SoundIoErrorInvalid);
+        soundio_destroy(soundio);
+    }
+
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_devices = "";
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    assert(soundio_output_device_count(soundio) == 0);
+    assert(soundio_input_device_count(soundio) == 0);
+    assert(soundio_default_output_device_index(soundio) == -1);
+    assert(soundio_default_input_device_index(soundio) == -1);
+    soundio_destroy(soundio);
+
+    soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_devices =
+        "out count=300 channels=2 formats=s16le|float32le rates=44100|48000-96000 latency=0.005-0.5;"
+        "in count=200, channels=1-2, formats=s24le, rates=16000, latency_current=0.02;"
+        "out";
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    assert(soundio_output_device_count(soundio) == 301);
+    assert(soundio_input_device_count(soundio) == 200);
+    assert(soundio_default_output_device_index(soundio) == 0);
+
+    struct SoundIoDevice *device = soundio_get_output_device(soundio, 0);
+    assert(strcmp(device->id, "dummy-out") == 0);
+    soundio_device_unref(device);
+    device = soundio_get_output_device(soundio, 300);
+    assert(strcmp(device->id, "dummy-out-300") == 0);
+    assert(device->format_count == 18);
+    assert(device->software_latency_min == 0.01);
+    soundio_device_unref(device);
+
+    device = soundio_get_output_device(soundio, 123);
+    assert(strcmp(device->id, "dummy-out-123") == 0);
+    for (int i = 0; i < device->layout_count; i += 1)
+        assert(device->layouts[i].channel_count == 2);
+    assert(device->format_count == 2);
+    assert(device->formats[0] == SoundIoFormatS16LE);
+    assert(device->formats[1] == SoundIoFormatFloat32LE);
+    assert(device->sample_rate_count == 2);
+    assert(device->sample_rate_current == 48000);
+    assert(soundio_device_supports_sample_rate(device, 44100));
+    assert(!soundio_device_supports_sample_rate(device, 32000));
+    assert(soundio_device_supports_sample_rate(device, 88200));
+    assert(device->software_latency_min == 0.005);
+    assert(device->software_latency_max == 0.5);
+    assert(device->software_latency_current == 0.1);
+    soundio_device_unref(device);
+
+    device = soundio_get_input_device(soundio, 199);
+    assert(strcmp(device->id, "dummy-in-199") == 0);
+    for (int i = 0; i < device->layout_count; i += 1)
+        assert(device->layouts[i].channel_count <= 2);
+    assert(device->format_count == 1);
+    assert(device->sample_rate_current == 16000);
+    assert(device->software_latency_current == 0.02);
+    soundio_device_unref(device);
+
+    // A stream opens on every one of them.
+    for (int i = 0; i < 300; i += 1) {
+        device = soundio_get_output_device(soundio, i);
+        struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+        outstream->format = SoundIoFormatFloat32LE;
+        outstream->sample_rate = 44100;
+        outstream->write_callback = freewheel_write_callback;
+        ok_or_panic(soundio_outstream_open(outstream));
+        assert(outstream->layout.channel_count == 2);
+        soundio_outstream_destroy(outstream);
+        soundio_device_unref(device);
+    }
+    soundio_destroy(soundio);
+
+    // The packed 24 bit formats are only there when asked for by name.
+    soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_devices = "out formats=s24packedle|s24packedbe|u24packedle|u24packedbe;"
+        "out formats=s8|u8|s16le|s16be|u16le|u16be|s24le|s24be|u24le|u24be|s24packedle|s24packedbe|"
+        "u24packedle|u24packedbe|s32le|s32be|u32le|u32be|float32le|float32be|float64le|float64be";
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    device = soundio_get_output_device(soundio, 0);
+    assert(device->format_count == 4);
+    assert(device->formats[0] == SoundIoFormatS24PackedLE);
+    assert(device->formats[3] == SoundIoFormatU24PackedBE);
+    soundio_device_unref(device);
+    device = soundio_get_output_device(soundio, 1);
+    assert(device->format_count == 22);
+    assert(device->formats[21] == SoundIoFormatFloat64BE);
+    soundio_device_unref(device);
+    for (packed_index = 0; packed_index < 4; packed_index += 1) {
+        struct SoundIoOutStream *outstream = create_dummy_outstream(soundio, packed_write_callback,
+                packed_setup_outstream);
+        ok_or_panic(soundio_outstream_open(outstream));
+        assert(outstream->bytes_per_sample == 3);
+        SOUNDIO_ATOMIC_STORE(packed_frames, 0);
+        ok_or_panic(soundio_outstream_start(outstream));
+        wait_for_frames(&packed_frames, 4800);
+        soundio_outstream_destroy(outstream);
+    }
+    soundio_destroy(soundio);
+}
+
 struct Test {
     const char *name;
     void (*fn)(void);
@@ -223,6 +3010,44 @@ static struct Test tests[] = {
     {"soundio_device_nearest_sample_rate", test_nearest_sample_rate},
     {"ring buffer basic", test_ring_buffer_basic},
     {"ring buffer threaded", test_ring_buffer_threaded},
+    {"ring buffer reserve/commit", test_ring_buffer_reserve_commit},
+    {"ring buffer throughput", test_ring_buffer_throughput},
+    {"ring buffer create/destroy", test_ring_buffer_create_speed},
+    {"ring buffer huge pages", test_ring_buffer_huge_pages},
+    {"ring buffer large", test_ring_buffer_large},
+    {"convert values", test_convert_values},
+    {"convert simd levels", test_convert_simd_levels},
+    {"convert areas", test_convert_areas},
+    {"interleave", test_interleave},
+    {"ring buffer overwrite", test_ring_buffer_overwrite},
+    {"ring buffer overwrite threaded", test_ring_buffer_overwrite_threaded},
+    {"ring buffer wakeup", test_ring_buffer_wakeup},
+    {"mpsc ring buffer basic", test_mpsc_ring_buffer_basic},
+    {"mpsc ring buffer scaling", test_mpsc_ring_buffer_scaling},
+    {"broadcast ring buffer basic", test_broadcast_ring_buffer_basic},
+    {"broadcast ring buffer threaded", test_broadcast_ring_buffer_threaded},
+    {"outstream page faults", test_outstream_page_faults},
+    {"native float streams", test_native_float_streams},
+    {"resampler", test_resampler},
+    {"resampled streams", test_resampled_streams},
+    {"bridge control", test_bridge_control},
+    {"bridge", test_bridge},
+    {"remix matrix", test_remix_matrix},
+    {"remix simd levels", test_remix_simd_levels},
+    {"remixed streams", test_remixed_streams},
+    {"volume", test_volume},
+    {"outstream software volume", test_outstream_software_volume},
+    {"dither", test_dither},
+    {"dithered streams", test_dithered_streams},
+    {"meter", test_meter},
+    {"meter threaded", test_meter_threaded},
+    {"metered streams", test_metered_streams},
+    {"dummy instream clock", test_dummy_instream_clock},
+    {"dummy freewheel", test_dummy_freewheel},
+    {"dummy loopback", test_dummy_loopback},
+    {"dummy faults", test_dummy_faults},
+    {"dummy shared timer", test_dummy_shared_timer},
+    {"dummy devices", test_dummy_devices},
     {NULL, NULL},
 };
 